@@ -32,7 +32,12 @@
 #include <ctype.h>
 #include "cJSON.h"
 
+/* Parse error of the calling thread, so threads can parse concurrently. */
+#if defined(__GNUC__) || defined(__clang__)
+static __thread const char *ep;
+#else
 static const char *ep;
+#endif
 
 const char *cJSON_GetErrorPtr(void) {return ep;}
 
@@ -109,7 +114,10 @@ static const char *parse_number(cJSON *item,const char *num)
 	n=sign*n*pow(10.0,(scale+subscale*signsubscale));	/* number = +/- number.fraction * 10^+/- exponent */
 	
 	item->valuedouble=n;
-	item->valueint=(int)n;
+	/* saturate like later cJSON, (int) of a double out of range is undefined */
+	if (n>=INT_MAX) item->valueint=INT_MAX;
+	else if (n<=INT_MIN) item->valueint=INT_MIN;
+	else item->valueint=(int)n;
 	item->type=cJSON_Number;
 	return num;
 }
@@ -47,7 +47,8 @@ LOCAL_SRC_FILES :=		\
                     jmemnobs.c  \
                     jquant1.c   \
                     jquant2.c   \
-                    jutils.c    
+                    jutils.c    \
+                    transupp.c  
                                     
 LOCAL_MODULE := libjpeg
 
@@ -15,14 +15,39 @@ LOCAL_C_INCLUDES := $(LOCAL_PATH)/../libpng-1.6.17 \
 LOCAL_SRC_FILES := imgsdk.c \
 				   chrbuf.c	\
 				   eftcmd.c	\
+				   eftplan.c \
+				   plancache.c \
+				   resample.c \
+				   rotate.c \
+				   roidec.c \
+				   parallel.c \
+				   skin.c \
+				   eye.c \
+				   convolve.c \
+				   lut3d.c \
+				   lutcache.c \
+				   texpool.c \
+				   tiler.c \
+				   progcache.c \
+				   pointop.c \
+				   logger.c \
+				   stats.c \
+				   trace.c \
+				   platform_android.c \
 				   android_main.c \
 				   NativeImageSdk.c \
 				   jniHelper.c  \
+				   imgdec.c \
+				   batch.c \
+				   pipeline.c \
+				   spscq.c \
                    utility.c
 				   					
 # Must enable when BUILD_EXECUTABLE
 # And disable when BUILD_SHARED_LIBRARY
 #LOCAL_CFLAGS	+= -pie -fPIE
+# console.c is the main() of BUILD_EXECUTABLE
+#LOCAL_SRC_FILES += console.c
 
 LOCAL_LDLIBS	:= -llog -lGLESv2 -lEGL -landroid -lz
 
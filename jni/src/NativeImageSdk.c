@@ -4,12 +4,14 @@
  *
  *******************************/
 
+#include <malloc.h>
 #include <pthread.h>
 #include <stdint.h>
 #include <sys/types.h>
 #include <android/asset_manager_jni.h>
 #include <android/native_window_jni.h>
 #include "NativeImageSdk.h"
+#include "batch.h"
 #include "imgsdk.h"
 #include "jniHelper.h"
 #include "utility.h"
@@ -28,8 +30,7 @@ jlong JNICALL Java_org_imgsdk_core_NativeImageSdk_initSDK
 		return 0;
 	}
 
-	Log("initSDK pthread self:%lx\n", pthread_self() );
-	Log("initSDK pthread gettid:%x\n", gettid() );
+	LogThread("initSDK");
 
 	jclass cls = (*env)->GetObjectClass(env, jcontext);
 	jmethodID mid = (*env)->GetMethodID(env, cls, 
@@ -79,8 +80,7 @@ jlong JNICALL Java_org_imgsdk_core_NativeImageSdk_initRenderSDK
 		return 0;
 	}
 
-	Log("initRenderSDK pthread_self:%lx\n", pthread_self() );
-	Log("initRenderSDK gettid:%x\n", gettid() );
+	LogThread("initRenderSDK");
 
 	jclass cls = (*env)->GetObjectClass(env, jcontext);
 	jmethodID mid = (*env)->GetMethodID(env, cls, 
@@ -143,8 +143,7 @@ void JNICALL Java_org_imgsdk_core_NativeImageSdk_freeSDK
 {
 	LOG_ENTRY;
 
-	Log("freeSDK pthread self:%lx\n", pthread_self() );
-	Log("freeSDK gettid:%x\n", gettid() );
+	LogThread("freeSDK");
 
     SdkEnv *sdk = (SdkEnv *)((intptr_t) ptr);
     if (NULL != sdk) {
@@ -179,7 +178,7 @@ JNIEXPORT void JNICALL Java_org_imgsdk_core_NativeImageSdk_setInputPath
         return;
     }
 
-	Log("input path:%s\n", path);
+	LogD("input path:%s\n", path);
 	setInputImagePath(sdk, path);
 
 	LOG_EXIT;
@@ -211,7 +210,7 @@ JNIEXPORT void JNICALL Java_org_imgsdk_core_NativeImageSdk_setOutputPath
         return;
     }
 
-    Log("output path:%s\n", path);
+    LogD("output path:%s\n", path);
 	setOutputImagePath(sdk, path);
 
 	LOG_EXIT;
@@ -237,16 +236,13 @@ void JNICALL Java_org_imgsdk_core_NativeImageSdk_setEffectCmd
 		return;
 	}
 
-	Log("setEffectCmd pthread self:%lx\n", pthread_self() );
-	Log("setEffectCmd gettid:%x\n", gettid() );
-
 	char *cmd = jstring2string(env, jcommand);
     if (NULL == cmd) {
         LogE("Effect cmd is NULL\n");
         return;
     }
 
-    Log("EffectCmd = %s\n", cmd);
+    LogD("EffectCmd = %s\n", cmd);
 	setEffectCmd (sdk, cmd);
 
 	LOG_EXIT;
@@ -267,9 +263,6 @@ void JNICALL Java_org_imgsdk_core_NativeImageSdk_executeCmd
 		return;
 	}
 
-	Log("executeCmd pthread self:%lx\n", pthread_self() );
-	Log("executeCmd gettid :%x\n", gettid() );
-
 	swapEglBuffers(sdk);
     onSdkDraw (sdk);
 
@@ -287,7 +280,7 @@ void JNICALL Java_org_imgsdk_core_NativeImageSdk_executeCmd
 		}
 
 		char *path = getOutputImagePath(sdk);
-		Log("output path:%s\n", path);
+		LogD("output path:%s\n", path);
 		jstring jpath = NULL;
 		if (NULL != path) {
 			jpath = string2jstring(env, path);
@@ -301,6 +294,128 @@ void JNICALL Java_org_imgsdk_core_NativeImageSdk_executeCmd
 	LOG_EXIT;
 }
 
+/*
+ * Get the i-th string of a java String[] as char*
+ * Return:
+ *		NULL if array is NULL or element is NULL
+ */
+static char* getStringElement(JNIEnv *env, jobjectArray jarr, int i)
+{
+	if (NULL == jarr) {
+		return NULL;
+	}
+	jstring jstr = (jstring)(*env)->GetObjectArrayElement(env, jarr, i);
+	if (NULL == jstr) {
+		return NULL;
+	}
+	char *str = jstring2string(env, jstr);
+	(*env)->DeleteLocalRef(env, jstr);
+	return str;
+}
+
+/*
+ * Class:     org_imgsdk_core_NativeImageSdk
+ * Method:    executeBatch
+ * Signature: (J[Ljava/lang/String;[Ljava/lang/String;[Ljava/lang/String;)[I
+ */
+jintArray JNICALL Java_org_imgsdk_core_NativeImageSdk_executeBatch
+  (JNIEnv *env, jobject thiz, jlong ptr, jobjectArray jinputs, jobjectArray joutputs, jobjectArray jcmds)
+{
+	LOG_ENTRY;
+	SdkEnv *sdk = (SdkEnv *) ((intptr_t) ptr);
+	if (NULL == sdk || NULL == jinputs || NULL == joutputs) {
+		LogE("NULL pointer exception\n");
+		return NULL;
+	}
+
+	jsize count = (*env)->GetArrayLength(env, jinputs);
+	if ((*env)->GetArrayLength(env, joutputs) != count ||
+			(NULL != jcmds && (*env)->GetArrayLength(env, jcmds) != count)) {
+		LogE("inputs, outputs and cmds must have the same length\n");
+		return NULL;
+	}
+
+	BatchJob_t *jobs = (BatchJob_t *)calloc(count, sizeof(BatchJob_t));
+	jint *results = (jint *)calloc(count, sizeof(jint));
+	if (NULL == jobs || NULL == results) {
+		LogE("Failed calloc batch jobs\n");
+		free(jobs);
+		free(results);
+		return NULL;
+	}
+
+	int i;
+	bool valid = true;
+	for (i = 0; i < count; ++i) {
+		jobs[i].inputPath = getStringElement(env, jinputs, i);
+		jobs[i].outputPath = getStringElement(env, joutputs, i);
+		jobs[i].effectCmd = getStringElement(env, jcmds, i);
+		if (NULL == jobs[i].inputPath || NULL == jobs[i].outputPath) {
+			valid = false;
+		}
+	}
+
+	if (valid) {
+		runBatch(sdk, jobs, count);
+	} else {
+		LogE("NULL path in batch\n");
+	}
+
+	for (i = 0; i < count; ++i) {
+		results[i] = valid ? jobs[i].result : -1;
+		free((char *)jobs[i].inputPath);
+		free((char *)jobs[i].outputPath);
+		free((char *)jobs[i].effectCmd);
+	}
+	free(jobs);
+
+	jintArray jresults = (*env)->NewIntArray(env, count);
+	if (NULL != jresults) {
+		(*env)->SetIntArrayRegion(env, jresults, 0, count, results);
+	}
+	free(results);
+
+	LOG_EXIT;
+	return jresults;
+}
+
+/*
+ * Class:     org_imgsdk_core_NativeImageSdk
+ * Method:    getStats
+ * Signature: (J)Ljava/lang/String;
+ */
+jstring JNICALL Java_org_imgsdk_core_NativeImageSdk_getStats
+  (JNIEnv *env, jobject thiz, jlong ptr)
+{
+	SdkEnv *sdk = (SdkEnv *) ((intptr_t) ptr);
+	if (NULL == sdk) {
+		LogE("NULL pointer exception\n");
+		return NULL;
+	}
+
+	char json[STATS_JSON_SIZE];
+	if (formatStats(getSdkStats(sdk), json, sizeof(json)) < 0) {
+		LogE("Failed formatStats\n");
+		return NULL;
+	}
+	return (*env)->NewStringUTF(env, json);
+}
+
+/*
+ * Class:     org_imgsdk_core_NativeImageSdk
+ * Method:    resetStats
+ * Signature: (J)V
+ */
+void JNICALL Java_org_imgsdk_core_NativeImageSdk_resetStats
+  (JNIEnv *env, jobject thiz, jlong ptr)
+{
+	SdkEnv *sdk = (SdkEnv *) ((intptr_t) ptr);
+	if (NULL == sdk) {
+		LogE("NULL pointer exception\n");
+		return;
+	}
+	resetStats(getSdkStats(sdk));
+}
 
 /***
  * I am hesitated about how to register native methods;
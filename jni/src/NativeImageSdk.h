@@ -64,6 +64,30 @@ JNIEXPORT void JNICALL Java_org_imgsdk_core_NativeImageSdk_setEffectCmd
 JNIEXPORT void JNICALL Java_org_imgsdk_core_NativeImageSdk_executeCmd
   (JNIEnv *, jobject, jlong, jobject jlistener, jobject jparam);
 
+/*
+ * Class:     org_imgsdk_core_NativeImageSdk
+ * Method:    executeBatch
+ * Signature: (J[Ljava/lang/String;[Ljava/lang/String;[Ljava/lang/String;)[I
+ */
+JNIEXPORT jintArray JNICALL Java_org_imgsdk_core_NativeImageSdk_executeBatch
+  (JNIEnv *, jobject, jlong, jobjectArray, jobjectArray, jobjectArray);
+
+/*
+ * Class:     org_imgsdk_core_NativeImageSdk
+ * Method:    getStats
+ * Signature: (J)Ljava/lang/String;
+ */
+JNIEXPORT jstring JNICALL Java_org_imgsdk_core_NativeImageSdk_getStats
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     org_imgsdk_core_NativeImageSdk
+ * Method:    resetStats
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_org_imgsdk_core_NativeImageSdk_resetStats
+  (JNIEnv *, jobject, jlong);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,26 @@
+/***************************************
+ * file name:   batch.c
+ * description: implement batch processing
+ *				decode thread -> caller (GL) thread -> encode thread
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include "batch.h"
+#include "pipeline.h"
+
+// how many images may wait between two stages
+#define BATCH_DEPTH 2
+
+/**
+ * Run jobs through an off-screen SdkEnv.
+ * Return:
+ *		>= 0 count of jobs succeed
+ *		  -1 ERROR
+ */
+int runBatch (SdkEnv *env, BatchJob_t *jobs, int count)
+{
+	PipelineOpt_t opt = { 1, 1, BATCH_DEPTH };
+	return runPipeline (env, jobs, count, &opt);
+}
@@ -0,0 +1,39 @@
+/************************************
+ * file name:   batch.h
+ * description: process many images through one SdkEnv
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __BATCH__H__
+#define __BATCH__H__
+
+#include "imgsdk.h"
+
+/**
+ * One image of batch
+ */
+typedef struct {
+	const char	*inputPath;		// input image path
+	const char	*outputPath;	// output image path
+	const char	*effectCmd;		// effect command, NULL means the last one
+	int			result;			// [OUT] 0 OK, -1 ERROR
+} BatchJob_t;
+
+/**
+ * Run jobs through an off-screen SdkEnv.
+ * The image N+1 is decoded and the image N-1 is encoded on worker
+ * threads while the image N is processed on the caller's thread,
+ * which must own the EGL context of env.
+ * Parameters:
+ *		env:	off-screen sdk context
+ *		jobs:	[IN/OUT] jobs, result is filled
+ *		count:	job count
+ * Return:
+ *		>= 0 count of jobs succeed
+ *		  -1 ERROR
+ */
+int runBatch (SdkEnv *env, BatchJob_t *jobs, int count);
+
+#endif
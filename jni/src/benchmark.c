@@ -0,0 +1,762 @@
+/***************************************
+ * file name:   benchmark.c
+ * description: benchmark of codecs & effects on a synthetic corpus
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ * Usage:
+ *		imgbench [-d dir] [-o result.json] [-n iterations]
+ *				 [-m max megapixels] [-f filter] [-t trace.json] [-r]
+ * Notice:
+ *	1. The corpus is generated into dir on the first run, the same
+ *	   bytes on every host, -r generates it again
+ *	2. Every case runs once to warm up, then iterations times
+ *	3. Only cases whose name contains filter run
+ *	4. -t traces the whole run, later spans of a thread are dropped
+ *	   once its buffer is full, so trace with -f & a small -n
+ *
+ ***************************************/
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cJSON.h"
+#include "eftplan.h"
+#include "eye.h"
+#include "imgsdk.h"
+#include "jpeglib.h"
+#include "lutcache.h"
+#include "png.h"
+
+#define DEFAULT_DIR			"bench_corpus"
+#define DEFAULT_ITERATIONS	5
+#define DEFAULT_MAX_MP		50
+#define CORPUS_SEED			0x1d872b41u
+#define CUBE_SIZE			33
+
+/**
+ * Allocations are counted by wrapping glibc's allocator
+ */
+#ifdef __GLIBC__
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t n, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+static uint64_t sAllocs;
+static uint64_t sAllocBytes;
+
+void *malloc (size_t size) {
+	__atomic_fetch_add (&sAllocs, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add (&sAllocBytes, size, __ATOMIC_RELAXED);
+	return __libc_malloc (size);
+}
+
+void *calloc (size_t n, size_t size) {
+	__atomic_fetch_add (&sAllocs, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add (&sAllocBytes, n * size, __ATOMIC_RELAXED);
+	return __libc_calloc (n, size);
+}
+
+void *realloc (void *ptr, size_t size) {
+	__atomic_fetch_add (&sAllocs, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add (&sAllocBytes, size, __ATOMIC_RELAXED);
+	return __libc_realloc (ptr, size);
+}
+#define ALLOCS_COUNTED true
+#else
+static uint64_t sAllocs;
+static uint64_t sAllocBytes;
+#define ALLOCS_COUNTED false
+#endif
+
+/**
+ * Image sizes of corpus, 64K to 50 MP
+ */
+static const struct {
+	int width;
+	int height;
+} sSizes[] = {
+	{  256,  256 },
+	{ 1024, 1024 },
+	{ 2048, 1536 },
+	{ 4000, 3000 },
+	{ 8160, 6120 },
+};
+
+typedef enum {
+	JPEG_BASELINE = 0,
+	JPEG_PROGRESSIVE,
+	JPEG_RESTART,		// restart marker every MCU row
+	PNG_PLAIN,
+	PNG_INTERLACED,		// Adam7
+} Variant_e;
+
+static const char *sVariantNames[] = {
+	"baseline", "progressive", "restart", "plain", "interlaced"
+};
+
+/**
+ * Effects measured, %d are filled by width & height in format
+ */
+static const struct {
+	const char *name;
+	const char *format;
+} sEffects[] = {
+	{ "Gray",		"{\"effect\":\"Gray\"}" },
+	{ "Rotate90",	"{\"effect\":\"Rotate\",\"degree\":90}" },
+	{ "Rotate30",	"{\"effect\":\"Rotate\",\"degree\":30}" },
+	{ "Scale50",	"{\"effect\":\"Scale\",\"percent\":50}" },
+	{ "Clip",		"{\"effect\":\"Clip\",\"param\":{\"x\":%d,\"y\":%d,\"w\":%d,\"h\":%d}}" },
+	{ "Skin",		"{\"effect\":\"Skin\"}" },
+	{ "Eye",		"{\"effect\":\"Eye\",\"eyes\":[{\"x\":%d,\"y\":%d,\"r\":%d}]}" },
+	{ "Blur",		"{\"effect\":\"Blur\",\"sigma\":3}" },
+	{ "BoxBlur",	"{\"effect\":\"BoxBlur\",\"radius\":5}" },
+	{ "Sharpen",	"{\"effect\":\"Sharpen\",\"amount\":50}" },
+	{ "Unsharp",	"{\"effect\":\"Unsharp\",\"sigma\":2,\"amount\":120,\"threshold\":4}" },
+	{ "Lut",		"{\"effect\":\"Lut\",\"path\":\"%s\",\"intensity\":80}" },
+	{ "Brightness",	"{\"effect\":\"Brightness\",\"amount\":20}" },
+	{ "Contrast",	"{\"effect\":\"Contrast\",\"amount\":30}" },
+	{ "Gamma",		"{\"effect\":\"Gamma\",\"gamma\":1.8}" },
+	{ "Curves",		"{\"effect\":\"Curves\",\"points\":[[0,10],[64,50],[192,210],[255,245]]}" },
+};
+
+typedef struct {
+	const char	*dir;
+	const char	*output;
+	const char	*filter;
+	const char	*trace;
+	int			iterations;
+	int			maxMp;
+	bool		regenerate;
+} BenchOpt_t;
+
+/**
+ * One measured case, see runCase
+ */
+typedef struct {
+	char		name[128];
+	const char	*op;
+	PixForm_e	form;
+	int			width;
+	int			height;
+	const char	*variant;		// codec variant or effect name
+	long		fileBytes;		// size of encoded file, 0 for effects
+} BenchCase_t;
+
+typedef int (*CaseFunc) (void *arg);
+
+static const char* formName (PixForm_e form) {
+	return GRAY == form ? "gray" : (RGB24 == form ? "rgb" : "rgba");
+}
+
+/**
+ * Integer hash, so the corpus is the same on every host
+ */
+static uint32_t hash32 (uint32_t x) {
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+/**
+ * Photo-like content: gradients, hard edges & fine noise
+ */
+static void fillSynthetic (Bitmap_t *img) {
+	int w = img->width;
+	int h = img->height;
+	int x, y, c;
+	for (y = 0; y < h; ++y) {
+		uint8_t *p = (uint8_t *)img->base + (size_t)y * w * img->form;
+		for (x = 0; x < w; ++x, p += img->form) {
+			uint32_t noise = hash32 (CORPUS_SEED ^ (uint32_t)(y * w + x));
+			int block = ((x * 16 / w) ^ (y * 12 / h)) & 3;
+			for (c = 0; c < img->form && c < 3; ++c) {
+				int v = (c == 0 ? x * 255 / w : (c == 1 ? y * 255 / h : (x + y) * 255 / (w + h)));
+				v = (v * 3 + block * 48) / 4 + (int)((noise >> (8 * c)) & 15) - 8;
+				p[c] = v < 0 ? 0 : (v > 255 ? 255 : v);
+			}
+			if (RGBA32 == img->form) {
+				p[3] = 255 - (x * 64 / w);
+			}
+		}
+	}
+}
+
+static int newSynthetic (int width, int height, PixForm_e form, Bitmap_t *img) {
+	img->width = width;
+	img->height = height;
+	img->form = form;
+	img->base = (char *)malloc ((size_t)width * height * form);
+	if (NULL == img->base) {
+		LogE ("Failed malloc %dx%d image\n", width, height);
+		return -1;
+	}
+	fillSynthetic (img);
+	return 0;
+}
+
+static int writeCorpusJpeg (const char *path, const Bitmap_t *img, Variant_e variant) {
+	FILE *fp = fopen (path, "wb");
+	if (NULL == fp) {
+		LogE ("Failed open %s\n", path);
+		return -1;
+	}
+
+	struct jpeg_compress_struct jcs;
+	struct jpeg_error_mgr jerr;
+	jcs.err = jpeg_std_error (&jerr);
+	jpeg_create_compress (&jcs);
+	jpeg_stdio_dest (&jcs, fp);
+	jcs.image_width = img->width;
+	jcs.image_height = img->height;
+	jcs.input_components = img->form;
+	jcs.in_color_space = GRAY == img->form ? JCS_GRAYSCALE : JCS_RGB;
+	jpeg_set_defaults (&jcs);
+	jpeg_set_quality (&jcs, 85, TRUE);
+	if (JPEG_PROGRESSIVE == variant) {
+		jpeg_simple_progression (&jcs);
+	} else if (JPEG_RESTART == variant) {
+		jcs.restart_in_rows = 1;
+	}
+
+	jpeg_start_compress (&jcs, TRUE);
+	int stride = img->width * img->form;
+	while (jcs.next_scanline < jcs.image_height) {
+		JSAMPROW row = (JSAMPROW)(img->base + (size_t)jcs.next_scanline * stride);
+		jpeg_write_scanlines (&jcs, &row, 1);
+	}
+	jpeg_finish_compress (&jcs);
+	jpeg_destroy_compress (&jcs);
+	fclose (fp);
+	return 0;
+}
+
+static int writeCorpusPng (const char *path, const Bitmap_t *img, Variant_e variant) {
+	FILE *fp = fopen (path, "wb");
+	if (NULL == fp) {
+		LogE ("Failed open %s\n", path);
+		return -1;
+	}
+
+	png_structp png = png_create_write_struct (PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop info = NULL == png ? NULL : png_create_info_struct (png);
+	if (NULL == info || setjmp (png_jmpbuf (png))) {
+		LogE ("Failed write %s\n", path);
+		png_destroy_write_struct (&png, &info);
+		fclose (fp);
+		return -1;
+	}
+
+	int colorType = GRAY == img->form ? PNG_COLOR_TYPE_GRAY :
+		(RGB24 == img->form ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_RGB_ALPHA);
+	png_init_io (png, fp);
+	png_set_IHDR (png, info, img->width, img->height, 8, colorType,
+			PNG_INTERLACED == variant ? PNG_INTERLACE_ADAM7 : PNG_INTERLACE_NONE,
+			PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info (png, info);
+
+	// interlaced images need every row at once
+	int passes = png_set_interlace_handling (png);
+	int stride = img->width * img->form;
+	int pass, y;
+	for (pass = 0; pass < passes; ++pass) {
+		for (y = 0; y < img->height; ++y) {
+			png_write_row (png, (png_bytep)img->base + (size_t)y * stride);
+		}
+	}
+	png_write_end (png, info);
+	png_destroy_write_struct (&png, &info);
+	fclose (fp);
+	return 0;
+}
+
+static void corpusPath (const BenchOpt_t *opt, int width, int height, PixForm_e form,
+		Variant_e variant, char *path, int size) {
+	snprintf (path, size, "%s/%s_%dx%d_%s.%s", opt->dir, formName (form), width, height,
+			sVariantNames[variant], variant >= PNG_PLAIN ? "png" : "jpg");
+}
+
+static bool fileExists (const char *path) {
+	struct stat st;
+	return 0 == stat (path, &st);
+}
+
+static long fileSize (const char *path) {
+	struct stat st;
+	return 0 == stat (path, &st) ? (long)st.st_size : -1;
+}
+
+/**
+ * Write a 3D LUT of a fixed color grade
+ */
+static int writeCorpusCube (const char *path) {
+	FILE *fp = fopen (path, "w");
+	if (NULL == fp) {
+		LogE ("Failed open %s\n", path);
+		return -1;
+	}
+	fprintf (fp, "TITLE \"imgbench\"\nLUT_3D_SIZE %d\n", CUBE_SIZE);
+	int r, g, b;
+	for (b = 0; b < CUBE_SIZE; ++b) {
+		for (g = 0; g < CUBE_SIZE; ++g) {
+			for (r = 0; r < CUBE_SIZE; ++r) {
+				float fr = r / (CUBE_SIZE - 1.0f);
+				float fg = g / (CUBE_SIZE - 1.0f);
+				float fb = b / (CUBE_SIZE - 1.0f);
+				fprintf (fp, "%.6f %.6f %.6f\n", fr * 0.9f + 0.05f,
+						fg * fg * 0.5f + fg * 0.5f, fb * 0.8f + fr * 0.1f);
+			}
+		}
+	}
+	fclose (fp);
+	return 0;
+}
+
+/**
+ * Generate missing corpus files
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+static int prepareCorpus (const BenchOpt_t *opt) {
+	if (mkdir (opt->dir, 0755) < 0 && EEXIST != errno) {
+		LogE ("Failed mkdir %s\n", opt->dir);
+		return -1;
+	}
+
+	char path[512];
+	snprintf (path, sizeof(path), "%s/grade.cube", opt->dir);
+	if ((opt->regenerate || !fileExists (path)) && writeCorpusCube (path) < 0) {
+		return -1;
+	}
+
+	static const PixForm_e forms[] = { GRAY, RGB24, RGBA32 };
+	int i, f, v;
+	for (i = 0; i < (int)(sizeof(sSizes) / sizeof(sSizes[0])); ++i) {
+		int width = sSizes[i].width;
+		int height = sSizes[i].height;
+		if ((double)width * height > opt->maxMp * 1e6) {
+			continue;
+		}
+		for (f = 0; f < 3; ++f) {
+			Bitmap_t img = { 0 };
+			for (v = JPEG_BASELINE; v <= PNG_INTERLACED; ++v) {
+				// JPEG has no alpha
+				if (RGBA32 == forms[f] && v < PNG_PLAIN) {
+					continue;
+				}
+				corpusPath (opt, width, height, forms[f], v, path, sizeof(path));
+				if (!opt->regenerate && fileExists (path)) {
+					continue;
+				}
+				if (NULL == img.base && newSynthetic (width, height, forms[f], &img) < 0) {
+					return -1;
+				}
+				Log ("Generate %s\n", path);
+				int ret = v < PNG_PLAIN ? writeCorpusJpeg (path, &img, v) :
+					writeCorpusPng (path, &img, v);
+				if (ret < 0) {
+					freeBitmap (&img);
+					return -1;
+				}
+			}
+			freeBitmap (&img);
+		}
+	}
+	return 0;
+}
+
+/**
+ * Reset peak RSS of process
+ * Return:
+ *		true if VmHWM is reset
+ */
+static bool resetPeakRss (void) {
+	FILE *fp = fopen ("/proc/self/clear_refs", "w");
+	if (NULL == fp) {
+		return false;
+	}
+	bool ok = fputs ("5", fp) >= 0;
+	return 0 == fclose (fp) && ok;
+}
+
+/**
+ * Peak RSS in KB, since the last resetPeakRss if it worked
+ */
+static long getPeakRss (void) {
+	FILE *fp = fopen ("/proc/self/status", "r");
+	if (NULL != fp) {
+		char line[256];
+		long kb = -1;
+		while (NULL != fgets (line, sizeof(line), fp)) {
+			if (1 == sscanf (line, "VmHWM: %ld kB", &kb)) {
+				break;
+			}
+		}
+		fclose (fp);
+		if (kb >= 0) {
+			return kb;
+		}
+	}
+	struct rusage usage;
+	return 0 == getrusage (RUSAGE_SELF, &usage) ? usage.ru_maxrss : -1;
+}
+
+static int compareNs (const void *a, const void *b) {
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+	return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/**
+ * Nearest rank percentile of sorted samples
+ */
+static double percentileMs (const uint64_t *ns, int n, int p) {
+	int rank = (p * n + 99) / 100;
+	if (rank < 1) {
+		rank = 1;
+	}
+	return ns[rank - 1] / 1e6;
+}
+
+/**
+ * Run fn once to warm up then iterations times, add the result to cases
+ * Return:
+ *		 0 OK
+ *		-1 ERROR, fn failed
+ */
+static int runCase (const BenchOpt_t *opt, const BenchCase_t *bc, CaseFunc fn, void *arg,
+		cJSON *cases) {
+	if (NULL != opt->filter && NULL == strstr (bc->name, opt->filter)) {
+		return 0;
+	}
+
+	bool rssReset = resetPeakRss ();
+	if (fn (arg) < 0) {
+		LogE ("Failed %s\n", bc->name);
+		return -1;
+	}
+
+	int n = opt->iterations;
+	uint64_t *ns = (uint64_t *)malloc (n * sizeof(uint64_t));
+	if (NULL == ns) {
+		return -1;
+	}
+	uint64_t allocs = __atomic_load_n (&sAllocs, __ATOMIC_RELAXED);
+	uint64_t allocBytes = __atomic_load_n (&sAllocBytes, __ATOMIC_RELAXED);
+	int i;
+	for (i = 0; i < n; ++i) {
+		uint64_t begin_ns = getNanoTime ();
+		if (fn (arg) < 0) {
+			LogE ("Failed %s\n", bc->name);
+			free (ns);
+			return -1;
+		}
+		ns[i] = getNanoTime () - begin_ns;
+	}
+	allocs = __atomic_load_n (&sAllocs, __ATOMIC_RELAXED) - allocs;
+	allocBytes = __atomic_load_n (&sAllocBytes, __ATOMIC_RELAXED) - allocBytes;
+	long peakRss = getPeakRss ();
+
+	qsort (ns, n, sizeof(uint64_t), compareNs);
+	double total = 0;
+	for (i = 0; i < n; ++i) {
+		total += ns[i];
+	}
+	double mp = (double)bc->width * bc->height / 1e6;
+	double p50 = percentileMs (ns, n, 50);
+
+	cJSON *jcase = cJSON_CreateObject ();
+	cJSON_AddStringToObject (jcase, "name", bc->name);
+	cJSON_AddStringToObject (jcase, "op", bc->op);
+	cJSON_AddStringToObject (jcase, "form", formName (bc->form));
+	cJSON_AddStringToObject (jcase, "variant", bc->variant);
+	cJSON_AddNumberToObject (jcase, "width", bc->width);
+	cJSON_AddNumberToObject (jcase, "height", bc->height);
+	cJSON_AddNumberToObject (jcase, "megapixels", mp);
+	if (bc->fileBytes > 0) {
+		cJSON_AddNumberToObject (jcase, "fileBytes", bc->fileBytes);
+	}
+	cJSON_AddNumberToObject (jcase, "iterations", n);
+	cJSON_AddNumberToObject (jcase, "minMs", ns[0] / 1e6);
+	cJSON_AddNumberToObject (jcase, "p50Ms", p50);
+	cJSON_AddNumberToObject (jcase, "p90Ms", percentileMs (ns, n, 90));
+	cJSON_AddNumberToObject (jcase, "p99Ms", percentileMs (ns, n, 99));
+	cJSON_AddNumberToObject (jcase, "maxMs", ns[n - 1] / 1e6);
+	cJSON_AddNumberToObject (jcase, "meanMs", total / n / 1e6);
+	cJSON_AddNumberToObject (jcase, "mpPerSec", p50 > 0 ? mp * 1000 / p50 : 0);
+	cJSON_AddNumberToObject (jcase, "peakRssKB", peakRss);
+	cJSON_AddItemToObject (jcase, "peakRssOfCase", rssReset ? cJSON_CreateTrue () : cJSON_CreateFalse ());
+	if (ALLOCS_COUNTED) {
+		cJSON_AddNumberToObject (jcase, "allocs", (double)allocs / n);
+		cJSON_AddNumberToObject (jcase, "allocBytes", (double)allocBytes / n);
+	}
+	cJSON_AddItemToArray (cases, jcase);
+
+	printf ("%-48s %9.2f ms p50 %9.2f ms p99 %8.1f MP/s %8ld KB %8.0f allocs\n",
+			bc->name, p50, percentileMs (ns, n, 99), p50 > 0 ? mp * 1000 / p50 : 0,
+			peakRss, (double)allocs / n);
+	free (ns);
+	return 0;
+}
+
+/**
+ * Add a case that can't run to cases, e.g. RGBA of JPEG
+ */
+static void skipCase (const BenchOpt_t *opt, const BenchCase_t *bc, const char *reason,
+		cJSON *cases) {
+	if (NULL != opt->filter && NULL == strstr (bc->name, opt->filter)) {
+		return;
+	}
+	cJSON *jcase = cJSON_CreateObject ();
+	cJSON_AddStringToObject (jcase, "name", bc->name);
+	cJSON_AddStringToObject (jcase, "op", bc->op);
+	cJSON_AddStringToObject (jcase, "form", formName (bc->form));
+	cJSON_AddStringToObject (jcase, "variant", bc->variant);
+	cJSON_AddNumberToObject (jcase, "width", bc->width);
+	cJSON_AddNumberToObject (jcase, "height", bc->height);
+	cJSON_AddStringToObject (jcase, "unsupported", reason);
+	cJSON_AddItemToArray (cases, jcase);
+
+	printf ("%-48s unsupported: %s\n", bc->name, reason);
+}
+
+typedef struct {
+	const char	*path;
+	Bitmap_t	*img;
+	bool		png;
+} CodecArg_t;
+
+static int decodeCase (void *arg) {
+	CodecArg_t *ca = (CodecArg_t *)arg;
+	freeBitmap (ca->img);
+	return ca->png ? read_png (ca->path, ca->img) : read_jpeg (ca->path, ca->img);
+}
+
+static int encodeCase (void *arg) {
+	CodecArg_t *ca = (CodecArg_t *)arg;
+	return ca->png ? write_png (ca->path, ca->img) : write_jpeg (ca->path, ca->img);
+}
+
+typedef struct {
+	const EftPlan_t	*plan;
+	LutCache		*luts;
+	const Bitmap_t	*src;
+	Bitmap_t		dst;
+} EffectArg_t;
+
+static int effectCase (void *arg) {
+	EffectArg_t *ea = (EffectArg_t *)arg;
+	return runEffectPlan (ea->plan, ea->luts, ea->src, false, &ea->dst) < 0 ? -1 : 0;
+}
+
+/**
+ * read_jpeg & read_png of every corpus file, write_jpeg & write_png of
+ * synthetic images of every form. RGBA JPEG can't be read, it's listed
+ * as unsupported
+ */
+static int benchCodecs (const BenchOpt_t *opt, cJSON *cases) {
+	static const PixForm_e forms[] = { GRAY, RGB24, RGBA32 };
+	char path[512];
+	char outPath[512];
+	int i, f, v;
+	for (i = 0; i < (int)(sizeof(sSizes) / sizeof(sSizes[0])); ++i) {
+		int width = sSizes[i].width;
+		int height = sSizes[i].height;
+		if ((double)width * height > opt->maxMp * 1e6) {
+			continue;
+		}
+		for (f = 0; f < 3; ++f) {
+			Bitmap_t img = { 0 };
+			for (v = JPEG_BASELINE; v <= PNG_INTERLACED; ++v) {
+				bool png = v >= PNG_PLAIN;
+				BenchCase_t bc = { "", png ? "read_png" : "read_jpeg", forms[f],
+					width, height, sVariantNames[v], 0 };
+				snprintf (bc.name, sizeof(bc.name), "%s/%s/%dx%d/%s", bc.op,
+						formName (forms[f]), width, height, bc.variant);
+				if (RGBA32 == forms[f] && !png) {
+					skipCase (opt, &bc, "JPEG has no alpha", cases);
+					continue;
+				}
+				corpusPath (opt, width, height, forms[f], v, path, sizeof(path));
+				bc.fileBytes = fileSize (path);
+				CodecArg_t ca = { path, &img, png };
+				if (runCase (opt, &bc, decodeCase, &ca, cases) < 0) {
+					freeBitmap (&img);
+					return -1;
+				}
+			}
+
+			// encode from the synthetic image, not depending on decoders
+			if (newSynthetic (width, height, forms[f], &img) < 0) {
+				return -1;
+			}
+			for (v = 0; v < 2; ++v) {
+				bool png = 1 == v;
+				BenchCase_t bc = { "", png ? "write_png" : "write_jpeg", forms[f],
+					width, height, "default", 0 };
+				snprintf (bc.name, sizeof(bc.name), "%s/%s/%dx%d", bc.op,
+						formName (forms[f]), width, height);
+				snprintf (outPath, sizeof(outPath), "%s/out.%s", opt->dir, png ? "png" : "jpg");
+				CodecArg_t ca = { outPath, &img, png };
+				int ret = runCase (opt, &bc, encodeCase, &ca, cases);
+				remove (outPath);
+				if (ret < 0) {
+					freeBitmap (&img);
+					return -1;
+				}
+			}
+			freeBitmap (&img);
+		}
+	}
+	return 0;
+}
+
+/**
+ * Every effect on RGB & RGBA images of every size
+ */
+static int benchEffects (const BenchOpt_t *opt, cJSON *cases) {
+	static EftPlan_t plan;
+	static const PixForm_e forms[] = { RGB24, RGBA32 };
+	char cube[512];
+	char cmd[1024];
+	snprintf (cube, sizeof(cube), "%s/grade.cube", opt->dir);
+
+	LutCache *luts = newLutCache (1);
+	if (NULL == luts) {
+		return -1;
+	}
+
+	int ret = 0;
+	int i, f, e;
+	for (i = 0; 0 == ret && i < (int)(sizeof(sSizes) / sizeof(sSizes[0])); ++i) {
+		int width = sSizes[i].width;
+		int height = sSizes[i].height;
+		if ((double)width * height > opt->maxMp * 1e6) {
+			continue;
+		}
+		for (f = 0; 0 == ret && f < 2; ++f) {
+			Bitmap_t img = { 0 };
+			if (newSynthetic (width, height, forms[f], &img) < 0) {
+				ret = -1;
+				break;
+			}
+			for (e = 0; 0 == ret && e < (int)(sizeof(sEffects) / sizeof(sEffects[0])); ++e) {
+				const char *name = sEffects[e].name;
+				if (strcmp (name, "Clip") == 0) {
+					snprintf (cmd, sizeof(cmd), sEffects[e].format,
+							width / 4, height / 4, width / 2, height / 2);
+				} else if (strcmp (name, "Eye") == 0) {
+					int r = (width < height ? width : height) / 8;
+					snprintf (cmd, sizeof(cmd), sEffects[e].format, width / 3, height / 2,
+							r > EYE_MAX_RADIUS ? EYE_MAX_RADIUS : r);
+				} else if (strcmp (name, "Lut") == 0) {
+					snprintf (cmd, sizeof(cmd), sEffects[e].format, cube);
+				} else {
+					snprintf (cmd, sizeof(cmd), "%s", sEffects[e].format);
+				}
+				if (parseEffectPlan (cmd, &plan) < 0) {
+					LogE ("Failed parseEffectPlan:%s\n", cmd);
+					ret = -1;
+					break;
+				}
+
+				BenchCase_t bc = { "", "effect", forms[f], width, height, name, 0 };
+				snprintf (bc.name, sizeof(bc.name), "effect/%s/%s/%dx%d", name,
+						formName (forms[f]), width, height);
+				EffectArg_t ea = { &plan, luts, &img, { 0 } };
+				ret = runCase (opt, &bc, effectCase, &ea, cases);
+				freeBitmap (&ea.dst);
+			}
+			freeBitmap (&img);
+		}
+	}
+
+	freeLutCache (luts);
+	return ret;
+}
+
+static void usage (const char *name) {
+	printf ("Usage:\n");
+	printf ("  %s [-d dir] [-o result.json] [-n iterations] [-m max megapixels] [-f filter] [-t trace.json] [-r]\n", name);
+	printf ("    -d  corpus directory, default %s\n", DEFAULT_DIR);
+	printf ("    -o  write JSON result to file\n");
+	printf ("    -n  measured iterations of every case, default %d\n", DEFAULT_ITERATIONS);
+	printf ("    -m  skip images larger than megapixels, default %d\n", DEFAULT_MAX_MP);
+	printf ("    -f  only run cases whose name contains filter, e.g. read_jpeg or /rgb/\n");
+	printf ("    -t  write Chrome trace-event JSON to file\n");
+	printf ("    -r  generate corpus again\n");
+}
+
+int main (int argc, char **argv) {
+	BenchOpt_t opt = { DEFAULT_DIR, NULL, NULL, NULL, DEFAULT_ITERATIONS, DEFAULT_MAX_MP, false };
+	int c;
+	while ((c = getopt (argc, argv, "d:o:n:m:f:t:rh")) != -1) {
+		switch (c) {
+			case 'd': opt.dir = optarg; break;
+			case 'o': opt.output = optarg; break;
+			case 'n': opt.iterations = atoi (optarg); break;
+			case 'm': opt.maxMp = atoi (optarg); break;
+			case 'f': opt.filter = optarg; break;
+			case 't': opt.trace = optarg; break;
+			case 'r': opt.regenerate = true; break;
+			default:
+				usage (argv[0]);
+				return 'h' == c ? 0 : -1;
+		}
+	}
+	if (opt.iterations < 1 || opt.maxMp < 1) {
+		usage (argv[0]);
+		return -1;
+	}
+
+	if (prepareCorpus (&opt) < 0) {
+		LogE ("Failed prepare corpus in %s\n", opt.dir);
+		return -1;
+	}
+
+	cJSON *root = cJSON_CreateObject ();
+	cJSON *cases = cJSON_CreateArray ();
+	cJSON_AddNumberToObject (root, "version", 1);
+	cJSON_AddNumberToObject (root, "cpus", sysconf (_SC_NPROCESSORS_ONLN));
+	cJSON_AddNumberToObject (root, "iterations", opt.iterations);
+	cJSON_AddNumberToObject (root, "seed", CORPUS_SEED);
+	cJSON_AddItemToObject (root, "cases", cases);
+
+	if (NULL != opt.trace) {
+		startTrace ();
+	}
+	int ret = benchCodecs (&opt, cases);
+	if (0 == ret) {
+		ret = benchEffects (&opt, cases);
+	}
+	if (NULL != opt.trace) {
+		stopTrace ();
+		if (dumpTrace (opt.trace) < 0) {
+			ret = -1;
+		}
+	}
+
+	if (NULL != opt.output) {
+		char *text = cJSON_Print (root);
+		FILE *fp = fopen (opt.output, "w");
+		if (NULL == text || NULL == fp || fputs (text, fp) < 0) {
+			LogE ("Failed write %s\n", opt.output);
+			ret = -1;
+		}
+		if (NULL != fp) {
+			fclose (fp);
+		}
+		free (text);
+	}
+	cJSON_Delete (root);
+	return ret;
+}
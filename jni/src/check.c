@@ -0,0 +1,671 @@
+/***************************************
+ * file name:   check.c
+ * description: regression checks of processImage on synthetic images
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ * Usage:
+ *		imgcheck [-d dir] [-c console]
+ * Notice:
+ *	1. Run in the directory of vert.shdr & frag.shdr, `make check`
+ *	   does so. Set EGL_PLATFORM=surfaceless on hosts without display
+ *	2. Images are written into dir, build/check by default
+ *	3. Exit code is the count of failed checks
+ *	4. -c checks the console tool imgsdk at path console
+ *
+ ***************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "convolve.h"
+#include "eftplan.h"
+#include "imgsdk.h"
+#include "pipeline.h"
+#include "rotate.h"
+
+#define DEFAULT_DIR		"check"
+
+// top band of the orientation image
+#define BAND_SIZE		64
+#define BAND_ROWS		16
+#define BAND_BRIGHT		240
+#define BAND_DARK		16
+
+// top quarter of output is brighter than bottom quarter by this
+#define BAND_CONTRAST	100
+
+// JPEG is lossy, flat bands still decode within this
+#define JPEG_TOLERANCE	12
+
+// mean error of JPEG on the synthetic image, broken rows give ~50
+#define JPEG_MEAN_TOLERANCE	8
+
+static int sFailed;
+
+/**
+ * Print the result of one check
+ */
+static void report (bool ok, const char *name, const char *detail) {
+	if (ok) {
+		printf ("PASS %s\n", name);
+	} else {
+		printf ("FAIL %s: %s\n", name, detail);
+		++sFailed;
+	}
+}
+
+/**
+ * Row y counted from the top, whatever order rows are stored in
+ */
+static const uint8_t* rowOf (const Bitmap_t *b, int y) {
+	if (b->bottomUp) {
+		y = b->height - 1 - y;
+	}
+	return (const uint8_t *)b->base + (size_t)y * b->width * b->form;
+}
+
+/**
+ * Largest channel difference of a & b compared row by row from the top
+ * Return:
+ *		>= 0 the difference
+ *		  -1 sizes or forms differ
+ */
+static int diffBitmap (const Bitmap_t *a, const Bitmap_t *b) {
+	if (a->width != b->width || a->height != b->height || a->form != b->form) {
+		return -1;
+	}
+	int maxDiff = 0;
+	int n = a->width * a->form;
+	int x, y;
+	for (y = 0; y < a->height; ++y) {
+		const uint8_t *pa = rowOf (a, y);
+		const uint8_t *pb = rowOf (b, y);
+		for (x = 0; x < n; ++x) {
+			int d = abs (pa[x] - pb[x]);
+			if (d > maxDiff) {
+				maxDiff = d;
+			}
+		}
+	}
+	return maxDiff;
+}
+
+/**
+ * Mean of rows [top, bottom) counted from the top
+ */
+static int meanRows (const Bitmap_t *b, int top, int bottom) {
+	long sum = 0;
+	int n = b->width * b->form;
+	int x, y;
+	for (y = top; y < bottom; ++y) {
+		const uint8_t *p = rowOf (b, y);
+		for (x = 0; x < n; ++x) {
+			sum += p[x];
+		}
+	}
+	return bottom > top ? (int)(sum / ((long)(bottom - top) * n)) : 0;
+}
+
+/**
+ * Synthetic image, gradients with noise so every pixel matters
+ */
+static int makeImage (Bitmap_t *b, int width, int height, PixForm_e form, unsigned seed) {
+	memset (b, 0, sizeof(*b));
+	if (ensureBitmap (b, width, height, form) < 0) {
+		return -1;
+	}
+	uint8_t *p = (uint8_t *)b->base;
+	int x, y, c;
+	for (y = 0; y < height; ++y) {
+		for (x = 0; x < width; ++x) {
+			for (c = 0; c < (int)form; ++c) {
+				seed = seed * 1103515245u + 12345u;
+				*p++ = (uint8_t)((x * 3 + y * 5 + c * 40) ^ ((seed >> 16) & 15));
+			}
+		}
+	}
+	return 0;
+}
+
+/**
+ * Image with a bright band on top, the rest dark
+ */
+static int makeBandImage (Bitmap_t *b, int width, int height) {
+	memset (b, 0, sizeof(*b));
+	if (ensureBitmap (b, width, height, RGB24) < 0) {
+		return -1;
+	}
+	int rowSize = width * RGB24;
+	int y;
+	for (y = 0; y < height; ++y) {
+		memset (b->base + (size_t)y * rowSize, y < BAND_ROWS ? BAND_BRIGHT : BAND_DARK, rowSize);
+	}
+	return 0;
+}
+
+/**
+ * Save b as PNG & read it back, rows of the file are top-down
+ */
+static int roundTripPng (const char *path, const Bitmap_t *b, Bitmap_t *back) {
+	memset (back, 0, sizeof(*back));
+	if (write_png (path, b) < 0 || read_png (path, back) < 0) {
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * JPEG & PNG inputs keep their top on top through processImage, in
+ * memory and in the saved file. The shader mirrors & shrinks the
+ * picture a little, so only top & bottom quarters are compared.
+ */
+static void checkOrientation (SdkEnv *env, const char *dir) {
+	const char *cmds[] = {
+		"{\"effect\":\"Normal\"}",
+		"{\"effect\":\"Clip\",\"param\":{\"x\":0,\"y\":0,\"w\":64,\"h\":32}}",
+		"[{\"effect\":\"Brightness\",\"amount\":10},{\"effect\":\"Rotate\",\"degree\":180},"
+			"{\"effect\":\"Rotate\",\"degree\":180}]",
+	};
+	const char *exts[] = { "png", "jpg" };
+
+	Bitmap_t band;
+	if (makeBandImage (&band, BAND_SIZE, BAND_SIZE) < 0) {
+		report (false, "orientation", "no memory");
+		return;
+	}
+
+	Bitmap_t outs[2][3];
+	memset (outs, 0, sizeof(outs));
+	char path[1024];
+	char name[128];
+	char detail[128];
+	int i, j;
+	for (i = 0; i < 2; ++i) {
+		snprintf (path, sizeof(path), "%s/band.%s", dir, exts[i]);
+		Bitmap_t in;
+		memset (&in, 0, sizeof(in));
+		if (saveImage (path, &band) < 0 || loadImage (path, &in) < 0) {
+			snprintf (name, sizeof(name), "orientation %s", exts[i]);
+			report (false, name, "failed save or load");
+			continue;
+		}
+		for (j = 0; j < 3; ++j) {
+			snprintf (name, sizeof(name), "orientation %s %s", exts[i], cmds[j]);
+			Bitmap_t *out = &outs[i][j];
+			out->form = RGB24;
+			if (processImage (env, &in, cmds[j], out) < 0) {
+				report (false, name, "failed processImage");
+				continue;
+			}
+			int quarter = out->height / 4;
+			int top = meanRows (out, 0, quarter);
+			int bottom = meanRows (out, out->height - quarter, out->height);
+			if (top < bottom + BAND_CONTRAST) {
+				snprintf (detail, sizeof(detail), "top %d, bottom %d", top, bottom);
+				report (false, name, detail);
+				continue;
+			}
+
+			// and the saved file
+			Bitmap_t back;
+			snprintf (path, sizeof(path), "%s/band_%s_%d.png", dir, exts[i], j);
+			if (roundTripPng (path, out, &back) < 0) {
+				report (false, name, "failed save or read back");
+				continue;
+			}
+			int diff = diffBitmap (out, &back);
+			freeBitmap (&back);
+			snprintf (detail, sizeof(detail), "saved file differs by %d", diff);
+			report (0 == diff, name, detail);
+		}
+		freeBitmap (&in);
+	}
+
+	// JPEG & PNG input give the same picture
+	for (j = 0; j < 3; ++j) {
+		if (NULL == outs[0][j].base || NULL == outs[1][j].base) {
+			continue;
+		}
+		int diff = diffBitmap (&outs[0][j], &outs[1][j]);
+		snprintf (name, sizeof(name), "orientation jpg == png %s", cmds[j]);
+		snprintf (detail, sizeof(detail), "differ by %d", diff);
+		report (diff >= 0 && diff <= JPEG_TOLERANCE, name, detail);
+		freeBitmap (&outs[0][j]);
+		freeBitmap (&outs[1][j]);
+	}
+	freeBitmap (&band);
+}
+
+/**
+ * Tiled rendering gives the whole image's output
+ */
+static void checkTiles (SdkEnv *env, const char *dir) {
+	const char *cmds[] = {
+		"{\"effect\":\"Gray\"}",
+		"[{\"effect\":\"Blur\",\"sigma\":2},{\"effect\":\"Brightness\",\"amount\":20}]",
+		"[{\"effect\":\"Clip\",\"param\":{\"x\":10,\"y\":30,\"w\":180,\"h\":100}},"
+			"{\"effect\":\"Rotate\",\"degree\":90}]",
+		"{\"effect\":\"Sharpen\",\"amount\":50}",
+	};
+	const PixForm_e forms[] = { RGB24, RGBA32, GRAY };
+	const int tileSizes[] = { TILE_MIN_SIZE, 97 };
+
+	Bitmap_t ins[4];
+	memset (ins, 0, sizeof(ins));
+	int i, j, k;
+	for (i = 0; i < 3; ++i) {
+		makeImage (&ins[i], 333, 211, forms[i], i + 1);
+	}
+
+	// rows of JPEG are bottom-up
+	char path[1024];
+	snprintf (path, sizeof(path), "%s/tiles.jpg", dir);
+	if (saveImage (path, &ins[0]) < 0 || loadImage (path, &ins[3]) < 0) {
+		report (false, "tiles jpg", "failed save or load");
+	}
+
+	char name[256];
+	char detail[128];
+	for (i = 0; i < 4; ++i) {
+		if (NULL == ins[i].base) {
+			continue;
+		}
+		for (j = 0; j < 4; ++j) {
+			Bitmap_t whole;
+			memset (&whole, 0, sizeof(whole));
+			whole.form = ins[i].form;
+			setTileSize (env, 0);
+			if (processImage (env, &ins[i], cmds[j], &whole) < 0) {
+				snprintf (name, sizeof(name), "tiles input %d %s", i, cmds[j]);
+				report (false, name, "failed processImage");
+				continue;
+			}
+			for (k = 0; k < 2; ++k) {
+				snprintf (name, sizeof(name), "tiles input %d tile %d %s", i, tileSizes[k], cmds[j]);
+				Bitmap_t tiled;
+				memset (&tiled, 0, sizeof(tiled));
+				tiled.form = ins[i].form;
+				if (setTileSize (env, tileSizes[k]) < 0 ||
+						processImage (env, &ins[i], cmds[j], &tiled) < 0) {
+					report (false, name, "failed processImage");
+					continue;
+				}
+				int diff = diffBitmap (&whole, &tiled);
+				snprintf (detail, sizeof(detail), "%dx%d vs %dx%d differ by %d",
+						whole.width, whole.height, tiled.width, tiled.height, diff);
+				report (diff >= 0 && diff <= 1 && whole.bottomUp == tiled.bottomUp, name, detail);
+				freeBitmap (&tiled);
+			}
+			freeBitmap (&whole);
+		}
+		freeBitmap (&ins[i]);
+	}
+	setTileSize (env, 0);
+}
+
+/**
+ * Mean channel difference of a & b over the color channels both have,
+ * e.g. RGB of RGBA32 against RGB24
+ * Return:
+ *		>= 0 the difference
+ *		  -1 sizes differ or one is GRAY & the other isn't
+ */
+static int meanDiffBitmap (const Bitmap_t *a, const Bitmap_t *b) {
+	if (a->width != b->width || a->height != b->height ||
+			(GRAY == a->form) != (GRAY == b->form)) {
+		return -1;
+	}
+	int channels = GRAY == a->form ? 1 : 3;
+	long sum = 0;
+	int x, y, c;
+	for (y = 0; y < a->height; ++y) {
+		const uint8_t *pa = rowOf (a, y);
+		const uint8_t *pb = rowOf (b, y);
+		for (x = 0; x < a->width; ++x) {
+			for (c = 0; c < channels; ++c) {
+				sum += abs (pa[x * a->form + c] - pb[x * b->form + c]);
+			}
+		}
+	}
+	return (int)(sum / ((long)a->width * a->height * channels));
+}
+
+/**
+ * Compare output, written from input by cmd, with processImage of input
+ */
+static void checkOutputFile (SdkEnv *env, const char *name, const char *input,
+		const char *output, const char *cmd, int tolerance) {
+	Bitmap_t in, want, got;
+	memset (&in, 0, sizeof(in));
+	memset (&want, 0, sizeof(want));
+	memset (&got, 0, sizeof(got));
+	if (loadImage (input, &in) < 0 || loadImage (output, &got) < 0) {
+		report (false, name, "failed load input or output");
+	} else {
+		want.form = in.form;
+		if (processImage (env, &in, cmd, &want) < 0) {
+			report (false, name, "failed processImage");
+		} else {
+			char detail[128];
+			int diff = meanDiffBitmap (&want, &got);
+			snprintf (detail, sizeof(detail), "form %d, mean error %d", got.form, diff);
+			report (diff >= 0 && diff <= tolerance, name, detail);
+		}
+	}
+	freeBitmap (&in);
+	freeBitmap (&want);
+	freeBitmap (&got);
+}
+
+/**
+ * Inputs & outputs of format conversion, gray to PNG & RGBA to JPEG.
+ * Both encoders must write whatever form the output keeps.
+ */
+static const struct {
+	PixForm_e	form;
+	const char	*input;
+	const char	*output;
+	int			tolerance;
+} sConversions[] = {
+	{ GRAY, "gray.jpg", "gray_out.png", 0 },
+	{ RGBA32, "rgba.png", "rgba_out.jpg", JPEG_MEAN_TOLERANCE },
+};
+
+#define CONVERSIONS	(int)(sizeof(sConversions) / sizeof(sConversions[0]))
+
+/**
+ * Write the inputs of sConversions into dir
+ */
+static int makeConversionInputs (const char *dir) {
+	char path[1024];
+	int i;
+	for (i = 0; i < CONVERSIONS; ++i) {
+		Bitmap_t b;
+		snprintf (path, sizeof(path), "%s/%s", dir, sConversions[i].input);
+		if (makeImage (&b, 160, 120, sConversions[i].form, 11 + i) < 0) {
+			return -1;
+		}
+		int retCode = saveImage (path, &b);
+		freeBitmap (&b);
+		if (retCode < 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Pipeline writes every output form it keeps
+ */
+static void checkPipeline (SdkEnv *env, const char *dir) {
+	const char *cmd = "{\"effect\":\"Normal\"}";
+	if (makeConversionInputs (dir) < 0) {
+		report (false, "pipeline", "failed save inputs");
+		return;
+	}
+
+	char inputs[CONVERSIONS][1024];
+	char outputs[CONVERSIONS][1024];
+	BatchJob_t jobs[CONVERSIONS];
+	memset (jobs, 0, sizeof(jobs));
+	int i;
+	for (i = 0; i < CONVERSIONS; ++i) {
+		snprintf (inputs[i], sizeof(inputs[i]), "%s/%s", dir, sConversions[i].input);
+		snprintf (outputs[i], sizeof(outputs[i]), "%s/pipe_%s", dir, sConversions[i].output);
+		jobs[i].inputPath = inputs[i];
+		jobs[i].outputPath = outputs[i];
+		jobs[i].effectCmd = cmd;
+	}
+	runPipeline (env, jobs, CONVERSIONS, NULL);
+
+	char name[128];
+	for (i = 0; i < CONVERSIONS; ++i) {
+		snprintf (name, sizeof(name), "pipeline %s", sConversions[i].output);
+		if (0 != jobs[i].result) {
+			report (false, name, "failed runPipeline");
+			continue;
+		}
+		checkOutputFile (env, name, inputs[i], outputs[i], cmd, sConversions[i].tolerance);
+	}
+}
+
+/**
+ * Console tool writes every output form it keeps
+ */
+static void checkConsole (SdkEnv *env, const char *dir, const char *console) {
+	const char *cmd = "{\"effect\":\"Normal\"}";
+	if (makeConversionInputs (dir) < 0) {
+		report (false, "console", "failed save inputs");
+		return;
+	}
+
+	char input[1024];
+	char output[1024];
+	char line[4096];
+	char name[128];
+	int i;
+	for (i = 0; i < CONVERSIONS; ++i) {
+		snprintf (name, sizeof(name), "console %s", sConversions[i].output);
+		snprintf (input, sizeof(input), "%s/%s", dir, sConversions[i].input);
+		snprintf (output, sizeof(output), "%s/console_%s", dir, sConversions[i].output);
+		snprintf (line, sizeof(line), "'%s' '%s' '%s' '%s' >/dev/null 2>&1",
+				console, input, output, cmd);
+		if (0 != system (line)) {
+			report (false, name, "failed run console");
+			continue;
+		}
+		checkOutputFile (env, name, input, output, cmd, sConversions[i].tolerance);
+	}
+}
+
+/**
+ * Run cmd by the CPU plan of processImage
+ */
+static int runPlan (const char *cmd, const Bitmap_t *src, Bitmap_t *dst) {
+	EftPlan_t plan;
+	if (parseEffectPlan (cmd, &plan) < 0) {
+		return -1;
+	}
+	return runEffectPlan (&plan, NULL, src, false, dst);
+}
+
+/**
+ * Point ops fused in one pass give what they give one by one.
+ * The shader of processImage isn't idempotent, so the plan it runs
+ * is compared.
+ */
+static void checkPointOps () {
+	const char *ops[][2] = {
+		{ "{\"effect\":\"Brightness\",\"amount\":30}", "{\"effect\":\"Contrast\",\"amount\":-40}" },
+		{ "{\"effect\":\"Gamma\",\"gamma\":1.8}",
+			"{\"effect\":\"Curves\",\"channel\":\"red\",\"points\":[[0,20],[128,200],[255,255]]}" },
+		{ "{\"effect\":\"Gray\"}", "{\"effect\":\"Brightness\",\"amount\":-25}" },
+		{ "{\"effect\":\"Curves\",\"channel\":\"green\",\"points\":[[0,0],[64,160],[255,230]]}",
+			"{\"effect\":\"Gray\"}" },
+		{ "{\"effect\":\"Gray\"}", "{\"effect\":\"Gray\"}" },
+	};
+	const PixForm_e forms[] = { RGB24, RGBA32, GRAY };
+
+	char fused[512];
+	char name[sizeof(fused) + 64];
+	char detail[128];
+	int i, j;
+	for (i = 0; i < 3; ++i) {
+		Bitmap_t in;
+		if (makeImage (&in, 256, 128, forms[i], 7 + i) < 0) {
+			report (false, "point ops", "no memory");
+			continue;
+		}
+		for (j = 0; j < (int)(sizeof(ops) / sizeof(ops[0])); ++j) {
+			snprintf (fused, sizeof(fused), "[%s,%s]", ops[j][0], ops[j][1]);
+			snprintf (name, sizeof(name), "point ops form %d %s", forms[i], fused);
+
+			Bitmap_t one, step, two;
+			memset (&one, 0, sizeof(one));
+			memset (&step, 0, sizeof(step));
+			memset (&two, 0, sizeof(two));
+			if (runPlan (fused, &in, &one) < 0 ||
+					runPlan (ops[j][0], &in, &step) < 0 ||
+					runPlan (ops[j][1], &step, &two) < 0) {
+				report (false, name, "failed runEffectPlan");
+			} else {
+				int diff = diffBitmap (&one, &two);
+				snprintf (detail, sizeof(detail), "differ by %d", diff);
+				report (0 == diff, name, detail);
+			}
+			freeBitmap (&one);
+			freeBitmap (&step);
+			freeBitmap (&two);
+		}
+		freeBitmap (&in);
+	}
+}
+
+/**
+ * Separable kernels at CONV_MAX_GAIN give the exact result on a flat
+ * image, nothing saturates between the passes
+ */
+static void checkConvolveGain () {
+	static const int16_t one[] = { 32767 };
+	static const int16_t three[] = { 10923, 10922, 10923 };
+	static const int16_t signs[] = { -6144, 20480, -6144 };
+	static const int16_t eighth[] = { 512 };
+	static const int16_t half[] = { 2048 };
+	static const int16_t unit[] = { CONV_ONE };
+	const struct {
+		const char		*name;
+		const int16_t	*kx;
+		int				nx;
+		const int16_t	*ky;
+		int				ny;
+	} cases[] = {
+		{ "kx 8, ky 1/8", one, 1, eighth, 1 },
+		{ "kx 1/8, ky 8", eighth, 1, one, 1 },
+		{ "kx 8 of 3 taps, ky 1/8", three, 3, eighth, 1 },
+		{ "kx 2 of |8|, ky 1/2", signs, 3, half, 1 },
+		{ "kx 8, ky 1 saturated", one, 1, unit, 1 },
+	};
+	const int value = 200;
+
+	Bitmap_t flat;
+	memset (&flat, 0, sizeof(flat));
+	if (ensureBitmap (&flat, 64, 16, RGB24) < 0) {
+		report (false, "convolve gain", "no memory");
+		return;
+	}
+	memset (flat.base, value, (size_t)flat.width * flat.height * flat.form);
+
+	char name[128];
+	char detail[128];
+	int i, k;
+	for (i = 0; i < (int)(sizeof(cases) / sizeof(cases[0])); ++i) {
+		snprintf (name, sizeof(name), "convolve gain %s", cases[i].name);
+		long sx = 0, sy = 0;
+		for (k = 0; k < cases[i].nx; ++k) {
+			sx += cases[i].kx[k];
+		}
+		for (k = 0; k < cases[i].ny; ++k) {
+			sy += cases[i].ky[k];
+		}
+		long want = (value * sx * sy + ((long)CONV_ONE * CONV_ONE / 2)) / ((long)CONV_ONE * CONV_ONE);
+		want = want > 255 ? 255 : want;
+
+		Bitmap_t out;
+		memset (&out, 0, sizeof(out));
+		if (convolveSeparable (&flat, cases[i].kx, cases[i].nx,
+					cases[i].ky, cases[i].ny, &out) < 0) {
+			report (false, name, "failed convolveSeparable");
+			continue;
+		}
+		int worst = 0;
+		size_t n = (size_t)out.width * out.height * out.form;
+		size_t j;
+		for (j = 0; j < n; ++j) {
+			int d = abs ((uint8_t)out.base[j] - (int)want);
+			worst = d > worst ? d : worst;
+		}
+		snprintf (detail, sizeof(detail), "want %ld, off by %d", want, worst);
+		report (worst <= 1, name, detail);
+		freeBitmap (&out);
+	}
+	freeBitmap (&flat);
+}
+
+/**
+ * Rotating a side of 32768 or more keeps the picture, the sampling
+ * coordinates don't overflow
+ */
+static void checkRotateWide () {
+	const int width = 40000;
+	const int height = 8;
+	const int value = 100;
+	Bitmap_t src, dst;
+	memset (&src, 0, sizeof(src));
+	memset (&dst, 0, sizeof(dst));
+	if (ensureBitmap (&src, width, height, GRAY) < 0) {
+		report (false, "rotate wide", "no memory");
+		return;
+	}
+	memset (src.base, value, (size_t)width * height);
+
+	if (rotateImage (&src, 1, RESAMPLE_BILINEAR, &dst) < 0) {
+		report (false, "rotate wide", "failed rotateImage");
+	} else {
+		// the area is kept, edge pixels are partly covered
+		long sum = 0;
+		size_t n = (size_t)dst.width * dst.height;
+		size_t i;
+		for (i = 0; i < n; ++i) {
+			sum += (uint8_t)dst.base[i];
+		}
+		long area = sum / value;
+		char detail[128];
+		snprintf (detail, sizeof(detail), "covered %ld of %d pixels", area, width * height);
+		report (labs (area - (long)width * height) < width / 10, "rotate wide", detail);
+	}
+	freeBitmap (&src);
+	freeBitmap (&dst);
+}
+
+int main (int argc, char **argv) {
+	const char *dir = DEFAULT_DIR;
+	const char *console = NULL;
+	int opt;
+	while ((opt = getopt (argc, argv, "d:c:")) != -1) {
+		switch (opt) {
+			case 'd':
+				dir = optarg;
+				break;
+			case 'c':
+				console = optarg;
+				break;
+			default:
+				fprintf (stderr, "Usage: %s [-d dir] [-c console]\n", argv[0]);
+				return 1;
+		}
+	}
+	mkdir (dir, 0755);
+
+	SdkEnv *env = newDefaultSdkEnv ();
+	if (NULL == env) {
+		fprintf (stderr, "Failed newDefaultSdkEnv, run in the directory of shaders\n");
+		return 1;
+	}
+
+	checkOrientation (env, dir);
+	checkTiles (env, dir);
+	checkPipeline (env, dir);
+	if (NULL != console) {
+		checkConsole (env, dir, console);
+	}
+	checkPointOps ();
+	checkConvolveGain ();
+	checkRotateWide ();
+
+	freeSdkEnv (env);
+	printf ("%d check(s) failed\n", sFailed);
+	return sFailed;
+}
@@ -9,8 +9,10 @@
 #ifndef __COMM__H__
 #define __COMM__H__
 
-#include <android/log.h>
 #include <stdio.h>
+#include "logger.h"
+#include "platform.h"
+#include "trace.h"
 
 #define OK               0x0000 
 #define NULL_POINTER    -0x0001
@@ -19,11 +21,12 @@
 #define ERR_ALLOC_MEM   -0x0004
 
 
+// return NULL_POINTER (-1) from the int function if X is NULL
 #define VALIDATE_NOT_NULL(X) 						\
     do { 											\
-        if (NULL == X) { 							\
+        if (NULL == (X)) { 							\
             LogE(#X" = NULL in %s\n", __FUNCTION__);	\
-            return ;								\
+            return NULL_POINTER;					\
         } 											\
     } while (0)
 	
@@ -36,7 +39,7 @@
 #define VALIDATE_NOT_NULL3(X, Y, Z)             \
     do {                                        \
         VALIDATE_NOT_NULL2(X, Y);               \
-        VALIDATE_NOT_NULL(X);                   \
+        VALIDATE_NOT_NULL(Z);                   \
     } while (0)
 
 
@@ -47,16 +50,34 @@
 
 #define TAG "ImageSDK"
 
-#ifdef _ANDROID_
-// Android log
-#define Log(...) ((void)__android_log_print(INFO, TAG, __VA_ARGS__))
-#define LogD(...) ((void)__android_log_print(DEBUG, TAG, __VA_ARGS__))
-#define LogE(...) ((void)__android_log_print(ERROR, TAG, __VA_ARGS__))
+// Levels below LOG_MIN_LEVEL are compiled out
+#ifndef LOG_MIN_LEVEL
+#ifdef _DEBUG_
+#define LOG_MIN_LEVEL DEBUG
 #else
-// output to stdout
-#define Log(...) ((void)printf( __VA_ARGS__))
-#define LogD(...) ((void)printf( __VA_ARGS__))
-#define LogE(...) ((void)printf( __VA_ARGS__))
+#define LOG_MIN_LEVEL INFO
+#endif
+#endif
+
+// Async log to Android log or stderr, see logger.h
+#define LOG_AT(level, ...)												\
+	((level) >= LOG_MIN_LEVEL &&										\
+	 (level) >= __atomic_load_n (&gLogLevel, __ATOMIC_RELAXED) ?		\
+	 logWrite (level, TAG, __VA_ARGS__) : (void)0)
+
+#define Log(...) LOG_AT(INFO, __VA_ARGS__)
+#define LogD(...) LOG_AT(DEBUG, __VA_ARGS__)
+#define LogW(...) LOG_AT(WARN, __VA_ARGS__)
+#define LogE(...) LOG_AT(ERROR, __VA_ARGS__)
+
+// Log the calling thread, only for debugging threading issues
+#ifdef _TRACE_THREAD_
+#include <pthread.h>
+#include <unistd.h>
+#define LogThread(name) Log("%s pthread:%lx tid:%x\n", name, \
+		(unsigned long)pthread_self(), (unsigned int)gettid())
+#else
+#define LogThread(name) ((void)0)
 #endif
 
 typedef char bool;
@@ -0,0 +1,96 @@
+/***************************************
+ * file name:   console.c
+ * description: console application entry
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ * Usage:
+ *		imgsdk input output [effect]
+ * Notice:
+ *	1. input & onput support *.jpg or *.png
+ *	2. support input and output image type are not same 
+ *	3. vert.shdr & frag.shdr must be prepared in the current directory
+ *	4. effect is a command such as {"effect":"Gray"}, Normal by default
+ *	5. IMGSDK_TRACE=trace.json writes Chrome trace-event JSON of the run
+ *	6. IMGSDK_PROGRAM_CACHE=dir keeps shader program binaries in dir
+ *	7. stats of the run are printed to stdout as one JSON line
+ *
+ ***************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "imgsdk.h"
+
+int main (int argc, char **argv) {
+	if (3 != argc && 4 != argc) {
+		Log ("Usage:\n");
+		Log ("  %s input output [effect]\n", argv[0]);
+		return -1;
+	}
+
+	const char *trace = getenv ("IMGSDK_TRACE");
+	if (NULL != trace) {
+		startTrace ();
+	}
+
+	const char *programs = getenv ("IMGSDK_PROGRAM_CACHE");
+	if (NULL != programs) {
+		setProgramCacheDir (programs);
+	}
+
+	Bitmap_t img = { 0 };
+	Bitmap_t out = { 0 };
+	uint64_t begin_ns = getNanoTime ();
+	if (loadImage (argv[1], &img) < 0) {
+		LogE ("Failed loadImage %s\n", argv[1]);
+		return -1;
+	}
+	uint64_t decode_ns = getNanoTime () - begin_ns;
+
+	SdkEnv *env = newDefaultSdkEnv ();
+	if (NULL == env) {
+		LogE ("Failed get SdkEnv instance\n");
+		freeBitmap (&img);
+		return -1;
+	}
+	SdkStats_t *stats = getSdkStats (env);
+	addStageTime (stats, STAGE_DECODE, decode_ns);
+	addCounter (stats, COUNTER_BYTES_DECODED, (int64_t)img.width * img.height * img.form);
+
+	int ret = -1;
+	out.form = img.form;
+	const char *cmd = 4 == argc ? argv[3] : "{\"effect\":\"Normal\"}";
+	if (processImage (env, &img, cmd, &out) < 0) {
+		LogE ("Failed processImage\n");
+	}
+	else {
+		begin_ns = getNanoTime ();
+		if (saveImage (argv[2], &out) < 0) {
+			LogE ("Failed saveImage %s\n", argv[2]);
+		}
+		else {
+			endStage (stats, STAGE_ENCODE, begin_ns);
+			addCounter (stats, COUNTER_BYTES_ENCODED, (int64_t)out.width * out.height * out.form);
+			ret = 0;
+		}
+	}
+
+	// log lines are cut at LOG_LINE_SIZE, the stats go to stdout whole
+	char json[STATS_JSON_SIZE];
+	if (formatStats (stats, json, sizeof(json)) > 0) {
+		fputs (json, stdout);
+		fputc ('\n', stdout);
+	}
+
+	if (NULL != trace) {
+		stopTrace ();
+		if (dumpTrace (trace) < 0) {
+			ret = -1;
+		}
+	}
+
+	freeBitmap (&img);
+	freeBitmap (&out);
+	freeSdkEnv (env);
+	return ret;
+}
@@ -0,0 +1,620 @@
+/***************************************
+ * file name:   convolve.c
+ * description: implement convolution filters
+ *
+ *	The image is cut into tiles run on all cores. A tile reads its
+ *	source block with a halo of kernel radius, edge pixels replicated:
+ *		separable:	padded rows --horizontal--> int16 rows --vertical--> tile
+ *		2D:			padded rows --all taps--> tile
+ *	Taps are CONV_BITS fixed point, the int16 rows keep INTER_BITS of
+ *	fraction. The inner loops use SSE2 or NEON when available.
+ *
+ *	Box blur slides column sums down and row sums across instead,
+ *	Gaussian of large sigma is 3 box blurs.
+ *
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <malloc.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "comm.h"
+#include "convolve.h"
+#include "parallel.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define CONVOLVE_SSE2
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CONVOLVE_NEON
+#endif
+
+// fraction bits of horizontal pass output, few enough that 255 at
+// CONV_MAX_GAIN never saturates the int16 rows
+#define INTER_BITS 4
+
+#if (255 * CONV_MAX_GAIN) << INTER_BITS > 32767
+#error "int16 rows of separable convolution overflow at CONV_MAX_GAIN"
+#endif
+
+// tile of separable & 2D convolution
+#define TILE_WIDTH  256
+#define TILE_HEIGHT 64
+
+// least rows of a box blur strip
+#define BOX_STRIP_ROWS 64
+
+// box sum / area = (sum + area / 2) * recip >> BOX_RECIP_BITS
+#define BOX_RECIP_BITS 48
+
+// smaller sigma convolves with sampled gaussian
+#define GAUSS_BOX_SIGMA 2.0f
+
+typedef struct {
+	const Bitmap_t	*src;
+	Bitmap_t		*dst;
+	const int16_t	*kx;		// 2D: the whole kernel
+	int				nx;
+	const int16_t	*ky;		// 2D: NULL
+	int				ny;
+	int				tilesX;
+	int				failed;		// set by tiles failed malloc
+} ConvJob;
+
+typedef struct {
+	const Bitmap_t	*src;
+	Bitmap_t		*dst;
+	int				radius;
+	uint64_t		recip;
+	int				failed;
+} BoxJob;
+
+typedef struct {
+	const Bitmap_t	*src;
+	const Bitmap_t	*blur;
+	Bitmap_t		*dst;
+	int				amount;		// Q8
+	int				threshold;
+} UnsharpJob;
+
+static inline int maxInt (int a, int b) {
+	return a > b ? a : b;
+}
+
+static inline int minInt (int a, int b) {
+	return a < b ? a : b;
+}
+
+static inline int clampInt (int v, int lo, int hi) {
+	return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static inline uint8_t clampByte (int v) {
+	return v < 0 ? 0 : (v > 255 ? 255 : (uint8_t)v);
+}
+
+/**
+ * dst[i] = sum of src[t][i] * k[t] >> shift, saturated to int16
+ */
+static void convolveBytes (const uint8_t *const *src, const int16_t *k, int n,
+		int len, int shift, int16_t *dst) {
+	const int round = 1 << (shift - 1);
+	int i = 0, t;
+#if defined(CONVOLVE_SSE2)
+	const __m128i vround = _mm_set1_epi32 (round);
+	const __m128i vshift = _mm_cvtsi32_si128 (shift);
+	const __m128i zero = _mm_setzero_si128 ();
+	for (; i + 8 <= len; i += 8) {
+		__m128i lo = vround, hi = vround;
+		for (t = 0; t + 1 < n; t += 2) {
+			__m128i a = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *)(src[t] + i)), zero);
+			__m128i b = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *)(src[t + 1] + i)), zero);
+			__m128i wt = _mm_set1_epi32 ((int)((uint16_t)k[t] | (uint32_t)(uint16_t)k[t + 1] << 16));
+			lo = _mm_add_epi32 (lo, _mm_madd_epi16 (_mm_unpacklo_epi16 (a, b), wt));
+			hi = _mm_add_epi32 (hi, _mm_madd_epi16 (_mm_unpackhi_epi16 (a, b), wt));
+		}
+		if (t < n) {
+			__m128i a = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *)(src[t] + i)), zero);
+			__m128i wt = _mm_set1_epi32 ((uint16_t)k[t]);
+			lo = _mm_add_epi32 (lo, _mm_madd_epi16 (_mm_unpacklo_epi16 (a, zero), wt));
+			hi = _mm_add_epi32 (hi, _mm_madd_epi16 (_mm_unpackhi_epi16 (a, zero), wt));
+		}
+		lo = _mm_sra_epi32 (lo, vshift);
+		hi = _mm_sra_epi32 (hi, vshift);
+		_mm_storeu_si128 ((__m128i *)(dst + i), _mm_packs_epi32 (lo, hi));
+	}
+#elif defined(CONVOLVE_NEON)
+	const int32x4_t vshift = vdupq_n_s32 (-shift);
+	for (; i + 8 <= len; i += 8) {
+		int32x4_t lo = vdupq_n_s32 (round);
+		int32x4_t hi = lo;
+		for (t = 0; t < n; ++t) {
+			int16x8_t a = vreinterpretq_s16_u16 (vmovl_u8 (vld1_u8 (src[t] + i)));
+			lo = vmlal_n_s16 (lo, vget_low_s16 (a), k[t]);
+			hi = vmlal_n_s16 (hi, vget_high_s16 (a), k[t]);
+		}
+		lo = vshlq_s32 (lo, vshift);
+		hi = vshlq_s32 (hi, vshift);
+		vst1q_s16 (dst + i, vcombine_s16 (vqmovn_s32 (lo), vqmovn_s32 (hi)));
+	}
+#endif
+	for (; i < len; ++i) {
+		int acc = round;
+		for (t = 0; t < n; ++t) {
+			acc += src[t][i] * k[t];
+		}
+		acc >>= shift;
+		dst[i] = (int16_t)clampInt (acc, -32768, 32767);
+	}
+}
+
+/**
+ * dst[i] = sum of src[t][i] * k[t] of int16 rows, back to pixels
+ */
+static void convolveShorts (const int16_t *const *src, const int16_t *k, int n,
+		int len, uint8_t *dst) {
+	const int shift = CONV_BITS + INTER_BITS;
+	const int round = 1 << (shift - 1);
+	int i = 0, t;
+#if defined(CONVOLVE_SSE2)
+	const __m128i vround = _mm_set1_epi32 (round);
+	const __m128i zero = _mm_setzero_si128 ();
+	for (; i + 8 <= len; i += 8) {
+		__m128i lo = vround, hi = vround;
+		for (t = 0; t + 1 < n; t += 2) {
+			__m128i a = _mm_loadu_si128 ((const __m128i *)(src[t] + i));
+			__m128i b = _mm_loadu_si128 ((const __m128i *)(src[t + 1] + i));
+			__m128i wt = _mm_set1_epi32 ((int)((uint16_t)k[t] | (uint32_t)(uint16_t)k[t + 1] << 16));
+			lo = _mm_add_epi32 (lo, _mm_madd_epi16 (_mm_unpacklo_epi16 (a, b), wt));
+			hi = _mm_add_epi32 (hi, _mm_madd_epi16 (_mm_unpackhi_epi16 (a, b), wt));
+		}
+		if (t < n) {
+			__m128i a = _mm_loadu_si128 ((const __m128i *)(src[t] + i));
+			__m128i wt = _mm_set1_epi32 ((uint16_t)k[t]);
+			lo = _mm_add_epi32 (lo, _mm_madd_epi16 (_mm_unpacklo_epi16 (a, zero), wt));
+			hi = _mm_add_epi32 (hi, _mm_madd_epi16 (_mm_unpackhi_epi16 (a, zero), wt));
+		}
+		lo = _mm_srai_epi32 (lo, CONV_BITS + INTER_BITS);
+		hi = _mm_srai_epi32 (hi, CONV_BITS + INTER_BITS);
+		__m128i px = _mm_packus_epi16 (_mm_packs_epi32 (lo, hi), zero);
+		_mm_storel_epi64 ((__m128i *)(dst + i), px);
+	}
+#elif defined(CONVOLVE_NEON)
+	for (; i + 8 <= len; i += 8) {
+		int32x4_t lo = vdupq_n_s32 (round);
+		int32x4_t hi = lo;
+		for (t = 0; t < n; ++t) {
+			int16x8_t a = vld1q_s16 (src[t] + i);
+			lo = vmlal_n_s16 (lo, vget_low_s16 (a), k[t]);
+			hi = vmlal_n_s16 (hi, vget_high_s16 (a), k[t]);
+		}
+		lo = vshrq_n_s32 (lo, CONV_BITS + INTER_BITS);
+		hi = vshrq_n_s32 (hi, CONV_BITS + INTER_BITS);
+		vst1_u8 (dst + i, vqmovun_s16 (vcombine_s16 (vqmovn_s32 (lo), vqmovn_s32 (hi))));
+	}
+#endif
+	for (; i < len; ++i) {
+		int acc = round;
+		for (t = 0; t < n; ++t) {
+			acc += src[t][i] * k[t];
+		}
+		dst[i] = clampByte (acc >> shift);
+	}
+}
+
+/**
+ * Copy columns [x0 - rx, x0 + tw + rx) of row, edge pixels replicated
+ */
+static void padRow (const uint8_t *row, int width, int form, int x0, int tw, int rx, uint8_t *pad) {
+	int first = maxInt (x0 - rx, 0);
+	int last = minInt (x0 + tw + rx, width);
+	int x;
+	for (x = x0 - rx; x < first; ++x, pad += form) {
+		memcpy (pad, row, form);
+	}
+	memcpy (pad, row + first * form, (last - first) * form);
+	pad += (last - first) * form;
+	for (x = last; x < x0 + tw + rx; ++x, pad += form) {
+		memcpy (pad, row + (width - 1) * form, form);
+	}
+}
+
+static int convolveTile (const ConvJob *job, int index) {
+	const Bitmap_t *src = job->src;
+	int w = src->width;
+	int h = src->height;
+	int form = src->form;
+	int rx = job->nx / 2;
+	int ry = job->ny / 2;
+	int x0 = (index % job->tilesX) * TILE_WIDTH;
+	int y0 = (index / job->tilesX) * TILE_HEIGHT;
+	int tw = minInt (TILE_WIDTH, w - x0);
+	int th = minInt (TILE_HEIGHT, h - y0);
+	int len = tw * form;
+	int padLen = (tw + 2 * rx) * form;
+
+	// source rows read by the tile
+	int sy0 = maxInt (y0 - ry, 0);
+	int sy1 = minInt (y0 + th + ry, h);
+
+	bool separable = NULL != job->ky;
+	uint8_t *pad = (uint8_t *)malloc ((size_t)(separable ? 1 : sy1 - sy0) * padLen);
+	int16_t *inter = (int16_t *)malloc ((size_t)(separable ? sy1 - sy0 : 1) * len * sizeof(int16_t));
+	if (NULL == pad || NULL == inter) {
+		LogE ("Failed malloc convolution tile\n");
+		free (pad);
+		free (inter);
+		return -1;
+	}
+
+	const uint8_t *taps[CONV_MAX_SIDE * CONV_MAX_SIDE];
+	const uint8_t *base = (const uint8_t *)src->base;
+	uint8_t *out = (uint8_t *)job->dst->base + ((size_t)y0 * w + x0) * form;
+	int y, i, j;
+	if (separable) {
+		const int16_t *rows[CONV_MAX_TAPS];
+		for (y = sy0; y < sy1; ++y) {
+			padRow (base + (size_t)y * w * form, w, form, x0, tw, rx, pad);
+			for (i = 0; i < job->nx; ++i) {
+				taps[i] = pad + i * form;
+			}
+			convolveBytes (taps, job->kx, job->nx, len, CONV_BITS - INTER_BITS,
+					inter + (y - sy0) * len);
+		}
+		for (y = y0; y < y0 + th; ++y, out += w * form) {
+			for (j = 0; j < job->ny; ++j) {
+				rows[j] = inter + (clampInt (y - ry + j, 0, h - 1) - sy0) * len;
+			}
+			convolveShorts (rows, job->ky, job->ny, len, out);
+		}
+	} else {
+		for (y = sy0; y < sy1; ++y) {
+			padRow (base + (size_t)y * w * form, w, form, x0, tw, rx, pad + (y - sy0) * padLen);
+		}
+		for (y = y0; y < y0 + th; ++y, out += w * form) {
+			for (j = 0; j < job->ny; ++j) {
+				const uint8_t *row = pad + (clampInt (y - ry + j, 0, h - 1) - sy0) * padLen;
+				for (i = 0; i < job->nx; ++i) {
+					taps[j * job->nx + i] = row + i * form;
+				}
+			}
+			convolveBytes (taps, job->kx, job->nx * job->ny, len, CONV_BITS, inter);
+			for (i = 0; i < len; ++i) {
+				out[i] = clampByte (inter[i]);
+			}
+		}
+	}
+
+	free (pad);
+	free (inter);
+	return 0;
+}
+
+static void convolveTiles (void *arg, int begin, int end) {
+	ConvJob *job = (ConvJob *)arg;
+	int i;
+	for (i = begin; i < end; ++i) {
+		if (convolveTile (job, i) < 0) {
+			__atomic_store_n (&job->failed, 1, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+static bool isFilterable (const Bitmap_t *src, const Bitmap_t *dst) {
+	if (NULL == src || NULL == src->base || NULL == dst || src == dst ||
+			src->width <= 0 || src->height <= 0) {
+		return false;
+	}
+	if (src->form != GRAY && src->form != RGB24 && src->form != RGBA32) {
+		LogE ("Unsupported pixel format %d in convolution\n", src->form);
+		return false;
+	}
+	return true;
+}
+
+static int runConvolution (const Bitmap_t *src, ConvJob *job, Bitmap_t *dst) {
+	if (ensureBitmap (dst, src->width, src->height, src->form) < 0) {
+		return -1;
+	}
+	job->src = src;
+	job->dst = dst;
+	job->tilesX = (src->width + TILE_WIDTH - 1) / TILE_WIDTH;
+	job->failed = 0;
+	int tilesY = (src->height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+	uint64_t trace_ns = TRACE_BEGIN ();
+	int retCode = parallelFor (job->tilesX * tilesY, 1, convolveTiles, job);
+	TRACE_END ("convolve", trace_ns);
+	return retCode < 0 || job->failed ? -1 : 0;
+}
+
+/**
+ * Odd count, sum of |taps| within gain
+ */
+static bool isValidKernel (const int16_t *k, int n, int maxTaps) {
+	if (NULL == k || n < 1 || n > maxTaps || 0 == (n & 1)) {
+		return false;
+	}
+	int gain = 0;
+	int i;
+	for (i = 0; i < n; ++i) {
+		gain += abs (k[i]);
+	}
+	return gain <= CONV_MAX_GAIN * CONV_ONE;
+}
+
+/**
+ * Convolve with separable kernel kx * ky
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int convolveSeparable (const Bitmap_t *src, const int16_t *kx, int nx,
+		const int16_t *ky, int ny, Bitmap_t *dst)
+{
+	if (!isFilterable (src, dst) ||
+			!isValidKernel (kx, nx, CONV_MAX_TAPS) || !isValidKernel (ky, ny, CONV_MAX_TAPS)) {
+		return -1;
+	}
+	ConvJob job;
+	job.kx = kx;
+	job.nx = nx;
+	job.ky = ky;
+	job.ny = ny;
+	return runConvolution (src, &job, dst);
+}
+
+/**
+ * Convolve with non-separable kernel
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int convolve2D (const Bitmap_t *src, const int16_t *kernel, int kw, int kh, Bitmap_t *dst)
+{
+	if (!isFilterable (src, dst) || NULL == kernel ||
+			kw < 1 || kw > CONV_MAX_SIDE || 0 == (kw & 1) ||
+			kh < 1 || kh > CONV_MAX_SIDE || 0 == (kh & 1)) {
+		return -1;
+	}
+	ConvJob job;
+	job.kx = kernel;
+	job.nx = kw;
+	job.ky = NULL;
+	job.ny = kh;
+	return runConvolution (src, &job, dst);
+}
+
+/**
+ * Box filter rows [y0, y1) by sliding column sums
+ */
+static void boxStrip (void *arg, int y0, int y1) {
+	BoxJob *job = (BoxJob *)arg;
+	const Bitmap_t *src = job->src;
+	int w = src->width;
+	int h = src->height;
+	int form = src->form;
+	int r = job->radius;
+	int n = w * form;
+	uint32_t half = (uint32_t)(2 * r + 1) * (2 * r + 1) / 2;
+
+	uint32_t *col = (uint32_t *)calloc (n, sizeof(uint32_t));
+	if (NULL == col) {
+		LogE ("Failed malloc box strip\n");
+		__atomic_store_n (&job->failed, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	const uint8_t *base = (const uint8_t *)src->base;
+	int x, y, c, i;
+	for (i = -r; i <= r; ++i) {
+		const uint8_t *row = base + (size_t)clampInt (y0 + i, 0, h - 1) * n;
+		for (x = 0; x < n; ++x) {
+			col[x] += row[x];
+		}
+	}
+
+	for (y = y0; y < y1; ++y) {
+		if (y > y0) {
+			const uint8_t *in = base + (size_t)clampInt (y + r, 0, h - 1) * n;
+			const uint8_t *out = base + (size_t)clampInt (y - r - 1, 0, h - 1) * n;
+			for (x = 0; x < n; ++x) {
+				col[x] += in[x] - out[x];
+			}
+		}
+
+		uint8_t *dst = (uint8_t *)job->dst->base + (size_t)y * n;
+		for (c = 0; c < form; ++c) {
+			uint32_t s = half;
+			for (i = -r; i <= r; ++i) {
+				s += col[clampInt (i, 0, w - 1) * form + c];
+			}
+			for (x = 0; x < w; ++x) {
+				dst[x * form + c] = (uint8_t)((s * job->recip) >> BOX_RECIP_BITS);
+				s += col[minInt (x + r + 1, w - 1) * form + c];
+				s -= col[maxInt (x - r, 0) * form + c];
+			}
+		}
+	}
+	free (col);
+}
+
+/**
+ * Box blur by running sums
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int boxBlur (const Bitmap_t *src, int radius, Bitmap_t *dst)
+{
+	if (!isFilterable (src, dst) || radius < 0 || radius > CONV_MAX_RADIUS) {
+		return -1;
+	}
+	if (ensureBitmap (dst, src->width, src->height, src->form) < 0) {
+		return -1;
+	}
+	if (0 == radius) {
+		memcpy (dst->base, src->base, src->width * src->height * src->form);
+		return 0;
+	}
+
+	BoxJob job;
+	job.src = src;
+	job.dst = dst;
+	job.radius = radius;
+	job.recip = ((uint64_t)1 << BOX_RECIP_BITS) / ((2 * radius + 1) * (2 * radius + 1)) + 1;
+	job.failed = 0;
+	int grain = maxInt (BOX_STRIP_ROWS, 2 * radius);
+	uint64_t trace_ns = TRACE_BEGIN ();
+	int retCode = parallelFor (src->height, grain, boxStrip, &job);
+	TRACE_END ("boxBlur", trace_ns);
+	return retCode < 0 || job.failed ? -1 : 0;
+}
+
+/**
+ * Sampled gaussian in CONV_BITS, taps sum to CONV_ONE
+ * Return:
+ *		tap count
+ */
+static int buildGaussian (float sigma, int16_t *k) {
+	int r = (int)ceilf (3.0f * sigma);
+	int n = 2 * r + 1;
+	float w[CONV_MAX_TAPS];
+	float sum = 0.0f;
+	int i;
+	for (i = 0; i < n; ++i) {
+		float d = (float)(i - r);
+		w[i] = expf (-d * d / (2.0f * sigma * sigma));
+		sum += w[i];
+	}
+	int total = 0;
+	for (i = 0; i < n; ++i) {
+		k[i] = (int16_t)lrintf (w[i] / sum * CONV_ONE);
+		total += k[i];
+	}
+	k[r] += CONV_ONE - total;
+	return n;
+}
+
+/**
+ * Radii of 3 box blurs whose variances sum to sigma^2
+ */
+static void boxRadii (float sigma, int *radii) {
+	const int n = 3;
+	float ideal = sqrtf (12.0f * sigma * sigma / n + 1.0f);
+	int lower = (int)ideal;
+	if (0 == (lower & 1)) {
+		--lower;
+	}
+	int upper = lower + 2;
+	int m = (int)lrintf ((12.0f * sigma * sigma - n * lower * lower - 4.0f * n * lower - 3.0f * n) /
+			(-4.0f * lower - 4.0f));
+	int i;
+	for (i = 0; i < n; ++i) {
+		radii[i] = ((i < m ? lower : upper) - 1) / 2;
+	}
+}
+
+/**
+ * Gaussian blur
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int gaussianBlur (const Bitmap_t *src, float sigma, Bitmap_t *dst)
+{
+	if (!isFilterable (src, dst) || !(sigma >= CONV_MIN_SIGMA && sigma <= CONV_MAX_SIGMA)) {
+		return -1;
+	}
+
+	if (sigma < GAUSS_BOX_SIGMA) {
+		int16_t k[CONV_MAX_TAPS];
+		int n = buildGaussian (sigma, k);
+		return convolveSeparable (src, k, n, k, n, dst);
+	}
+
+	int radii[3];
+	boxRadii (sigma, radii);
+	Bitmap_t tmp;
+	memset (&tmp, 0, sizeof(Bitmap_t));
+	int retCode = 0;
+	if (boxBlur (src, radii[0], dst) < 0 ||
+			boxBlur (dst, radii[1], &tmp) < 0 ||
+			boxBlur (&tmp, radii[2], dst) < 0) {
+		retCode = -1;
+	}
+	freeBitmap (&tmp);
+	return retCode;
+}
+
+/**
+ * Sharpen by 3x3 laplacian kernel
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int sharpenImage (const Bitmap_t *src, int amount, Bitmap_t *dst)
+{
+	if (amount < 0 || amount > 100) {
+		return -1;
+	}
+	int16_t a = (int16_t)(amount * CONV_ONE / 100);
+	int16_t kernel[9] = {
+		0,	-a,					0,
+		-a,	CONV_ONE + 4 * a,	-a,
+		0,	-a,					0
+	};
+	return convolve2D (src, kernel, 3, 3, dst);
+}
+
+static void unsharpRows (void *arg, int y0, int y1) {
+	UnsharpJob *job = (UnsharpJob *)arg;
+	size_t n = (size_t)job->src->width * job->src->form;
+	const uint8_t *src = (const uint8_t *)job->src->base + y0 * n;
+	const uint8_t *blur = (const uint8_t *)job->blur->base + y0 * n;
+	uint8_t *dst = (uint8_t *)job->dst->base + y0 * n;
+	size_t i;
+	for (i = 0; i < (y1 - y0) * n; ++i) {
+		int d = src[i] - blur[i];
+		dst[i] = abs (d) > job->threshold ?
+			clampByte (src[i] + ((d * job->amount + 128) >> 8)) : src[i];
+	}
+}
+
+/**
+ * Unsharp mask
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int unsharpMask (const Bitmap_t *src, float sigma, int amount, int threshold, Bitmap_t *dst)
+{
+	if (!isFilterable (src, dst) || amount < 0 || amount > 500 ||
+			threshold < 0 || threshold > 255) {
+		return -1;
+	}
+
+	Bitmap_t blur;
+	memset (&blur, 0, sizeof(Bitmap_t));
+	if (gaussianBlur (src, sigma, &blur) < 0 ||
+			ensureBitmap (dst, src->width, src->height, src->form) < 0) {
+		freeBitmap (&blur);
+		return -1;
+	}
+
+	UnsharpJob job;
+	job.src = src;
+	job.blur = &blur;
+	job.dst = dst;
+	job.amount = (amount * 256 + 50) / 100;
+	job.threshold = threshold;
+	uint64_t trace_ns = TRACE_BEGIN ();
+	int retCode = parallelFor (src->height, BOX_STRIP_ROWS, unsharpRows, &job);
+	TRACE_END ("unsharpMask", trace_ns);
+	freeBitmap (&blur);
+	return retCode;
+}
@@ -0,0 +1,113 @@
+/************************************
+ * file name:   convolve.h
+ * description: convolution filters
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __CONVOLVE__H__
+#define __CONVOLVE__H__
+
+#include <stdint.h>
+#include "imgsdk.h"
+
+// fixed point of kernel taps
+#define CONV_BITS 12
+#define CONV_ONE  (1 << CONV_BITS)
+
+// max taps of 1D kernel, max side of 2D kernel
+#define CONV_MAX_TAPS 63
+#define CONV_MAX_SIDE 15
+
+// max sum of |taps| of one axis of separable kernel, in CONV_ONE.
+// A single tap is at most 32767, just below CONV_MAX_GAIN
+#define CONV_MAX_GAIN 8
+
+// ranges of blur
+#define CONV_MAX_RADIUS 100
+#define CONV_MIN_SIGMA 0.3f
+#define CONV_MAX_SIGMA 50.0f
+
+/*
+ * All filters below work on GRAY, RGB24 and RGBA32, every channel
+ * alpha included, replicating edge pixels outside the image.
+ * dst must not be src, dst->base is reused if large enough.
+ */
+
+/**
+ * Convolve with separable kernel kx * ky
+ * Parameters:
+ *		src:	source image
+ *		kx:		horizontal taps in CONV_BITS fixed point, centered
+ *		nx:		odd tap count of kx, 1 - CONV_MAX_TAPS
+ *		ky:		vertical taps like kx
+ *		ny:		odd tap count of ky
+ *		dst:	[OUT] result
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int convolveSeparable (const Bitmap_t *src, const int16_t *kx, int nx,
+		const int16_t *ky, int ny, Bitmap_t *dst);
+
+/**
+ * Convolve with non-separable kernel
+ * Parameters:
+ *		src:	source image
+ *		kernel:	kw * kh taps row by row in CONV_BITS fixed point, centered
+ *		kw:		odd width, 1 - CONV_MAX_SIDE
+ *		kh:		odd height, 1 - CONV_MAX_SIDE
+ *		dst:	[OUT] result
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int convolve2D (const Bitmap_t *src, const int16_t *kernel, int kw, int kh, Bitmap_t *dst);
+
+/**
+ * Box blur of (2 * radius + 1)^2 window by running sums, the cost
+ * doesn't depend on radius
+ * Parameters:
+ *		radius:	0 - CONV_MAX_RADIUS, 0 copies
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int boxBlur (const Bitmap_t *src, int radius, Bitmap_t *dst);
+
+/**
+ * Gaussian blur. Small sigma convolves with a sampled kernel, larger
+ * sigma runs 3 box blurs of the same variance.
+ * Parameters:
+ *		sigma:	CONV_MIN_SIGMA - CONV_MAX_SIGMA pixels
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int gaussianBlur (const Bitmap_t *src, float sigma, Bitmap_t *dst);
+
+/**
+ * Sharpen by 3x3 laplacian kernel
+ * Parameters:
+ *		amount:	0 - 100, 100 adds 1x laplacian
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int sharpenImage (const Bitmap_t *src, int amount, Bitmap_t *dst);
+
+/**
+ * Unsharp mask: p + amount * (p - gaussian(p)) where the difference
+ * is larger than threshold
+ * Parameters:
+ *		sigma:		gaussian sigma, CONV_MIN_SIGMA - CONV_MAX_SIGMA
+ *		amount:		percent 0 - 500
+ *		threshold:	0 - 255
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int unsharpMask (const Bitmap_t *src, float sigma, int amount, int threshold, Bitmap_t *dst);
+
+#endif
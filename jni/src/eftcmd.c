@@ -7,9 +7,14 @@
  ***************************************/
 
 #include <assert.h>
+#include <string.h>
 #include "comm.h"
 #include "eftcmd.h"
 #include "cJSON.h"
+#include "convolve.h"
+#include "eye.h"
+#include "resample.h"
+#include "skin.h"
 
 static int parseNormalEffect (const cJSON *json, eftcmd_t *eftcmd) {
     if (NULL == json || NULL == eftcmd) {
@@ -17,8 +22,17 @@ static int parseNormalEffect (const cJSON *json, eftcmd_t *eftcmd) {
     }
     eftcmd->cmd = ec_NORMAL;
     eftcmd->count = 0;
-    eftcmd->params = NULL;
-    eftcmd->valid = false;
+    eftcmd->valid = true;
+    return 0;
+}
+
+static int parseGrayEffect (const cJSON *json, eftcmd_t *eftcmd) {
+    if (NULL == json || NULL == eftcmd) {
+        return -1;
+    }
+    eftcmd->cmd = ec_GRAY;
+    eftcmd->count = 0;
+    eftcmd->valid = true;
     return 0;
 }
 
@@ -35,10 +49,26 @@ static int parseRotateEffect (cJSON *json, eftcmd_t *eftcmd) {
 		LogE ("parseRotateEffect error:Invalid param type\n");
 		return -1;
 	}
+
+	// optional sampling filter of arbitrary angles
+	ResampleFilter filter = RESAMPLE_BILINEAR;
+	cJSON *jfilter = cJSON_GetObjectItem (json, "filter");
+	if (NULL != jfilter) {
+		if (jfilter->type != cJSON_String ||
+				RESAMPLE_END == (filter = getResampleFilter (jfilter->valuestring)) ||
+				(filter != RESAMPLE_BILINEAR && filter != RESAMPLE_BICUBIC)) {
+			LogE ("parseRotateEffect error:Invalid filter\n");
+			return -1;
+		}
+	}
+	if (eftcmd->capacity < 2) {
+		return -1;
+	}
     
     eftcmd->cmd = ec_ROTATE;
-    eftcmd->count = 1;
-    *(eftcmd->params) = jparam->valueint;
+    eftcmd->count = 2;
+    eftcmd->params[0] = jparam->valueint;
+    eftcmd->params[1] = filter;
     eftcmd->valid = true;
 
     return 0;
@@ -57,10 +87,29 @@ static int parseScaleEffect (cJSON *json, eftcmd_t *eftcmd) {
 		LogE ("parseScaleEffect error:Invalid param type\n");
 		return -1;
 	}
+	if (jparam->valueint < SCALE_MIN_PERCENT || jparam->valueint > SCALE_MAX_PERCENT) {
+		LogE ("parseScaleEffect error:percent out of %d - %d\n", SCALE_MIN_PERCENT, SCALE_MAX_PERCENT);
+		return -1;
+	}
+
+	// optional resampling filter
+	ResampleFilter filter = RESAMPLE_BICUBIC;
+	cJSON *jfilter = cJSON_GetObjectItem (json, "filter");
+	if (NULL != jfilter) {
+		if (jfilter->type != cJSON_String ||
+				RESAMPLE_END == (filter = getResampleFilter (jfilter->valuestring))) {
+			LogE ("parseScaleEffect error:Invalid filter\n");
+			return -1;
+		}
+	}
+	if (eftcmd->capacity < 2) {
+		return -1;
+	}
     
     eftcmd->cmd = ec_SCALE;
-    eftcmd->count = 1;
-    *(eftcmd->params) = jparam->valueint;
+    eftcmd->count = 2;
+    eftcmd->params[0] = jparam->valueint;
+    eftcmd->params[1] = filter;
     eftcmd->valid = true;
 
     return 0;
@@ -70,31 +119,34 @@ static int parseClipEffect (cJSON *json, eftcmd_t *eftcmd) {
     if (NULL == json || NULL == eftcmd){
         return -1;
     }
+    if (eftcmd->capacity < 4) {
+        return -1;
+    }
     cJSON *jparam = cJSON_GetObjectItem (json, "param");
     if (NULL == jparam) {
         return -1;
     }
 
     cJSON *jx = cJSON_GetObjectItem (jparam, "x");
-    if (jx->type != cJSON_Number) {
+    if (NULL == jx || jx->type != cJSON_Number) {
         LogE ("parseClipEffect error:Invalid param type\n");
         return -1;
     }
 
     cJSON *jy = cJSON_GetObjectItem (jparam, "y");
-    if (jy->type != cJSON_Number) {
+    if (NULL == jy || jy->type != cJSON_Number) {
         LogE ("parseClipEffect error:Invalid param type\n");
         return -1;
     }
 
     cJSON *jw = cJSON_GetObjectItem (jparam, "w");
-    if (jw->type != cJSON_Number) {
+    if (NULL == jw || jw->type != cJSON_Number) {
         LogE ("parseClipEffect error:Invalid param type\n");
         return -1;
     }
 
     cJSON *jh = cJSON_GetObjectItem (jparam, "h");
-    if (jy->type != cJSON_Number) {
+    if (NULL == jh || jh->type != cJSON_Number) {
         LogE ("parseClipEffect error:Invalid param type\n");
         return -1;
     }
@@ -107,17 +159,384 @@ static int parseClipEffect (cJSON *json, eftcmd_t *eftcmd) {
     eftcmd->params[3] = jh->valueint;
     eftcmd->valid = true;
 
-    return -1;
+    return 0;
+}
+
+/**
+ * Optional number in [min, max], keep *value if absent
+ */
+static int parseOptionalInt (const cJSON *json, const char *name, int min, int max, int *value) {
+	cJSON *jitem = cJSON_GetObjectItem ((cJSON *)json, name);
+	if (NULL == jitem) {
+		return 0;
+	}
+	if (jitem->type != cJSON_Number || jitem->valueint < min || jitem->valueint > max) {
+		LogE ("Invalid param %s\n", name);
+		return -1;
+	}
+	*value = jitem->valueint;
+	return 0;
+}
+
+/**
+ * Number in [min, max] that must be present
+ */
+static int parseRequiredInt (const cJSON *json, const char *name, int min, int max, int *value) {
+	if (NULL == cJSON_GetObjectItem ((cJSON *)json, name)) {
+		LogE ("Missing param %s\n", name);
+		return -1;
+	}
+	return parseOptionalInt (json, name, min, max, value);
 }
 
 static int parseSkinEffect (const cJSON *json, eftcmd_t *eftcmd) {
-    LogE ("Not implemented yet!\n");
-	return -1;
+    if (NULL == json || NULL == eftcmd){
+        return -1;
+    }
+    if (eftcmd->capacity < 2) {
+        return -1;
+    }
+
+	// optional window radius & strength
+	int radius = SKIN_DEFAULT_RADIUS;
+	int level = SKIN_DEFAULT_LEVEL;
+	if (parseOptionalInt (json, "radius", SKIN_MIN_RADIUS, SKIN_MAX_RADIUS, &radius) < 0 ||
+			parseOptionalInt (json, "level", 0, 100, &level) < 0) {
+		return -1;
+	}
+
+    eftcmd->cmd = ec_SKIN;
+    eftcmd->count = 2;
+    eftcmd->params[0] = radius;
+    eftcmd->params[1] = level;
+    eftcmd->valid = true;
+
+    return 0;
 }
 
 static int parseEyeEffect (const cJSON *json, eftcmd_t *eftcmd) {
-    LogE ("Not implemented yet!\n");
-	return -1;
+    if (NULL == json || NULL == eftcmd){
+        return -1;
+    }
+	cJSON *jeyes = cJSON_GetObjectItem ((cJSON *)json, "eyes");
+	if (NULL == jeyes || jeyes->type != cJSON_Array) {
+		LogE ("parseEyeEffect error:Invalid eyes\n");
+		return -1;
+	}
+	int n = cJSON_GetArraySize (jeyes);
+	if (n < 1 || n > EYE_MAX_COUNT) {
+		LogE ("parseEyeEffect error:%d eyes, 1 - %d supported\n", n, EYE_MAX_COUNT);
+		return -1;
+	}
+	if (eftcmd->capacity < 2 + 3 * n) {
+		return -1;
+	}
+
+	int zoom = EYE_DEFAULT_ZOOM;
+	int sharpen = EYE_DEFAULT_SHARPEN;
+	if (parseOptionalInt (json, "zoom", 0, 100, &zoom) < 0 ||
+			parseOptionalInt (json, "sharpen", 0, 100, &sharpen) < 0) {
+		return -1;
+	}
+
+	// params: zoom, sharpen, then x, y, radius of each eye
+	int i;
+	for (i = 0; i < n; ++i) {
+		cJSON *jeye = cJSON_GetArrayItem (jeyes, i);
+		cJSON *jx = cJSON_GetObjectItem (jeye, "x");
+		cJSON *jy = cJSON_GetObjectItem (jeye, "y");
+		cJSON *jr = cJSON_GetObjectItem (jeye, "r");
+		if (NULL == jx || jx->type != cJSON_Number ||
+				NULL == jy || jy->type != cJSON_Number ||
+				NULL == jr || jr->type != cJSON_Number ||
+				jx->valueint < -EYE_MAX_COORD || jx->valueint > EYE_MAX_COORD ||
+				jy->valueint < -EYE_MAX_COORD || jy->valueint > EYE_MAX_COORD ||
+				jr->valueint < EYE_MIN_RADIUS || jr->valueint > EYE_MAX_RADIUS) {
+			LogE ("parseEyeEffect error:Invalid eye %d\n", i);
+			return -1;
+		}
+		eftcmd->params[2 + 3 * i] = jx->valueint;
+		eftcmd->params[3 + 3 * i] = jy->valueint;
+		eftcmd->params[4 + 3 * i] = jr->valueint;
+	}
+
+    eftcmd->cmd = ec_EYE;
+    eftcmd->count = 2 + 3 * n;
+    eftcmd->params[0] = zoom;
+    eftcmd->params[1] = sharpen;
+    eftcmd->valid = true;
+
+    return 0;
+}
+
+/**
+ * Optional sigma in [CONV_MIN_SIGMA, CONV_MAX_SIGMA], to 1/SIGMA_PARAM_SCALE pixel
+ */
+static int parseOptionalSigma (const cJSON *json, int *value) {
+	cJSON *jitem = cJSON_GetObjectItem ((cJSON *)json, "sigma");
+	if (NULL == jitem) {
+		return 0;
+	}
+	if (jitem->type != cJSON_Number ||
+			!(jitem->valuedouble >= CONV_MIN_SIGMA && jitem->valuedouble <= CONV_MAX_SIGMA)) {
+		LogE ("Invalid param sigma\n");
+		return -1;
+	}
+	*value = (int)(jitem->valuedouble * SIGMA_PARAM_SCALE + 0.5);
+	return 0;
+}
+
+static int parseBlurEffect (const cJSON *json, eftcmd_t *eftcmd) {
+    if (NULL == json || NULL == eftcmd){
+        return -1;
+    }
+    if (eftcmd->capacity < 1) {
+        return -1;
+    }
+	int sigma = BLUR_DEFAULT_SIGMA;
+	if (parseOptionalSigma (json, &sigma) < 0) {
+		return -1;
+	}
+
+    eftcmd->cmd = ec_BLUR;
+    eftcmd->count = 1;
+    eftcmd->params[0] = sigma;
+    eftcmd->valid = true;
+
+    return 0;
+}
+
+static int parseBoxBlurEffect (const cJSON *json, eftcmd_t *eftcmd) {
+    if (NULL == json || NULL == eftcmd){
+        return -1;
+    }
+    if (eftcmd->capacity < 1) {
+        return -1;
+    }
+	int radius = BOX_BLUR_DEFAULT_RADIUS;
+	if (parseOptionalInt (json, "radius", 1, CONV_MAX_RADIUS, &radius) < 0) {
+		return -1;
+	}
+
+    eftcmd->cmd = ec_BOX_BLUR;
+    eftcmd->count = 1;
+    eftcmd->params[0] = radius;
+    eftcmd->valid = true;
+
+    return 0;
+}
+
+static int parseSharpenEffect (const cJSON *json, eftcmd_t *eftcmd) {
+    if (NULL == json || NULL == eftcmd){
+        return -1;
+    }
+    if (eftcmd->capacity < 1) {
+        return -1;
+    }
+	int amount = SHARPEN_DEFAULT_AMOUNT;
+	if (parseOptionalInt (json, "amount", 0, 100, &amount) < 0) {
+		return -1;
+	}
+
+    eftcmd->cmd = ec_SHARPEN;
+    eftcmd->count = 1;
+    eftcmd->params[0] = amount;
+    eftcmd->valid = true;
+
+    return 0;
+}
+
+static int parseUnsharpEffect (const cJSON *json, eftcmd_t *eftcmd) {
+    if (NULL == json || NULL == eftcmd){
+        return -1;
+    }
+    if (eftcmd->capacity < 3) {
+        return -1;
+    }
+	int sigma = UNSHARP_DEFAULT_SIGMA;
+	int amount = UNSHARP_DEFAULT_AMOUNT;
+	int threshold = 0;
+	if (parseOptionalSigma (json, &sigma) < 0 ||
+			parseOptionalInt (json, "amount", 0, 500, &amount) < 0 ||
+			parseOptionalInt (json, "threshold", 0, 255, &threshold) < 0) {
+		return -1;
+	}
+
+    eftcmd->cmd = ec_UNSHARP;
+    eftcmd->count = 3;
+    eftcmd->params[0] = sigma;
+    eftcmd->params[1] = amount;
+    eftcmd->params[2] = threshold;
+    eftcmd->valid = true;
+
+    return 0;
+}
+
+static int parseLutEffect (const cJSON *json, eftcmd_t *eftcmd) {
+    if (NULL == json || NULL == eftcmd){
+        return -1;
+    }
+    if (eftcmd->capacity < 1) {
+        return -1;
+    }
+	cJSON *jpath = cJSON_GetObjectItem ((cJSON *)json, "path");
+	if (NULL == jpath || jpath->type != cJSON_String) {
+		LogE ("parseLutEffect error:Invalid path\n");
+		return -1;
+	}
+	int len = strlen (jpath->valuestring);
+	if (0 == len || NULL == eftcmd->text || len >= eftcmd->textCapacity) {
+		LogE ("parseLutEffect error:No room for path of %d bytes\n", len);
+		return -1;
+	}
+	int intensity = 100;
+	if (parseOptionalInt (json, "intensity", 0, 100, &intensity) < 0) {
+		return -1;
+	}
+
+    eftcmd->cmd = ec_LUT;
+    eftcmd->count = 1;
+    eftcmd->params[0] = intensity;
+    memcpy (eftcmd->text, jpath->valuestring, len + 1);
+    eftcmd->valid = true;
+
+    return 0;
+}
+
+static int parseBrightnessEffect (const cJSON *json, eftcmd_t *eftcmd) {
+    if (NULL == json || NULL == eftcmd){
+        return -1;
+    }
+    if (eftcmd->capacity < 1) {
+        return -1;
+    }
+	int amount = 0;
+	if (parseRequiredInt (json, "amount", -100, 100, &amount) < 0) {
+		return -1;
+	}
+
+    eftcmd->cmd = ec_BRIGHTNESS;
+    eftcmd->count = 1;
+    eftcmd->params[0] = amount;
+    eftcmd->valid = true;
+
+    return 0;
+}
+
+static int parseContrastEffect (const cJSON *json, eftcmd_t *eftcmd) {
+    if (NULL == json || NULL == eftcmd){
+        return -1;
+    }
+    if (eftcmd->capacity < 1) {
+        return -1;
+    }
+	int amount = 0;
+	if (parseRequiredInt (json, "amount", -100, 100, &amount) < 0) {
+		return -1;
+	}
+
+    eftcmd->cmd = ec_CONTRAST;
+    eftcmd->count = 1;
+    eftcmd->params[0] = amount;
+    eftcmd->valid = true;
+
+    return 0;
+}
+
+static int parseGammaEffect (const cJSON *json, eftcmd_t *eftcmd) {
+    if (NULL == json || NULL == eftcmd){
+        return -1;
+    }
+    if (eftcmd->capacity < 1) {
+        return -1;
+    }
+	cJSON *jgamma = cJSON_GetObjectItem ((cJSON *)json, "gamma");
+	if (NULL == jgamma || jgamma->type != cJSON_Number) {
+		LogE ("parseGammaEffect error:Invalid gamma\n");
+		return -1;
+	}
+	// range check as double, NaN fails too, then it fits int
+	double scaled = jgamma->valuedouble * GAMMA_PARAM_SCALE + 0.5;
+	if (!(scaled >= GAMMA_MIN && scaled < GAMMA_MAX + 1)) {
+		LogE ("parseGammaEffect error:gamma out of range\n");
+		return -1;
+	}
+	int gamma = (int)scaled;
+
+    eftcmd->cmd = ec_GAMMA;
+    eftcmd->count = 1;
+    eftcmd->params[0] = gamma;
+    eftcmd->valid = true;
+
+    return 0;
+}
+
+static int parseCurvesEffect (const cJSON *json, eftcmd_t *eftcmd) {
+    if (NULL == json || NULL == eftcmd){
+        return -1;
+    }
+	cJSON *jpoints = cJSON_GetObjectItem ((cJSON *)json, "points");
+	if (NULL == jpoints || jpoints->type != cJSON_Array) {
+		LogE ("parseCurvesEffect error:Invalid points\n");
+		return -1;
+	}
+	int n = cJSON_GetArraySize (jpoints);
+	if (n < CURVE_MIN_POINTS || n > CURVE_MAX_POINTS) {
+		LogE ("parseCurvesEffect error:%d points, %d - %d supported\n",
+				n, CURVE_MIN_POINTS, CURVE_MAX_POINTS);
+		return -1;
+	}
+	if (eftcmd->capacity < 1 + 2 * n) {
+		return -1;
+	}
+
+	// optional channel, all by default
+	int channels = CURVE_RGB;
+	cJSON *jchannel = cJSON_GetObjectItem ((cJSON *)json, "channel");
+	if (NULL != jchannel) {
+		const char *name = jchannel->type == cJSON_String ? jchannel->valuestring : "";
+		if (strcmp (name, "rgb") == 0) {
+			channels = CURVE_RGB;
+		} else if (strcmp (name, "red") == 0) {
+			channels = CURVE_RED;
+		} else if (strcmp (name, "green") == 0) {
+			channels = CURVE_GREEN;
+		} else if (strcmp (name, "blue") == 0) {
+			channels = CURVE_BLUE;
+		} else {
+			LogE ("parseCurvesEffect error:Invalid channel\n");
+			return -1;
+		}
+	}
+
+	// params: channels, then x, y of each point
+	int i;
+	for (i = 0; i < n; ++i) {
+		cJSON *jpoint = cJSON_GetArrayItem (jpoints, i);
+		cJSON *jx = NULL;
+		cJSON *jy = NULL;
+		if (jpoint->type == cJSON_Array && cJSON_GetArraySize (jpoint) == 2) {
+			jx = cJSON_GetArrayItem (jpoint, 0);
+			jy = cJSON_GetArrayItem (jpoint, 1);
+		}
+		if (NULL == jx || jx->type != cJSON_Number ||
+				NULL == jy || jy->type != cJSON_Number ||
+				jx->valueint < 0 || jx->valueint > 255 ||
+				jy->valueint < 0 || jy->valueint > 255 ||
+				(i > 0 && jx->valueint <= eftcmd->params[2 * i - 1])) {
+			LogE ("parseCurvesEffect error:Invalid point %d\n", i);
+			return -1;
+		}
+		eftcmd->params[1 + 2 * i] = jx->valueint;
+		eftcmd->params[2 + 2 * i] = jy->valueint;
+	}
+
+    eftcmd->cmd = ec_CURVES;
+    eftcmd->count = 1 + 2 * n;
+    eftcmd->params[0] = channels;
+    eftcmd->valid = true;
+
+    return 0;
 }
 
 /**
@@ -131,7 +550,9 @@ static int parseEyeEffect (const cJSON *json, eftcmd_t *eftcmd) {
  */
 int parseEffectCmd(const char *usercmd, eftcmd_t *eftcmd) 
 {
-	VALIDATE_NOT_NULL2 (usercmd, eftcmd);
+	if (NULL == usercmd || NULL == eftcmd) {
+		return -1;
+	}
 
 	cJSON *json = cJSON_Parse (usercmd);
 	if (NULL == json) {
@@ -139,16 +560,28 @@ int parseEffectCmd(const char *usercmd, eftcmd_t *eftcmd)
 		return -1;
 	}
 
-	cJSON *jeft = cJSON_GetObjectItem (json, "effect");
-	if (NULL == jeft) {
-		LogE ("parseEffectCmd error:Invalid effect command\n");
-		cJSON_Delete (json);
+	int retCode = parseEffectItem (json, eftcmd);
+	cJSON_Delete (json);
+
+	return retCode;
+}
+
+/**
+ * Parse one effect object such as {"effect":"Rotate", "degree":90}
+ * Return:
+ *		 0 OK
+ *		-1 error
+ */
+int parseEffectItem(cJSON *json, eftcmd_t *eftcmd)
+{
+	if (NULL == json || NULL == eftcmd || json->type != cJSON_Object) {
+		LogE ("parseEffectItem error:Invalid effect command\n");
 		return -1;
 	}
 
-	if (jeft->type != cJSON_String) {
-		LogE ("parseEffectCmd error:Invalid effect command\n");
-		cJSON_Delete (json);
+	cJSON *jeft = cJSON_GetObjectItem (json, "effect");
+	if (NULL == jeft || jeft->type != cJSON_String) {
+		LogE ("parseEffectItem error:Invalid effect command\n");
 		return -1;
 	}
 
@@ -162,6 +595,14 @@ int parseEffectCmd(const char *usercmd, eftcmd_t *eftcmd)
 			retCode = 0;
 		}
 	}
+	else if (strcmp (eft, "Gray") == 0) {
+        if (parseGrayEffect (json, eftcmd) < 0) {
+            LogE ("Failed parseGrayEffect\n");
+        }
+		else {
+			retCode = 0;
+		}
+	}
     else if (strcmp(eft, "Rotate") == 0) {
         if (parseRotateEffect (json, eftcmd) < 0) {
             LogE ("Failed parseRotateEffect\n");
@@ -202,11 +643,81 @@ int parseEffectCmd(const char *usercmd, eftcmd_t *eftcmd)
 			retCode = 0;
 		}
 	}
+	else if (strcmp (eft, "Blur") == 0) {
+        if (parseBlurEffect (json, eftcmd) < 0) {
+            LogE ("Failed parseBlurEffect\n");
+        }
+		else {
+			retCode = 0;
+		}
+	}
+	else if (strcmp (eft, "BoxBlur") == 0) {
+        if (parseBoxBlurEffect (json, eftcmd) < 0) {
+            LogE ("Failed parseBoxBlurEffect\n");
+        }
+		else {
+			retCode = 0;
+		}
+	}
+	else if (strcmp (eft, "Sharpen") == 0) {
+        if (parseSharpenEffect (json, eftcmd) < 0) {
+            LogE ("Failed parseSharpenEffect\n");
+        }
+		else {
+			retCode = 0;
+		}
+	}
+	else if (strcmp (eft, "Unsharp") == 0) {
+        if (parseUnsharpEffect (json, eftcmd) < 0) {
+            LogE ("Failed parseUnsharpEffect\n");
+        }
+		else {
+			retCode = 0;
+		}
+	}
+	else if (strcmp (eft, "Lut") == 0) {
+        if (parseLutEffect (json, eftcmd) < 0) {
+            LogE ("Failed parseLutEffect\n");
+        }
+		else {
+			retCode = 0;
+		}
+	}
+	else if (strcmp (eft, "Brightness") == 0) {
+        if (parseBrightnessEffect (json, eftcmd) < 0) {
+            LogE ("Failed parseBrightnessEffect\n");
+        }
+		else {
+			retCode = 0;
+		}
+	}
+	else if (strcmp (eft, "Contrast") == 0) {
+        if (parseContrastEffect (json, eftcmd) < 0) {
+            LogE ("Failed parseContrastEffect\n");
+        }
+		else {
+			retCode = 0;
+		}
+	}
+	else if (strcmp (eft, "Gamma") == 0) {
+        if (parseGammaEffect (json, eftcmd) < 0) {
+            LogE ("Failed parseGammaEffect\n");
+        }
+		else {
+			retCode = 0;
+		}
+	}
+	else if (strcmp (eft, "Curves") == 0) {
+        if (parseCurvesEffect (json, eftcmd) < 0) {
+            LogE ("Failed parseCurvesEffect\n");
+        }
+		else {
+			retCode = 0;
+		}
+	}
     else {
         LogE ("Invalid effect command\n");
     }
 
-	cJSON_Delete (json);
-	
 	return retCode;
 }
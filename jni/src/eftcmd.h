@@ -10,26 +10,68 @@
 #define __EFTCMD__H__
 
 #include <comm.h>
+#include "cJSON.h"
 
 /*
  * Define effect command
  */
 typedef enum {
 	ec_NORMAL = 0,		// normal effect:no parameters
-	ec_ROTATE,			// roate image:1 parameters (degree)
-	ec_SCALE,			// scale image:1 parameters (zoom factor)
+	ec_ROTATE,			// roate image:2 parameters (degree, filter)
+	ec_SCALE,			// scale image:2 parameters (zoom factor, filter)
 	ec_CLIP,			// clip sub image:4 params (x, y, width, height)
-	ec_SKIN,			// skin effect 
-	ec_EYE,				// eye effect
+	ec_SKIN,			// skin effect:2 parameters (radius, level)
+	ec_EYE,				// eye effect:2 + 3n params (zoom, sharpen, x, y, radius of n eyes)
+	ec_GRAY,			// gray scale:no parameters
+	ec_BLUR,			// gaussian blur:1 parameter (sigma)
+	ec_BOX_BLUR,		// box blur:1 parameter (radius)
+	ec_SHARPEN,			// laplacian sharpen:1 parameter (amount)
+	ec_UNSHARP,			// unsharp mask:3 parameters (sigma, amount, threshold)
+	ec_LUT,				// 3D color LUT:1 parameter (intensity), text (file path)
+	ec_BRIGHTNESS,		// brightness:1 parameter (amount)
+	ec_CONTRAST,		// contrast:1 parameter (amount)
+	ec_GAMMA,			// gamma:1 parameter (gamma)
+	ec_CURVES,			// tone curve:1 + 2n params (channels, x, y of n points)
 	ec_END				// == end == 
 } ecEnum;
 
+// sigma parameters are in 1 / SIGMA_PARAM_SCALE pixel
+#define SIGMA_PARAM_SCALE 100
+
+// defaults of filter cmds, sigma in SIGMA_PARAM_SCALE
+#define BLUR_DEFAULT_SIGMA 200
+#define BOX_BLUR_DEFAULT_RADIUS 3
+#define SHARPEN_DEFAULT_AMOUNT 50
+#define UNSHARP_DEFAULT_SIGMA 100
+#define UNSHARP_DEFAULT_AMOUNT 100
+
+// scale percent
+#define SCALE_MIN_PERCENT 1
+#define SCALE_MAX_PERCENT 1000
+
+// gamma parameter is in 1 / GAMMA_PARAM_SCALE, out = in ^ (1 / gamma)
+#define GAMMA_PARAM_SCALE 100
+#define GAMMA_MIN 10
+#define GAMMA_MAX 1000
+
+// points of tone curve, x ascending in 0 - 255
+#define CURVE_MIN_POINTS 2
+#define CURVE_MAX_POINTS 7
+
+// channels of tone curve
+#define CURVE_RED   1
+#define CURVE_GREEN 2
+#define CURVE_BLUE  4
+#define CURVE_RGB   (CURVE_RED | CURVE_GREEN | CURVE_BLUE)
+
 typedef struct {
 	ecEnum	 cmd;		    // effect command
 	bool     valid;	        // if the cmd is valid 
 	int		 count;	        // parameter count
 	int		 *params;	    // params
     int      capacity;      // capacity of paramSet
+    char     *text;         // text param such as file path, may be NULL
+    int      textCapacity;  // capacity of text
 } eftcmd_t;
 
 /**
@@ -43,4 +85,15 @@ typedef struct {
  */
 int parseEffectCmd(const char *userCmd, eftcmd_t *eftcmd);
 
+/**
+ * Parse one effect object of user cmd
+ * Params:
+ *		json:		[IN]  effect object
+ *		eftcmd:		[OUT] effect cmd
+ * Return:
+ *		 0 OK
+ *		-1 error
+ */
+int parseEffectItem(cJSON *json, eftcmd_t *eftcmd);
+
 #endif
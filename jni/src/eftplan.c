@@ -0,0 +1,717 @@
+/***************************************
+ * file name:   eftplan.c
+ * description: implement effect plan
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <malloc.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "comm.h"
+#include "convolve.h"
+#include "eftplan.h"
+#include "eye.h"
+#include "resample.h"
+#include "rotate.h"
+#include "skin.h"
+
+#define PI 3.14159265358979f
+
+// BT.601 luma
+#define LUMA_R 0.299f
+#define LUMA_G 0.587f
+#define LUMA_B 0.114f
+
+static PassType passTypeOf (ecEnum cmd) {
+	switch (cmd) {
+		case ec_ROTATE:
+		case ec_SCALE:
+		case ec_CLIP:
+			return PASS_GEOMETRY;
+		case ec_GRAY:
+		case ec_BRIGHTNESS:
+		case ec_CONTRAST:
+		case ec_GAMMA:
+		case ec_CURVES:
+			return PASS_POINT;
+		case ec_LUT:
+			return PASS_LUT;
+		default:
+			return PASS_FILTER;
+	}
+}
+
+/**
+ * Color matrix of step mixing channels
+ * Return:
+ *		true if step is one
+ */
+static bool stepColor (const EftStep_t *step, float *c) {
+	if (ec_GRAY != step->cmd) {
+		return false;
+	}
+	memset (c, 0, 12 * sizeof(float));
+	int i;
+	for (i = 0; i < 3; ++i) {
+		c[i * 4 + 0] = LUMA_R;
+		c[i * 4 + 1] = LUMA_G;
+		c[i * 4 + 2] = LUMA_B;
+	}
+	return true;
+}
+
+static EftPass_t* newPass (EftPlan_t *plan, PassType type, int first) {
+	EftPass_t *pass = &plan->passes[plan->nPasses++];
+	pass->type = type;
+	pass->first = first;
+	pass->count = 0;
+	identityPointOp (&pass->point);
+	return pass;
+}
+
+/**
+ * Fuse adjacent steps of the same pass type. Point ops compose into
+ * tables; a second color matrix of a pass starts a new pass.
+ */
+static void compilePlan (EftPlan_t *plan) {
+	plan->nPasses = 0;
+	int i;
+	for (i = 0; i < plan->nSteps; ++i) {
+		const EftStep_t *step = &plan->steps[i];
+		PassType type = passTypeOf (step->cmd);
+		EftPass_t *pass = plan->nPasses > 0 ? &plan->passes[plan->nPasses - 1] : NULL;
+		if (NULL == pass || pass->type != type || PASS_FILTER == type || PASS_LUT == type) {
+			pass = newPass (plan, type, i);
+		}
+
+		if (PASS_POINT == type) {
+			float c[12];
+			uint8_t table[3][256];
+			if (stepColor (step, c)) {
+				if (appendPointColor (&pass->point, c) < 0) {
+					pass = newPass (plan, type, i);
+					appendPointColor (&pass->point, c);
+				}
+			} else if (pointTableOf (step->cmd, step->params, step->count, table) == 0) {
+				appendPointTable (&pass->point, table);
+			}
+		}
+		++pass->count;
+	}
+}
+
+static int addPlanStep (EftPlan_t *plan, cJSON *json) {
+	if (plan->nSteps >= PLAN_MAX_STEPS) {
+		LogE ("Too many effect steps, max %d\n", PLAN_MAX_STEPS);
+		return -1;
+	}
+
+	EftStep_t *step = &plan->steps[plan->nSteps];
+	eftcmd_t cmd;
+	memset (&cmd, 0, sizeof(eftcmd_t));
+	cmd.params = step->params;
+	cmd.capacity = PLAN_MAX_PARAMS;
+	cmd.text = plan->text + plan->nText;
+	cmd.textCapacity = PLAN_MAX_TEXT - plan->nText;
+	cmd.text[0] = '\0';
+	if (parseEffectItem (json, &cmd) < 0) {
+		return -1;
+	}
+
+	// Normal changes nothing
+	if (ec_NORMAL != cmd.cmd) {
+		step->cmd = cmd.cmd;
+		step->count = cmd.count;
+		step->text = -1;
+		if ('\0' != cmd.text[0]) {
+			step->text = plan->nText;
+			plan->nText += strlen (cmd.text) + 1;
+		}
+		++plan->nSteps;
+	}
+	return 0;
+}
+
+/**
+ * Parse user cmd to plan
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int parseEffectPlan(const char *userCmd, EftPlan_t *plan)
+{
+	if (NULL == userCmd || NULL == plan) {
+		return -1;
+	}
+
+	cJSON *json = cJSON_Parse (userCmd);
+	if (NULL == json) {
+		LogE ("parseEffectPlan error:%s\n", cJSON_GetErrorPtr() );
+		return -1;
+	}
+
+	EftPlan_t tmp;
+	memset (&tmp, 0, sizeof(EftPlan_t));
+	int retCode = 0;
+	if (cJSON_Array == json->type) {
+		int count = cJSON_GetArraySize (json);
+		int i;
+		for (i = 0; i < count && 0 == retCode; ++i) {
+			retCode = addPlanStep (&tmp, cJSON_GetArrayItem (json, i));
+		}
+	} else {
+		retCode = addPlanStep (&tmp, json);
+	}
+	cJSON_Delete (json);
+
+	if (retCode < 0) {
+		return -1;
+	}
+	compilePlan (&tmp);
+	memcpy (plan, &tmp, sizeof(EftPlan_t));
+	return 0;
+}
+
+/**
+ * Split the leading Clip effects off user cmd
+ * Return:
+ *		 0 OK
+ *		 1 cmd doesn't start with Clip
+ *		-1 ERROR
+ */
+int splitEffectClip(const char *userCmd, Rect_t *rect, char **rest)
+{
+	if (NULL == userCmd || NULL == rect || NULL == rest) {
+		return -1;
+	}
+
+	cJSON *json = cJSON_Parse (userCmd);
+	if (NULL == json) {
+		LogE ("splitEffectClip error:%s\n", cJSON_GetErrorPtr() );
+		return -1;
+	}
+
+	// region as edges in source coordinates, the image bounds them later
+	int64_t left = 0;
+	int64_t top = 0;
+	int64_t right = INT32_MAX;
+	int64_t bottom = INT32_MAX;
+	bool isArray = cJSON_Array == json->type;
+	int count = isArray ? cJSON_GetArraySize (json) : 1;
+	int clips = 0;
+	int retCode = 0;
+	for (; clips < count; ++clips) {
+		int params[PLAN_MAX_PARAMS];
+		char text[PLAN_MAX_TEXT];
+		eftcmd_t cmd;
+		memset (&cmd, 0, sizeof(eftcmd_t));
+		cmd.params = params;
+		cmd.capacity = PLAN_MAX_PARAMS;
+		cmd.text = text;
+		cmd.textCapacity = PLAN_MAX_TEXT;
+		if (parseEffectItem (isArray ? cJSON_GetArrayItem (json, clips) : json, &cmd) < 0) {
+			retCode = -1;
+			break;
+		}
+		if (ec_CLIP != cmd.cmd) {
+			break;
+		}
+
+		// the same as bindGeometryPass, relative to the last clip
+		int64_t x = params[0];
+		int64_t y = params[1];
+		int64_t r = left + x + params[2];
+		int64_t b = top + y + params[3];
+		left += x > 0 ? x : 0;
+		top += y > 0 ? y : 0;
+		right = r < right ? r : right;
+		bottom = b < bottom ? b : bottom;
+		if (right <= left || bottom <= top) {
+			LogE ("Clip region is empty\n");
+			retCode = -1;
+			break;
+		}
+	}
+
+	if (0 == retCode && 0 == clips) {
+		retCode = 1;
+	}
+	if (0 == retCode) {
+		rect->x = (int)left;
+		rect->y = (int)top;
+		rect->width = (int)(right - left);
+		rect->height = (int)(bottom - top);
+		if (clips < count) {
+			int i;
+			for (i = 0; i < clips; ++i) {
+				cJSON_DeleteItemFromArray (json, 0);
+			}
+			*rest = cJSON_PrintUnformatted (json);
+		} else {
+			*rest = strdup ("{\"effect\":\"Normal\"}");
+		}
+		if (NULL == *rest) {
+			LogE ("Failed malloc rest cmd\n");
+			retCode = -1;
+		}
+	}
+	cJSON_Delete (json);
+	return retCode;
+}
+
+/**
+ * a = b * a, both are 2x3 affine matrices
+ */
+static void concatAffine (const float *b, float *a) {
+	float r[6];
+	r[0] = b[0] * a[0] + b[1] * a[3];
+	r[1] = b[0] * a[1] + b[1] * a[4];
+	r[2] = b[0] * a[2] + b[1] * a[5] + b[2];
+	r[3] = b[3] * a[0] + b[4] * a[3];
+	r[4] = b[3] * a[1] + b[4] * a[4];
+	r[5] = b[3] * a[2] + b[4] * a[5] + b[5];
+	memcpy (a, r, sizeof(r));
+}
+
+static float snapZero (float v) {
+	return fabsf (v) < 1e-6f ? 0.0f : v;
+}
+
+/**
+ * Resolve geometry pass for the source size
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int bindGeometryPass(const EftPlan_t *plan, const EftPass_t *pass,
+		int width, int height, bool bottomUp, Affine_t *affine)
+{
+	if (NULL == plan || NULL == pass || NULL == affine ||
+			PASS_GEOMETRY != pass->type || width <= 0 || height <= 0) {
+		return -1;
+	}
+
+	// forward map: source -> output, in continuous pixel coordinates
+	float fwd[6] = { 1, 0, 0, 0, 1, 0 };
+	int w = width;
+	int h = height;
+	if (bottomUp) {
+		float flip[6] = { 1, 0, 0, 0, -1, (float)h };
+		concatAffine (flip, fwd);
+	}
+
+	int i;
+	for (i = pass->first; i < pass->first + pass->count; ++i) {
+		const EftStep_t *step = &plan->steps[i];
+		switch (step->cmd) {
+			case ec_ROTATE: {
+				// clockwise, the canvas grows to hold the whole image
+				float rad = step->params[0] * PI / 180.0f;
+				float c = snapZero (cosf (rad));
+				float s = snapZero (sinf (rad));
+				int nw, nh;
+				getRotatedSize (w, h, step->params[0], &nw, &nh);
+				float toCenter[6] = { 1, 0, -w / 2.0f, 0, 1, -h / 2.0f };
+				float rotate[6] = { c, -s, 0, s, c, 0 };
+				float fromCenter[6] = { 1, 0, nw / 2.0f, 0, 1, nh / 2.0f };
+				concatAffine (toCenter, fwd);
+				concatAffine (rotate, fwd);
+				concatAffine (fromCenter, fwd);
+				w = nw;
+				h = nh;
+				break;
+			}
+
+			case ec_SCALE: {
+				int percent = step->params[0];
+				if (percent <= 0) {
+					LogE ("Invalid scale percent %d\n", percent);
+					return -1;
+				}
+				int nw = (int)((int64_t)w * percent / 100);
+				int nh = (int)((int64_t)h * percent / 100);
+				nw = nw > 0 ? nw : 1;
+				nh = nh > 0 ? nh : 1;
+				float scale[6] = { (float)nw / w, 0, 0, 0, (float)nh / h, 0 };
+				concatAffine (scale, fwd);
+				w = nw;
+				h = nh;
+				break;
+			}
+
+			case ec_CLIP: {
+				int x0 = step->params[0] > 0 ? step->params[0] : 0;
+				int y0 = step->params[1] > 0 ? step->params[1] : 0;
+				int64_t x1 = (int64_t)step->params[0] + step->params[2];
+				int64_t y1 = (int64_t)step->params[1] + step->params[3];
+				x1 = x1 < w ? x1 : w;
+				y1 = y1 < h ? y1 : h;
+				if (x1 <= x0 || y1 <= y0) {
+					LogE ("Clip region is out of image\n");
+					return -1;
+				}
+				float move[6] = { 1, 0, (float)-x0, 0, 1, (float)-y0 };
+				concatAffine (move, fwd);
+				w = (int)x1 - x0;
+				h = (int)y1 - y0;
+				break;
+			}
+
+			default:
+				return -1;
+		}
+		if (w > PLAN_MAX_SIZE || h > PLAN_MAX_SIZE) {
+			LogE ("Image %d x %d is larger than %d\n", w, h, PLAN_MAX_SIZE);
+			return -1;
+		}
+	}
+
+	if (bottomUp) {
+		float flip[6] = { 1, 0, 0, 0, -1, (float)h };
+		concatAffine (flip, fwd);
+	}
+
+	// invert to output -> source
+	float det = fwd[0] * fwd[4] - fwd[1] * fwd[3];
+	if (fabsf (det) < 1e-12f) {
+		return -1;
+	}
+	float *m = affine->m;
+	m[0] =  fwd[4] / det;
+	m[1] = -fwd[1] / det;
+	m[3] = -fwd[3] / det;
+	m[4] =  fwd[0] / det;
+	m[2] = -(m[0] * fwd[2] + m[1] * fwd[5]);
+	m[5] = -(m[3] * fwd[2] + m[4] * fwd[5]);
+
+	// sample at pixel centers, return pixel index coordinates
+	m[2] += 0.5f * (m[0] + m[1]) - 0.5f;
+	m[5] += 0.5f * (m[3] + m[4]) - 0.5f;
+
+	affine->width = w;
+	affine->height = h;
+	return 0;
+}
+
+/**
+ * Whether the pass only scales, then the separable resampler is used
+ */
+static bool isScaleOnly (const EftPlan_t *plan, const EftPass_t *pass) {
+	int i;
+	for (i = pass->first; i < pass->first + pass->count; ++i) {
+		if (ec_SCALE != plan->steps[i].cmd) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Rotation the pass does by itself, without resampling through affine
+ * Params:
+ *		degree:		[OUT] clockwise, in the image's storage order
+ *		filter:		[OUT] sampling filter of arbitrary angle
+ * Return:
+ *		 true	the pass is quarter turns, or one rotation of any angle
+ */
+static bool getPassRotation (const EftPlan_t *plan, const EftPass_t *pass,
+		bool bottomUp, int *degree, ResampleFilter *filter) {
+	int sum = 0;
+	int i;
+	for (i = pass->first; i < pass->first + pass->count; ++i) {
+		const EftStep_t *step = &plan->steps[i];
+		if (ec_ROTATE != step->cmd) {
+			return false;
+		}
+		// every rotation grows the canvas, they can't be summed
+		if (0 != step->params[0] % 90 && pass->count > 1) {
+			return false;
+		}
+		sum += step->params[0] % 360;
+		*filter = step->params[1];
+	}
+
+	// rows stored bottom-up turn the other way
+	*degree = bottomUp ? -sum : sum;
+	return true;
+}
+
+static unsigned char clampByte (float v) {
+	if (v <= 0.0f) {
+		return 0;
+	}
+	if (v >= 255.0f) {
+		return 255;
+	}
+	return (unsigned char)(v + 0.5f);
+}
+
+/**
+ * Bilinear resampling through affine, color ops fused
+ * Parameters:
+ *		point:	ops of the following point pass, NULL if none
+ */
+static void resampleAffine (const Bitmap_t *src, const Affine_t *af,
+		const PointMap_t *point, Bitmap_t *dst) {
+	const float *m = af->m;
+	const unsigned char *base = (const unsigned char *)src->base;
+	int form = src->form;
+	int sw = src->width;
+	int sh = src->height;
+	int stride = sw * form;
+	unsigned char *out = (unsigned char *)dst->base;
+
+	int x, y, k;
+	for (y = 0; y < af->height; ++y) {
+		float sx = m[1] * y + m[2];
+		float sy = m[4] * y + m[5];
+		unsigned char *row = out;
+		for (x = 0; x < af->width; ++x, sx += m[0], sy += m[3], out += form) {
+			if (sx < -0.5f || sy < -0.5f || sx > sw - 0.5f || sy > sh - 0.5f) {
+				memset (out, 0, form);
+				continue;
+			}
+
+			int x0 = (int)floorf (sx);
+			int y0 = (int)floorf (sy);
+			float ax = sx - x0;
+			float ay = sy - y0;
+			int x1 = x0 + 1 < sw ? x0 + 1 : sw - 1;
+			int y1 = y0 + 1 < sh ? y0 + 1 : sh - 1;
+			x0 = x0 > 0 ? x0 : 0;
+			y0 = y0 > 0 ? y0 : 0;
+
+			const unsigned char *p00 = base + y0 * stride + x0 * form;
+			const unsigned char *p01 = base + y0 * stride + x1 * form;
+			const unsigned char *p10 = base + y1 * stride + x0 * form;
+			const unsigned char *p11 = base + y1 * stride + x1 * form;
+			for (k = 0; k < form; ++k) {
+				float top = p00[k] + (p01[k] - p00[k]) * ax;
+				float bottom = p10[k] + (p11[k] - p10[k]) * ax;
+				out[k] = clampByte (top + (bottom - top) * ay);
+			}
+		}
+
+		// the row is still in cache
+		if (NULL != point) {
+			mapPointRow (point, row, row, af->width, form);
+		}
+	}
+}
+
+static bool isConvolution (ecEnum cmd) {
+	return ec_BLUR == cmd || ec_BOX_BLUR == cmd || ec_SHARPEN == cmd || ec_UNSHARP == cmd;
+}
+
+static int runConvolutionStep (const EftStep_t *step, const Bitmap_t *src, Bitmap_t *dst) {
+	const int *p = step->params;
+	switch (step->cmd) {
+		case ec_BLUR:
+			return gaussianBlur (src, (float)p[0] / SIGMA_PARAM_SCALE, dst);
+		case ec_BOX_BLUR:
+			return boxBlur (src, p[0], dst);
+		case ec_SHARPEN:
+			return sharpenImage (src, p[0], dst);
+		case ec_UNSHARP:
+			return unsharpMask (src, (float)p[0] / SIGMA_PARAM_SCALE, p[1], p[2], dst);
+		default:
+			return -1;
+	}
+}
+
+/**
+ * Run the first nPasses passes of plan
+ * Return:
+ *		 1 plan doesn't change the image
+ *		 0 OK
+ *		-1 ERROR
+ */
+int runEffectPasses(const EftPlan_t *plan, int nPasses, LutCache *luts,
+		const Bitmap_t *src, bool bottomUp, Bitmap_t *dst)
+{
+	if (NULL == plan || NULL == src || NULL == src->base || NULL == dst ||
+			nPasses < 0 || nPasses > plan->nPasses) {
+		return -1;
+	}
+	if (0 == nPasses) {
+		return 1;
+	}
+	if (src->form != GRAY && src->form != RGB24 && src->form != RGBA32) {
+		LogE ("Unsupported pixel format %d in plan\n", src->form);
+		return -1;
+	}
+
+	uint64_t trace_ns = TRACE_BEGIN ();
+	Bitmap_t tmp;
+	memset (&tmp, 0, sizeof(Bitmap_t));
+	const Bitmap_t *cur = src;
+	int retCode = 0;
+	int i;
+	for (i = 0; i < nPasses && 0 == retCode; ++i) {
+		const EftPass_t *pass = &plan->passes[i];
+		Bitmap_t *out = (cur == dst) ? &tmp : dst;
+
+		if (PASS_GEOMETRY == pass->type) {
+			Affine_t af;
+			if (bindGeometryPass (plan, pass, cur->width, cur->height, bottomUp, &af) < 0 ||
+					ensureBitmap (out, af.width, af.height, cur->form) < 0) {
+				retCode = -1;
+				break;
+			}
+
+			if (isScaleOnly (plan, pass)) {
+				// filter of the last scale step wins
+				ResampleFilter filter = plan->steps[pass->first + pass->count - 1].params[1];
+				if (resampleImage (cur, af.width, af.height, filter, out) < 0) {
+					retCode = -1;
+					break;
+				}
+				cur = out;
+				continue;
+			}
+
+			int degree;
+			ResampleFilter filter;
+			if (getPassRotation (plan, pass, bottomUp, &degree, &filter)) {
+				if (rotateImage (cur, degree, filter, out) < 0) {
+					retCode = -1;
+					break;
+				}
+				cur = out;
+				continue;
+			}
+
+			// fuse the following color ops into resampling
+			PointMap_t *point = NULL;
+			if (i + 1 < nPasses && PASS_POINT == plan->passes[i + 1].type) {
+				point = (PointMap_t *)malloc (sizeof(PointMap_t));
+				if (NULL == point) {
+					retCode = -1;
+					break;
+				}
+				bindPointOp (&plan->passes[++i].point, point);
+			}
+			uint64_t pass_ns = TRACE_BEGIN ();
+			resampleAffine (cur, &af, point, out);
+			TRACE_END ("resampleAffine", pass_ns);
+			free (point);
+			cur = out;
+		}
+		else if (PASS_POINT == pass->type) {
+			// in place unless it's the caller's image
+			if (cur == src) {
+				if (ensureBitmap (out, cur->width, cur->height, cur->form) < 0) {
+					retCode = -1;
+					break;
+				}
+			} else {
+				out = (Bitmap_t *)cur;
+			}
+			if (applyPointOp (cur, &pass->point, out) < 0) {
+				retCode = -1;
+				break;
+			}
+			cur = out;
+		}
+		else if (PASS_LUT == pass->type) {
+			const EftStep_t *step = &plan->steps[pass->first];
+			const Lut3D_t *lut = getLut3D (luts, plan->text + step->text);
+			if (NULL == lut) {
+				retCode = -1;
+				break;
+			}
+			// in place unless it's the caller's image
+			if (cur != src) {
+				out = (Bitmap_t *)cur;
+			}
+			if (applyLut3D (cur, lut, step->params[0], out) < 0) {
+				retCode = -1;
+				break;
+			}
+			cur = out;
+		}
+		else {
+			const EftStep_t *step = &plan->steps[pass->first];
+			if (ec_SKIN == step->cmd) {
+				// out is never cur here
+				if (smoothSkin (cur, step->params[0], step->params[1], out) < 0) {
+					retCode = -1;
+					break;
+				}
+				cur = out;
+				continue;
+			}
+			if (isConvolution (step->cmd)) {
+				if (runConvolutionStep (step, cur, out) < 0) {
+					retCode = -1;
+					break;
+				}
+				cur = out;
+				continue;
+			}
+			if (ec_EYE == step->cmd) {
+				// touches the eyes only, in place unless it's the caller's image
+				if (cur == src) {
+					if (ensureBitmap (out, cur->width, cur->height, cur->form) < 0) {
+						retCode = -1;
+						break;
+					}
+					memcpy (out->base, cur->base, cur->width * cur->height * cur->form);
+				} else {
+					out = (Bitmap_t *)cur;
+				}
+				Eye_t eyes[EYE_MAX_COUNT];
+				int n = (step->count - 2) / 3;
+				int k;
+				for (k = 0; k < n; ++k) {
+					eyes[k].x = step->params[2 + 3 * k];
+					eyes[k].y = step->params[3 + 3 * k];
+					eyes[k].radius = step->params[4 + 3 * k];
+					if (bottomUp) {
+						eyes[k].y = out->height - 1 - eyes[k].y;
+					}
+				}
+				if (enhanceEyes (out, eyes, n, step->params[0], step->params[1]) < 0) {
+					retCode = -1;
+					break;
+				}
+				cur = out;
+				continue;
+			}
+			LogE ("Effect %d is not supported in plan\n", step->cmd);
+			retCode = -1;
+		}
+	}
+
+	// result must be in dst, in the row order of src
+	if (0 == retCode && cur == &tmp) {
+		Bitmap_t swap = *dst;
+		*dst = tmp;
+		tmp = swap;
+	}
+	if (0 == retCode) {
+		dst->bottomUp = bottomUp;
+	}
+	freeBitmap (&tmp);
+	TRACE_END ("effectPlan", trace_ns);
+	return retCode;
+}
+
+/**
+ * Run plan on image
+ * Return:
+ *		 1 plan doesn't change the image
+ *		 0 OK
+ *		-1 ERROR
+ */
+int runEffectPlan(const EftPlan_t *plan, LutCache *luts,
+		const Bitmap_t *src, bool bottomUp, Bitmap_t *dst)
+{
+	if (NULL == plan) {
+		return -1;
+	}
+	return runEffectPasses (plan, plan->nPasses, luts, src, bottomUp, dst);
+}
@@ -0,0 +1,145 @@
+/************************************
+ * file name:   eftplan.h
+ * description: compile effect commands into an execution plan
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __EFTPLAN__H__
+#define __EFTPLAN__H__
+
+#include "eftcmd.h"
+#include "imgsdk.h"
+#include "lutcache.h"
+#include "pointop.h"
+
+// max effect steps in one user cmd
+#define PLAN_MAX_STEPS 16
+
+// max parameters of one step, Curves of 7 points takes 15
+#define PLAN_MAX_PARAMS 16
+
+// bytes of text params of all steps, e.g. LUT paths
+#define PLAN_MAX_TEXT 1024
+
+// largest side of an image out of a geometry pass
+#define PLAN_MAX_SIZE 32768
+
+/**
+ * Pass of the plan. Adjacent steps of the same kind are fused into
+ * one pass, so every pixel is touched once per pass.
+ */
+typedef enum {
+	PASS_GEOMETRY = 0,	// rotate, scale, clip: one affine resampling
+	PASS_POINT,			// per-pixel color ops: lookup tables & one color matrix
+	PASS_FILTER,		// ops reading neighbour pixels, never fused
+	PASS_LUT			// 3D color LUT, never fused
+} PassType;
+
+/**
+ * One effect of user cmd
+ */
+typedef struct {
+	ecEnum	cmd;						// effect command
+	int		count;						// parameter count
+	int		params[PLAN_MAX_PARAMS];	// params
+	int		text;						// offset of text param in plan text, -1 none
+} EftStep_t;
+
+typedef struct {
+	PassType	type;
+	int			first;			// index of the first step
+	int			count;			// step count
+	PointOp_t	point;			// PASS_POINT: ops composed
+} EftPass_t;
+
+typedef struct {
+	EftStep_t	steps[PLAN_MAX_STEPS];
+	int			nSteps;
+	EftPass_t	passes[PLAN_MAX_STEPS];
+	int			nPasses;
+	char		text[PLAN_MAX_TEXT];	// text params, '\0' terminated
+	int			nText;
+} EftPlan_t;
+
+/**
+ * Geometry pass bound to an image size.
+ * Output pixel (x, y) samples source at
+ *		sx = m[0] * x + m[1] * y + m[2]
+ *		sy = m[3] * x + m[4] * y + m[5]
+ */
+typedef struct {
+	float	m[6];
+	int		width;			// output width
+	int		height;			// output height
+} Affine_t;
+
+/**
+ * Parse user cmd to plan. User cmd is an effect object or an array
+ * of effect objects run in order, e.g.
+ *	[{"effect":"Rotate","degree":90}, {"effect":"Scale","percent":50},
+ *	 {"effect":"Gray"}]
+ * Params:
+ *		userCmd:	[IN]  cmd user input
+ *		plan:		[OUT] plan
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int parseEffectPlan(const char *userCmd, EftPlan_t *plan);
+
+/**
+ * Split the leading Clip effects off user cmd, so that only the
+ * clipped region of image needs decoding (see roidec.h)
+ * Params:
+ *		userCmd:	[IN]  cmd user input
+ *		rect:		[OUT] region of source image, not clipped to image size
+ *		rest:		[OUT] cmd of the effects after the clips, free() it
+ * Return:
+ *		 0 OK
+ *		 1 cmd doesn't start with Clip
+ *		-1 ERROR
+ */
+int splitEffectClip(const char *userCmd, Rect_t *rect, char **rest);
+
+/**
+ * Resolve geometry pass for the source size
+ * Params:
+ *		plan:		plan
+ *		pass:		geometry pass of plan
+ *		width:		source width
+ *		height:		source height
+ *		bottomUp:	source rows are stored bottom-up (read_jpeg)
+ *		affine:		[OUT] output to source mapping
+ * Return:
+ *		 0 OK
+ *		-1 ERROR, e.g. the image is clipped to empty
+ */
+int bindGeometryPass(const EftPlan_t *plan, const EftPass_t *pass,
+		int width, int height, bool bottomUp, Affine_t *affine);
+
+/**
+ * Run plan on image
+ * Params:
+ *		plan:		plan
+ *		luts:		LUTs of Lut steps, NULL if plan has none
+ *		src:		source image
+ *		bottomUp:	source rows are stored bottom-up (read_jpeg)
+ *		dst:		[OUT] result, dst->base is reused if large enough
+ * Return:
+ *		 1 plan doesn't change the image, dst is untouched
+ *		 0 OK
+ *		-1 ERROR
+ */
+int runEffectPlan(const EftPlan_t *plan, LutCache *luts,
+		const Bitmap_t *src, bool bottomUp, Bitmap_t *dst);
+
+/**
+ * Run the first nPasses passes of plan, the rest may run elsewhere
+ * (e.g. a trailing LUT pass on GPU). See runEffectPlan.
+ */
+int runEffectPasses(const EftPlan_t *plan, int nPasses, LutCache *luts,
+		const Bitmap_t *src, bool bottomUp, Bitmap_t *dst);
+
+#endif
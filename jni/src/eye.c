@@ -0,0 +1,206 @@
+/***************************************
+ * file name:   eye.c
+ * description: implement eye enhancement
+ *
+ *	For a pixel at distance d < r from the center, t = (d / r)^2:
+ *		warp:		sample at center + (p - center) * (1 - k * (1 - t))
+ *		sharpen:	q = w + a * (1 - t) * (w - box3x3(w))
+ *	The warp maps the circle onto itself, so an eye only reads its
+ *	bounding box and 1 pixel around, which is copied to a tile first.
+ *
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <malloc.h>
+#include <stdint.h>
+#include <string.h>
+#include "comm.h"
+#include "eye.h"
+
+// center magnification is 1 / (1 - EYE_MAX_ZOOM) at zoom 100
+#define EYE_MAX_ZOOM 0.4f
+
+// unsharp amount at the center at sharpen 100
+#define EYE_MAX_SHARPEN 1.5f
+
+typedef struct {
+	uint8_t		*src;		// bounding box of eye & 1 pixel border
+	uint8_t		*warp;		// src warped
+	int			x;			// tile position in image
+	int			y;
+	int			width;
+	int			height;
+} EyeTile;
+
+static inline int maxInt (int a, int b) {
+	return a > b ? a : b;
+}
+
+static inline int minInt (int a, int b) {
+	return a < b ? a : b;
+}
+
+static inline uint8_t clampByte (float v) {
+	return v <= 0.0f ? 0 : (v >= 255.0f ? 255 : (uint8_t)(v + 0.5f));
+}
+
+/**
+ * Bilinear sample of tile src at tile coordinates (fx, fy)
+ */
+static void sampleTile (const EyeTile *tile, int form, float fx, float fy, uint8_t *out) {
+	fx = fx < 0.0f ? 0.0f : (fx > tile->width - 1 ? tile->width - 1 : fx);
+	fy = fy < 0.0f ? 0.0f : (fy > tile->height - 1 ? tile->height - 1 : fy);
+	int x0 = (int)fx;
+	int y0 = (int)fy;
+	int x1 = minInt (x0 + 1, tile->width - 1);
+	int y1 = minInt (y0 + 1, tile->height - 1);
+	float ax = fx - x0;
+	float ay = fy - y0;
+
+	int stride = tile->width * form;
+	const uint8_t *p00 = tile->src + y0 * stride + x0 * form;
+	const uint8_t *p01 = tile->src + y0 * stride + x1 * form;
+	const uint8_t *p10 = tile->src + y1 * stride + x0 * form;
+	const uint8_t *p11 = tile->src + y1 * stride + x1 * form;
+	int c;
+	for (c = 0; c < form; ++c) {
+		float top = p00[c] + (p01[c] - p00[c]) * ax;
+		float bottom = p10[c] + (p11[c] - p10[c]) * ax;
+		out[c] = clampByte (top + (bottom - top) * ay);
+	}
+}
+
+static void enhanceEye (Bitmap_t *img, const Eye_t *eye, float zoom, float sharpen, EyeTile *tile) {
+	int w = img->width;
+	int h = img->height;
+	int form = img->form;
+	int cn = RGBA32 == form ? 3 : form;
+	int r = eye->radius;
+
+	// bounding box of circle, the center may be far outside
+	if ((int64_t)eye->x + r < 0 || (int64_t)eye->y + r < 0 ||
+			(int64_t)eye->x - r >= w || (int64_t)eye->y - r >= h) {
+		return;
+	}
+	int x0 = maxInt (eye->x - r, 0);
+	int y0 = maxInt (eye->y - r, 0);
+	int x1 = minInt (eye->x + r + 1, w);
+	int y1 = minInt (eye->y + r + 1, h);
+	if (x1 <= x0 || y1 <= y0) {
+		return;
+	}
+
+	tile->x = maxInt (x0 - 1, 0);
+	tile->y = maxInt (y0 - 1, 0);
+	tile->width = minInt (x1 + 1, w) - tile->x;
+	tile->height = minInt (y1 + 1, h) - tile->y;
+	int stride = tile->width * form;
+	int y, x, c;
+	for (y = 0; y < tile->height; ++y) {
+		memcpy (tile->src + y * stride,
+				img->base + ((size_t)(tile->y + y) * w + tile->x) * form, stride);
+	}
+	memcpy (tile->warp, tile->src, tile->height * stride);
+
+	float r2 = (float)r * r;
+	for (y = y0; y < y1; ++y) {
+		float dy = (float)(y - eye->y);
+		uint8_t *out = tile->warp + (y - tile->y) * stride + (x0 - tile->x) * form;
+		for (x = x0; x < x1; ++x, out += form) {
+			float dx = (float)(x - eye->x);
+			float t = (dx * dx + dy * dy) / r2;
+			if (t >= 1.0f) {
+				continue;
+			}
+			float s = 1.0f - zoom * (1.0f - t);
+			sampleTile (tile, form, eye->x + dx * s - tile->x, eye->y + dy * s - tile->y, out);
+		}
+	}
+
+	for (y = y0; y < y1; ++y) {
+		float dy = (float)(y - eye->y);
+		int ty = y - tile->y;
+		const uint8_t *rows[3] = {
+			tile->warp + maxInt (ty - 1, 0) * stride,
+			tile->warp + ty * stride,
+			tile->warp + minInt (ty + 1, tile->height - 1) * stride
+		};
+		uint8_t *out = (uint8_t *)img->base + ((size_t)y * w + x0) * form;
+		for (x = x0; x < x1; ++x, out += form) {
+			float dx = (float)(x - eye->x);
+			float t = (dx * dx + dy * dy) / r2;
+			if (t >= 1.0f) {
+				continue;
+			}
+			int tx = x - tile->x;
+			int left = maxInt (tx - 1, 0) * form;
+			int right = minInt (tx + 1, tile->width - 1) * form;
+			int center = tx * form;
+			float amount = sharpen * (1.0f - t);
+			for (c = 0; c < cn; ++c) {
+				int sum = 0;
+				int i;
+				for (i = 0; i < 3; ++i) {
+					sum += rows[i][left + c] + rows[i][center + c] + rows[i][right + c];
+				}
+				float v = rows[1][center + c];
+				out[c] = clampByte (v + amount * (v - sum / 9.0f));
+			}
+			if (cn < form) {
+				out[cn] = rows[1][center + cn];
+			}
+		}
+	}
+}
+
+/**
+ * Enlarge and sharpen eyes in place
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int enhanceEyes (Bitmap_t *img, const Eye_t *eyes, int count, int zoom, int sharpen)
+{
+	if (NULL == img || NULL == img->base || NULL == eyes || count < 0 ||
+			zoom < 0 || zoom > 100 || sharpen < 0 || sharpen > 100) {
+		return -1;
+	}
+	if (img->form != GRAY && img->form != RGB24 && img->form != RGBA32) {
+		LogE ("Unsupported pixel format %d in eye\n", img->form);
+		return -1;
+	}
+
+	// tiles of the largest eye
+	int side = 0;
+	int i;
+	for (i = 0; i < count; ++i) {
+		if (eyes[i].radius < EYE_MIN_RADIUS || eyes[i].radius > EYE_MAX_RADIUS) {
+			LogE ("Invalid eye radius %d\n", eyes[i].radius);
+			return -1;
+		}
+		side = maxInt (side, 2 * eyes[i].radius + 3);
+	}
+	if (0 == side) {
+		return 0;
+	}
+
+	EyeTile tile;
+	size_t size = (size_t)side * side * img->form;
+	tile.src = (uint8_t *)malloc (2 * size);
+	if (NULL == tile.src) {
+		LogE ("Failed malloc eye tile\n");
+		return -1;
+	}
+	tile.warp = tile.src + size;
+
+	uint64_t trace_ns = TRACE_BEGIN ();
+	for (i = 0; i < count; ++i) {
+		enhanceEye (img, &eyes[i], zoom * EYE_MAX_ZOOM / 100.0f,
+				sharpen * EYE_MAX_SHARPEN / 100.0f, &tile);
+	}
+	TRACE_END ("enhanceEyes", trace_ns);
+	free (tile.src);
+	return 0;
+}
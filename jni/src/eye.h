@@ -0,0 +1,52 @@
+/************************************
+ * file name:   eye.h
+ * description: eye enhancement effect
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __EYE__H__
+#define __EYE__H__
+
+#include "imgsdk.h"
+
+// max eyes of one Eye cmd
+#define EYE_MAX_COUNT 2
+
+// radius range of an eye
+#define EYE_MIN_RADIUS 1
+#define EYE_MAX_RADIUS 512
+
+// range of eye centers, -EYE_MAX_COORD - EYE_MAX_COORD
+#define EYE_MAX_COORD (1 << 24)
+
+// defaults of eye cmd
+#define EYE_DEFAULT_ZOOM 30
+#define EYE_DEFAULT_SHARPEN 40
+
+typedef struct {
+	int		x;			// center
+	int		y;
+	int		radius;
+} Eye_t;
+
+/**
+ * Enlarge and sharpen eyes in place.
+ * Inside the circle of an eye pixels are pulled toward the center
+ * (strongest at the center, none at the rim) then unsharp-masked
+ * with the same falloff. Only the bounding box of each eye is read
+ * and written, so the cost depends on the eye size, not the image.
+ * Parameters:
+ *		img:		[IN/OUT] GRAY, RGB24 or RGBA32 image, alpha isn't sharpened
+ *		eyes:		eye circles in img coordinates, may be partly outside
+ *		count:		eye count
+ *		zoom:		enlarge strength 0 - 100
+ *		sharpen:	sharpen strength 0 - 100
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int enhanceEyes (Bitmap_t *img, const Eye_t *eyes, int count, int zoom, int sharpen);
+
+#endif
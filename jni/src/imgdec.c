@@ -0,0 +1,558 @@
+/***************************************
+ * file name:   imgdec.c
+ * description: implement incremental image decoder
+ *				png:  libpng progressive reader
+ *				jpeg: libjpeg with a suspending data source
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <malloc.h>
+#include <setjmp.h>
+#include <string.h>
+#include "comm.h"
+#include "imgdec.h"
+#include "jpeglib.h"
+#include "jerror.h"
+#include "png.h"
+
+// bytes needed to sniff the image format
+#define SNIFF_LEN 8
+
+// initial capability of jpeg input buffer
+#define JPEG_SOURCE_CAPABILITY 4096
+
+/**
+ * Decoder state
+ */
+typedef enum {
+	DEC_HEADER = 0,		// waiting for header
+	DEC_START,			// header is parsed, start decompress
+	DEC_ROWS,			// reading rows
+	DEC_FINISH,			// all rows are read, read the tail
+	DEC_DONE,			// complete
+	DEC_ERROR			// failed
+} DecState;
+
+/**
+ * Suspending jpeg data source.
+ * The unconsumed bytes are kept in buf, because libjpeg rewinds
+ * next_input_byte to the last restart point when it suspends.
+ */
+typedef struct {
+	struct jpeg_source_mgr pub;
+	JOCTET	*buf;			// buffered input
+	int		size;			// bytes in buf
+	int		capability;		// capability of buf
+	long	skip;			// bytes still to skip
+	bool	eof;			// no more data
+} JpegSource;
+
+/**
+ * Jpeg error manager. Never exit() on corrupt network data
+ */
+typedef struct {
+	struct jpeg_error_mgr pub;
+	jmp_buf jmp;
+} JpegError;
+
+struct ImgDecoder {
+	ImageType	type;				// image format
+	DecState	state;				// decoder state
+	Bitmap_t	bitmap;				// decoded pixels
+	int			rows;				// rows decoded completely
+
+	char		sniff[SNIFF_LEN];	// first bytes when type is unknown
+	int			nSniff;				// length of sniff
+
+	struct jpeg_decompress_struct jds;
+	JpegError	jerr;
+	JpegSource	jsrc;
+	bool		jpegCreated;
+
+	png_structp	png;
+	png_infop	pngInfo;
+	int			passes;				// png interlace passes
+};
+
+static ImageType sniffImageType (const char *data, int len) {
+	const unsigned char *p = (const unsigned char *)data;
+	if (len >= 3 && 0xFF == p[0] && 0xD8 == p[1] && 0xFF == p[2]) {
+		return IMAGE_JPG;
+	}
+	if (len >= SNIFF_LEN && 0 == png_sig_cmp ((png_const_bytep)data, 0, SNIFF_LEN)) {
+		return IMAGE_PNG;
+	}
+	return IMAGE_UNKNOWN;
+}
+
+static int allocDecoderBitmap (ImgDecoder *dec, int width, int height, int form) {
+	if (width <= 0 || height <= 0 || form < GRAY || form > RGBA32) {
+		LogE ("Invalid image %d x %d form=%d\n", width, height, form);
+		return -1;
+	}
+	size_t size = (size_t)width * height * form;
+	dec->bitmap.base = (char *)calloc (size, 1);
+	if (NULL == dec->bitmap.base) {
+		LogE ("Failed calloc mem for %d x %d\n", width, height);
+		return -1;
+	}
+	dec->bitmap.width = width;
+	dec->bitmap.height = height;
+	dec->bitmap.form = form;
+	LogD ("[stream %d x %d form=%d]\n", width, height, form);
+	return 0;
+}
+
+/*
+ * ========== jpeg ==========
+ */
+
+static void initJpegSource (j_decompress_ptr cinfo) {
+	// no work necessary here
+}
+
+static boolean fillJpegSource (j_decompress_ptr cinfo) {
+	static const JOCTET fakeEOI[2] = { 0xFF, JPEG_EOI };
+	JpegSource *src = (JpegSource *)cinfo->src;
+	if (!src->eof) {
+		// suspend until next feedImgDecoder
+		return FALSE;
+	}
+
+	// truncated stream, output the rows received so far
+	WARNMS (cinfo, JWRN_JPEG_EOF);
+	src->pub.next_input_byte = fakeEOI;
+	src->pub.bytes_in_buffer = 2;
+	return TRUE;
+}
+
+static void skipJpegSource (j_decompress_ptr cinfo, long count) {
+	JpegSource *src = (JpegSource *)cinfo->src;
+	if (count <= 0) {
+		return;
+	}
+	if ((size_t)count > src->pub.bytes_in_buffer) {
+		src->skip = count - src->pub.bytes_in_buffer;
+		src->pub.next_input_byte += src->pub.bytes_in_buffer;
+		src->pub.bytes_in_buffer = 0;
+	} else {
+		src->pub.next_input_byte += count;
+		src->pub.bytes_in_buffer -= count;
+	}
+}
+
+static void termJpegSource (j_decompress_ptr cinfo) {
+	// no work necessary here
+}
+
+/**
+ * Drop the consumed bytes and append the new chunk
+ */
+static int appendJpegSource (JpegSource *src, const char *data, int len) {
+	int remain = (int)src->pub.bytes_in_buffer;
+	if (remain > 0 && src->pub.next_input_byte != src->buf) {
+		memmove (src->buf, src->pub.next_input_byte, remain);
+	}
+	src->size = remain;
+
+	if (src->skip > 0) {
+		int n = len < src->skip ? len : (int)src->skip;
+		src->skip -= n;
+		data += n;
+		len -= n;
+	}
+
+	if (src->size + len > src->capability) {
+		int cap = src->capability * 2;
+		if (cap < src->size + len) {
+			cap = src->size + len;
+		}
+		JOCTET *buf = (JOCTET *)realloc (src->buf, cap);
+		if (NULL == buf) {
+			LogE ("Failed realloc jpeg source buffer\n");
+			return -1;
+		}
+		src->buf = buf;
+		src->capability = cap;
+	}
+
+	if (len > 0) {
+		memcpy (src->buf + src->size, data, len);
+		src->size += len;
+	}
+	src->pub.next_input_byte = src->buf;
+	src->pub.bytes_in_buffer = src->size;
+	return 0;
+}
+
+static void onJpegError (j_common_ptr cinfo) {
+	JpegError *err = (JpegError *)cinfo->err;
+	char msg[JMSG_LENGTH_MAX];
+	(*cinfo->err->format_message) (cinfo, msg);
+	LogE ("jpeg decode error:%s\n", msg);
+	longjmp (err->jmp, 1);
+}
+
+static int initJpegDecoder (ImgDecoder *dec) {
+	dec->jds.err = jpeg_std_error (&dec->jerr.pub);
+	dec->jerr.pub.error_exit = onJpegError;
+	if (setjmp (dec->jerr.jmp)) {
+		return -1;
+	}
+	jpeg_create_decompress (&dec->jds);
+	dec->jpegCreated = true;
+
+	dec->jsrc.buf = (JOCTET *)malloc (JPEG_SOURCE_CAPABILITY);
+	if (NULL == dec->jsrc.buf) {
+		LogE ("Failed malloc jpeg source buffer\n");
+		return -1;
+	}
+	dec->jsrc.capability = JPEG_SOURCE_CAPABILITY;
+	dec->jsrc.pub.init_source = initJpegSource;
+	dec->jsrc.pub.fill_input_buffer = fillJpegSource;
+	dec->jsrc.pub.skip_input_data = skipJpegSource;
+	dec->jsrc.pub.resync_to_restart = jpeg_resync_to_restart;
+	dec->jsrc.pub.term_source = termJpegSource;
+	dec->jsrc.pub.next_input_byte = dec->jsrc.buf;
+	dec->jsrc.pub.bytes_in_buffer = 0;
+	dec->jds.src = &dec->jsrc.pub;
+	return 0;
+}
+
+/**
+ * Run the jpeg state machine until it suspends or completes
+ */
+static int decodeJpeg (ImgDecoder *dec) {
+	struct jpeg_decompress_struct *jds = &dec->jds;
+	if (setjmp (dec->jerr.jmp)) {
+		dec->state = DEC_ERROR;
+		return -1;
+	}
+
+	if (DEC_HEADER == dec->state) {
+		if (JPEG_SUSPENDED == jpeg_read_header (jds, TRUE)) {
+			return 0;
+		}
+		if (1 == jds->num_components) {
+			jds->out_color_space = JCS_GRAYSCALE;
+		} else if (3 == jds->num_components) {
+			jds->out_color_space = JCS_RGB;
+		} else {
+			LogE ("Not supported jpeg components:%d\n", jds->num_components);
+			dec->state = DEC_ERROR;
+			return -1;
+		}
+		jpeg_calc_output_dimensions (jds);
+		if (allocDecoderBitmap (dec, jds->output_width, jds->output_height,
+					jds->output_components) < 0) {
+			dec->state = DEC_ERROR;
+			return -1;
+		}
+		dec->state = DEC_START;
+	}
+
+	if (DEC_START == dec->state) {
+		// progressive jpeg absorbs the whole input here
+		if (!jpeg_start_decompress (jds)) {
+			return 0;
+		}
+		dec->state = DEC_ROWS;
+	}
+
+	if (DEC_ROWS == dec->state) {
+		int stride = dec->bitmap.width * dec->bitmap.form;
+		while (jds->output_scanline < jds->output_height) {
+			JSAMPROW row = (JSAMPROW)(dec->bitmap.base + jds->output_scanline * stride);
+			if (0 == jpeg_read_scanlines (jds, &row, 1)) {
+				return 0;
+			}
+			dec->rows = jds->output_scanline;
+		}
+		dec->state = DEC_FINISH;
+	}
+
+	if (DEC_FINISH == dec->state) {
+		if (!jpeg_finish_decompress (jds)) {
+			return 0;
+		}
+		dec->state = DEC_DONE;
+	}
+
+	return 0;
+}
+
+/*
+ * ========== png ==========
+ */
+
+static void onPngInfo (png_structp png, png_infop info) {
+	ImgDecoder *dec = (ImgDecoder *)png_get_progressive_ptr (png);
+	int type = png_get_color_type (png, info);
+
+	// normalize to gray, rgb or rgba 8 bits
+	png_set_expand (png);
+	png_set_strip_16 (png);
+	if (PNG_COLOR_TYPE_GRAY_ALPHA == type ||
+			(PNG_COLOR_TYPE_GRAY == type && png_get_valid (png, info, PNG_INFO_tRNS))) {
+		png_set_gray_to_rgb (png);
+	}
+	dec->passes = png_set_interlace_handling (png);
+	png_read_update_info (png, info);
+
+	if (allocDecoderBitmap (dec, png_get_image_width (png, info),
+				png_get_image_height (png, info),
+				png_get_channels (png, info)) < 0) {
+		png_error (png, "Failed alloc bitmap");
+	}
+	dec->state = DEC_ROWS;
+}
+
+static void onPngRow (png_structp png, png_bytep row, png_uint_32 rowNum, int pass) {
+	ImgDecoder *dec = (ImgDecoder *)png_get_progressive_ptr (png);
+
+	// no new data for this row in this pass
+	if (NULL == row) {
+		return;
+	}
+
+	png_bytep dst = (png_bytep)dec->bitmap.base + rowNum * dec->bitmap.width * dec->bitmap.form;
+	png_progressive_combine_row (png, dst, row);
+
+	// rows are final only in the last interlace pass
+	if (pass == dec->passes - 1) {
+		dec->rows = rowNum + 1;
+	}
+}
+
+static void onPngEnd (png_structp png, png_infop info) {
+	ImgDecoder *dec = (ImgDecoder *)png_get_progressive_ptr (png);
+	dec->rows = dec->bitmap.height;
+	dec->state = DEC_DONE;
+}
+
+static int initPngDecoder (ImgDecoder *dec) {
+	dec->png = png_create_read_struct (PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (NULL == dec->png) {
+		LogE ("Failed png_create_read_struct\n");
+		return -1;
+	}
+	dec->pngInfo = png_create_info_struct (dec->png);
+	if (NULL == dec->pngInfo) {
+		LogE ("Failed png_create_info_struct\n");
+		return -1;
+	}
+	png_set_progressive_read_fn (dec->png, dec, onPngInfo, onPngRow, onPngEnd);
+	return 0;
+}
+
+static int decodePng (ImgDecoder *dec, const char *data, int len) {
+	if (setjmp (png_jmpbuf (dec->png))) {
+		dec->state = DEC_ERROR;
+		return -1;
+	}
+	png_process_data (dec->png, dec->pngInfo, (png_bytep)data, len);
+	return 0;
+}
+
+/*
+ * ========== decoder ==========
+ */
+
+static int initCodec (ImgDecoder *dec, ImageType type) {
+	dec->type = type;
+	if (IMAGE_JPG == type) {
+		return initJpegDecoder (dec);
+	}
+	else if (IMAGE_PNG == type) {
+		return initPngDecoder (dec);
+	}
+	return -1;
+}
+
+static int feedCodec (ImgDecoder *dec, const char *data, int len) {
+	if (IMAGE_JPG == dec->type) {
+		if (appendJpegSource (&dec->jsrc, data, len) < 0) {
+			dec->state = DEC_ERROR;
+			return -1;
+		}
+		return decodeJpeg (dec);
+	}
+	return decodePng (dec, data, len);
+}
+
+/**
+ * Create an incremental decoder
+ * Parameters:
+ *		type:	IMAGE_PNG or IMAGE_JPG.
+ *				IMAGE_UNKNOWN means sniff the format from the first bytes
+ * Return:
+ *		NULL if ERROR
+ */
+ImgDecoder* newImgDecoder (ImageType type)
+{
+	ImgDecoder *dec = (ImgDecoder *)calloc (1, sizeof(ImgDecoder));
+	if (NULL == dec) {
+		LogE ("Failed calloc ImgDecoder\n");
+		return NULL;
+	}
+
+	dec->state = DEC_HEADER;
+	if (IMAGE_UNKNOWN != type && initCodec (dec, type) < 0) {
+		LogE ("Failed init codec for image type %d\n", type);
+		freeImgDecoder (dec);
+		return NULL;
+	}
+	return dec;
+}
+
+/**
+ * Release the decoder and the bitmap it owns
+ */
+void freeImgDecoder (ImgDecoder *dec)
+{
+	if (NULL == dec) {
+		return;
+	}
+	if (dec->jpegCreated) {
+		jpeg_destroy_decompress (&dec->jds);
+	}
+	if (NULL != dec->jsrc.buf) {
+		free (dec->jsrc.buf);
+	}
+	if (NULL != dec->png) {
+		png_destroy_read_struct (&dec->png, &dec->pngInfo, NULL);
+	}
+	freeBitmap (&dec->bitmap);
+	free (dec);
+}
+
+/**
+ * Feed the next chunk of encoded data, and decode as far as possible
+ * Return:
+ *		 0 OK (need more data or complete)
+ *		-1 ERROR
+ */
+int feedImgDecoder (ImgDecoder *dec, const char *data, int len)
+{
+	if (NULL == dec || len < 0 || (NULL == data && len > 0)) {
+		return -1;
+	}
+	if (DEC_ERROR == dec->state) {
+		return -1;
+	}
+	if (DEC_DONE == dec->state) {
+		// ignore trailing bytes
+		return 0;
+	}
+
+	if (IMAGE_UNKNOWN == dec->type) {
+		int n = SNIFF_LEN - dec->nSniff;
+		if (n > len) {
+			n = len;
+		}
+		memcpy (dec->sniff + dec->nSniff, data, n);
+		dec->nSniff += n;
+		data += n;
+		len -= n;
+
+		ImageType type = sniffImageType (dec->sniff, dec->nSniff);
+		if (IMAGE_UNKNOWN == type) {
+			if (dec->nSniff < SNIFF_LEN) {
+				return 0;
+			}
+			LogE ("Unknown image format in stream\n");
+			dec->state = DEC_ERROR;
+			return -1;
+		}
+		if (initCodec (dec, type) < 0 || feedCodec (dec, dec->sniff, dec->nSniff) < 0) {
+			dec->state = DEC_ERROR;
+			return -1;
+		}
+	}
+
+	return feedCodec (dec, data, len);
+}
+
+/**
+ * Tell the decoder there is no more data.
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int finishImgDecoder (ImgDecoder *dec)
+{
+	if (NULL == dec || DEC_ERROR == dec->state) {
+		return -1;
+	}
+	if (DEC_DONE == dec->state) {
+		return 0;
+	}
+	if (IMAGE_UNKNOWN == dec->type) {
+		LogE ("Stream is too short to sniff image format\n");
+		dec->state = DEC_ERROR;
+		return -1;
+	}
+
+	if (IMAGE_JPG == dec->type) {
+		dec->jsrc.eof = true;
+		if (decodeJpeg (dec) < 0) {
+			return -1;
+		}
+	}
+
+	if (DEC_DONE != dec->state) {
+		LogE ("Stream is truncated, %d rows decoded\n", dec->rows);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Get the bitmap being decoded
+ * Return:
+ *		NULL if the header is not parsed yet
+ */
+const Bitmap_t* getImgDecoderBitmap (const ImgDecoder *dec)
+{
+	if (NULL == dec || NULL == dec->bitmap.base) {
+		return NULL;
+	}
+	return &dec->bitmap;
+}
+
+/**
+ * Get the count of rows decoded completely
+ */
+int getImgDecoderRows (const ImgDecoder *dec)
+{
+	if (NULL == dec) {
+		return 0;
+	}
+	return dec->rows;
+}
+
+/**
+ * Check if the whole image is decoded
+ */
+bool isImgDecoderComplete (const ImgDecoder *dec)
+{
+	return NULL != dec && DEC_DONE == dec->state;
+}
+
+/**
+ * Take the bitmap away from decoder. The caller must call freeBitmap
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int detachImgDecoderBitmap (ImgDecoder *dec, Bitmap_t *mem)
+{
+	if (NULL == dec || NULL == mem || NULL == dec->bitmap.base) {
+		return -1;
+	}
+	*mem = dec->bitmap;
+	dec->bitmap.base = NULL;
+	return 0;
+}
@@ -0,0 +1,89 @@
+/************************************
+ * file name:   imgdec.h
+ * description: push-style incremental image decoder
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __IMGDEC__H__
+#define __IMGDEC__H__
+
+#include "comm.h"
+#include "imgsdk.h"
+
+/**
+ * Incremental decoder defined in imgdec.c. It's not visible to user
+ * The caller feeds the encoded bytes as they arrive (from network for
+ * example), and polls the rows decoded so far.
+ */
+struct ImgDecoder;
+typedef struct ImgDecoder ImgDecoder;
+
+/**
+ * Create an incremental decoder
+ * Parameters:
+ *		type:	IMAGE_PNG or IMAGE_JPG.
+ *				IMAGE_UNKNOWN means sniff the format from the first bytes
+ * Return:
+ *		NULL if ERROR
+ */
+ImgDecoder* newImgDecoder (ImageType type);
+
+/**
+ * Release the decoder and the bitmap it owns
+ */
+void freeImgDecoder (ImgDecoder *dec);
+
+/**
+ * Feed the next chunk of encoded data, and decode as far as possible
+ * Parameters:
+ *		dec:	decoder instance
+ *		data:	encoded bytes
+ *		len:	length of data
+ * Return:
+ *		 0 OK (need more data or complete)
+ *		-1 ERROR (the decoder is unusable after that)
+ */
+int feedImgDecoder (ImgDecoder *dec, const char *data, int len);
+
+/**
+ * Tell the decoder there is no more data.
+ * A truncated jpeg stream is padded with a fake EOI, so the rows
+ * received so far are still available.
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int finishImgDecoder (ImgDecoder *dec);
+
+/**
+ * Get the bitmap being decoded
+ * Return:
+ *		NULL if the header is not parsed yet
+ * Notice:
+ *		Rows are stored top-down in arrival order (unlike read_jpeg,
+ *		the jpeg rows are NOT flipped). Only the first
+ *		getImgDecoderRows() rows are valid.
+ */
+const Bitmap_t* getImgDecoderBitmap (const ImgDecoder *dec);
+
+/**
+ * Get the count of rows decoded completely
+ */
+int getImgDecoderRows (const ImgDecoder *dec);
+
+/**
+ * Check if the whole image is decoded
+ */
+bool isImgDecoderComplete (const ImgDecoder *dec);
+
+/**
+ * Take the bitmap away from decoder. The caller must call freeBitmap
+ * Return:
+ *		 0 OK
+ *		-1 ERROR (the header is not parsed yet)
+ */
+int detachImgDecoderBitmap (ImgDecoder *dec, Bitmap_t *mem);
+
+#endif
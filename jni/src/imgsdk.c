@@ -10,21 +10,27 @@
  ***************************************************************/
 
 #include <assert.h>
+#include <limits.h>
 #include <malloc.h>
 #include <math.h>
 #include <pthread.h>
 #include <string.h>
 #include <sys/time.h>
 #include <sys/types.h>
-#include <android/asset_manager.h>
-#include <android_native_app_glue.h>
 #include <GLES2/gl2.h>
 #include "chrbuf.h"
 #include "comm.h"
 #include "eftcmd.h"
+#include "eftplan.h"
 #include "imgsdk.h"
 #include "jpeglib.h"
+#include "lut3d.h"
+#include "lutcache.h"
+#include "plancache.h"
+#include "progcache.h"
 #include "png.h"
+#include "texpool.h"
+#include "tiler.h"
 #include "utility.h"
 
 // user cmd default capability
@@ -39,12 +45,6 @@ typedef enum ActiveType {
     ACTIVE_PATH = 2,		// input path is active
 } ActiveType;
 
-typedef enum ImageType {
-	IMAGE_UNKNOWN = 0,	// unknown image type
-	IMAGE_PNG,			// png format
-	IMAGE_JPG			// jpg format
-} ImageType;
-
 /**
  * User's image information
  */
@@ -58,7 +58,7 @@ typedef struct {
     ActiveType		active;			// which is active ( param or pixel) 
     PixForm_e		pixfmt;			// pixel format
     PlatformType	platform;		// 0 Android, 1 iOS
-    const void		*platformData;	// AssetManager* in Android
+    const void		*platformData;	// see readPlatformAsset
     char            *vertSource;    // vertex shader source
     int             nVertSource;    // length of vertSource
     char            *fragSource;    // fragment shader source
@@ -70,16 +70,17 @@ typedef struct {
  * You may update me When you process image
  */
 typedef struct CommHandle {
-    GLuint program;				// program handler
-    GLuint vertShader;			// vertex shader handle
-    GLuint fragShader;			// fragment shader handle
+    GLuint program;				// program handler, owned by program cache
     GLint positionIdx;		    // attribute vec3 aPosition
-    GLuint texture1Idx;         // texture handle
-    GLuint texture2Idx;         // texture handle
+    GLuint texture1Idx;         // input texture of the image, owned by pool
+    GLuint texture2Idx;         // render target of the image, owned by pool
     GLuint sampler2dIdx;        // sampler handler
     GLuint texCoordIdx;         // texture coordinate
     GLuint colorIdx;            // attribute color
-    GLuint fboIdx;				// framebuffer id
+    GLuint fboIdx;				// framebuffer of texture2
+    GLenum fboStatus;			// glCheckFramebufferStatus of fboIdx
+    GLsizei texWidth;			// width of texture1 & texture2
+    GLsizei texHeight;			// height of texture1 & texture2
 } CommHandle;
 
 /**
@@ -94,6 +95,103 @@ typedef struct eglEnv {
     EGLNativeWindowType window;	// ignore in off-screen render)
 } eglEnv;
 
+/**
+ * GL state of a trailing Lut pass. GLES2 has no 3D texture, so the
+ * LUT is a grid of blue slices in a 2D texture, red along x & green
+ * along y of a slice, and the shader blends 2 slices by hand.
+ */
+typedef struct {
+    GLuint program;             // 0 until the first Lut pass
+    bool failed;                // program can't be built, stay on CPU
+    GLint positionIdx;          // attribute vec2 aPosition
+    GLint imageIdx;             // sampler2D uImage
+    GLint lutIdx;               // sampler2D uLut
+    GLint gridIdx;              // vec4 uLutGrid
+    GLint intensityIdx;         // float uIntensity
+    GLuint table;               // grid texture
+    uint32_t tableId;           // id of the LUT in table, 0 none
+    int size;                   // nodes per axis
+    int cols;                   // slices per row of grid
+    int rows;                   // slice rows of grid
+    GLuint output;              // mapped image, owned by pool
+    bool active;                // output holds the image to render
+} LutGpu;
+
+/*
+ * GLES 3 entries of async readback. GLES 2 headers of old NDKs lack
+ * them, so they're found by eglGetProcAddress on a GLES 3 context.
+ */
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER            0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ                  0x88E1
+#endif
+#ifndef GL_MAP_READ_BIT
+#define GL_MAP_READ_BIT                 0x0001
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE   0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT      0x00000001
+#endif
+#ifndef GL_TIMEOUT_EXPIRED
+#define GL_TIMEOUT_EXPIRED              0x911B
+#endif
+#ifndef GL_WAIT_FAILED
+#define GL_WAIT_FAILED                  0x911D
+#endif
+
+typedef void* (GL_APIENTRY *MapBufferRangeFunc) (GLenum target, GLintptr offset,
+        GLsizeiptr length, GLbitfield access);
+typedef GLboolean (GL_APIENTRY *UnmapBufferFunc) (GLenum target);
+typedef void* (GL_APIENTRY *FenceSyncFunc) (GLenum condition, GLbitfield flags);
+typedef GLenum (GL_APIENTRY *ClientWaitSyncFunc) (void *sync, GLbitfield flags, uint64_t timeout);
+typedef void (GL_APIENTRY *DeleteSyncFunc) (void *sync);
+
+// one wait for a fence in ns, waits again on timeout
+#define FENCE_WAIT_NS 1000000000ULL
+
+/**
+ * Image submitted by submitImage
+ */
+typedef struct {
+    Bitmap_t *out;              // image to fill
+    GLuint pbo;                 // pixel pack buffer, 0 on GLES 2
+    GLsizeiptr pboSize;         // storage size of pbo
+    void *fence;                // GLsync after reading into pbo
+    int result;                 // readback result on GLES 2
+    uint64_t readNs;            // readback time spent in submitImage
+} ReadSlot;
+
+/**
+ * Readback slots in order of submitting
+ */
+typedef struct {
+    bool async;                 // GLES 3 entries are found
+    MapBufferRangeFunc mapBufferRange;
+    UnmapBufferFunc unmapBuffer;
+    FenceSyncFunc fenceSync;
+    ClientWaitSyncFunc clientWaitSync;
+    DeleteSyncFunc deleteSync;
+    ReadSlot slots[READBACK_SLOTS];
+    int head;                   // oldest pending slot
+    int count;                  // pending slots
+} Readback;
+
+/**
+ * Rendering of images beyond maxSize tile by tile. On GLES 3 a tile is
+ * read into a pixel pack buffer & converted while the next one renders.
+ */
+typedef struct {
+    int maxSize;                // largest side rendered whole
+    GLuint pbo[2];              // pixel pack buffers of tiles in turn, 0 on GLES 2
+    GLsizeiptr pboSize[2];      // storage size of pbo
+    char *stage;                // source pixels of a tile
+    int nStage;                 // size of stage
+} Tiles;
+
 /**
  * ImageSDK callback function
  */
@@ -137,8 +235,39 @@ typedef struct SdkEnv {
     // user cmd
     chrbuf_t *userCmd;
 
-    // effect cmd
-    eftcmd_t effectCmd;
+    // compiled plans of recent user cmds
+    PlanCache *plans;
+
+    // plan of current user cmd, owned by plans
+    const EftPlan_t *plan;
+
+    // result of the plan on CPU, reused between images
+    Bitmap_t planned;
+
+    // loaded LUTs of Lut effects
+    LutCache *luts;
+
+    // trailing Lut pass on GPU
+    LutGpu lutGpu;
+
+    // textures & framebuffers by size, reused between images
+    TexPool *textures;
+
+    // linked programs, the effect program & the LUT one live together
+    ProgCache *programs;
+
+    // images submitted & not collected
+    Readback readback;
+
+    // tiled rendering of large images
+    Tiles tiles;
+
+    // stage timers & counters
+    SdkStats_t stats;
+
+    // scratch buffer for pixel conversion, reused between images
+    char *scratch;
+    int nScratch;
 
     // callback	
     CallbackFunc onCreate;
@@ -150,6 +279,25 @@ static void onCreate(SdkEnv *env);
 static void onDraw(SdkEnv *env);
 static void onRender(SdkEnv *env);
 static void onDestroy(SdkEnv *env);
+static void drawFrame(SdkEnv *env, bool finish);
+static void drawQuad(SdkEnv *env, const float *vertex, const float *texCoord);
+
+/*
+ * Quad of the image, vert.shdr mirrors x
+ */
+static const float sQuadVertex[] = {
+    -0.9,  0.9, 0,
+    -0.9, -0.9, 0,
+     0.9, -0.9, 0,
+     0.9,  0.9, 0
+};
+
+static const float sQuadTexCoord[] = {
+    0, 1,
+    0, 0,
+    1, 0,
+    1, 1
+};
 
 int sdkMain(SdkEnv *env)
 {
@@ -161,71 +309,7 @@ int sdkMain(SdkEnv *env)
     env->onDestroy = onDestroy;
 
     onSdkCreate(env);
-}
-
-/*
- * Console application entry
- * Usage:
- *		imgsdk input output
- * Notice:
- *	1. input & onput support *.jpg or *.png
- *	2. support input and output image type are not same 
- *	3. vert.shdr & frag.shdr must be prepared 
- */
-int main(int argc, char **argv) {
-    if (3 != argc) {
-        Log("Usage:\n");
-        Log("  %s input output\n", argv[0]);
-        return -1;
-    }
-
-    SdkEnv *env = newDefaultSdkEnv();
-    if (NULL == env) {
-        LogE("Failed get SdkEnv instance\n");
-    }
-    setInputImagePath (env, argv[1]);
-    setOutputImagePath (env, argv[2]);
-
-    sdkMain (env);
-    setEffectCmd (env, "{\"effect\":\"Normal\"}");
-    onSdkDraw (env);
-
-    Bitmap_t *img = (Bitmap_t *) env->userData.param;
-    uint32_t begin_t = getCurrentTime();
-
-    glBindTexture(GL_TEXTURE, env->handle.texture2Idx);
-    memset (img->base, 0, img->width * img->height * img->form);
-
-    // copy pixels from GPU memory to CPU memory
-    int x = 0;
-    int y = 0;
-	GLint fmt = GL_RGBA;
-	if (IMAGE_JPG == env->userData.inputImageType) {
-		fmt = GL_RGB;
-	}
-    glReadPixels(x, y, img->width, img->height, fmt, GL_UNSIGNED_BYTE, img->base);
-    int errCode = glGetError ();
-    if (GL_NO_ERROR != errCode ) { 
-        Log ("Failed read pixles, error code:0x%04x\n", errCode);
-    }
-    uint32_t finish_t = getCurrentTime();
-    LogD("Read pixel data cost %d ms\n", (finish_t - begin_t));
-
-    begin_t = getCurrentTime();
-    if (NULL != env->userData.outputPath) {
-        if (saveImage (env->userData.outputPath, img) < 0) {
-            LogE ("Failed saveImage\n");
-        }
-		else { 
-            finish_t = getCurrentTime();
-            LogD("Save %s cost %d ms\n", 
-                    env->userData.outputPath,
-                    (finish_t - begin_t));
-        }
-    }
-
-    freeSdkEnv(env);
-    //onSdkDestroy(env);
+    return 0;
 }
 
 /*
@@ -275,8 +359,9 @@ int read_png(const char *path, Bitmap_t *mem)
     mem->form = bpp;
     mem->width = width;
     mem->height = height;
+    mem->bottomUp = false;
 
-    Log("[%s %d x %d bpp=%d]\n", path, width, height, bpp);
+    LogD("[%s %d x %d bpp=%d]\n", path, width, height, bpp);
 
     int size = width * height * bpp;
     if (mem->base == NULL) {
@@ -350,8 +435,13 @@ int write_png(const char *path, const Bitmap_t *mem)
 
         case GRAY:
             form = PNG_COLOR_TYPE_GRAY;
-            depth = 1;
             break;
+
+        default:
+            LogE("write_png doesn't support form %d\n", mem->form);
+            fclose(fp);
+            png_destroy_write_struct(&png_ptr, &info_ptr);
+            return -1;
     }
 
     png_init_io(png_ptr, fp);
@@ -360,7 +450,8 @@ int write_png(const char *path, const Bitmap_t *mem)
     png_bytep row_pointers[mem->height];
     int k;
     for (k = 0; k < mem->height; ++k) {
-        row_pointers[k] = mem->base + k * mem->width * mem->form;
+        int row = mem->bottomUp ? mem->height - 1 - k : k;
+        row_pointers[k] = mem->base + row * mem->width * mem->form;
     }
     png_write_image(png_ptr, row_pointers);
     png_write_end(png_ptr, info_ptr);
@@ -396,64 +487,61 @@ int readFile(const char* path, char** mem)
         (*mem) = (char *)calloc(1, size + 1);
         if (NULL == *mem) {
             LogE("Failed calloc mem for shader file\n");
-            close (fp);
+            fclose (fp);
             return -1;
         }
     }
 
     if (fread(*mem, 1, size, fp) != size) {
         LogE("Failed read shader to mem\n");
-        close(fp);
+        fclose(fp);
         free (*mem);
         *mem = NULL;
         return -1;
     }
 
+    fclose(fp);
     return size;
 }
 
-// Used for glsl log
-#define LOG_BUFF_SIZE 1024
-static char sLogBuff[LOG_BUFF_SIZE];
+// directory of program binaries, NULL means none
+static char *sProgramCacheDir = NULL;
+static pthread_mutex_t sProgramCacheLock = PTHREAD_MUTEX_INITIALIZER;
 
-/**
- * Create a glsh shader
- * Parameters:
- *		type:	Just support GL_VERTEX_SHADER and GL_FRAGMENT_SHADER
- *		source:	shader source code
+/*
+ * Save program binaries in dir for later runs
  * Return:
- *		if failed, return 0
- *		if success, return the handle of shader
- */
-static int loadShader(GLenum type, const char* source) {
-    VALIDATE_NOT_NULL(source);
-    GLuint shader = glCreateShader(type);
-    if (!shader) {
-        LogE("Invalid shader\n");
-        return 0;
-    }
-    GLint length = strlen(source);
-    glShaderSource(shader, 1, &source, &length);
-    glCompileShader(shader);
-    int compiled, len;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
-    if (!compiled) {
-        memset(sLogBuff, 0, LOG_BUFF_SIZE);
-        glGetShaderInfoLog(shader, LOG_BUFF_SIZE, &len, sLogBuff);
-        if (len > 0) {
-            Log("compile error:%s\n", sLogBuff);
-        } else {
-            LogE("Failed get compile log\n");
+ *		 0 OK
+ *		-1 ERROR
+ */
+int setProgramCacheDir(const char *dir)
+{
+    char *copy = NULL;
+    if (NULL != dir) {
+        copy = strdup(dir);
+        if (NULL == copy) {
+            return -1;
         }
-        shader = 0;
-        glDeleteShader(shader);
     }
+    pthread_mutex_lock(&sProgramCacheLock);
+    free(sProgramCacheDir);
+    sProgramCacheDir = copy;
+    pthread_mutex_unlock(&sProgramCacheLock);
+    return 0;
+}
 
-    return shader;
+/**
+ * Create the program cache of env in the directory set
+ */
+static ProgCache* newEnvProgCache(void) {
+    pthread_mutex_lock(&sProgramCacheLock);
+    ProgCache *cache = newProgCache(sProgramCacheDir);
+    pthread_mutex_unlock(&sProgramCacheLock);
+    return cache;
 }
 
 /**
- * Create program and store shader handle in SdkEnv
+ * Get the program of sources from the program cache of env
  * Return:
  *		0  OK
  *     -1 ERROR
@@ -461,101 +549,165 @@ static int loadShader(GLenum type, const char* source) {
 static int createProgram(SdkEnv *env, const char* vertexSource, const char* fragSource) {
     VALIDATE_NOT_NULL3(env, vertexSource, fragSource);
 
-    // Make sure to reset them
-    env->handle.program		= 0;
-    env->handle.vertShader	= 0;
-    env->handle.fragShader	= 0;
+    // Make sure to reset it
+    env->handle.program = 0;
 
-    int program = 0;
-    int vertShader = 0;
-    int fragShader = 0;
-
-    do {
-        vertShader = loadShader(GL_VERTEX_SHADER, vertexSource);
-        if (!vertShader) {
-            LogE("Failed load vertex shader\n");
-            break;
-        }
+    uint64_t begin_ns = getNanoTime();
+    GLuint program = getProgram(env->programs, vertexSource, fragSource);
+    LogD("Get program in %.3f ms\n", (getNanoTime() - begin_ns) / 1e6);
+    if (!program) {
+        LogE("Failed getProgram\n");
+        return -1;
+    }
+    env->handle.program = program;
+    return 0;
+}
 
-        fragShader = loadShader(GL_FRAGMENT_SHADER, fragSource);
-        if (!fragShader) {
-            LogE("Failed load fragment sahder\n");
-            break;
+void freeBitmap(Bitmap_t *mem)
+{
+    if (NULL != mem) {
+        if (NULL != mem->base) {
+            free (mem->base);
+            mem->base = NULL;
         }
+    }
+}
 
-        // Mark to delete, fre automaticlly when do not use any longer
-        //glDeleteShader(vertShader);
-        //glDeleteShader(fragShader);
-
-        program = glCreateProgram();
-        if (!program) {
-            LogE("Failed create program\n");
-            break;
-        }
+/*
+ * Make mem hold width * height pixels of form
+ * Return:
+ *		 1 mem->base is allocated
+ *		 0 mem->base is reused
+ *		-1 ERROR
+ */
+int ensureBitmap(Bitmap_t *mem, int width, int height, PixForm_e form)
+{
+    if (NULL == mem || width <= 0 || height <= 0 || form < GRAY || form > RGBA32) {
+        return -1;
+    }
 
-        glAttachShader(program, vertShader);
-        glAttachShader(program, fragShader);
-        glLinkProgram(program);
-        GLint linkStatus = GL_FALSE;
-        glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
-        GLint len;
-        if (!linkStatus) {
-            memset(sLogBuff, 0, LOG_BUFF_SIZE);
-            glGetProgramInfoLog(program, LOG_BUFF_SIZE, &len, sLogBuff); 
-            if (len > 0) {
-                Log("link error log:%s\n", sLogBuff);
-            } else {
-                LogE("Failed get link log\n");
-            }
-            break;
-        }
+    // pixels are indexed by int
+    int64_t size = (int64_t)width * height * form;
+    if (size > INT_MAX) {
+        LogE ("Bitmap %d x %d x %d is too large\n", width, height, form);
+        return -1;
+    }
 
-        glValidateProgram (program);
-        GLint success;
-        glGetProgramiv (program, GL_VALIDATE_STATUS, &success);
-        if (!success) {
-            memset (sLogBuff, 0, LOG_BUFF_SIZE);
-            glGetProgramInfoLog (program, LOG_BUFF_SIZE, &len, sLogBuff);
-            if (len > 0) {
-                Log("program is invalidate:%s\n", sLogBuff); 
-            } 
-			else {
-                LogE("Failed get program status\n");
-            }
-            break;
+    int retCode = 0;
+    if (NULL == mem->base || (int64_t)mem->width * mem->height * mem->form < size) {
+        freeBitmap (mem);
+        mem->base = (char *)malloc ((size_t)size);
+        if (NULL == mem->base) {
+            LogE ("Failed malloc bitmap %d x %d x %d\n", width, height, form);
+            return -1;
         }
+        retCode = 1;
+    }
+    mem->width = width;
+    mem->height = height;
+    mem->form = form;
+    return retCode;
+}
 
-        env->handle.program		= program;
-        env->handle.vertShader	= vertShader;
-        env->handle.fragShader	= fragShader;
+/**
+ * All envs share the default display, and eglTerminate on it destroys
+ * every env's context. So the display is counted by the envs using it.
+ */
+static pthread_mutex_t sDisplayLock = PTHREAD_MUTEX_INITIALIZER;
+static int sDisplayRefs = 0;
 
-        return 0;
+/**
+ * Get the default display, initialize it for the first env
+ * Return:
+ *		EGL_NO_DISPLAY if ERROR
+ */
+static EGLDisplay acquireDisplay() {
+    pthread_mutex_lock(&sDisplayLock);
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (EGL_NO_DISPLAY == display || EGL_SUCCESS != eglGetError()) {
+        LogE("Failed eglGetDisplay\n");
+        pthread_mutex_unlock(&sDisplayLock);
+        return EGL_NO_DISPLAY;
+    }
 
-    } while (0);
+    if (0 == sDisplayRefs) {
+        EGLint major, minor;
+        if (!eglInitialize(display, &major, &minor) || EGL_SUCCESS != eglGetError()) {
+            LogE("Failed eglInitialize\n");
+            pthread_mutex_unlock(&sDisplayLock);
+            return EGL_NO_DISPLAY;
+        }
+        Log("EGL %d.%d\n", major, minor);
+    }
+    ++sDisplayRefs;
+    pthread_mutex_unlock(&sDisplayLock);
+    return display;
+}
 
-    if (program) {
-        glDeleteProgram(program);
+/**
+ * Release the display got by acquireDisplay, terminate it with the last env
+ */
+static void releaseDisplay(EGLDisplay display) {
+    pthread_mutex_lock(&sDisplayLock);
+    if (sDisplayRefs > 0 && 0 == --sDisplayRefs) {
+        eglTerminate(display);
     }
+    pthread_mutex_unlock(&sDisplayLock);
+}
 
-    if (vertShader) {
-        glDeleteShader(vertShader);
+/**
+ * Find GLES 3 entries of async readback & create pixel pack buffers.
+ * Readback stays synchronous on GLES 2.
+ */
+static void initReadback(SdkEnv *env) {
+    Readback *rb = &env->readback;
+    const char *version = (const char *)glGetString(GL_VERSION);
+    int major = 0;
+    if (NULL == version || sscanf(version, "OpenGL ES %d", &major) != 1 || major < 3) {
+        Log("%s, synchronous readback\n", NULL != version ? version : "Unknown GL version");
+        return;
     }
 
-    if (fragShader) {
-        glDeleteShader(fragShader);
+    rb->mapBufferRange = (MapBufferRangeFunc)eglGetProcAddress("glMapBufferRange");
+    rb->unmapBuffer = (UnmapBufferFunc)eglGetProcAddress("glUnmapBuffer");
+    rb->fenceSync = (FenceSyncFunc)eglGetProcAddress("glFenceSync");
+    rb->clientWaitSync = (ClientWaitSyncFunc)eglGetProcAddress("glClientWaitSync");
+    rb->deleteSync = (DeleteSyncFunc)eglGetProcAddress("glDeleteSync");
+    if (NULL == rb->mapBufferRange || NULL == rb->unmapBuffer || NULL == rb->fenceSync ||
+            NULL == rb->clientWaitSync || NULL == rb->deleteSync) {
+        LogW("%s without sync entries, synchronous readback\n", version);
+        return;
     }
 
-    return -1;
+    GLuint pbos[READBACK_SLOTS];
+    glGenBuffers(READBACK_SLOTS, pbos);
+    int i;
+    for (i = 0; i < READBACK_SLOTS; ++i) {
+        rb->slots[i].pbo = pbos[i];
+    }
+    rb->async = true;
+    Log("%s, async readback\n", version);
 }
 
-void freeBitmap(Bitmap_t *mem)
-{
-    if (NULL != mem) {
-        if (NULL != mem->base) {
-            free (mem->base);
-            mem->base = NULL;
+/**
+ * Delete fences & pixel pack buffers, env's context is current
+ */
+static void releaseReadback(SdkEnv *env) {
+    Readback *rb = &env->readback;
+    int i;
+    for (i = 0; i < READBACK_SLOTS; ++i) {
+        ReadSlot *slot = &rb->slots[i];
+        if (NULL != slot->fence) {
+            rb->deleteSync(slot->fence);
+            slot->fence = NULL;
+        }
+        if (0 != slot->pbo) {
+            glDeleteBuffers(1, &slot->pbo);
+            slot->pbo = 0;
         }
     }
+    rb->count = 0;
+    rb->async = false;
 }
 
 /**
@@ -564,19 +716,10 @@ void freeBitmap(Bitmap_t *mem)
  */
 static int initDefaultEGL(SdkEnv *env) {
     VALIDATE_NOT_NULL(env);
-	env->egl.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
-	if (EGL_NO_DISPLAY == env->egl.display ||
-			EGL_SUCCESS != eglGetError()) {
-		LogE("Failed eglGetDisplay\n");
-		return -1;
-	}
-
-    EGLint major, minor;
-    if (!eglInitialize(env->egl.display, &major, &minor) || EGL_SUCCESS != eglGetError()) {
-        LogE("Failed eglInitialize\n");
+    env->egl.display = acquireDisplay();
+    if (EGL_NO_DISPLAY == env->egl.display) {
         return -1;
     }
-    Log("EGL %d.%d\n", major, minor);
 
     EGLConfig configs[2];
     EGLint numConfigs;
@@ -585,18 +728,27 @@ static int initDefaultEGL(SdkEnv *env) {
         return -1;
     }
 
+    // GLES 3 for async readback, GLES 2 otherwise
+#ifndef EGL_OPENGL_ES3_BIT
+#define EGL_OPENGL_ES3_BIT 0x0040
+#endif
     EGLint cfg_attrs[] = { 
         EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
-        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT | EGL_OPENGL_ES3_BIT,
         EGL_RED_SIZE,        8,
         EGL_GREEN_SIZE,      8,
         EGL_BLUE_SIZE,       8,
         EGL_ALPHA_SIZE,      8,
         EGL_NONE
     };
+    int version = 3;
     if (!eglChooseConfig(env->egl.display, cfg_attrs, configs, 2, &numConfigs) || numConfigs < 1) {
-        LogE("Failed eglChooseConfig\n");
-        return -1;
+        version = 2;
+        cfg_attrs[3] = EGL_OPENGL_ES2_BIT;
+        if (!eglChooseConfig(env->egl.display, cfg_attrs, configs, 2, &numConfigs) || numConfigs < 1) {
+            LogE("Failed eglChooseConfig\n");
+            return -1;
+        }
     }
 
 #define SURFACE_MAX_WIDTH  2048
@@ -626,10 +778,14 @@ static int initDefaultEGL(SdkEnv *env) {
     }
 
     EGLint context_attrs[] = {
-        EGL_CONTEXT_CLIENT_VERSION, 2,
+        EGL_CONTEXT_CLIENT_VERSION, version,
         EGL_NONE
     };
     env->egl.context = eglCreateContext(env->egl.display, configs[0], EGL_NO_CONTEXT, context_attrs);
+    if (EGL_NO_CONTEXT == env->egl.context && 3 == version) {
+        context_attrs[1] = 2;
+        env->egl.context = eglCreateContext(env->egl.display, configs[0], EGL_NO_CONTEXT, context_attrs);
+    }
     if (EGL_NO_CONTEXT == env->egl.context) {
         LogE("Failed create context, error code:%x\n", eglGetError() );
         return -1;
@@ -645,48 +801,95 @@ static int initDefaultEGL(SdkEnv *env) {
     Log("EGL Pbuffer Surface %d x %d\n", env->egl.width, env->egl.height);
 
     env->type = OFF_SCREEN_RENDER;
+    initReadback(env);
 
     return 0;
 }
 
 /**
- * Release shader & program
+ * Release programs
  */
 static int releaseShader(SdkEnv *env) {
     VALIDATE_NOT_NULL(env);
 
-    glDetachShader(env->handle.program, env->handle.vertShader);
-    glDetachShader(env->handle.program, env->handle.fragShader);
-    glDeleteShader(env->handle.vertShader);
-    glDeleteShader(env->handle.fragShader);
-    glDeleteProgram(env->handle.program);
+    freeProgCache(env->programs);
+    env->programs = NULL;
+    env->handle.program = 0;
+    env->lutGpu.program = 0;
     glReleaseShaderCompiler();
+    return 0;
 }
 
-static void freeEffectCmd(eftcmd_t *cmd) {
-    if (NULL == cmd) {
-        return;
+/**
+ * Bind env's context to the calling thread
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int makeSdkEnvCurrent(SdkEnv *env)
+{
+    if (NULL == env || EGL_NO_CONTEXT == env->egl.context) {
+        return -1;
     }
-    cmd->capacity = 0;
-    cmd->valid = false;
-    cmd->cmd = ec_NORMAL;
-    cmd->count = 0;
-    if (NULL != cmd->params) {
-        free(cmd->params);
-        cmd->params = NULL;
+    if (eglGetCurrentContext() == env->egl.context) {
+        return 0;
+    }
+    if (!eglMakeCurrent(env->egl.display, env->egl.surface, env->egl.surface, env->egl.context)) {
+        LogE("Failed eglMakeCurrent, error code:%x\n", eglGetError() );
+        return -1;
     }
+    return 0;
 }
 
 /**
- * Free SdkEnv resource
+ * Unbind env's context from the calling thread
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
  */
-int freeSdkEnv(SdkEnv *env)
+int releaseSdkEnvCurrent(SdkEnv *env)
 {
     if (NULL == env) {
         return -1;
     }
+    if (eglGetCurrentContext() != env->egl.context) {
+        return 0;
+    }
+    if (!eglMakeCurrent(env->egl.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT)) {
+        LogE("Failed eglMakeCurrent, error code:%x\n", eglGetError() );
+        return -1;
+    }
+    return 0;
+}
 
+/**
+ * Release what initSdkEnv set up: GL objects, EGL and the caches.
+ * The env itself and the data set by user are kept.
+ */
+static void releaseEnv(SdkEnv *env)
+{
     if (env->egl.display != EGL_NO_DISPLAY) {
+        // the thread may be using another env, restore it at last
+        EGLDisplay prevDisplay = eglGetCurrentDisplay();
+        EGLContext prevContext = eglGetCurrentContext();
+        EGLSurface prevDraw = eglGetCurrentSurface(EGL_DRAW);
+        EGLSurface prevRead = eglGetCurrentSurface(EGL_READ);
+
+        // GL objects belong to this env's context
+        if (env->egl.context != EGL_NO_CONTEXT && makeSdkEnvCurrent(env) == 0) {
+            releaseShader(env);
+            freeTexPool (env->textures);
+            env->textures = NULL;
+            if (0 != env->lutGpu.table) {
+                glDeleteTextures (1, &env->lutGpu.table);
+            }
+            releaseReadback (env);
+            glDeleteBuffers (2, env->tiles.pbo);
+        }
+        env->lutGpu.table = 0;
+        env->tiles.pbo[0] = 0;
+        env->tiles.pbo[1] = 0;
+
         eglMakeCurrent(env->egl.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
         if (env->egl.context != EGL_NO_CONTEXT) {
             eglDestroyContext(env->egl.display, env->egl.context);
@@ -694,13 +897,57 @@ int freeSdkEnv(SdkEnv *env)
         if (env->egl.surface != EGL_NO_SURFACE) {
             eglDestroySurface(env->egl.display, env->egl.surface);
         }
-        eglTerminate(env->egl.display);
-        eglReleaseThread();
+
+        if (EGL_NO_CONTEXT != prevContext && env->egl.context != prevContext) {
+            eglMakeCurrent(prevDisplay, prevDraw, prevRead, prevContext);
+        } else {
+            eglReleaseThread();
+        }
+        releaseDisplay(env->egl.display);
     }
 
     env->egl.display = EGL_NO_DISPLAY;
     env->egl.context = EGL_NO_CONTEXT;
     env->egl.surface = EGL_NO_SURFACE;
+    env->type = ON_SCREEN_RENDER;
+
+    if (NULL != env->userCmd) {
+        freeChrbuf (env->userCmd);
+        env->userCmd = NULL;
+    }
+
+    free (env->userData.vertSource);
+    free (env->userData.fragSource);
+    env->userData.vertSource = NULL;
+    env->userData.fragSource = NULL;
+
+    freeBitmap(&env->planned);
+    freePlanCache(env->plans);
+    env->plans = NULL;
+    freeLutCache(env->luts);
+    env->luts = NULL;
+
+    if (NULL != env->tiles.stage) {
+        free (env->tiles.stage);
+        env->tiles.stage = NULL;
+    }
+    if (NULL != env->scratch) {
+        free (env->scratch);
+        env->scratch = NULL;
+    }
+}
+
+/**
+ * Free SdkEnv resource
+ */
+int freeSdkEnv(SdkEnv *env)
+{
+    if (NULL == env) {
+        return -1;
+    }
+
+    releaseEnv(env);
+
     if (ACTIVE_PATH == env->userData.active 
             && NULL != env->userData.inputPath) {
         free (env->userData.inputPath);
@@ -714,11 +961,6 @@ int freeSdkEnv(SdkEnv *env)
         env->userData.param = NULL;
     }
 
-    if (NULL != env->userCmd) {
-        freeChrbuf (env->userCmd);
-        env->userCmd = NULL;
-    }
-
     if (NULL != env->userData.inputPath) {
         free (env->userData.inputPath);
         env->userData.inputPath = NULL;
@@ -729,16 +971,8 @@ int freeSdkEnv(SdkEnv *env)
         env->userData.outputPath = NULL;
     }
 
-    releaseShader(env);
-
-    if (OFF_SCREEN_RENDER == env->type) {
-        glDeleteFramebuffers (1, &env->handle.fboIdx);
-        glDeleteTextures (1, &env->handle.texture2Idx);
-    }
-
-    freeEffectCmd(&env->effectCmd);
-
     free (env);
+    return 0;
 }
 
 /**
@@ -828,9 +1062,21 @@ SdkEnv* newBlankSdkEnv(int platform)
     }
 
     SdkEnv *env = (SdkEnv *)calloc(1, sizeof(SdkEnv));
+    if (NULL != env) {
+        resetStats (&env->stats);
+    }
     return env;
 }
 
+/**
+ * Limit tile size to the texture size of GL
+ */
+static int clampTileSize (int size) {
+    GLint maxSize = 0;
+    glGetIntegerv (GL_MAX_TEXTURE_SIZE, &maxSize);
+    return maxSize > 0 && maxSize < size ? maxSize : size;
+}
+
 /**
  * Initialize opengl buffers such as framebuffer
  * texture .etc
@@ -838,73 +1084,167 @@ SdkEnv* newBlankSdkEnv(int platform)
 static int initGlBuffers (SdkEnv *env) {
     VALIDATE_NOT_NULL (env);
 
-    glGenFramebuffers (1, &env->handle.fboIdx);
-    glGenTextures(1, &env->handle.texture1Idx);
-    glGenTextures(1, &env->handle.texture2Idx);
+    env->textures = newTexPool (TEX_POOL_CAPABILITY);
+    if (NULL == env->textures) {
+        LogE ("Failed newTexPool\n");
+        return -1;
+    }
 
-    glBindTexture (GL_TEXTURE_2D, env->handle.texture1Idx);
-    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    // programs are built on first use
+    env->programs = newEnvProgCache ();
+    if (NULL == env->programs) {
+        LogE ("Failed newProgCache\n");
+        freeTexPool (env->textures);
+        env->textures = NULL;
+        return -1;
+    }
 
+    // larger images are tiled, also to bound texture memory
+    env->tiles.maxSize = clampTileSize (TILE_MAX_SIZE);
     return 0;
 }
 
 /**
- * Create a default SdkEnv instance
+ * CPU side setup of an env, run on a loader thread while the caller's
+ * thread initializes EGL. Shader sources are read here, they're
+ * compiled on the first image.
  */
-SdkEnv* newDefaultSdkEnv() 
-{
-    SdkEnv *env = (SdkEnv *)calloc(1, sizeof(SdkEnv));
-    if (NULL == env){
-        return NULL;
+typedef struct {
+    SdkEnv *env;
+    bool fromAssets;            // read shaders by readPlatformAsset
+    bool threaded;              // thread is to be joined
+    pthread_t thread;
+    int result;                 // 0 OK, -1 ERROR
+} EnvLoader;
+
+static int readShaderSource(const EnvLoader *loader, const char *name, char **mem) {
+    if (loader->fromAssets) {
+        return readPlatformAsset(loader->env->userData.platformData, name, mem);
+    }
+    return readFile(name, mem);
+}
+
+static void* loadEnvProc(void *arg) {
+    EnvLoader *loader = (EnvLoader *)arg;
+    SdkEnv *env = loader->env;
+    uint64_t trace_ns = TRACE_BEGIN();
+    loader->result = -1;
+
+    env->userCmd = newChrbuf (USER_CMD_CAPABILITY);
+    if (NULL == env->userCmd) {
+        LogE ("Failed newChrbuf for userCmd\n");
+        return NULL;
     }
-    if (initDefaultEGL(env) < 0) {
-        LogE("Failed initDefaultEGL\n");
-        freeSdkEnv(env);
+    env->plans = newPlanCache (PLAN_CACHE_CAPABILITY);
+    if (NULL == env->plans) {
+        LogE ("Failed newPlanCache\n");
         return NULL;
     }
-
-    chrbuf_t *userCmd = newChrbuf (USER_CMD_CAPABILITY);
-    if (NULL == userCmd) {
-        LogE ("Failed newChrbuf for userCmd\n");
-        freeSdkEnv (env);
+    env->luts = newLutCache (LUT_CACHE_CAPABILITY);
+    if (NULL == env->luts) {
+        LogE ("Failed newLutCache\n");
         return NULL;
     }
-    env->userCmd = userCmd;
 
-    char *vertSource = NULL;
-    int count = readFile(VERT_SHADER_FILE, &vertSource);
+    uint64_t begin_ns = getNanoTime ();
+    int count = readShaderSource(loader, VERT_SHADER_FILE, &env->userData.vertSource);
     if (count < 0) {
-        LogE("Failed open vertex shader file:%s\n", VERT_SHADER_FILE);
-        freeSdkEnv(env);
+        LogE("Failed read vertex shader file:%s\n", VERT_SHADER_FILE);
         return NULL;
     }
-    Log("Read %s OK.\n", VERT_SHADER_FILE);
     env->userData.nVertSource = count;
-    env->userData.vertSource = vertSource;
+    Log("Read %s OK.\n", VERT_SHADER_FILE);
 
-    char *fragSource = NULL;
-    count = readFile(FRAG_SHADER_FILE, &fragSource);
+    count = readShaderSource(loader, FRAG_SHADER_FILE, &env->userData.fragSource);
     if (count < 0) {
         LogE("Failed read fragment shader file:%s\n", FRAG_SHADER_FILE);
-        free (vertSource);
-        freeSdkEnv(env);
         return NULL;
     }
     env->userData.nFragSource = count;
-    env->userData.fragSource = fragSource;
     Log("Read %s OK.\n", FRAG_SHADER_FILE);
+    endStage (&env->stats, STAGE_IO, begin_ns);
+    addCounter (&env->stats, COUNTER_BYTES_READ,
+            env->userData.nVertSource + env->userData.nFragSource);
 
-    if (attachShader(env, vertSource, fragSource) < 0) {
+    TRACE_END("loadEnv", trace_ns);
+    loader->result = 0;
+    return NULL;
+}
+
+/**
+ * Start setting up env on a loader thread. Without thread it's set
+ * up by joinEnvLoader.
+ */
+static void startEnvLoader(EnvLoader *loader, SdkEnv *env, bool fromAssets) {
+    loader->env = env;
+    loader->fromAssets = fromAssets;
+    loader->result = -1;
+    loader->threaded = pthread_create(&loader->thread, NULL, loadEnvProc, loader) == 0;
+}
+
+/**
+ * Wait for the loader
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+static int joinEnvLoader(EnvLoader *loader) {
+    if (loader->threaded) {
+        pthread_join(loader->thread, NULL);
+        loader->threaded = false;
+    } else {
+        loadEnvProc(loader);
+    }
+    return loader->result;
+}
+
+/**
+ * Compile the effect program on first use
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+static int ensureProgram(SdkEnv *env) {
+    if (0 != env->handle.program) {
+        return 0;
+    }
+    if (attachShader(env, env->userData.vertSource, env->userData.fragSource) < 0) {
         LogE("Failed attachShader\n");
-        free (vertSource);
-        free (fragSource);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Create a default SdkEnv instance
+ */
+SdkEnv* newDefaultSdkEnv() 
+{
+    SdkEnv *env = (SdkEnv *)calloc(1, sizeof(SdkEnv));
+    if (NULL == env){
+        return NULL;
+    }
+    resetStats (&env->stats);
+
+    EnvLoader loader;
+    startEnvLoader(&loader, env, false);
+
+    uint64_t begin_ns = getNanoTime ();
+    int retCode = initDefaultEGL(env);
+    if (retCode < 0) {
+        LogE("Failed initDefaultEGL\n");
+    } else {
+        endStage (&env->stats, STAGE_INIT, begin_ns);
+    }
+
+    if (joinEnvLoader(&loader) < 0 || retCode < 0) {
         freeSdkEnv(env);
         return NULL;
     }
 
     if (initGlBuffers (env) < 0) {
         LogE ("Failed init OpenGL buffers.\n");
+        freeSdkEnv(env);
         return NULL;
     }
 
@@ -922,19 +1262,16 @@ int initEGL(SdkEnv *env)
     LOG_ENTRY;
 
     VALIDATE_NOT_NULL(env);
-    VALIDATE_NOT_NULL(env->egl.window);
-
-    env->egl.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
-    if (EGL_NO_DISPLAY == env->egl.display || EGL_SUCCESS != eglGetError()) {
-        LogE("Failed eglGetDisplay\n");
+    // the window is an integer handle on some platforms
+    if ((EGLNativeWindowType)0 == env->egl.window) {
+        LogE("env->egl.window = NULL in %s\n", __FUNCTION__);
         return -1;
     }
-    EGLint major, minor;
-    if (!eglInitialize(env->egl.display, &major, &minor) || EGL_SUCCESS != eglGetError()) {
-        LogE("Failed eglInitialize\n");
+
+    env->egl.display = acquireDisplay();
+    if (EGL_NO_DISPLAY == env->egl.display) {
         return -1;
     }
-    Log("EGL %d.%d\n", major, minor);
 
     EGLConfig configs[2];
     EGLint numConfigs;
@@ -1007,227 +1344,1123 @@ static int readFileFromAssets(const SdkEnv *sdk,
         const char *fname, 
         char **mem) {
 
-    VALIDATE_NOT_NULL2(sdk, sdk->userData.platformData);
-    VALIDATE_NOT_NULL2(fname, mem);
+    VALIDATE_NOT_NULL2(sdk, mem);
+    return readPlatformAsset (sdk->userData.platformData, fname, mem);
+}
+
+/**
+ * EGL part of initSdkEnv
+ */
+static int initEnvEGL(SdkEnv *env) {
+    uint64_t begin_ns;
+    if (0 != env->egl.window) {	// On-screen render
+        begin_ns = getNanoTime ();
+        if (initEGL(env) < 0) {
+            LogE("Failed initEGL\n");
+            return -1;
+        }
+        endStage (&env->stats, STAGE_INIT, begin_ns);
+
+        if (getNativeWindowSize (env->egl.window,
+                    &env->userData.width, &env->userData.height) < 0) {
+            env->userData.width = env->egl.width;
+            env->userData.height = env->egl.height;
+        }
+        Log ("Native window %d x %d\n", 
+                env->userData.width, env->userData.height);
+
+        if (env->egl.width != env->userData.width ||
+                env->egl.height != env->userData.height) {
+            LogE("EGL and Native window size are not equal\n");
+            return -1;
+        }
+    } else {	// Off-screen render
+        begin_ns = getNanoTime ();
+        if (initDefaultEGL(env) < 0) {
+            LogE("Failed initDefaultEGL\n");
+            return -1;
+        }
+        endStage (&env->stats, STAGE_INIT, begin_ns);
+    }
+
+    return 0;
+}
+
+/**
+ * Initialize the specified SdkEnv instance
+ */
+int initSdkEnv(SdkEnv *env) 
+{
+    VALIDATE_NOT_NULL(env);
 
-    AAssetManager *assetMgr = (AAssetManager *)(sdk->userData.platformData);
-    AAsset *asset = AAssetManager_open(assetMgr, fname, AASSET_MODE_UNKNOWN);
-    if (NULL == asset) {
-        LogE("Failed open %s by asset manger\n", fname);
+    LogThread("initSdkEnv");
+
+    if (SDK_STATUS_OK == env->status) {
+        LogE("SDK is already initialized\n");
         return -1;
     }
-    size_t size = AAsset_getLength(asset);
-    if (size <= 0) {
-        LogE("%s length is invalid (file length must > 0)\n", fname);
-        AAsset_close (asset);
+
+    if (NULL == env->userData.platformData) {
+        LogE("Please call setPlatformData first!\n");
         return -1;
     }
-    *mem = calloc(1, size + 1);
-    if (NULL == *mem) {
-        LogE("Failed calloc memory for %s\n", fname);
-        AAsset_close (asset);
+
+    EnvLoader loader;
+    startEnvLoader(&loader, env, true);
+    int retCode = initEnvEGL(env);
+    if (joinEnvLoader(&loader) < 0) {
+        LogE ("Failed load env\n");
+        retCode = -1;
+    }
+
+    if (retCode >= 0 && initGlBuffers (env) < 0) {
+        LogE ("Failed init OpenGL buffers\n");
+        retCode = -1;
+    }
+
+    // env is the caller's, leave it as before init
+    if (retCode < 0) {
+        releaseEnv(env);
+        return -1;
+    }
+
+    env->status = SDK_STATUS_OK;
+
+    return 0;
+}
+
+/*
+ * Set input image path
+ * Parameters:
+ *		env:	sdk context
+ *		path:	input image path
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ * Notice:
+ *		userData.active & inputPath & inputImageType  may changed
+ */
+int setInputImagePath (SdkEnv* env, const char* path)
+{
+    VALIDATE_NOT_NULL2 (env, path);
+	if (env->userData.inputPath != NULL &&
+			strcmp(env->userData.inputPath, path) == 0) {
+		LogD ("Same input image path\n");
+		return 0;
+	}
+
+    if (NULL != env->userData.inputPath) {
+        free (env->userData.inputPath);
+    }
+    env->userData.inputPath = strdup (path);
+    env->userData.active = ACTIVE_PATH;
+	const char const *postfix = getFilePostfix (path);
+	if (strcasecmp (postfix, "jpg") == 0) {
+		env->userData.inputImageType = IMAGE_JPG;
+	}
+	else if (strcasecmp (postfix, "png") == 0) {
+		env->userData.inputImageType = IMAGE_PNG;
+	}
+	else {
+		env->userData.inputImageType = IMAGE_UNKNOWN;
+	}
+    return 0;
+}
+
+/*
+ * Set output image path
+ * Parameters:
+ *              env:    sdk context
+ *              path:   output image path
+ *  Return:
+ *               0  OK
+ *              -1  ERROR
+ */
+int setOutputImagePath (SdkEnv* env, const char* path)
+{
+    VALIDATE_NOT_NULL2 (env, path);
+    if (NULL != env->userData.outputPath) {
+        free (env->userData.outputPath);
+    }
+    env->userData.outputPath = strdup(path);
+    return 0;
+}
+
+/*
+ * Get output image path
+ * Parameters:
+ *              env:    sdk context
+ *  Return:
+ *              NULL	ERROR
+ */
+char* getOutputImagePath (SdkEnv* env)
+{
+	if (NULL == env) {
+		return NULL;
+	}
+	return env->userData.outputPath;
+}
+
+
+/**
+ * Map pixel format to the texture format
+ */
+static GLenum glFormatOf(PixForm_e form) {
+    switch (form) {
+        case GRAY:
+            return GL_LUMINANCE;
+        case RGB24:
+            return GL_RGB;
+        default:
+            return GL_RGBA;
+    }
+}
+
+/**
+ * Upload image to texture1 and make texture2 the render target size.
+ * Both come from the texture pool, so storage is allocated once per
+ * size & format and only the pixels are transferred.
+ */
+static int uploadImage (SdkEnv *env, const Bitmap_t *img) {
+    if (NULL == env || NULL == img || NULL == img->base) {
+        return -1;
+    }
+
+    // In off-screen render, We must reAssign value.
+    // Otherwise, the elemets will be invisible
+    if (OFF_SCREEN_RENDER == env->type) {
+        env->egl.width = img->width;
+        env->egl.height = img->height;
+    }
+
+    uint64_t begin_ns = getNanoTime ();
+    addCounter (&env->stats, COUNTER_BYTES_UPLOADED,
+            (int64_t)img->width * img->height * img->form);
+
+    // render target, RGBA is the only color-renderable & readable
+    // format guaranteed by OpenGL ES 2.0
+    GLenum fmt = glFormatOf (img->form);
+    PoolTex_t *input = acquireTexture (env->textures, TEX_INPUT, img->width, img->height, fmt);
+    PoolTex_t *target = NULL;
+    if (NULL != input) {
+        addCounter (&env->stats, COUNTER_ALLOCS, input->fresh ? 1 : 0);
+        target = acquireTexture (env->textures, TEX_TARGET, img->width, img->height, GL_RGBA);
+    }
+    if (NULL == target) {
+        LogE ("Failed acquire textures %dx%d\n", img->width, img->height);
+        return -1;
+    }
+    addCounter (&env->stats, COUNTER_ALLOCS, target->fresh ? 1 : 0);
+
+    env->handle.texture1Idx = input->texture;
+    env->handle.texture2Idx = target->texture;
+    env->handle.fboIdx = target->fbo;
+    env->handle.fboStatus = target->status;
+    env->handle.texWidth = img->width;
+    env->handle.texHeight = img->height;
+
+    int level = 0;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, input->texture);
+    uint64_t trace_ns = TRACE_BEGIN ();
+    glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, img->width, img->height, fmt, GL_UNSIGNED_BYTE, img->base);
+    TRACE_END ("glTexSubImage2D", trace_ns);
+    endStage (&env->stats, STAGE_UPLOAD, begin_ns);
+    return 0;
+}
+
+static const char LUT_VERT_SOURCE[] =
+    "attribute vec2 aPosition;\n"
+    "varying vec2 vTexCoord;\n"
+    "void main() {\n"
+    "    vTexCoord = aPosition * 0.5 + 0.5;\n"
+    "    gl_Position = vec4(aPosition, 0.0, 1.0);\n"
+    "}\n";
+
+// uLutGrid: nodes per axis, slices per row, 1 / grid width, 1 / grid height
+static const char LUT_FRAG_SOURCE[] =
+    "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+    "precision highp float;\n"
+    "#else\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform sampler2D uImage;\n"
+    "uniform sampler2D uLut;\n"
+    "uniform vec4 uLutGrid;\n"
+    "uniform float uIntensity;\n"
+    "varying vec2 vTexCoord;\n"
+    "vec3 lutSlice(float b, vec2 rg) {\n"
+    "    float row = floor((b + 0.5) / uLutGrid.y);\n"
+    "    float col = b - row * uLutGrid.y;\n"
+    "    vec2 xy = vec2(col, row) * uLutGrid.x + 0.5 + rg * (uLutGrid.x - 1.0);\n"
+    "    return texture2D(uLut, xy * uLutGrid.zw).rgb;\n"
+    "}\n"
+    "void main() {\n"
+    "    vec4 color = texture2D(uImage, vTexCoord);\n"
+    "    float b = color.b * (uLutGrid.x - 1.0);\n"
+    "    float b0 = floor(b);\n"
+    "    float b1 = min(b0 + 1.0, uLutGrid.x - 1.0);\n"
+    "    vec3 mapped = mix(lutSlice(b0, color.rg), lutSlice(b1, color.rg), b - b0);\n"
+    "    gl_FragColor = vec4(mix(color.rgb, mapped, uIntensity), color.a);\n"
+    "}\n";
+
+/**
+ * Build the program of Lut pass on first use
+ * Return:
+ *		 0 OK
+ *		-1 ERROR, Lut passes stay on CPU
+ */
+static int prepareLutProgram (SdkEnv *env) {
+    LutGpu *gpu = &env->lutGpu;
+    if (0 != gpu->program) {
+        return 0;
+    }
+    if (gpu->failed) {
+        return -1;
+    }
+    gpu->failed = true;
+
+    GLuint program = getProgram (env->programs, LUT_VERT_SOURCE, LUT_FRAG_SOURCE);
+    if (!program) {
+        LogE ("Failed get LUT program\n");
+        return -1;
+    }
+
+    gpu->program = program;
+    gpu->positionIdx = glGetAttribLocation (program, "aPosition");
+    gpu->imageIdx = glGetUniformLocation (program, "uImage");
+    gpu->lutIdx = glGetUniformLocation (program, "uLut");
+    gpu->gridIdx = glGetUniformLocation (program, "uLutGrid");
+    gpu->intensityIdx = glGetUniformLocation (program, "uIntensity");
+
+    glGenTextures (1, &gpu->table);
+    glBindTexture (GL_TEXTURE_2D, gpu->table);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    gpu->tableId = 0;
+    gpu->output = 0;
+    gpu->failed = false;
+    return 0;
+}
+
+/**
+ * Upload LUT as the grid texture unless it's there already
+ */
+static int bindLutTable (SdkEnv *env, const Lut3D_t *lut) {
+    LutGpu *gpu = &env->lutGpu;
+    if (gpu->tableId == lut->id) {
+        return 0;
+    }
+
+    GLint maxSize = 0;
+    glGetIntegerv (GL_MAX_TEXTURE_SIZE, &maxSize);
+    int n = lut->size;
+    int cols = maxSize / n < n ? maxSize / n : n;
+    if (cols <= 0) {
+        return -1;
+    }
+    int rows = (n + cols - 1) / cols;
+    int width = cols * n;
+    int height = rows * n;
+    uint8_t *grid = (uint8_t *)calloc ((size_t)width * height, 4);
+    if (NULL == grid) {
+        LogE ("Failed calloc LUT grid\n");
+        return -1;
+    }
+
+    const int16_t *node = lut->table;
+    int r, g, b, c;
+    for (b = 0; b < n; ++b) {
+        uint8_t *slice = grid + ((size_t)(b / cols) * n * width + (b % cols) * n) * 4;
+        for (g = 0; g < n; ++g) {
+            uint8_t *out = slice + (size_t)g * width * 4;
+            for (r = 0; r < n; ++r, node += 4, out += 4) {
+                for (c = 0; c < 3; ++c) {
+                    int v = (node[c] + (1 << (LUT_NODE_BITS - 1))) >> LUT_NODE_BITS;
+                    out[c] = v < 0 ? 0 : (v > 255 ? 255 : v);
+                }
+                out[3] = 255;
+            }
+        }
+    }
+
+    glPixelStorei (GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture (GL_TEXTURE_2D, gpu->table);
+    glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, grid);
+    free (grid);
+
+    gpu->tableId = lut->id;
+    gpu->size = n;
+    gpu->cols = cols;
+    gpu->rows = rows;
+    return 0;
+}
+
+/**
+ * Map texture1 through the bound LUT into lutGpu.output
+ */
+static int renderLut (SdkEnv *env, int intensity) {
+    LutGpu *gpu = &env->lutGpu;
+    GLsizei width = env->handle.texWidth;
+    GLsizei height = env->handle.texHeight;
+
+    PoolTex_t *output = acquireTexture (env->textures, TEX_LUT, width, height, GL_RGBA);
+    if (NULL == output) {
+        return -1;
+    }
+    addCounter (&env->stats, COUNTER_ALLOCS, output->fresh ? 1 : 0);
+    if (GL_FRAMEBUFFER_COMPLETE != output->status) {
+        LogE ("LUT framebuffer not ready. status code:0x%04x\n", output->status);
+        return -1;
+    }
+    gpu->output = output->texture;
+    glBindFramebuffer (GL_FRAMEBUFFER, output->fbo);
+
+    float vertex[] = {
+        -1, -1,
+         1, -1,
+         1,  1,
+        -1,  1
+    };
+
+    glViewport (0, 0, width, height);
+    glUseProgram (gpu->program);
+
+    glActiveTexture (GL_TEXTURE0);
+    glBindTexture (GL_TEXTURE_2D, env->handle.texture1Idx);
+    glUniform1i (gpu->imageIdx, 0);
+    glActiveTexture (GL_TEXTURE1);
+    glBindTexture (GL_TEXTURE_2D, gpu->table);
+    glUniform1i (gpu->lutIdx, 1);
+    glActiveTexture (GL_TEXTURE0);
+
+    glUniform4f (gpu->gridIdx, (float)gpu->size, (float)gpu->cols,
+            1.0f / (gpu->cols * gpu->size), 1.0f / (gpu->rows * gpu->size));
+    glUniform1f (gpu->intensityIdx, intensity / 100.0f);
+
+    glEnableVertexAttribArray (gpu->positionIdx);
+    glVertexAttribPointer (gpu->positionIdx, 2, GL_FLOAT, GL_FALSE, 0, vertex);
+    glDrawArrays (GL_TRIANGLE_FAN, 0, 4);
+    glDisableVertexAttribArray (gpu->positionIdx);
+
+    glBindFramebuffer (GL_FRAMEBUFFER, 0);
+    gpu->active = true;
+    return 0;
+}
+
+/**
+ * Run the effect plan on CPU. A trailing Lut pass of a color image
+ * is left to GPU when it can.
+ * Parameters:
+ *		bottomUp:	img rows are stored bottom-up (read_jpeg)
+ *		gpuStep:	[OUT] step of the Lut pass left, NULL if none
+ *		effect_ns:	[OUT] time of CPU passes
+ * Return:
+ *		image to render, img or env->planned
+ *		NULL ERROR
+ */
+static const Bitmap_t* runPlanned (SdkEnv *env, const Bitmap_t *img, bool bottomUp,
+        const EftStep_t **gpuStep, uint64_t *effect_ns) {
+    env->lutGpu.active = false;
+    *gpuStep = NULL;
+    *effect_ns = 0;
+    if (NULL == env->plan) {
+        return img;
+    }
+
+    const EftPlan_t *plan = env->plan;
+    const EftStep_t *lutStep = NULL;
+    const Lut3D_t *lut = NULL;
+    if (plan->nPasses > 0 && PASS_LUT == plan->passes[plan->nPasses - 1].type &&
+            GRAY != img->form && prepareLutProgram (env) == 0) {
+        lutStep = &plan->steps[plan->passes[plan->nPasses - 1].first];
+        lut = getLut3D (env->luts, plan->text + lutStep->text);
+        if (NULL == lut) {
+            LogE ("Failed getLut3D\n");
+            return NULL;
+        }
+        if (bindLutTable (env, lut) < 0) {
+            lutStep = NULL;
+        }
+    }
+
+    uint64_t begin_ns = getNanoTime ();
+    int ret = runEffectPasses (plan, plan->nPasses - (NULL != lutStep ? 1 : 0),
+            env->luts, img, bottomUp, &env->planned);
+    if (ret < 0) {
+        LogE ("Failed runEffectPlan\n");
+        return NULL;
+    }
+    *gpuStep = lutStep;
+    *effect_ns = getNanoTime () - begin_ns;
+    return 0 == ret ? &env->planned : img;
+}
+
+/**
+ * Run the effect plan on CPU and upload the result.
+ * A trailing Lut pass of a color image runs on GPU when it can.
+ * Parameters:
+ *		bottomUp:	img rows are stored bottom-up (read_jpeg)
+ */
+static int uploadPlanned (SdkEnv *env, const Bitmap_t *img, bool bottomUp) {
+    const EftStep_t *lutStep = NULL;
+    uint64_t effect_ns = 0;
+    const Bitmap_t *src = runPlanned (env, img, bottomUp, &lutStep, &effect_ns);
+    if (NULL == src || uploadImage (env, src) < 0) {
+        return -1;
+    }
+    if (NULL == env->plan) {
+        return 0;
+    }
+
+    // CPU passes & GPU LUT pass count as one effect sample
+    if (NULL != lutStep) {
+        uint64_t begin_ns = getNanoTime ();
+        if (renderLut (env, lutStep->params[0]) < 0) {
+            LogE ("Failed render LUT\n");
+            return -1;
+        }
+        effect_ns += getNanoTime () - begin_ns;
+    }
+    addStageTime (&env->stats, STAGE_EFFECT, effect_ns);
+    return 0;
+}
+
+/**
+ * Ensure the buffer of env has the specified size
+ */
+static char* ensureBuffer (SdkEnv *env, char **buffer, int *length, int size) {
+    if (*length < size) {
+        char *buf = (char *)realloc (*buffer, size);
+        if (NULL == buf) {
+            LogE ("Failed realloc buffer of %d bytes\n", size);
+            return NULL;
+        }
+        *buffer = buf;
+        *length = size;
+        addCounter (&env->stats, COUNTER_ALLOCS, 1);
+    }
+    return *buffer;
+}
+
+/**
+ * Ensure the scratch buffer has the specified size
+ */
+static char* ensureScratch (SdkEnv *env, int size) {
+    return ensureBuffer (env, &env->scratch, &env->nScratch, size);
+}
+
+/**
+ * Size mem to width x height in mem->form, RGBA32 if it's unknown
+ * Return:
+ *		size of mem in bytes
+ *		-1 ERROR
+ */
+static int prepareOutput (SdkEnv *env, Bitmap_t *mem, int width, int height) {
+    PixForm_e form = mem->form;
+    if (form != GRAY && form != RGB24 && form != RGBA32) {
+        form = RGBA32;
+    }
+    int ret = ensureBitmap (mem, width, height, form);
+    if (ret < 0) {
+        return -1;
+    }
+    addCounter (&env->stats, COUNTER_ALLOCS, ret);
+    return width * height * form;
+}
+
+/**
+ * Convert width x height RGBA pixels read back to mem->form,
+ * they're put at (x, y) of mem
+ */
+static void packOutput (const char *rgba, int width, int height, Bitmap_t *mem, int x, int y) {
+    int form = mem->form;
+    if (RGBA32 == form && width == mem->width) {
+        char *dst = mem->base + (size_t)y * width * RGBA32;
+        if (rgba != dst) {
+            memcpy (dst, rgba, (size_t)width * height * RGBA32);
+        }
+        return;
+    }
+
+    int row, i;
+    for (row = 0; row < height; ++row) {
+        const char *src = rgba + (size_t)row * width * RGBA32;
+        char *dst = mem->base + ((size_t)(y + row) * mem->width + x) * form;
+        if (RGBA32 == form) {
+            memcpy (dst, src, (size_t)width * RGBA32);
+            continue;
+        }
+        for (i = 0; i < width; ++i, src += RGBA32, dst += form) {
+            dst[0] = src[0];
+            if (RGB24 == form) {
+                dst[1] = src[1];
+                dst[2] = src[2];
+            }
+        }
+    }
+}
+
+/*
+ * Read the rendered image back to memory
+ * Parameters:
+ *		env:	sdk context
+ *		mem:	[IN/OUT] mem->form is the wanted pixel format.
+ *				mem->base is reused if it holds width * height * form
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int readOutputImage (SdkEnv* env, Bitmap_t *mem)
+{
+    if (NULL == env || NULL == mem) {
+        return -1;
+    }
+
+    uint64_t begin_ns = getNanoTime ();
+    int size = prepareOutput (env, mem, env->egl.width, env->egl.height);
+    if (size < 0) {
+        return -1;
+    }
+
+    // glReadPixels only guarantees GL_RGBA in OpenGL ES 2.0
+    char *rgba = mem->base;
+    if (RGBA32 != mem->form) {
+        rgba = ensureScratch (env, mem->width * mem->height * RGBA32);
+        if (NULL == rgba) {
+            return -1;
+        }
+    }
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    uint64_t trace_ns = TRACE_BEGIN ();
+    glReadPixels(0, 0, mem->width, mem->height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    TRACE_END ("glReadPixels", trace_ns);
+    int errCode = glGetError ();
+    if (GL_NO_ERROR != errCode ) {
+        LogE ("Failed read pixles, error code:0x%04x\n", errCode);
+        return -1;
+    }
+
+    packOutput (rgba, mem->width, mem->height, mem, 0, 0);
+    endStage (&env->stats, STAGE_READBACK, begin_ns);
+    addCounter (&env->stats, COUNTER_BYTES_READBACK, size);
+    return 0;
+}
+
+/**
+ * Read the tile rendered at rect into pixel pack buffer n, the CPU
+ * goes on while GPU transfers
+ */
+static int startTileReadback (SdkEnv *env, int n, const Rect_t *rect) {
+    Tiles *tiles = &env->tiles;
+    GLsizeiptr size = (GLsizeiptr)rect->width * rect->height * RGBA32;
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, tiles->pbo[n]);
+    if (tiles->pboSize[n] < size) {
+        glBufferData (GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        tiles->pboSize[n] = size;
+        addCounter (&env->stats, COUNTER_ALLOCS, 1);
+    }
+    glPixelStorei (GL_PACK_ALIGNMENT, 1);
+    uint64_t trace_ns = TRACE_BEGIN ();
+    glReadPixels (0, 0, rect->width, rect->height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    TRACE_END ("glReadPixels", trace_ns);
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+    int errCode = glGetError ();
+    if (GL_NO_ERROR != errCode) {
+        LogE ("Failed read tile to buffer, error code:0x%04x\n", errCode);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Convert pixel pack buffer n to rect of out, mapping waits for GPU
+ */
+static int finishTileReadback (SdkEnv *env, int n, const Rect_t *rect, Bitmap_t *out) {
+    Readback *rb = &env->readback;
+    int retCode = -1;
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, env->tiles.pbo[n]);
+    uint64_t trace_ns = TRACE_BEGIN ();
+    const char *rgba = (const char *)rb->mapBufferRange (GL_PIXEL_PACK_BUFFER, 0,
+            (GLsizeiptr)rect->width * rect->height * RGBA32, GL_MAP_READ_BIT);
+    if (NULL == rgba) {
+        LogE ("Failed glMapBufferRange, error code:0x%04x\n", glGetError ());
+    } else {
+        packOutput (rgba, rect->width, rect->height, out, rect->x, rect->y);
+        rb->unmapBuffer (GL_PIXEL_PACK_BUFFER);
+        retCode = 0;
+    }
+    TRACE_END ("glMapBufferRange", trace_ns);
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+    return retCode;
+}
+
+/**
+ * Read the tile rendered at rect to out at once
+ */
+static int readTile (SdkEnv *env, const Rect_t *rect, Bitmap_t *out) {
+    char *rgba = ensureScratch (env, rect->width * rect->height * RGBA32);
+    if (NULL == rgba) {
+        return -1;
+    }
+    glPixelStorei (GL_PACK_ALIGNMENT, 1);
+    uint64_t trace_ns = TRACE_BEGIN ();
+    glReadPixels (0, 0, rect->width, rect->height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    TRACE_END ("glReadPixels", trace_ns);
+    int errCode = glGetError ();
+    if (GL_NO_ERROR != errCode) {
+        LogE ("Failed read tile, error code:0x%04x\n", errCode);
+        return -1;
+    }
+    packOutput (rgba, rect->width, rect->height, out, rect->x, rect->y);
+    return 0;
+}
+
+/**
+ * Image is too large to render whole
+ */
+static bool isTiled (const SdkEnv *env, const Bitmap_t *img) {
+    int maxSize = env->tiles.maxSize;
+    return maxSize > 0 && (img->width > maxSize || img->height > maxSize);
+}
+
+/**
+ * Render img tile by tile into out. CPU passes run on the whole image
+ * first, so their neighborhoods don't see tile edges. A tile uploads
+ * its source with halo, renders & is read back while the next one is
+ * uploaded, so texture memory is that of one tile whatever the size.
+ */
+static int renderTiles (SdkEnv *env, const Bitmap_t *img, Bitmap_t *out) {
+    Tiles *tiles = &env->tiles;
+    bool async = env->readback.async;
+    const EftStep_t *lutStep = NULL;
+    uint64_t effect_ns = 0;
+    const Bitmap_t *src = runPlanned (env, img, img->bottomUp, &lutStep, &effect_ns);
+    if (NULL == src) {
+        return -1;
+    }
+
+    // tiles are planned in clip coordinates
+    float quad[8];
+    int i, k;
+    for (i = 0; i < 4; ++i) {
+        quad[2 * i] = -sQuadVertex[3 * i];
+        quad[2 * i + 1] = sQuadVertex[3 * i + 1];
+    }
+    Tiler_t tiler;
+    if (initTiler (&tiler, src->width, src->height, tiles->maxSize, quad, sQuadTexCoord) < 0) {
+        return -1;
+    }
+    int size = prepareOutput (env, out, src->width, src->height);
+    if (size < 0) {
+        return -1;
+    }
+
+    // stage has room for the edge repeated past a tile source
+    char *stage = ensureBuffer (env, &tiles->stage, &tiles->nStage,
+            (tiler.srcWidth + 1) * (tiler.srcHeight + 1) * src->form);
+    if (NULL == stage) {
+        return -1;
+    }
+
+    GLenum fmt = glFormatOf (src->form);
+    PoolTex_t *input = acquireTexture (env->textures, TEX_INPUT, tiler.srcWidth, tiler.srcHeight, fmt);
+    PoolTex_t *target = NULL;
+    if (NULL != input) {
+        addCounter (&env->stats, COUNTER_ALLOCS, input->fresh ? 1 : 0);
+        target = acquireTexture (env->textures, TEX_TARGET, tiler.tileWidth, tiler.tileHeight, GL_RGBA);
+    }
+    if (NULL == target) {
+        LogE ("Failed acquire tile textures %dx%d\n", tiler.tileWidth, tiler.tileHeight);
+        return -1;
+    }
+    addCounter (&env->stats, COUNTER_ALLOCS, target->fresh ? 1 : 0);
+    if (GL_FRAMEBUFFER_COMPLETE != target->status) {
+        LogE ("Framebuffer not ready. status code:0x%04x\n", target->status);
+        return -1;
+    }
+
+    env->handle.texture1Idx = input->texture;
+    env->handle.texture2Idx = target->texture;
+    env->handle.fboIdx = target->fbo;
+    env->handle.fboStatus = target->status;
+    env->handle.texWidth = tiler.srcWidth;
+    env->handle.texHeight = tiler.srcHeight;
+    if (async && 0 == tiles->pbo[0]) {
+        glGenBuffers (2, tiles->pbo);
+    }
+
+    uint64_t upload_ns = 0;
+    uint64_t render_ns = 0;
+    uint64_t readback_ns = 0;
+    int64_t uploaded = 0;
+    int count = getTileCount (&tiler);
+    Tile_t tile;
+    Rect_t pending;         // tile in pixel pack buffer, read on next tile
+    int ret = 0;
+    for (i = 0; i < count && 0 == ret; ++i) {
+        uint64_t trace_ns = TRACE_BEGIN ();
+        getTile (&tiler, i, &tile);
+
+        uint64_t begin_ns = getNanoTime ();
+        int width, height;
+        copyTileSource (&tiler, src, &tile.src, stage, &width, &height);
+        glPixelStorei (GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture (GL_TEXTURE_2D, input->texture);
+        glTexSubImage2D (GL_TEXTURE_2D, 0, 0, 0, width, height, fmt, GL_UNSIGNED_BYTE, stage);
+        uploaded += (int64_t)width * height * src->form;
+        upload_ns += getNanoTime () - begin_ns;
+
+        if (NULL != lutStep) {
+            begin_ns = getNanoTime ();
+            if (renderLut (env, lutStep->params[0]) < 0) {
+                LogE ("Failed render LUT\n");
+                ret = -1;
+                break;
+            }
+            effect_ns += getNanoTime () - begin_ns;
+        }
+
+        // vert.shdr mirrors x back
+        float vertex[12];
+        for (k = 0; k < 4; ++k) {
+            vertex[3 * k] = -tile.quad[2 * k];
+            vertex[3 * k + 1] = tile.quad[2 * k + 1];
+            vertex[3 * k + 2] = 0;
+        }
+        begin_ns = getNanoTime ();
+        glBindFramebuffer (GL_FRAMEBUFFER, target->fbo);
+        glViewport (0, 0, tile.out.width, tile.out.height);
+        glClearColor (0.0f, 0.0f, 0.0f, 1.0f);
+        glClear (GL_COLOR_BUFFER_BIT);
+        drawQuad (env, vertex, tile.texCoord);
+        render_ns += getNanoTime () - begin_ns;
+
+        begin_ns = getNanoTime ();
+        if (async) {
+            ret = startTileReadback (env, i & 1, &tile.out);
+            if (0 == ret && i > 0) {
+                ret = finishTileReadback (env, (i - 1) & 1, &pending, out);
+            }
+            pending = tile.out;
+        } else {
+            ret = readTile (env, &tile.out, out);
+        }
+        readback_ns += getNanoTime () - begin_ns;
+        TRACE_END ("tile", trace_ns);
+    }
+
+    if (0 == ret && async) {
+        uint64_t begin_ns = getNanoTime ();
+        ret = finishTileReadback (env, (count - 1) & 1, &pending, out);
+        readback_ns += getNanoTime () - begin_ns;
+    }
+    glBindFramebuffer (GL_FRAMEBUFFER, 0);
+    if (ret < 0) {
+        return -1;
+    }
+
+    // tiles of an image count as one sample of each stage
+    addStageTime (&env->stats, STAGE_UPLOAD, upload_ns);
+    addCounter (&env->stats, COUNTER_BYTES_UPLOADED, uploaded);
+    if (NULL != env->plan) {
+        addStageTime (&env->stats, STAGE_EFFECT, effect_ns);
+    }
+    addStageTime (&env->stats, STAGE_RENDER, render_ns);
+    addStageTime (&env->stats, STAGE_READBACK, readback_ns);
+    addCounter (&env->stats, COUNTER_BYTES_READBACK, size);
+    return 0;
+}
+
+/*
+ * Make env current & compile cmd unless it's the last one
+ */
+static int preparePlan (SdkEnv* env, const char *cmd)
+{
+    if (OFF_SCREEN_RENDER != env->type) {
+        LogE ("processImage only works in off-screen render\n");
+        return -1;
+    }
+    if (makeSdkEnvCurrent (env) < 0 || ensureProgram (env) < 0) {
+        return -1;
+    }
+
+    if (NULL != cmd && strcmp (cmd, env->userCmd->base) != 0) {
+        const EftPlan_t *plan = getEffectPlan (env->plans, cmd);
+        if (NULL == plan) {
+            LogE ("Failed parseEffectPlan:%s\n", cmd);
+            return -1;
+        }
+        env->plan = plan;
+        clearChrbuf (env->userCmd);
+        appendChrbuf (env->userCmd, cmd);
+    }
+    return 0;
+}
+
+/*
+ * processImage without counting
+ */
+static int runImage (SdkEnv* env, const Bitmap_t *img, const char *cmd, Bitmap_t *out)
+{
+    if (preparePlan (env, cmd) < 0) {
+        return -1;
+    }
+    if (out->form != GRAY && out->form != RGB24 && out->form != RGBA32) {
+        out->form = img->form;
+    }
+    // rendering keeps the row order
+    out->bottomUp = img->bottomUp;
+    if (isTiled (env, img)) {
+        return renderTiles (env, img, out);
+    }
+
+    if (uploadPlanned (env, img, img->bottomUp) < 0) {
+        LogE ("Failed uploadImage\n");
+        return -1;
+    }
+    onRender (env);
+    return readOutputImage (env, out);
+}
+
+/*
+ * Run effect on an image in memory and read back the result.
+ * Textures, framebuffer & program are kept alive between calls,
+ * and cmd is only parsed when it differs from the last one.
+ * Parameters:
+ *		env:	off-screen sdk context
+ *		img:	input image
+ *		cmd:	effect command, NULL means keep the last one
+ *		out:	[OUT] output image, see readOutputImage
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int processImage (SdkEnv* env, const Bitmap_t *img, const char *cmd, Bitmap_t *out)
+{
+    if (NULL == env || NULL == img || NULL == out) {
         return -1;
     }
 
-    if (AAsset_read(asset, *mem, size) != size) {
-        LogE("Failed read %s\n", fname);
-        AAsset_close(asset);
-        free (*mem);
-        *mem = NULL;
-        return -1;
+    uint64_t trace_ns = TRACE_BEGIN ();
+    int ret = runImage (env, img, cmd, out);
+    TRACE_END ("processImage", trace_ns);
+    addCounter (&env->stats, COUNTER_IMAGES, 1);
+    if (ret < 0) {
+        addCounter (&env->stats, COUNTER_FAILURES, 1);
     }
-
-    AAsset_close(asset);
-    return size + 1;
+    return ret;
 }
 
-static bool initEffectCmd(eftcmd_t *cmd) {
-   if (NULL == cmd) {
-        return false;
-   }
-
-#define MAX_EFFECT_PARAM_COUNT 8
-    cmd->capacity = MAX_EFFECT_PARAM_COUNT;
-    cmd->valid = true;
-    cmd->cmd = ec_NORMAL;
-    cmd->count = 0;
-    cmd->params = (int *)calloc(cmd->capacity, sizeof(int));
-    assert(NULL != cmd->params);
-
-    return true;
+/*
+ * Timers & counters of sdk stages
+ */
+SdkStats_t* getSdkStats (SdkEnv *env)
+{
+    return NULL == env ? NULL : &env->stats;
 }
 
 /**
- * Initialize the specified SdkEnv instance
+ * Read the rendered image into the pixel pack buffer of slot
+ * & fence it, the CPU doesn't wait for GPU
  */
-int initSdkEnv(SdkEnv *env) 
-{
-    VALIDATE_NOT_NULL(env);
-
-	Log("initSdkEnv pthead self = %lx\n", pthread_self());
-	Log("initSdkEnv gettid = %x\n", gettid());
-
-    uint32_t t_begin, t_finish;
-
-    if (env->type == SDK_STATUS_OK) {
-        LogE("SDK is already initialized\n");
+static int startReadback (SdkEnv *env, ReadSlot *slot) {
+    Readback *rb = &env->readback;
+    uint64_t begin_ns = getNanoTime ();
+    if (prepareOutput (env, slot->out, env->egl.width, env->egl.height) < 0) {
         return -1;
     }
 
-    if (NULL == env->userData.platformData) {
-        LogE("Please call setPlatformData first!\n");
+    // glReadPixels only guarantees GL_RGBA in OpenGL ES 2.0
+    int width = slot->out->width;
+    int height = slot->out->height;
+    GLsizeiptr size = (GLsizeiptr)width * height * RGBA32;
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, slot->pbo);
+    if (slot->pboSize < size) {
+        glBufferData (GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        slot->pboSize = size;
+        addCounter (&env->stats, COUNTER_ALLOCS, 1);
+    }
+    glPixelStorei (GL_PACK_ALIGNMENT, 1);
+    uint64_t trace_ns = TRACE_BEGIN ();
+    glReadPixels (0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    TRACE_END ("glReadPixels", trace_ns);
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+    int errCode = glGetError ();
+    if (GL_NO_ERROR != errCode) {
+        LogE ("Failed read pixels to buffer, error code:0x%04x\n", errCode);
         return -1;
     }
 
-	chrbuf_t *userCmd = newChrbuf (USER_CMD_CAPABILITY);
-    if (NULL == userCmd) {
-        LogE ("Failed newChrbuf for userCmd\n");
-        freeSdkEnv (env);
+    slot->fence = rb->fenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    if (NULL == slot->fence) {
+        LogE ("Failed glFenceSync, error code:0x%04x\n", glGetError ());
         return -1;
     }
-    env->userCmd = userCmd;
-
-    bool result = initEffectCmd(&env->effectCmd);
-    assert(result);
-
-    if (NULL != env->egl.window) {	// On-screen render
-        t_begin = getCurrentTime();
-        if (initEGL(env) < 0) {
-            LogE("Failed initEGL\n");
-            return -1;
-        }
-        t_finish = getCurrentTime();
-        Log("Initialize EGL OK cost %d ms.\n", t_finish - t_begin);
-
-        ANativeWindow *window = env->egl.window;
-        env->userData.width = ANativeWindow_getWidth(window);
-        env->userData.height = ANativeWindow_getHeight(window);
-        Log ("Native window %d x %d\n", 
-                env->userData.width, env->userData.height);
+    glFlush ();
+    slot->readNs = getNanoTime () - begin_ns;
+    return 0;
+}
 
-        if (env->egl.width != env->userData.width ||
-                env->egl.height != env->userData.height) {
-            LogE("EGL and Native window size are not equal\n");
-            return -1;
-        }
-    } else {	// Off-screen render
-        t_begin = getCurrentTime();
-        if (initDefaultEGL(env) < 0) {
-            LogE("Failed initDefaultEGL\n");
-            return -1;
-        }
-        t_finish = getCurrentTime();
-        Log("Initialize Default EGL OK cost %d ms.\n", t_finish - t_begin);
-    }
-
-#define VERT_SHDR_NAME "vert.shdr"
-    t_begin = getCurrentTime();
-    char *vertSource = NULL;
-    int nVertSource = readFileFromAssets (env, VERT_SHDR_NAME, &vertSource);
-    if (nVertSource < 0) {
-        LogE ("Failed read assets file:%s\n", VERT_SHDR_NAME);
-    }
-    env->userData.nVertSource = nVertSource;
-    env->userData.vertSource = vertSource; 
-    t_finish = getCurrentTime();
-    Log("Load %s OK cost %d ms.\n", VERT_SHDR_NAME, t_finish - t_begin);
-
-#define FRAG_SHDR_NAME "frag.shdr"
-    char *fragSource = NULL;
-    int nFragSource = readFileFromAssets (env, FRAG_SHDR_NAME, &fragSource);
-    if (nFragSource < 0) {
-        LogE("Failed read assets file:%s\n", FRAG_SHDR_NAME);
-    }
-    env->userData.nFragSource = nFragSource;
-    env->userData.fragSource = fragSource;
-    t_finish = getCurrentTime();
-    Log("Load %s OK cost %d ms.\n", FRAG_SHDR_NAME, t_finish - t_begin);
-
-    if (attachShader(env, vertSource, fragSource) < 0) {
-        LogE("Failed attachShader\n");
+/**
+ * Wait for the fence of slot & convert its pixel pack buffer to out
+ */
+static int finishReadback (SdkEnv *env, ReadSlot *slot) {
+    Readback *rb = &env->readback;
+    uint64_t begin_ns = getNanoTime ();
+    uint64_t trace_ns = TRACE_BEGIN ();
+    GLenum status;
+    do {
+        status = rb->clientWaitSync (slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_NS);
+    } while (GL_TIMEOUT_EXPIRED == status);
+    TRACE_END ("glClientWaitSync", trace_ns);
+    rb->deleteSync (slot->fence);
+    slot->fence = NULL;
+    if (GL_WAIT_FAILED == status) {
+        LogE ("Failed glClientWaitSync, error code:0x%04x\n", glGetError ());
         return -1;
     }
 
-    if (initGlBuffers (env) < 0) {
-        LogE ("Failed init OpenGL buffers\n");
-    }
-
-    env->status = SDK_STATUS_OK;
-
-    return 0;
+    Bitmap_t *mem = slot->out;
+    int size = mem->width * mem->height * mem->form;
+    int retCode = -1;
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, slot->pbo);
+    trace_ns = TRACE_BEGIN ();
+    const char *rgba = (const char *)rb->mapBufferRange (GL_PIXEL_PACK_BUFFER, 0,
+            (GLsizeiptr)mem->width * mem->height * RGBA32, GL_MAP_READ_BIT);
+    if (NULL == rgba) {
+        LogE ("Failed glMapBufferRange, error code:0x%04x\n", glGetError ());
+    } else {
+        packOutput (rgba, mem->width, mem->height, mem, 0, 0);
+        rb->unmapBuffer (GL_PIXEL_PACK_BUFFER);
+        retCode = 0;
+    }
+    TRACE_END ("glMapBufferRange", trace_ns);
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+
+    // waiting for GPU counts as readback here, render isn't finished
+    if (0 == retCode) {
+        addStageTime (&env->stats, STAGE_READBACK, slot->readNs + getNanoTime () - begin_ns);
+        addCounter (&env->stats, COUNTER_BYTES_READBACK, size);
+    }
+    return retCode;
 }
 
 /*
- * Set input image path
+ * Run effect on an image without waiting for readback
  * Parameters:
- *		env:	sdk context
- *		path:	input image path
+ *		env:	off-screen sdk context
+ *		img:	input image
+ *		cmd:	effect command, NULL means keep the last one
+ *		out:	[OUT] output image, filled by collectImage
  * Return:
  *		 0 OK
  *		-1 ERROR
- * Notice:
- *		userData.active & inputPath & inputImageType  may changed
  */
-int setInputImagePath (SdkEnv* env, const char* path)
+int submitImage (SdkEnv* env, const Bitmap_t *img, const char *cmd, Bitmap_t *out)
 {
-    VALIDATE_NOT_NULL2 (env, path);
-	if (env->userData.inputPath != NULL &&
-			strcmp(env->userData.inputPath, path) == 0) {
-		Log ("Same input image path\n");
-		return 0;
-	}
+    if (NULL == env || NULL == img || NULL == out) {
+        return -1;
+    }
+    Readback *rb = &env->readback;
+    if (rb->count >= READBACK_SLOTS) {
+        LogE ("No free readback slot, collectImage first\n");
+        return -1;
+    }
 
-    if (NULL != env->userData.inputPath) {
-        free (env->userData.inputPath);
+    uint64_t trace_ns = TRACE_BEGIN ();
+    ReadSlot *slot = &rb->slots[(rb->head + rb->count) % READBACK_SLOTS];
+    slot->out = out;
+    slot->result = -1;
+    slot->readNs = 0;
+    if (out->form != GRAY && out->form != RGB24 && out->form != RGBA32) {
+        out->form = img->form;
     }
-    env->userData.inputPath = strdup (path);
-    env->userData.active = ACTIVE_PATH;
-	const char const *postfix = getFilePostfix (path);
-	if (strcasecmp (postfix, "jpg") == 0) {
-		env->userData.inputImageType = IMAGE_JPG;
-	}
-	else if (strcasecmp (postfix, "png") == 0) {
-		env->userData.inputImageType = IMAGE_PNG;
-	}
-	else {
-		env->userData.inputImageType = IMAGE_UNKNOWN;
-	}
+    out->bottomUp = img->bottomUp;
+
+    int ret = preparePlan (env, cmd);
+    if (0 == ret && isTiled (env, img)) {
+        // tiles overlap their readbacks already, the result waits in slot
+        slot->result = renderTiles (env, img, out);
+    }
+    else if (0 == ret && uploadPlanned (env, img, img->bottomUp) < 0) {
+        LogE ("Failed uploadImage\n");
+        ret = -1;
+    }
+    else if (0 == ret && rb->async) {
+        drawFrame (env, false);
+        ret = startReadback (env, slot);
+    }
+    else if (0 == ret) {
+        // GLES 2, the result waits in slot
+        onRender (env);
+        slot->result = readOutputImage (env, out);
+    }
+    TRACE_END ("submitImage", trace_ns);
+
+    if (ret < 0) {
+        addCounter (&env->stats, COUNTER_IMAGES, 1);
+        addCounter (&env->stats, COUNTER_FAILURES, 1);
+        return -1;
+    }
+    ++rb->count;
     return 0;
 }
 
 /*
- * Set output image path
- * Parameters:
- *              env:    sdk context
- *              path:   output image path
- *  Return:
- *               0  OK
- *              -1  ERROR
+ * Wait for the oldest submitted image & fill its out
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
  */
-int setOutputImagePath (SdkEnv* env, const char* path)
+int collectImage (SdkEnv* env)
 {
-    VALIDATE_NOT_NULL2 (env, path);
-    if (NULL != env->userData.outputPath) {
-        free (env->userData.outputPath);
+    if (NULL == env || 0 == env->readback.count) {
+        return -1;
     }
-    env->userData.outputPath = strdup(path);
-    return 0;
+    Readback *rb = &env->readback;
+    ReadSlot *slot = &rb->slots[rb->head];
+    rb->head = (rb->head + 1) % READBACK_SLOTS;
+    --rb->count;
+
+    uint64_t trace_ns = TRACE_BEGIN ();
+    int ret = slot->result;
+    if (NULL != slot->fence) {
+        ret = makeSdkEnvCurrent (env) < 0 ? -1 : finishReadback (env, slot);
+    }
+    TRACE_END ("collectImage", trace_ns);
+
+    addCounter (&env->stats, COUNTER_IMAGES, 1);
+    if (ret < 0) {
+        addCounter (&env->stats, COUNTER_FAILURES, 1);
+    }
+    slot->out = NULL;
+    return ret;
 }
 
 /*
- * Get output image path
+ * Set the largest side of images rendered whole
  * Parameters:
- *              env:    sdk context
- *  Return:
- *              NULL	ERROR
+ *		size:	tile size, 0 means TILE_MAX_SIZE
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
  */
-char* getOutputImagePath (SdkEnv* env)
+int setTileSize (SdkEnv* env, int size)
 {
-	VALIDATE_NOT_NULL(env);
-	return env->userData.outputPath;
+    if (NULL == env || size < 0 || (size > 0 && size < TILE_MIN_SIZE)) {
+        return -1;
+    }
+    if (makeSdkEnvCurrent (env) < 0) {
+        return -1;
+    }
+    env->tiles.maxSize = clampTileSize (0 == size ? TILE_MAX_SIZE : size);
+    return 0;
 }
 
-
 /*
  * Set image effect command
  * Parameters:
@@ -1242,13 +2475,13 @@ int setEffectCmd(SdkEnv* env, const char* cmd)
     LOG_ENTRY;
     VALIDATE_NOT_NULL2(env, cmd);
 
-	Log("ptheadself = %lx\n", pthread_self());
-	Log("gettid = %x\n", gettid());
-
-    env->effectCmd.valid = false;
-    if (parseEffectCmd (cmd, &env->effectCmd) < 0) {
-        LogE ("Failed parseEffectCmd FIXME! \n");
+    // a bad cmd must not render the last effect
+    const EftPlan_t *plan = getEffectPlan (env->plans, cmd);
+    if (NULL == plan) {
+        LogE ("Failed parseEffectPlan:%s\n", cmd);
+        return -1;
     }
+    env->plan = plan;
 
     if (NULL == env->userData.inputPath &&
             NULL == env->userData.param) {
@@ -1256,18 +2489,18 @@ int setEffectCmd(SdkEnv* env, const char* cmd)
         return -1;
     }
 
-    Log ("effect cmd:%s\n", cmd);
+    LogD ("effect cmd:%s\n", cmd);
 
 	if (NULL != env->userCmd &&
 			env->userCmd->base != NULL &&
 			strcmp(cmd, env->userCmd->base) == 0) {
-		Log ("The same effect cmd\n");
+		LogD ("The same effect cmd\n");
 	}
 
     // input image by specified path
     if (ACTIVE_PATH == env->userData.active) {
 
-		Log ("ACTIVE PATH\n"); 
+		LogD ("ACTIVE PATH\n"); 
 
         if (NULL == env->userData.inputPath) {
             LogE ("Please setImagePath first\n");
@@ -1280,13 +2513,14 @@ int setEffectCmd(SdkEnv* env, const char* cmd)
             return -1;
         }
 
-        uint32_t begin_t = getCurrentTime();
+        uint64_t begin_ns = getNanoTime ();
         if(loadImage (env->userData.inputPath, img) < 0) {
             LogE("Failed loadImage\n");
             return -1;
         }
-        uint32_t end_t = getCurrentTime();
-        Log("Load %s cost %d ms\n", env->userData.inputPath, end_t - begin_t);
+        endStage (&env->stats, STAGE_DECODE, begin_ns);
+        addCounter (&env->stats, COUNTER_BYTES_DECODED,
+                (int64_t)img->width * img->height * img->form);
     
 
 //#ifdef _DEBUG_
@@ -1308,33 +2542,12 @@ int setEffectCmd(SdkEnv* env, const char* cmd)
         //////////////////////////////////////
 #endif
 
-        // In off-screen render, We must reAssign value.
-        // Otherwise, the elemets will be invisible
-        if (OFF_SCREEN_RENDER == env->type) {
-            env->egl.width = img->width;
-            env->egl.height = img->height;
-        }
-
         clearChrbuf (env->userCmd);
         appendChrbuf (env->userCmd, cmd);
         env->userData.param = (void *) img;
         env->userData.active = ACTIVE_PARAM;
 
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        glBindTexture(GL_TEXTURE_2D, env->handle.texture1Idx);
-		GLint fmt = GL_RGBA;
-		if (IMAGE_JPG == env->userData.inputImageType) {
-			fmt = GL_RGB;
-		}
-
-        int level = 0;
-#define BORDER 0
-        glTexImage2D(GL_TEXTURE_2D, level, fmt, img->width, img->height, BORDER, fmt, GL_UNSIGNED_BYTE, img->base);
-
-        glBindTexture(GL_TEXTURE_2D, env->handle.texture2Idx);
-        glTexImage2D(GL_TEXTURE_2D, level, fmt, img->width, img->height, BORDER, fmt, GL_UNSIGNED_BYTE, NULL);
-
-
+        uploadPlanned (env, img, img->bottomUp);
     }
     // reUse image in memory
     else if (ACTIVE_PARAM == env->userData.active) {
@@ -1346,7 +2559,16 @@ int setEffectCmd(SdkEnv* env, const char* cmd)
         }
 #endif
 
-        Log ("Reuse image\n");
+        LogD ("Reuse image\n");
+
+        // apply the new effect to the image in memory
+        if (NULL != env->userData.param &&
+                strcmp (cmd, env->userCmd->base) != 0) {
+            clearChrbuf (env->userCmd);
+            appendChrbuf (env->userCmd, cmd);
+            Bitmap_t *img = (Bitmap_t *) env->userData.param;
+            uploadPlanned (env, img, img->bottomUp);
+        }
     }
 
     LOG_EXIT;
@@ -1354,48 +2576,17 @@ int setEffectCmd(SdkEnv* env, const char* cmd)
 }
 
 static void onRender(SdkEnv *env) {
-    glViewport(0, 0, env->egl.width, env->egl.height);
-    glClear(GL_COLOR_BUFFER_BIT);
-    glClearColor (0.0f, 0.0f, 0.0f, 1.0f);
-    glUseProgram(env->handle.program);
-
-    if ( OFF_SCREEN_RENDER == env->type ) {
-        glBindFramebuffer (GL_FRAMEBUFFER, env->handle.fboIdx);
-
-        int level = 0;
-        glFramebufferTexture2D (
-                GL_FRAMEBUFFER, 
-                GL_COLOR_ATTACHMENT0,	 
-                GL_TEXTURE_2D,
-                env->handle.texture2Idx,
-                level);
-
-        GLenum status = glCheckFramebufferStatus (GL_FRAMEBUFFER);
-        if (status != GL_FRAMEBUFFER_COMPLETE) {
-            LogE ("Framebuffer not ready. status code:0x%04x\n", status);
-        }
-    }
-
-    float vertex[] = {
-        -0.9,  0.9, 0,
-        -0.9, -0.9, 0,
-         0.9, -0.9, 0,
-         0.9,  0.9, 0
-    };
-
-    float texCoord[] = {
-        0, 1,
-        0, 0,
-        1, 0,
-        1, 1
-    };
+    drawFrame(env, true);
+}
 
-    float colors[] = {
-        0.0f, 1.0f, 0.2f
-    };
+/*
+ * Draw the image with the effect program to the bound framebuffer
+ */
+static void drawQuad(SdkEnv *env, const float *vertex, const float *texCoord) {
+    glUseProgram(env->handle.program);
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, env->handle.texture1Idx);
+    glBindTexture(GL_TEXTURE_2D, env->lutGpu.active ? env->lutGpu.output : env->handle.texture1Idx);
     glUniform1i(env->handle.sampler2dIdx, 0);
 
     glEnableVertexAttribArray(env->handle.positionIdx);
@@ -1404,21 +2595,47 @@ static void onRender(SdkEnv *env) {
     glEnableVertexAttribArray(env->handle.texCoordIdx);
     glVertexAttribPointer(env->handle.texCoordIdx, 2, GL_FLOAT, GL_FALSE, 0, texCoord);
 
-
     glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+}
+
+/*
+ * Render a frame. Without finish GPU is only flushed, the readback
+ * fence of submitImage waits for it
+ */
+static void drawFrame(SdkEnv *env, bool finish) {
+    if (ensureProgram (env) < 0) {
+        return;
+    }
+    uint64_t begin_ns = getNanoTime ();
+
+    // texture2 is attached & checked once by the pool. Bind it before
+    // clearing, the pooled texture may hold an older image
+    if ( OFF_SCREEN_RENDER == env->type ) {
+        glBindFramebuffer (GL_FRAMEBUFFER, env->handle.fboIdx);
+        if (env->handle.fboStatus != GL_FRAMEBUFFER_COMPLETE) {
+            LogE ("Framebuffer not ready. status code:0x%04x\n", env->handle.fboStatus);
+        }
+    }
+
+    glViewport(0, 0, env->egl.width, env->egl.height);
+    glClearColor (0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    drawQuad(env, sQuadVertex, sQuadTexCoord);
 
     // Only rendering with OpenGL ES 2.0, so
     // I simply call glFinish()
-    uint32_t t1 = getCurrentTime ();	
-    glFinish();
-    uint32_t t2 = getCurrentTime ();
-    Log ("Render cost %d ms\n", (t2 - t1) );
+    if (finish) {
+        glFinish();
+    } else {
+        glFlush();
+    }
+    endStage (&env->stats, STAGE_RENDER, begin_ns);
 
     if (ON_SCREEN_RENDER == env->type ) {
-        Log ("On screen render\n");
+        LogD ("On screen render\n");
         swapEglBuffers (env);
     } else if (OFF_SCREEN_RENDER == env->type) {
-        Log ("Off screen render\n");
+        LogD ("Off screen render\n");
     }
 }
 
@@ -1430,10 +2647,11 @@ static void onDraw(SdkEnv *env) {
         LogE ("NULL pointer exception in onDraw()\n");
         return;
     }
-    Log("onDraw()\n");
-
-	Log("ptheadself = %lx\n", pthread_self());
-	Log("gettid = %x\n", gettid());
+    LogD("onDraw()\n");
+    if (ensureProgram (env) < 0) {
+        return;
+    }
+    uint64_t begin_ns = getNanoTime ();
 
 #define POINT_COUNT 5
     // start vertex
@@ -1487,16 +2705,14 @@ static void onDraw(SdkEnv *env) {
 
     // Only rendering with OpenGL ES 2.0, so
     // I simply call glFinish()
-    uint32_t t1 = getCurrentTime ();	
     glFinish();
-    uint32_t t2 = getCurrentTime ();
-    Log ("Render cost %d ms\n", (t2 - t1) );
+    endStage (&env->stats, STAGE_RENDER, begin_ns);
 
     if (ON_SCREEN_RENDER == env->type ) {
-        Log ("On screen render\n");
+        LogD ("On screen render\n");
         swapEglBuffers (env);
     } else if (OFF_SCREEN_RENDER == env->type) {
-        Log ("Off screen render\n");
+        LogD ("Off screen render\n");
     }
 }
 
@@ -1517,8 +2733,13 @@ static void onDestroy(SdkEnv *env) {
 
 int setEglNativeWindow(SdkEnv *env, const EGLNativeWindowType window)
 {
-    VALIDATE_NOT_NULL2(env, window);
+    VALIDATE_NOT_NULL(env);
+    if ((EGLNativeWindowType)0 == window) {
+        LogE("window = NULL in %s\n", __FUNCTION__);
+        return -1;
+    }
     env->egl.window = window;
+    return 0;
 }
 
 /**
@@ -1543,7 +2764,7 @@ void swapEglBuffers(const SdkEnv *env)
 
 /**
  * Assign an variable which type is AssetManager * to sdk context in 
- * Android platform. It does not define in other platforms
+ * Android platform, the directory of assets in Linux
  * Notice:
  *		Never check if data is really valid.
  *		The user ensure data is valid.
@@ -1612,7 +2833,7 @@ int read_jpeg(const char *path, Bitmap_t *mem)
 
     FILE *fp = fopen (path, "rb");
     if (NULL == fp) {
-        Log("Failed open %s\n", path);
+        LogE("Failed open %s\n", path);
         return -1;
     }
 
@@ -1623,11 +2844,12 @@ int read_jpeg(const char *path, Bitmap_t *mem)
     jpeg_stdio_src (&jds, fp);
     jpeg_read_header (&jds, TRUE);
 
-    Log("[%s %d x %d %d]\n", path, jds.image_width, jds.image_height, jds.num_components);
+    LogD("[%s %d x %d %d]\n", path, jds.image_width, jds.image_height, jds.num_components);
 
     mem->width = jds.image_width;
     mem->height = jds.image_height;
     mem->form =  jds.num_components;
+    mem->bottomUp = true;
     mem->base = (char *) calloc (jds.image_width * jds.image_height * jds.num_components, 1);
     assert (NULL != mem->base);
 
@@ -1644,6 +2866,111 @@ int read_jpeg(const char *path, Bitmap_t *mem)
     return 0;
 }
 
+/**
+ * Read a low-fidelity jpeg to memory for preview & thumbnail
+ * Parameters:
+ *		path:	jpeg file path
+ *		mem:	[OUT] decoded bitmap, rows are flipped as read_jpeg
+ *		opt:	preview options, NULL means the first scan at full size
+ * Return:
+ *		 0 OK
+ *		-1 error
+ */
+int read_jpeg_preview(const char *path, Bitmap_t *mem, const PreviewOpt_t *opt)
+{
+    if (NULL == path || NULL == mem) {
+        return -1;
+    }
+
+    int maxScans = 1;
+    int budgetMs = 0;
+    int scaleDenom = 1;
+    if (NULL != opt) {
+        maxScans = opt->maxScans;
+        budgetMs = opt->budgetMs;
+        scaleDenom = opt->scaleDenom;
+    }
+    if (1 != scaleDenom && 2 != scaleDenom && 4 != scaleDenom && 8 != scaleDenom) {
+        LogE ("Invalid preview scale 1/%d\n", scaleDenom);
+        return -1;
+    }
+
+    FILE *fp = fopen (path, "rb");
+    if (NULL == fp) {
+        LogE("Failed open %s\n", path);
+        return -1;
+    }
+
+    uint32_t begin_t = getCurrentTime();
+    struct jpeg_decompress_struct jds;
+    struct jpeg_error_mgr jerr;
+    jds.err = jpeg_std_error (&jerr);
+    jpeg_create_decompress (&jds);
+    jpeg_stdio_src (&jds, fp);
+    jpeg_read_header (&jds, TRUE);
+
+    jds.scale_num = 1;
+    jds.scale_denom = scaleDenom;
+    bool progressive = jpeg_has_multiple_scans (&jds);
+    jds.buffered_image = progressive;
+    jpeg_start_decompress (&jds);
+
+    int scans = 0;
+    if (progressive) {
+        // absorb scans until the limit, the output is built from
+        // the coefficients received so far
+        while (!jpeg_input_complete (&jds)) {
+            int ret = jpeg_consume_input (&jds);
+            if (JPEG_REACHED_EOI == ret) {
+                break;
+            }
+            if (JPEG_SCAN_COMPLETED != ret) {
+                continue;
+            }
+            ++scans;
+            if (maxScans > 0 && scans >= maxScans) {
+                break;
+            }
+            if (budgetMs > 0 && getCurrentTime() - begin_t >= budgetMs) {
+                break;
+            }
+        }
+        jpeg_start_output (&jds, jds.input_scan_number);
+    }
+
+    LogD("[%s preview %d x %d %d scans=%d]\n", path,
+            jds.output_width, jds.output_height, jds.output_components, scans);
+
+    mem->width = jds.output_width;
+    mem->height = jds.output_height;
+    mem->form = jds.output_components;
+    mem->bottomUp = true;
+    mem->base = (char *) calloc (jds.output_width * jds.output_height * jds.output_components, 1);
+    assert (NULL != mem->base);
+
+    int row_stride = jds.output_width * jds.output_components;
+    JSAMPROW row_pointer[1];
+    while (jds.output_scanline < jds.output_height) {
+        row_pointer[0] = (JSAMPROW)(mem->base + (jds.output_height - jds.output_scanline - 1) * row_stride);
+        jpeg_read_scanlines (&jds, row_pointer, 1);
+    }
+
+    if (progressive) {
+        jpeg_finish_output (&jds);
+        // skip the remaining scans
+        jpeg_abort_decompress (&jds);
+    } else {
+        jpeg_finish_decompress (&jds);
+    }
+    jpeg_destroy_decompress (&jds);
+    fclose (fp);
+
+    uint32_t finish_t = getCurrentTime();
+    LogD("Preview %s cost %d ms\n", path, (finish_t - begin_t));
+
+    return 0;
+}
+
 /**
  * Write jpeg data from memory to file
  * Return:
@@ -1671,6 +2998,12 @@ int write_jpeg(const char *path, const Bitmap_t *mem)
     assert (mem->form >= GRAY && mem->form <= RGBA32);
     assert (mem->form != RGB16);
 #endif
+    if (GRAY != mem->form && RGB24 != mem->form && RGBA32 != mem->form) {
+        LogE ("write_jpeg doesn't support form %d\n", mem->form);
+        jpeg_destroy_compress (&jcs);
+        fclose (fp);
+        return -1;
+    }
 
     int colorSpace = JCS_GRAYSCALE;
     int components = mem->form;
@@ -1681,6 +3014,18 @@ int write_jpeg(const char *path, const Bitmap_t *mem)
     jcs.input_components = components;
     jcs.in_color_space = colorSpace;
 
+    // JPEG has no alpha, RGBA rows are written without it
+    uint8_t *rgb = NULL;
+    if (RGBA32 == mem->form) {
+        rgb = (uint8_t *)malloc ((size_t)mem->width * 3);
+        if (NULL == rgb) {
+            LogE ("Failed malloc row of write_jpeg\n");
+            jpeg_destroy_compress (&jcs);
+            fclose (fp);
+            return -1;
+        }
+    }
+
     jpeg_set_defaults (&jcs);
 #define QUALITY 80
     jpeg_set_quality (&jcs, QUALITY, TRUE);
@@ -1689,11 +3034,23 @@ int write_jpeg(const char *path, const Bitmap_t *mem)
     int row_stride = mem->width * mem->form;
 
     while ( jcs.next_scanline < jcs.image_height ) {
-        row_pointer[0] = (JSAMPROW)(mem->base + jcs.next_scanline * row_stride);
+        int row = mem->bottomUp ? jcs.image_height - 1 - jcs.next_scanline : jcs.next_scanline;
+        const uint8_t *src = (const uint8_t *)mem->base + (size_t)row * row_stride;
+        if (NULL != rgb) {
+            int x;
+            for (x = 0; x < mem->width; ++x) {
+                rgb[3 * x] = src[4 * x];
+                rgb[3 * x + 1] = src[4 * x + 1];
+                rgb[3 * x + 2] = src[4 * x + 2];
+            }
+            src = rgb;
+        }
+        row_pointer[0] = (JSAMPROW)src;
         jpeg_write_scanlines (&jcs, row_pointer, 1);
     }
     jpeg_finish_compress (&jcs);
     jpeg_destroy_compress (&jcs);
+    free (rgb);
     fclose (fp);
     return 0;
 }
@@ -1716,16 +3073,19 @@ int loadImage (const char *path, Bitmap_t *mem)
         return -1;
     }
 
+    uint64_t trace_ns = TRACE_BEGIN ();
+    int retCode = -1;
     if (strcasecmp (postfix, "jpg") == 0) {
-        return read_jpeg (path, mem);
+        retCode = read_jpeg (path, mem);
     }
     else if (strcasecmp (postfix, "png") == 0) {
-        return read_png (path, mem);
+        retCode = read_png (path, mem);
     }
     else {
         LogE ("Invalid postfix name (%s) in loadImage\n", postfix);
-        return -1;
     }
+    TRACE_END ("loadImage", trace_ns);
+    return retCode;
 }
 
 /**
@@ -1746,14 +3106,17 @@ int saveImage (const char *path, const Bitmap_t *mem)
         return -1;
     }
 
+    uint64_t trace_ns = TRACE_BEGIN ();
+    int retCode = -1;
     if (strcasecmp (postfix, "jpg") == 0) {
-        return write_jpeg (path, mem);
+        retCode = write_jpeg (path, mem);
     }
     else if (strcasecmp (postfix, "png") == 0) {
-        return write_png (path, mem);
+        retCode = write_png (path, mem);
     }
     else {
         LogE ("Invalid postfix name (%s) in saveImage\n", postfix);
-        return -1;
     }
+    TRACE_END ("saveImage", trace_ns);
+    return retCode;
 }
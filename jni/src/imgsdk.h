@@ -9,9 +9,9 @@
 #ifndef __IMGSDK__H__
 #define __IMGSDK__H__
 
-#include <android/log.h>
 #include <EGL/egl.h>
 #include "comm.h"
+#include "stats.h"
 
 /*
  * pixel color format
@@ -32,8 +32,28 @@ typedef struct {
 	int width;			// image width
 	int height;			// image height
 	char* base;			// base address
+	bool bottomUp;		// rows are stored bottom-up, e.g. by read_jpeg
 } Bitmap_t;
 
+/**
+ * Rectangle region of image
+ */
+typedef struct {
+	int x;				// left
+	int y;				// top
+	int width;			// region width
+	int height;			// region height
+} Rect_t;
+
+/**
+ * Image file format
+ */
+typedef enum ImageType {
+	IMAGE_UNKNOWN = 0,	// unknown image type
+	IMAGE_PNG,			// png format
+	IMAGE_JPG			// jpg format
+} ImageType;
+
 /**
  * The platform supported currently
  */
@@ -85,7 +105,8 @@ int saveImage (const char *path, const Bitmap_t *mem);
 int read_png(const char *path, Bitmap_t *mem);
 
 /**
- * Write png data from memory to file
+ * Write png data from memory to file, 8 bits per channel
+ * of GRAY, RGB24 or RGBA32
  * Return:
  *		 0 OK
  *		-1 error
@@ -93,7 +114,7 @@ int read_png(const char *path, Bitmap_t *mem);
 int write_png(const char *path, const Bitmap_t *mem);
 
 /**
- * Read jpeg file to memory
+ * Read jpeg file to memory, rows are stored bottom-up
  * Return:
  *		 0 OK
  *		-1 error
@@ -101,7 +122,27 @@ int write_png(const char *path, const Bitmap_t *mem);
 int read_jpeg(const char *path, Bitmap_t *mem);
 
 /**
- * Write jpeg data from memory to file
+ * Options for jpeg preview decoding
+ */
+typedef struct {
+	int maxScans;		// stop after N scans of progressive jpeg, 0 no limit
+	int budgetMs;		// stop reading scans after N ms, 0 no limit
+	int scaleDenom;		// DCT scaling 1/scaleDenom (1, 2, 4 or 8)
+} PreviewOpt_t;
+
+/**
+ * Read a low-fidelity jpeg to memory for preview & thumbnail.
+ * Progressive jpeg is decoded in buffered-image mode and output after
+ * the scans allowed by opt. Baseline jpeg is only DCT scaled.
+ * Return:
+ *		 0 OK
+ *		-1 error
+ */
+int read_jpeg_preview(const char *path, Bitmap_t *mem, const PreviewOpt_t *opt);
+
+/**
+ * Write jpeg data from memory to file, GRAY, RGB24 or RGBA32
+ * whose alpha is dropped
  * Return:
  *		 0 OK
  *		-1 error
@@ -114,6 +155,16 @@ int write_jpeg(const char *path, const Bitmap_t *mem);
  */
 void freeBitmap(Bitmap_t *mem);
 
+/*
+ * Make mem hold width * height pixels of form, mem->base is reused
+ * if it's large enough. Bitmaps over INT_MAX bytes are refused.
+ * Return:
+ *		 1 mem->base is allocated
+ *		 0 mem->base is reused
+ *		-1 ERROR
+ */
+int ensureBitmap(Bitmap_t *mem, int width, int height, PixForm_e form);
+
 /**
  * Create an uninitialized SdkEnv instance, must call initSdkEnv next
  * Params:
@@ -126,9 +177,21 @@ SdkEnv* newBlankSdkEnv(int platform);
  * SdkEnv is used to render on-screen
  */ int initSdkEnv(SdkEnv *env);
 
+/**
+ * Save linked shader programs as binaries in dir, so later runs load
+ * them instead of compiling. Binaries of another driver are compiled
+ * again. It applies to SdkEnv created afterwards, NULL turns it off.
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int setProgramCacheDir(const char *dir);
+
 /**
  * Create a default SdkEnv instance. Do not call initSdkEnv next 
- * Default SdkEnv is used to render off-screen
+ * Default SdkEnv is used to render off-screen.
+ * Shader files are read while EGL initializes, and compiled by the
+ * first processImage or submitImage.
  */
 SdkEnv* newDefaultSdkEnv();
 
@@ -137,6 +200,24 @@ SdkEnv* newDefaultSdkEnv();
  */
 int freeSdkEnv(SdkEnv *env);
 
+/**
+ * Bind env to the calling thread. An env is used by one thread at a
+ * time, it's bound to the thread creating it. To move it to another
+ * thread, call releaseSdkEnvCurrent on the old thread first.
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int makeSdkEnvCurrent(SdkEnv *env);
+
+/**
+ * Unbind env from the calling thread
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int releaseSdkEnvCurrent(SdkEnv *env);
+
 /**
  * Run sdk
  */
@@ -151,7 +232,8 @@ int setEglNativeWindow(SdkEnv *env, const EGLNativeWindowType window);
  * Pass the platform related data to SdkEnv
  * Params:
  *		env:  SdkEnv instance
- *		data: ANativeAssetManager (AssetManager in java) instance in Android
+ *		data: ANativeAssetManager (AssetManager in java) instance in Android,
+ *			  directory of vert.shdr & frag.shdr in Linux
  */
 int setPlatformData(SdkEnv *env, const void *data);
 
@@ -180,6 +262,80 @@ void onSdkDestroy(SdkEnv *env);
  */
 int setEffectCmd(SdkEnv* env, const char* cmd);
 
+/*
+ * Run effect on an image in memory and read back the result.
+ * Textures, framebuffer & program are kept alive between calls,
+ * and cmd is only parsed when it differs from the last one.
+ * Parameters:
+ *		env:	off-screen sdk context
+ *		img:	input image
+ *		cmd:	effect command, NULL means keep the last one
+ *		out:	[OUT] output image, out->base is reused if big enough
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int processImage (SdkEnv* env, const Bitmap_t *img, const char *cmd, Bitmap_t *out);
+
+/*
+ * Read the rendered image back to memory
+ * Parameters:
+ *		mem:	[IN/OUT] mem->form is the wanted pixel format.
+ *				mem->base is reused if it holds width * height * form
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int readOutputImage (SdkEnv* env, Bitmap_t *mem);
+
+// images submitted and not collected yet
+#define READBACK_SLOTS 2
+
+/*
+ * Run effect on an image like processImage without waiting for
+ * readback. On GLES 3 pixels are read into a pixel pack buffer behind
+ * a fence, so the CPU goes on while GPU renders & transfers. On GLES 2
+ * it reads back at once like processImage.
+ * Up to READBACK_SLOTS images may be pending, collectImage finishes
+ * them in order of submitting.
+ * Parameters:
+ *		out:	[OUT] output image, sized here & filled by collectImage.
+ *				Keep it until collected
+ * Return:
+ *		 0 OK
+ *		-1 ERROR, e.g. no free slot, nothing is pending then
+ */
+int submitImage (SdkEnv* env, const Bitmap_t *img, const char *cmd, Bitmap_t *out);
+
+/*
+ * Wait for the oldest submitted image & fill its out
+ * Return:
+ *		 0 OK
+ *		-1 ERROR, the image failed or nothing is pending
+ */
+int collectImage (SdkEnv* env);
+
+// smallest tile size of setTileSize
+#define TILE_MIN_SIZE 64
+
+/*
+ * Images wider or higher than size are rendered tile by tile, so
+ * textures never exceed size x size. The default is 4096 or
+ * GL_MAX_TEXTURE_SIZE if it's smaller. Effects look the same tiled.
+ * Parameters:
+ *		size:	largest side rendered whole, 0 restores the default
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int setTileSize (SdkEnv* env, int size);
+
+/*
+ * Timers & counters of sdk stages, updated live.
+ * Read by copyStats or formatStats, clear by resetStats
+ */
+SdkStats_t* getSdkStats (SdkEnv *env);
+
 /*
  * Set input image path
  */
@@ -10,6 +10,42 @@
 #include "comm.h"
 #include "jniHelper.h"
 
+/**
+ * java.lang.String class & methods, resolved once in JNI_OnLoad.
+ * They are valid as long as the library is loaded.
+ */
+static jclass    sClsStr;
+static jmethodID sGetBytes;
+static jmethodID sNewString;
+static jstring   sEncode;
+
+/**
+ * Resolve the JNI handles used by every call
+ */
+jint JNI_OnLoad(JavaVM *vm, void *reserved)
+{
+	JNIEnv *env = NULL;
+	if ((*vm)->GetEnv(vm, (void **)&env, JNI_VERSION_1_4) != JNI_OK) {
+		LogE("Failed GetEnv in JNI_OnLoad\n");
+		return JNI_ERR;
+	}
+
+	jclass clsStr = (jclass) (*env)->FindClass(env, "java/lang/String");
+	if (NULL == clsStr) {
+		LogE("Not found java/lang/String\n");
+		return JNI_ERR;
+	}
+	sClsStr = (jclass) (*env)->NewGlobalRef(env, clsStr);
+	sGetBytes = (*env)->GetMethodID(env, sClsStr, "getBytes", "(Ljava/lang/String;)[B");
+	sNewString = (*env)->GetMethodID(env, sClsStr, "<init>", "([BLjava/lang/String;)V");
+	jstring strEncode = (*env)->NewStringUTF(env, "UTF-8");
+	sEncode = (jstring) (*env)->NewGlobalRef(env, strEncode);
+	(*env)->DeleteLocalRef(env, strEncode);
+	(*env)->DeleteLocalRef(env, clsStr);
+
+	return JNI_VERSION_1_4;
+}
+
 /**
  * Convert jstring to char*
  */
@@ -20,10 +56,7 @@ char* jstring2string(JNIEnv *env, jstring jstr)
 	}
 
 	char *cmd = NULL;
-	jclass clsStr = (jclass) (*env)->FindClass(env, "java/lang/String");
-	jstring strEncode = (jstring) (*env)->NewStringUTF(env, "UTF-8");
-	jmethodID mid = (jmethodID) (*env)->GetMethodID(env, clsStr, "getBytes", "(Ljava/lang/String;)[B");
-	jbyteArray byteArr = (jbyteArray) (*env)->CallObjectMethod(env, jstr, mid, strEncode);
+	jbyteArray byteArr = (jbyteArray) (*env)->CallObjectMethod(env, jstr, sGetBytes, sEncode);
 	jsize len = (*env)->GetArrayLength(env, byteArr);
 	jbyte *bp = (jbyte *) (*env)->GetByteArrayElements(env, byteArr, JNI_FALSE);
 	if (len > 0) {
@@ -33,8 +66,8 @@ char* jstring2string(JNIEnv *env, jstring jstr)
 		LogE("Failed env->GetByteArrayElements\n");
 	}
 
-	(*env)->ReleaseByteArrayElements (env, byteArr, bp, 0);
-	(*env)->DeleteLocalRef (env, strEncode);
+	(*env)->ReleaseByteArrayElements (env, byteArr, bp, JNI_ABORT);
+	(*env)->DeleteLocalRef (env, byteArr);
 
 	return cmd;
 }
@@ -48,18 +81,12 @@ jstring string2jstring(JNIEnv *env, const char *cmd)
 		return NULL;
 	}
 
-	jclass clsStr = (jclass) (*env)->FindClass(env, "java/lang/String");
-	jmethodID mid = (jmethodID) (*env)->GetMethodID(env,
-			clsStr, 
-			"<init>",
-			"([BLjava/lang/String;)V");
-	jstring strEncode = (jstring) (*env)->NewStringUTF(env, "UTF-8");
-
 	int len = strlen(cmd);
 	jbyteArray byteArr = (jbyteArray) (*env)->NewByteArray(env, len);
 	(*env)->SetByteArrayRegion (env, byteArr, 0, len, (jbyte *)cmd);
 
-	jstring jretStr =  (jstring) (*env)->NewObject(env, clsStr, mid, byteArr, strEncode);
+	jstring jretStr =  (jstring) (*env)->NewObject(env, sClsStr, sNewString, byteArr, sEncode);
+	(*env)->DeleteLocalRef (env, byteArr);
 
 	return (*env)->NewGlobalRef(env, jretStr);
 }
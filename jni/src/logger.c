@@ -0,0 +1,159 @@
+/***************************************
+ * file name:   logger.c
+ * description: leveled log with an async lock-free ring sink
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "comm.h"
+#include "logger.h"
+
+// logger thread sleeps this long while the ring is empty
+#define IDLE_SLEEP_NS 2000000
+
+/**
+ * Slot of ticket t is free when turn is base = t & ~(LOG_RING_SIZE - 1),
+ * holds the line when turn is base + 1, and is free for the next lap
+ * when turn is base + LOG_RING_SIZE. So zeroed slots are all free and
+ * tickets may wrap around.
+ */
+typedef struct {
+	uint32_t	turn;
+	int			level;
+	const char	*tag;
+	char		text[LOG_LINE_SIZE];
+} LogSlot;
+
+int gLogLevel = INFO;
+
+static LogSlot sRing[LOG_RING_SIZE];
+static uint32_t sHead;			// next ticket of producers
+static uint32_t sTail;			// next ticket of consumer
+static int sDraining;			// set by the only consumer at a time
+static unsigned int sDropped;
+static unsigned int sReported;	// dropped count written out
+static pthread_once_t sOnce = PTHREAD_ONCE_INIT;
+static int sAsync;				// logger thread is running
+
+void setLogLevel (int level)
+{
+	__atomic_store_n (&gLogLevel, level, __ATOMIC_RELAXED);
+}
+
+unsigned int getDroppedLogs (void)
+{
+	return __atomic_load_n (&sDropped, __ATOMIC_RELAXED);
+}
+
+/**
+ * Write out lines until the ring is empty
+ * Return:
+ *		count of lines written, -1 if another thread is draining
+ */
+static int drainRing (void) {
+	if (__atomic_exchange_n (&sDraining, 1, __ATOMIC_ACQUIRE)) {
+		return -1;
+	}
+
+	int count = 0;
+	for (;;) {
+		LogSlot *slot = &sRing[sTail & (LOG_RING_SIZE - 1)];
+		uint32_t full = (sTail & ~(LOG_RING_SIZE - 1u)) + 1;
+		if (__atomic_load_n (&slot->turn, __ATOMIC_ACQUIRE) != full) {
+			break;
+		}
+		platformWriteLog (slot->level, slot->tag, slot->text);
+		__atomic_store_n (&slot->turn, full - 1 + LOG_RING_SIZE, __ATOMIC_RELEASE);
+		++sTail;
+		++count;
+	}
+
+	unsigned int dropped = __atomic_load_n (&sDropped, __ATOMIC_RELAXED);
+	if (dropped != sReported) {
+		char text[64];
+		snprintf (text, sizeof(text), "%u log lines dropped\n", dropped - sReported);
+		platformWriteLog (WARN, TAG, text);
+		sReported = dropped;
+	}
+
+	__atomic_store_n (&sDraining, 0, __ATOMIC_RELEASE);
+	return count;
+}
+
+static void* loggerProc (void *arg) {
+	for (;;) {
+		if (drainRing () <= 0) {
+			struct timespec ts = { 0, IDLE_SLEEP_NS };
+			nanosleep (&ts, NULL);
+		}
+	}
+	return NULL;
+}
+
+static void startLogger (void) {
+	pthread_t thread;
+	pthread_attr_t attr;
+	pthread_attr_init (&attr);
+	pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+	if (pthread_create (&thread, &attr, loggerProc, NULL) == 0) {
+		__atomic_store_n (&sAsync, 1, __ATOMIC_RELEASE);
+	}
+	pthread_attr_destroy (&attr);
+	atexit (flushLog);
+}
+
+void logWrite (int level, const char *tag, const char *fmt, ...)
+{
+	pthread_once (&sOnce, startLogger);
+
+	// claim a ticket whose slot is free
+	uint32_t pos = __atomic_load_n (&sHead, __ATOMIC_RELAXED);
+	LogSlot *slot;
+	for (;;) {
+		slot = &sRing[pos & (LOG_RING_SIZE - 1)];
+		uint32_t turn = __atomic_load_n (&slot->turn, __ATOMIC_ACQUIRE);
+		int32_t diff = (int32_t)(turn - (pos & ~(LOG_RING_SIZE - 1u)));
+		if (0 == diff) {
+			if (__atomic_compare_exchange_n (&sHead, &pos, pos + 1, true,
+						__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (diff < 0) {
+			// the line of the last lap isn't written out
+			__atomic_fetch_add (&sDropped, 1, __ATOMIC_RELAXED);
+			return;
+		} else {
+			pos = __atomic_load_n (&sHead, __ATOMIC_RELAXED);
+		}
+	}
+
+	va_list args;
+	va_start (args, fmt);
+	vsnprintf (slot->text, LOG_LINE_SIZE, fmt, args);
+	va_end (args);
+	slot->level = level;
+	slot->tag = tag;
+	__atomic_store_n (&slot->turn, (pos & ~(LOG_RING_SIZE - 1u)) + 1, __ATOMIC_RELEASE);
+
+	// no logger thread, write out on the caller
+	if (!__atomic_load_n (&sAsync, __ATOMIC_ACQUIRE)) {
+		drainRing ();
+	}
+}
+
+void flushLog (void)
+{
+	// the logger thread may be draining, wait for it
+	int spins = 0;
+	while (drainRing () < 0 && spins++ < 1000) {
+		sched_yield ();
+	}
+}
@@ -0,0 +1,51 @@
+/************************************
+ * file name:   logger.h
+ * description: leveled log with an async lock-free ring sink
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ * The calling thread only formats a line into a ring slot, a logger
+ * thread writes the lines out by platformWriteLog. Lines are dropped,
+ * never waited for, while the ring is full. Use Log, LogD, LogW & LogE
+ * of comm.h rather than logWrite.
+ *
+ ***********************************/
+
+#ifndef __LOGGER__H__
+#define __LOGGER__H__
+
+// lines buffered before dropping, power of 2
+#define LOG_RING_SIZE 256
+
+// longer lines are truncated
+#define LOG_LINE_SIZE 256
+
+/**
+ * Runtime level, lines below it are skipped by the log macros.
+ * Read with a single relaxed load, set by setLogLevel
+ */
+extern int gLogLevel;
+
+/**
+ * Set runtime level, DEBUG, INFO, WARN or ERROR of comm.h
+ */
+void setLogLevel (int level);
+
+/**
+ * Format a line into the ring, start the logger thread the first time
+ */
+void logWrite (int level, const char *tag, const char *fmt, ...)
+	__attribute__ ((format (printf, 3, 4)));
+
+/**
+ * Write out the lines in the ring on the calling thread,
+ * called at exit too
+ */
+void flushLog (void);
+
+/**
+ * Count of lines dropped while the ring was full
+ */
+unsigned int getDroppedLogs (void);
+
+#endif
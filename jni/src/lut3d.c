@@ -0,0 +1,391 @@
+/***************************************
+ * file name:   lut3d.c
+ * description: implement 3D color lookup table
+ *
+ *	Tetrahedral interpolation: the cube around a color is cut into 6
+ *	tetrahedra by its fractions fr, fg, fb. With the axes sorted as
+ *	fa >= fb >= fc, the color blends 4 nodes:
+ *		c000 * (1 - fa) + c(a) * (fa - fb) + c(a, b) * (fb - fc) + c111 * fc
+ *	Weights are Q8 and nodes Q7, so a blend is 4 multiply-adds of
+ *	int16 lanes: SSE2 madd or NEON mlal when available.
+ *
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <malloc.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "comm.h"
+#include "lut3d.h"
+#include "parallel.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define LUT3D_SSE2
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define LUT3D_NEON
+#endif
+
+// fraction bits of interpolation weights
+#define WEIGHT_BITS 8
+#define WEIGHT_ONE  (1 << WEIGHT_BITS)
+
+// line of .cube file
+#define CUBE_LINE_SIZE 256
+
+// rows of a chunk of applying
+#define LUT_CHUNK_ROWS 32
+
+typedef struct {
+	const Bitmap_t	*src;
+	Bitmap_t		*dst;
+	const Lut3D_t	*lut;
+	int				mix;			// Q8 blend of mapped color
+	uint8_t			index[256];		// node below each 8 bits value
+	uint16_t		frac[256];		// Q8 position between index & index + 1
+} LutJob;
+
+/**
+ * Node from color in 0 - 1
+ */
+static int16_t toNode (float v) {
+	v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+	return (int16_t)lrintf (v * 255.0f * (1 << LUT_NODE_BITS));
+}
+
+static int allocTable (Lut3D_t *lut, int size) {
+	lut->table = (int16_t *)calloc ((size_t)size * size * size * 4, sizeof(int16_t));
+	if (NULL == lut->table) {
+		LogE ("Failed malloc LUT of size %d\n", size);
+		return -1;
+	}
+	lut->size = size;
+	return 0;
+}
+
+/**
+ * Parse "KEYWORD a b c" of .cube
+ */
+static int parseTriple (const char *s, float *v) {
+	char *end;
+	int i;
+	for (i = 0; i < 3; ++i) {
+		v[i] = strtof (s, &end);
+		if (end == s) {
+			return -1;
+		}
+		s = end;
+	}
+	return 0;
+}
+
+static int loadCubeLut (const char *path, Lut3D_t *lut) {
+	FILE *fp = fopen (path, "r");
+	if (NULL == fp) {
+		LogE ("Failed open LUT %s\n", path);
+		return -1;
+	}
+
+	char line[CUBE_LINE_SIZE];
+	float lo[3] = { 0.0f, 0.0f, 0.0f };
+	float hi[3] = { 1.0f, 1.0f, 1.0f };
+	int count = 0;
+	int total = 0;
+	int retCode = -1;
+	while (NULL != fgets (line, CUBE_LINE_SIZE, fp)) {
+		char *s = line;
+		while (' ' == *s || '\t' == *s) {
+			++s;
+		}
+		if ('#' == *s || '\r' == *s || '\n' == *s || '\0' == *s) {
+			continue;
+		}
+
+		if (strncmp (s, "LUT_3D_SIZE", 11) == 0) {
+			int size = atoi (s + 11);
+			if (NULL != lut->table || size < LUT_MIN_SIZE || size > LUT_MAX_SIZE) {
+				LogE ("Invalid LUT_3D_SIZE in %s\n", path);
+				break;
+			}
+			if (allocTable (lut, size) < 0) {
+				break;
+			}
+			total = size * size * size;
+		}
+		else if (strncmp (s, "DOMAIN_MIN", 10) == 0) {
+			if (parseTriple (s + 10, lo) < 0) {
+				break;
+			}
+		}
+		else if (strncmp (s, "DOMAIN_MAX", 10) == 0) {
+			if (parseTriple (s + 10, hi) < 0) {
+				break;
+			}
+		}
+		else if ((*s >= '0' && *s <= '9') || '-' == *s || '.' == *s) {
+			float v[3];
+			if (NULL == lut->table || count >= total || parseTriple (s, v) < 0) {
+				LogE ("Invalid LUT data in %s\n", path);
+				break;
+			}
+			int16_t *node = lut->table + count * 4;
+			int c;
+			for (c = 0; c < 3; ++c) {
+				node[c] = toNode (hi[c] > lo[c] ? (v[c] - lo[c]) / (hi[c] - lo[c]) : v[c]);
+			}
+			++count;
+		}
+		else if (strncmp (s, "TITLE", 5) != 0) {
+			// LUT_1D_SIZE & unknown keywords
+			LogE ("Unsupported line in %s: %s", path, s);
+			break;
+		}
+	}
+	if (total > 0 && count == total && feof (fp)) {
+		retCode = 0;
+	} else if (count != total) {
+		LogE ("LUT %s has %d of %d nodes\n", path, count, total);
+	}
+	fclose (fp);
+	return retCode;
+}
+
+static int loadPngLut (const char *path, Lut3D_t *lut) {
+	Bitmap_t img;
+	memset (&img, 0, sizeof(Bitmap_t));
+	if (read_png (path, &img) < 0) {
+		return -1;
+	}
+
+	int retCode = -1;
+	int size = (int)lrint (cbrt ((double)img.width * img.height));
+	if ((img.form != RGB24 && img.form != RGBA32) ||
+			size < LUT_MIN_SIZE || size > LUT_MAX_SIZE ||
+			img.width % size != 0 || img.height % size != 0 ||
+			(img.width / size) * (img.height / size) != size) {
+		LogE ("Invalid LUT image %s of %dx%d\n", path, img.width, img.height);
+	}
+	else if (allocTable (lut, size) == 0) {
+		int cols = img.width / size;
+		int r, g, b, c;
+		for (b = 0; b < size; ++b) {
+			int x0 = (b % cols) * size;
+			int y0 = (b / cols) * size;
+			for (g = 0; g < size; ++g) {
+				const uint8_t *p = (const uint8_t *)img.base +
+					((size_t)(y0 + g) * img.width + x0) * img.form;
+				int16_t *node = lut->table + ((b * size + g) * size) * 4;
+				for (r = 0; r < size; ++r, p += img.form, node += 4) {
+					for (c = 0; c < 3; ++c) {
+						node[c] = (int16_t)(p[c] << LUT_NODE_BITS);
+					}
+				}
+			}
+		}
+		retCode = 0;
+	}
+	freeBitmap (&img);
+	return retCode;
+}
+
+/**
+ * Load LUT file by the postfix of path
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int loadLut3D (const char *path, Lut3D_t *lut)
+{
+	if (NULL == path || NULL == lut) {
+		return -1;
+	}
+	memset (lut, 0, sizeof(Lut3D_t));
+	// getFilePostfix takes 3 chars only, "cube" has 4
+	const char *postfix = strrchr (path, '.');
+	if (NULL == postfix) {
+		LogE ("No postfix name of %s in loadLut3D\n", path);
+		return -1;
+	}
+	++postfix;
+
+	int retCode = -1;
+	if (strcasecmp (postfix, "cube") == 0) {
+		retCode = loadCubeLut (path, lut);
+	}
+	else if (strcasecmp (postfix, "png") == 0) {
+		retCode = loadPngLut (path, lut);
+	}
+	else {
+		LogE ("Invalid postfix name (%s) in loadLut3D\n", postfix);
+	}
+	if (retCode < 0) {
+		freeLut3D (lut);
+	}
+	return retCode;
+}
+
+/**
+ * Release table of LUT
+ */
+void freeLut3D (Lut3D_t *lut)
+{
+	if (NULL == lut) {
+		return;
+	}
+	free (lut->table);
+	lut->table = NULL;
+	lut->size = 0;
+}
+
+/**
+ * Blend 4 nodes of Q7 by Q8 weights into 8 bits r, g, b
+ */
+static inline void blendNodes (const int16_t *c0, const int16_t *c1, const int16_t *c2,
+		const int16_t *c3, int w0, int w1, int w2, int w3, uint8_t *out) {
+	const int shift = LUT_NODE_BITS + WEIGHT_BITS;
+#if defined(LUT3D_SSE2)
+	__m128i v01 = _mm_unpacklo_epi16 (_mm_loadl_epi64 ((const __m128i *)c0),
+			_mm_loadl_epi64 ((const __m128i *)c1));
+	__m128i v23 = _mm_unpacklo_epi16 (_mm_loadl_epi64 ((const __m128i *)c2),
+			_mm_loadl_epi64 ((const __m128i *)c3));
+	__m128i acc = _mm_add_epi32 (
+			_mm_madd_epi16 (v01, _mm_set1_epi32 (w0 | (w1 << 16))),
+			_mm_madd_epi16 (v23, _mm_set1_epi32 (w2 | (w3 << 16))));
+	acc = _mm_srai_epi32 (_mm_add_epi32 (acc, _mm_set1_epi32 (1 << (shift - 1))), shift);
+	acc = _mm_packus_epi16 (_mm_packs_epi32 (acc, acc), acc);
+	uint32_t v = (uint32_t)_mm_cvtsi128_si32 (acc);
+	out[0] = (uint8_t)v;
+	out[1] = (uint8_t)(v >> 8);
+	out[2] = (uint8_t)(v >> 16);
+#elif defined(LUT3D_NEON)
+	int32x4_t acc = vmull_n_s16 (vld1_s16 (c0), w0);
+	acc = vmlal_n_s16 (acc, vld1_s16 (c1), w1);
+	acc = vmlal_n_s16 (acc, vld1_s16 (c2), w2);
+	acc = vmlal_n_s16 (acc, vld1_s16 (c3), w3);
+	int16x4_t s = vrshrn_n_s32 (acc, LUT_NODE_BITS + WEIGHT_BITS);
+	uint8x8_t b = vqmovun_s16 (vcombine_s16 (s, s));
+	out[0] = vget_lane_u8 (b, 0);
+	out[1] = vget_lane_u8 (b, 1);
+	out[2] = vget_lane_u8 (b, 2);
+#else
+	int c;
+	for (c = 0; c < 3; ++c) {
+		int v = (c0[c] * w0 + c1[c] * w1 + c2[c] * w2 + c3[c] * w3 + (1 << (shift - 1))) >> shift;
+		out[c] = v < 0 ? 0 : (v > 255 ? 255 : (uint8_t)v);
+	}
+#endif
+}
+
+/**
+ * Tetrahedral interpolation of r, g, b
+ */
+static inline void mapColor (const LutJob *job, int r, int g, int b, uint8_t *out) {
+	int n = job->lut->size;
+	int fr = job->frac[r];
+	int fg = job->frac[g];
+	int fb = job->frac[b];
+	int dr = 4;
+	int dg = 4 * n;
+	int db = 4 * n * n;
+	const int16_t *c0 = job->lut->table +
+		((job->index[b] * n + job->index[g]) * n + job->index[r]) * 4;
+	const int16_t *c3 = c0 + dr + dg + db;
+
+	if (fr >= fg) {
+		if (fg >= fb) {
+			blendNodes (c0, c0 + dr, c0 + dr + dg, c3, WEIGHT_ONE - fr, fr - fg, fg - fb, fb, out);
+		} else if (fr >= fb) {
+			blendNodes (c0, c0 + dr, c0 + dr + db, c3, WEIGHT_ONE - fr, fr - fb, fb - fg, fg, out);
+		} else {
+			blendNodes (c0, c0 + db, c0 + db + dr, c3, WEIGHT_ONE - fb, fb - fr, fr - fg, fg, out);
+		}
+	} else {
+		if (fb >= fg) {
+			blendNodes (c0, c0 + db, c0 + db + dg, c3, WEIGHT_ONE - fb, fb - fg, fg - fr, fr, out);
+		} else if (fb >= fr) {
+			blendNodes (c0, c0 + dg, c0 + dg + db, c3, WEIGHT_ONE - fg, fg - fb, fb - fr, fr, out);
+		} else {
+			blendNodes (c0, c0 + dg, c0 + dg + dr, c3, WEIGHT_ONE - fg, fg - fr, fr - fb, fb, out);
+		}
+	}
+}
+
+static void lutRows (void *arg, int y0, int y1) {
+	const LutJob *job = (const LutJob *)arg;
+	int form = job->src->form;
+	size_t count = (size_t)(y1 - y0) * job->src->width;
+	const uint8_t *in = (const uint8_t *)job->src->base + (size_t)y0 * job->src->width * form;
+	uint8_t *out = (uint8_t *)job->dst->base + (size_t)y0 * job->src->width * form;
+	uint8_t rgb[3];
+	size_t i;
+	int c;
+	for (i = 0; i < count; ++i, in += form, out += form) {
+		if (GRAY == form) {
+			mapColor (job, in[0], in[0], in[0], rgb);
+			int luma = (77 * rgb[0] + 150 * rgb[1] + 29 * rgb[2] + 128) >> 8;
+			out[0] = (uint8_t)(in[0] + (((luma - in[0]) * job->mix + 128) >> 8));
+			continue;
+		}
+		mapColor (job, in[0], in[1], in[2], rgb);
+		for (c = 0; c < 3; ++c) {
+			out[c] = (uint8_t)(in[c] + (((rgb[c] - in[c]) * job->mix + 128) >> 8));
+		}
+		if (RGBA32 == form) {
+			out[3] = in[3];
+		}
+	}
+}
+
+/**
+ * Map colors through LUT
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int applyLut3D (const Bitmap_t *src, const Lut3D_t *lut, int intensity, Bitmap_t *dst)
+{
+	if (NULL == src || NULL == src->base || NULL == lut || NULL == lut->table ||
+			NULL == dst || intensity < 0 || intensity > 100) {
+		return -1;
+	}
+	if (src->form != GRAY && src->form != RGB24 && src->form != RGBA32) {
+		LogE ("Unsupported pixel format %d in LUT\n", src->form);
+		return -1;
+	}
+
+	if (dst != src && ensureBitmap (dst, src->width, src->height, src->form) < 0) {
+		return -1;
+	}
+
+	LutJob *job = (LutJob *)malloc (sizeof(LutJob));
+	if (NULL == job) {
+		return -1;
+	}
+	job->src = src;
+	job->dst = dst;
+	job->lut = lut;
+	job->mix = (intensity * 256 + 50) / 100;
+
+	// the last value sits at the end of the last cell
+	int i;
+	for (i = 0; i < 256; ++i) {
+		int pos = i * (lut->size - 1) * WEIGHT_ONE / 255;
+		int index = pos >> WEIGHT_BITS;
+		if (index >= lut->size - 1) {
+			index = lut->size - 2;
+		}
+		job->index[i] = (uint8_t)index;
+		job->frac[i] = (uint16_t)(pos - (index << WEIGHT_BITS));
+	}
+
+	uint64_t trace_ns = TRACE_BEGIN ();
+	int retCode = parallelFor (src->height, LUT_CHUNK_ROWS, lutRows, job);
+	TRACE_END ("applyLut3D", trace_ns);
+	free (job);
+	return retCode;
+}
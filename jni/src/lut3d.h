@@ -0,0 +1,66 @@
+/************************************
+ * file name:   lut3d.h
+ * description: 3D color lookup table
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __LUT3D__H__
+#define __LUT3D__H__
+
+#include <stdint.h>
+#include "imgsdk.h"
+
+// nodes per axis
+#define LUT_MIN_SIZE 2
+#define LUT_MAX_SIZE 65
+
+// fraction bits of table nodes, on the 0 - 255 scale
+#define LUT_NODE_BITS 7
+
+/**
+ * 3D LUT, output color of the grid node (r, g, b) is at
+ * table + ((b * size + g) * size + r) * 4 as r, g, b, 0
+ */
+typedef struct {
+	int			size;		// nodes per axis
+	int16_t		*table;		// nodes in LUT_NODE_BITS fixed point
+	uint32_t	id;			// set by the owner to tell LUTs apart
+} Lut3D_t;
+
+/**
+ * Load LUT file, by the postfix of path:
+ *		.cube:	Adobe/Resolve cube file of LUT_3D_SIZE
+ *		.png:	slices of blue side by side, each slice is a
+ *				size x size square of red along x & green along y.
+ *				A strip (size^2 x size) or a grid like 512x512 of 64.
+ * Parameters:
+ *		path:	LUT file path
+ *		lut:	[OUT] loaded LUT, release by freeLut3D
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int loadLut3D (const char *path, Lut3D_t *lut);
+
+/**
+ * Release table of LUT
+ */
+void freeLut3D (Lut3D_t *lut);
+
+/**
+ * Map colors through LUT with tetrahedral interpolation
+ * Parameters:
+ *		src:		GRAY, RGB24 or RGBA32 image, alpha is kept,
+ *					GRAY takes the luma of mapped gray
+ *		lut:		color table
+ *		intensity:	0 - 100, blend of mapped & original colors
+ *		dst:		[OUT] result, may be src to map in place
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int applyLut3D (const Bitmap_t *src, const Lut3D_t *lut, int intensity, Bitmap_t *dst);
+
+#endif
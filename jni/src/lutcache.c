@@ -0,0 +1,115 @@
+/************************************
+ * file name:   lutcache.c
+ * description: implement LUT cache
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#include <malloc.h>
+#include <string.h>
+#include "comm.h"
+#include "lutcache.h"
+
+typedef struct {
+	char		*path;		// NULL means empty
+	uint32_t	lastUse;	// tick of the last hit
+	Lut3D_t		lut;
+} LutEntry;
+
+struct LutCache {
+	LutEntry	*entries;
+	int			capability;
+	uint32_t	tick;
+	uint32_t	nextId;
+};
+
+/*
+ * Create a LUT cache
+ * Return:
+ *		NULL if ERROR
+ */
+LutCache* newLutCache (int cap)
+{
+	if (cap <= 0) {
+		return NULL;
+	}
+
+	LutCache *cache = (LutCache *)calloc (1, sizeof(LutCache));
+	if (NULL == cache) {
+		return NULL;
+	}
+	cache->entries = (LutEntry *)calloc (cap, sizeof(LutEntry));
+	if (NULL == cache->entries) {
+		free (cache);
+		return NULL;
+	}
+	cache->capability = cap;
+	return cache;
+}
+
+/*
+ * Release the LUT cache & its LUTs
+ */
+void freeLutCache (LutCache *cache)
+{
+	if (NULL == cache) {
+		return;
+	}
+	int i;
+	for (i = 0; i < cache->capability; ++i) {
+		free (cache->entries[i].path);
+		freeLut3D (&cache->entries[i].lut);
+	}
+	free (cache->entries);
+	free (cache);
+}
+
+/*
+ * Get the LUT of file
+ * Return:
+ *		NULL if ERROR
+ */
+const Lut3D_t* getLut3D (LutCache *cache, const char *path)
+{
+	if (NULL == cache || NULL == path) {
+		return NULL;
+	}
+	++cache->tick;
+
+	LutEntry *victim = NULL;
+	int i;
+	for (i = 0; i < cache->capability; ++i) {
+		LutEntry *entry = &cache->entries[i];
+		if (NULL != entry->path && strcmp (entry->path, path) == 0) {
+			entry->lastUse = cache->tick;
+			return &entry->lut;
+		}
+		// prefer an empty entry, then the least recently used one
+		if (NULL == victim || (NULL != victim->path &&
+					(NULL == entry->path || entry->lastUse < victim->lastUse))) {
+			victim = entry;
+		}
+	}
+
+	Lut3D_t lut;
+	if (loadLut3D (path, &lut) < 0) {
+		LogE ("Failed loadLut3D %s\n", path);
+		return NULL;
+	}
+	char *key = strdup (path);
+	if (NULL == key) {
+		LogE ("Failed strdup LUT path\n");
+		freeLut3D (&lut);
+		return NULL;
+	}
+
+	free (victim->path);
+	freeLut3D (&victim->lut);
+	victim->path = key;
+	victim->lastUse = cache->tick;
+	victim->lut = lut;
+	victim->lut.id = ++cache->nextId;
+	Log ("Loaded LUT %s of size %d\n", path, lut.size);
+	return &victim->lut;
+}
@@ -0,0 +1,45 @@
+/************************************
+ * file name:   lutcache.h
+ * description: LRU cache of loaded 3D LUTs
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __LUTCACHE__H__
+#define __LUTCACHE__H__
+
+#include "lut3d.h"
+
+// default count of LUTs kept, a 65^3 LUT takes 2 MB
+#define LUT_CACHE_CAPABILITY 4
+
+struct LutCache;
+typedef struct LutCache LutCache;
+
+/*
+ * Create a LUT cache
+ * Parameters:
+ *		cap:	max LUTs kept, the least recently used one is dropped
+ * Return:
+ *		NULL if ERROR
+ */
+LutCache* newLutCache (int cap);
+
+/*
+ * Release the LUT cache & its LUTs
+ */
+void freeLutCache (LutCache *cache);
+
+/*
+ * Get the LUT of file, load it if not cached.
+ * Every LUT loaded by the cache has a distinct id.
+ * Parameters:
+ *		cache:	LUT cache
+ *		path:	LUT file, see loadLut3D
+ * Return:
+ *		NULL if ERROR. The LUT is valid until the next call
+ */
+const Lut3D_t* getLut3D (LutCache *cache, const char *path);
+
+#endif
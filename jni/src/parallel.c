@@ -0,0 +1,81 @@
+/***************************************
+ * file name:   parallel.c
+ * description: implement parallel loop
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <pthread.h>
+#include <unistd.h>
+#include "parallel.h"
+
+typedef struct {
+	RangeFunc	fn;
+	void		*arg;
+	int			count;
+	int			grain;
+	int			next;		// first item of the next chunk
+} ParallelLoop;
+
+static void runChunks (ParallelLoop *loop) {
+	uint64_t trace_ns = TRACE_BEGIN ();
+	for (;;) {
+		int begin = __atomic_fetch_add (&loop->next, loop->grain, __ATOMIC_RELAXED);
+		if (begin >= loop->count) {
+			break;
+		}
+		int end = begin + loop->grain < loop->count ? begin + loop->grain : loop->count;
+		loop->fn (loop->arg, begin, end);
+	}
+	TRACE_END ("chunks", trace_ns);
+}
+
+static void* parallelProc (void *arg) {
+	runChunks ((ParallelLoop *)arg);
+	return NULL;
+}
+
+/**
+ * Run [0, count) in chunks on all cores
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int parallelFor (int count, int grain, RangeFunc fn, void *arg)
+{
+	if (count < 0 || NULL == fn) {
+		return -1;
+	}
+	if (grain < 1) {
+		grain = 1;
+	}
+
+	ParallelLoop loop;
+	loop.fn = fn;
+	loop.arg = arg;
+	loop.count = count;
+	loop.grain = grain;
+	loop.next = 0;
+
+	int chunks = (count + grain - 1) / grain;
+	int threads = (int)sysconf (_SC_NPROCESSORS_ONLN);
+	threads = threads < chunks ? threads : chunks;
+	threads = threads < PARALLEL_MAX_THREADS ? threads : PARALLEL_MAX_THREADS;
+
+	pthread_t workers[PARALLEL_MAX_THREADS];
+	int started = 0;
+	for (; started < threads - 1; ++started) {
+		if (pthread_create (&workers[started], NULL, parallelProc, &loop) != 0) {
+			LogE ("Failed create parallel thread, %d running\n", started);
+			break;
+		}
+	}
+
+	runChunks (&loop);
+	int i;
+	for (i = 0; i < started; ++i) {
+		pthread_join (workers[i], NULL);
+	}
+	return 0;
+}
@@ -0,0 +1,38 @@
+/************************************
+ * file name:   parallel.h
+ * description: run loops on all cores
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __PARALLEL__H__
+#define __PARALLEL__H__
+
+#include "comm.h"
+
+// max threads of one loop, the caller's included
+#define PARALLEL_MAX_THREADS 8
+
+/**
+ * Body of loop, handles items [begin, end)
+ */
+typedef void (*RangeFunc) (void *arg, int begin, int end);
+
+/**
+ * Run [0, count) in chunks of grain items on worker threads and the
+ * caller's thread, return after all chunks are done.
+ * Chunks are taken one by one, so uneven chunks balance themselves,
+ * and if no thread can be created the caller runs them all.
+ * Parameters:
+ *		count:	item count
+ *		grain:	items of a chunk
+ *		fn:		loop body, may run concurrently on different ranges
+ *		arg:	argument of fn
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int parallelFor (int count, int grain, RangeFunc fn, void *arg);
+
+#endif
@@ -0,0 +1,417 @@
+/***************************************
+ * file name:   pipeline.c
+ * description: implement decode/effect/encode pipeline
+ *
+ *	decoder[0..D) --spsc--> effect (caller) --spsc--> encoder[0..E)
+ *	                               ^------- recycle ------|
+ *
+ *	Job i is decoded by decoder i % D and encoded by encoder i % E,
+ *	so every queue has one producer and one consumer, and the effect
+ *	stage handles jobs in order.
+ *
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <malloc.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include "comm.h"
+#include "eftplan.h"
+#include "pipeline.h"
+#include "roidec.h"
+#include "spscq.h"
+
+#define DEFAULT_DEPTH 2
+
+/**
+ * Image passed between stages
+ */
+typedef struct {
+	int			index;		// job index
+	bool		ok;			// false if the stage before failed
+	Bitmap_t	bitmap;		// pixels
+	const char	*cmd;		// effect cmd of the job, NULL means the env's last one
+	char		*rest;		// cmd left after decoding the clipped region only
+} PipeSlot;
+
+struct Pipeline;
+
+/**
+ * Decode or encode worker
+ */
+typedef struct {
+	struct Pipeline	*pipe;
+	int				id;			// worker id
+	pthread_t		thread;
+	bool			started;
+	spscq_t			*queue;		// decoder: output, encoder: input
+	spscq_t			*recycle;	// encoder: output buffers for reusing
+	uint32_t		busy;		// ms spent on work
+} PipeWorker;
+
+typedef struct Pipeline {
+	BatchJob_t	*jobs;
+	int			count;
+	PipeSlot	*inSlots;		// decoded images
+	PipeSlot	*outSlots;		// processed images
+	PipeWorker	*decoders;
+	int			nDecoders;
+	PipeWorker	*encoders;
+	int			nEncoders;
+	int			abort;			// set when the pipeline can't run
+	SdkStats_t	*stats;			// stats of env, shared by all workers
+} Pipeline;
+
+static bool isAborted (Pipeline *pipe) {
+	return __atomic_load_n (&pipe->abort, __ATOMIC_ACQUIRE) != 0;
+}
+
+/**
+ * Push with backpressure
+ * Return:
+ *		false if the pipeline is aborted
+ */
+static bool pushSlot (Pipeline *pipe, spscq_t *q, PipeSlot *slot) {
+	int spins = 0;
+	while (!pushSpscq (q, slot)) {
+		if (isAborted (pipe)) {
+			return false;
+		}
+		backoffSpscq (&spins);
+	}
+	return true;
+}
+
+/**
+ * Pop, wait while empty
+ * Return:
+ *		NULL if the pipeline is aborted
+ */
+static PipeSlot* popSlot (Pipeline *pipe, spscq_t *q) {
+	int spins = 0;
+	PipeSlot *slot;
+	while (NULL == (slot = (PipeSlot *)popSpscq (q))) {
+		if (isAborted (pipe)) {
+			return NULL;
+		}
+		backoffSpscq (&spins);
+	}
+	return slot;
+}
+
+static void* decodeProc (void *arg) {
+	PipeWorker *worker = (PipeWorker *)arg;
+	Pipeline *pipe = worker->pipe;
+	setTraceThreadName ("decoder");
+	int i;
+	for (i = worker->id; i < pipe->count; i += pipe->nDecoders) {
+		PipeSlot *slot = &pipe->inSlots[i];
+		uint32_t begin_t = getCurrentTime ();
+		slot->index = i;
+
+		// leading clips are done by decoding the region only,
+		// so splitting them is part of decoding
+		Rect_t rect;
+		const char *path = pipe->jobs[i].inputPath;
+		uint64_t begin_ns = getNanoTime ();
+		bool clipped = NULL != slot->cmd && 0 == splitEffectClip (slot->cmd, &rect, &slot->rest);
+		if (clipped) {
+			uint64_t trace_ns = TRACE_BEGIN ();
+			slot->ok = loadImageRegion (path, &rect, &slot->bitmap) >= 0;
+			TRACE_END ("loadImageRegion", trace_ns);
+		} else {
+			slot->ok = loadImage (path, &slot->bitmap) >= 0;
+		}
+		if (slot->ok) {
+			endStage (pipe->stats, STAGE_DECODE, begin_ns);
+			addCounter (pipe->stats, COUNTER_BYTES_DECODED, (int64_t)slot->bitmap.width *
+					slot->bitmap.height * slot->bitmap.form);
+		} else {
+			LogE ("Failed loadImage %s\n", pipe->jobs[i].inputPath);
+		}
+		worker->busy += getCurrentTime () - begin_t;
+		if (!pushSlot (pipe, worker->queue, slot)) {
+			break;
+		}
+	}
+	return NULL;
+}
+
+static void* encodeProc (void *arg) {
+	PipeWorker *worker = (PipeWorker *)arg;
+	Pipeline *pipe = worker->pipe;
+	setTraceThreadName ("encoder");
+	int i;
+	for (i = worker->id; i < pipe->count; i += pipe->nEncoders) {
+		PipeSlot *slot = popSlot (pipe, worker->queue);
+		if (NULL == slot) {
+			break;
+		}
+
+		uint32_t begin_t = getCurrentTime ();
+		BatchJob_t *job = &pipe->jobs[slot->index];
+		job->result = -1;
+		if (slot->ok) {
+			uint64_t begin_ns = getNanoTime ();
+			if (saveImage (job->outputPath, &slot->bitmap) < 0) {
+				LogE ("Failed saveImage %s\n", job->outputPath);
+				addCounter (pipe->stats, COUNTER_FAILURES, 1);
+			} else {
+				job->result = 0;
+				endStage (pipe->stats, STAGE_ENCODE, begin_ns);
+				addCounter (pipe->stats, COUNTER_BYTES_ENCODED, (int64_t)slot->bitmap.width *
+						slot->bitmap.height * slot->bitmap.form);
+			}
+		}
+		worker->busy += getCurrentTime () - begin_t;
+
+		// give the output buffer back for reusing
+		if (!pushSpscq (worker->recycle, slot)) {
+			freeBitmap (&slot->bitmap);
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Wait for readback of out & pass it to its encoder
+ */
+static bool collectSlot (Pipeline *pipe, SdkEnv *env, PipeSlot *out, uint32_t *busy) {
+	uint32_t begin_t = getCurrentTime ();
+	if (out->ok) {
+		out->ok = collectImage (env) >= 0;
+	}
+	*busy += getCurrentTime () - begin_t;
+	return pushSlot (pipe, pipe->encoders[out->index % pipe->nEncoders].queue, out);
+}
+
+/**
+ * Effect stage on the caller's thread. Images are submitted up to
+ * READBACK_SLOTS ahead of collecting, so the next image runs on CPU
+ * & GPU while the last one reads back.
+ */
+static uint32_t runEffectStage (Pipeline *pipe, SdkEnv *env) {
+	uint32_t busy = 0;
+	PipeSlot *pending[READBACK_SLOTS];	// in order of submitting
+	int nPending = 0;
+	bool stopped = false;
+	int i, k;
+	for (i = 0; i < pipe->count; ++i) {
+		PipeSlot *in = popSlot (pipe, pipe->decoders[i % pipe->nDecoders].queue);
+		if (NULL == in) {
+			break;
+		}
+
+		uint32_t begin_t = getCurrentTime ();
+		PipeWorker *encoder = &pipe->encoders[i % pipe->nEncoders];
+		PipeSlot *out = &pipe->outSlots[i];
+		out->index = i;
+		out->ok = false;
+
+		// take the buffer of an encoded image
+		PipeSlot *reuse = (PipeSlot *)popSpscq (encoder->recycle);
+		if (NULL != reuse) {
+			out->bitmap = reuse->bitmap;
+			memset (&reuse->bitmap, 0, sizeof(Bitmap_t));
+		}
+
+		if (in->ok) {
+			// output keeps the pixel format of input, both encoders write GRAY, RGB & RGBA
+			if (out->bitmap.form != in->bitmap.form) {
+				freeBitmap (&out->bitmap);
+				out->bitmap.form = in->bitmap.form;
+			}
+			out->ok = submitImage (env, &in->bitmap,
+					NULL != in->rest ? in->rest : in->cmd, &out->bitmap) >= 0;
+		} else {
+			// processImage counts the decoded ones
+			addCounter (pipe->stats, COUNTER_IMAGES, 1);
+			addCounter (pipe->stats, COUNTER_FAILURES, 1);
+		}
+		freeBitmap (&in->bitmap);
+		free (in->rest);
+		in->rest = NULL;
+		busy += getCurrentTime () - begin_t;
+
+		pending[nPending++] = out;
+		if (READBACK_SLOTS == nPending) {
+			stopped = !collectSlot (pipe, env, pending[0], &busy);
+			for (k = 1; k < nPending; ++k) {
+				pending[k - 1] = pending[k];
+			}
+			--nPending;
+			if (stopped) {
+				break;
+			}
+		}
+	}
+
+	// the submitted ones must be collected to free readback slots
+	for (k = 0; k < nPending; ++k) {
+		if (stopped) {
+			if (pending[k]->ok) {
+				collectImage (env);
+			}
+		} else {
+			stopped = !collectSlot (pipe, env, pending[k], &busy);
+		}
+	}
+	return busy;
+}
+
+static int createWorkers (Pipeline *pipe, PipeWorker *workers, int n,
+		int depth, bool encoder) {
+	int i;
+	for (i = 0; i < n; ++i) {
+		PipeWorker *worker = &workers[i];
+		worker->pipe = pipe;
+		worker->id = i;
+		worker->queue = newSpscq (depth);
+		if (NULL == worker->queue) {
+			return -1;
+		}
+		if (encoder) {
+			worker->recycle = newSpscq (depth + 1);
+			if (NULL == worker->recycle) {
+				return -1;
+			}
+		}
+		if (pthread_create (&worker->thread, NULL,
+					encoder ? encodeProc : decodeProc, worker) != 0) {
+			LogE ("Failed create pipeline thread\n");
+			return -1;
+		}
+		worker->started = true;
+	}
+	return 0;
+}
+
+static void joinWorkers (PipeWorker *workers, int n) {
+	int i;
+	for (i = 0; i < n; ++i) {
+		if (workers[i].started) {
+			pthread_join (workers[i].thread, NULL);
+		}
+		freeSpscq (workers[i].queue);
+		freeSpscq (workers[i].recycle);
+	}
+}
+
+static uint32_t sumBusy (const PipeWorker *workers, int n) {
+	uint32_t busy = 0;
+	int i;
+	for (i = 0; i < n; ++i) {
+		busy += workers[i].busy;
+	}
+	return busy;
+}
+
+/**
+ * Run jobs through decode pool -> effect stage -> encode pool.
+ * Return:
+ *		>= 0 count of jobs succeed
+ *		  -1 ERROR
+ */
+int runPipeline (SdkEnv *env, BatchJob_t *jobs, int count, const PipelineOpt_t *opt)
+{
+	if (NULL == env || NULL == jobs || count < 0) {
+		return -1;
+	}
+
+	int i;
+	for (i = 0; i < count; ++i) {
+		if (NULL == jobs[i].inputPath || NULL == jobs[i].outputPath) {
+			LogE ("Invalid pipeline job %d\n", i);
+			return -1;
+		}
+		jobs[i].result = -1;
+	}
+	if (0 == count) {
+		return 0;
+	}
+
+	// the caller's thread runs effect, split the rest cores
+	int cpus = (int)sysconf (_SC_NPROCESSORS_ONLN);
+	int workers = cpus > 2 ? cpus - 1 : 2;
+	int nDecoders = (NULL != opt && opt->decoders > 0) ? opt->decoders : (workers + 1) / 2;
+	int nEncoders = (NULL != opt && opt->encoders > 0) ? opt->encoders : workers - (workers + 1) / 2;
+	int depth = (NULL != opt && opt->depth > 0) ? opt->depth : DEFAULT_DEPTH;
+	if (nEncoders < 1) {
+		nEncoders = 1;
+	}
+
+	Pipeline pipe;
+	memset (&pipe, 0, sizeof(Pipeline));
+	pipe.jobs = jobs;
+	pipe.count = count;
+	pipe.nDecoders = nDecoders;
+	pipe.nEncoders = nEncoders;
+	pipe.stats = getSdkStats (env);
+	pipe.inSlots = (PipeSlot *)calloc (count, sizeof(PipeSlot));
+	pipe.outSlots = (PipeSlot *)calloc (count, sizeof(PipeSlot));
+	pipe.decoders = (PipeWorker *)calloc (nDecoders, sizeof(PipeWorker));
+	pipe.encoders = (PipeWorker *)calloc (nEncoders, sizeof(PipeWorker));
+
+	// a job without cmd runs the last one, pass it explicitly, because
+	// the env's last one may be the rest of a clipped cmd
+	const char *cmd = NULL;
+	for (i = 0; NULL != pipe.inSlots && i < count; ++i) {
+		if (NULL != jobs[i].effectCmd) {
+			cmd = jobs[i].effectCmd;
+		}
+		pipe.inSlots[i].cmd = cmd;
+	}
+
+	int ret = -1;
+	uint32_t begin_t = getCurrentTime ();
+	uint32_t effectBusy = 0;
+	if (NULL == pipe.inSlots || NULL == pipe.outSlots ||
+			NULL == pipe.decoders || NULL == pipe.encoders) {
+		LogE ("Failed calloc pipeline\n");
+	}
+	else if (createWorkers (&pipe, pipe.encoders, nEncoders, depth, true) < 0 ||
+			createWorkers (&pipe, pipe.decoders, nDecoders, depth, false) < 0) {
+		LogE ("Failed create pipeline workers\n");
+		__atomic_store_n (&pipe.abort, 1, __ATOMIC_RELEASE);
+	}
+	else {
+		effectBusy = runEffectStage (&pipe, env);
+		ret = 0;
+	}
+
+	if (NULL != pipe.encoders) {
+		joinWorkers (pipe.encoders, nEncoders);
+	}
+	if (NULL != pipe.decoders) {
+		joinWorkers (pipe.decoders, nDecoders);
+	}
+
+	uint32_t finish_t = getCurrentTime ();
+	if (0 == ret) {
+		for (i = 0; i < count; ++i) {
+			if (0 == jobs[i].result) {
+				++ret;
+			}
+		}
+		Log ("Pipeline %d/%d images cost %d ms, busy decode %d ms x%d, "
+				"effect %d ms, encode %d ms x%d\n",
+				ret, count, finish_t - begin_t,
+				sumBusy (pipe.decoders, nDecoders), nDecoders, effectBusy,
+				sumBusy (pipe.encoders, nEncoders), nEncoders);
+	}
+
+	for (i = 0; NULL != pipe.inSlots && NULL != pipe.outSlots && i < count; ++i) {
+		freeBitmap (&pipe.inSlots[i].bitmap);
+		freeBitmap (&pipe.outSlots[i].bitmap);
+		free (pipe.inSlots[i].rest);
+	}
+	free (pipe.inSlots);
+	free (pipe.outSlots);
+	free (pipe.decoders);
+	free (pipe.encoders);
+
+	return ret;
+}
@@ -0,0 +1,42 @@
+/************************************
+ * file name:   pipeline.h
+ * description: three-stage decode/effect/encode pipeline
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __PIPELINE__H__
+#define __PIPELINE__H__
+
+#include "batch.h"
+#include "imgsdk.h"
+
+/**
+ * Pipeline options, 0 means choose by cpu count
+ */
+typedef struct {
+	int decoders;		// decode threads
+	int encoders;		// encode threads
+	int depth;			// images queued per worker
+} PipelineOpt_t;
+
+/**
+ * Run jobs through decode pool -> effect stage -> encode pool.
+ * Stages are connected by bounded lock-free spsc queues, so a fast
+ * stage blocks instead of piling up images (backpressure).
+ * The effect stage runs on the caller's thread, which must own the
+ * EGL context of env. Jobs are processed in order, the effect stage
+ * submits the next image before collecting the last, see submitImage.
+ * Parameters:
+ *		env:	off-screen sdk context
+ *		jobs:	[IN/OUT] jobs, result is filled
+ *		count:	job count
+ *		opt:	options, NULL means default
+ * Return:
+ *		>= 0 count of jobs succeed
+ *		  -1 ERROR
+ */
+int runPipeline (SdkEnv *env, BatchJob_t *jobs, int count, const PipelineOpt_t *opt);
+
+#endif
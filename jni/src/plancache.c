@@ -0,0 +1,195 @@
+/************************************
+ * file name:   plancache.c
+ * description: implement plan cache
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#include <malloc.h>
+#include <string.h>
+#include "comm.h"
+#include "plancache.h"
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME  1099511628211ULL
+
+typedef struct {
+	uint64_t	hash;		// hash of key, 0 means empty
+	char		*key;		// normalized cmd
+	uint32_t	lastUse;	// tick of the last hit
+	EftPlan_t	plan;
+} PlanEntry;
+
+struct PlanCache {
+	PlanEntry	*entries;
+	int			capability;
+	uint32_t	tick;
+	uint32_t	hits;
+	uint32_t	misses;
+	char		*norm;		// buffer for normalizing cmd
+	int			nNorm;
+};
+
+/*
+ * Create a plan cache
+ * Return:
+ *		NULL if ERROR
+ */
+PlanCache* newPlanCache (int cap)
+{
+	if (cap <= 0) {
+		return NULL;
+	}
+
+	PlanCache *cache = (PlanCache *)calloc (1, sizeof(PlanCache));
+	if (NULL == cache) {
+		return NULL;
+	}
+	cache->entries = (PlanEntry *)calloc (cap, sizeof(PlanEntry));
+	if (NULL == cache->entries) {
+		free (cache);
+		return NULL;
+	}
+	cache->capability = cap;
+	return cache;
+}
+
+/*
+ * Release the plan cache
+ */
+void freePlanCache (PlanCache *cache)
+{
+	if (NULL == cache) {
+		return;
+	}
+	int i;
+	for (i = 0; i < cache->capability; ++i) {
+		if (NULL != cache->entries[i].key) {
+			free (cache->entries[i].key);
+		}
+	}
+	free (cache->entries);
+	if (NULL != cache->norm) {
+		free (cache->norm);
+	}
+	free (cache);
+}
+
+/*
+ * Strip whitespace outside strings into cache->norm
+ * Return:
+ *		length of normalized cmd, -1 if ERROR
+ */
+static int normalizeCmd (PlanCache *cache, const char *cmd) {
+	int len = strlen (cmd);
+	if (cache->nNorm < len + 1) {
+		char *buf = (char *)realloc (cache->norm, len + 1);
+		if (NULL == buf) {
+			return -1;
+		}
+		cache->norm = buf;
+		cache->nNorm = len + 1;
+	}
+
+	char *dst = cache->norm;
+	bool quoted = false;
+	const char *p;
+	for (p = cmd; *p != '\0'; ++p) {
+		if (quoted) {
+			*dst++ = *p;
+			if ('\\' == *p && p[1] != '\0') {
+				*dst++ = *++p;
+			} else if ('"' == *p) {
+				quoted = false;
+			}
+		} else if (' ' != *p && '\t' != *p && '\r' != *p && '\n' != *p) {
+			*dst++ = *p;
+			quoted = '"' == *p;
+		}
+	}
+	*dst = '\0';
+	return dst - cache->norm;
+}
+
+static uint64_t hashKey (const char *key, int len) {
+	uint64_t hash = FNV_OFFSET;
+	int i;
+	for (i = 0; i < len; ++i) {
+		hash ^= (unsigned char)key[i];
+		hash *= FNV_PRIME;
+	}
+	return 0 == hash ? 1 : hash;
+}
+
+/*
+ * Get the plan of user cmd
+ * Return:
+ *		NULL if ERROR
+ */
+const EftPlan_t* getEffectPlan (PlanCache *cache, const char *cmd)
+{
+	if (NULL == cache || NULL == cmd) {
+		return NULL;
+	}
+
+	int len = normalizeCmd (cache, cmd);
+	if (len < 0) {
+		LogE ("Failed normalize effect cmd\n");
+		return NULL;
+	}
+	uint64_t hash = hashKey (cache->norm, len);
+	++cache->tick;
+
+	PlanEntry *victim = NULL;
+	int i;
+	for (i = 0; i < cache->capability; ++i) {
+		PlanEntry *entry = &cache->entries[i];
+		if (entry->hash == hash && strcmp (entry->key, cache->norm) == 0) {
+			entry->lastUse = cache->tick;
+			++cache->hits;
+			return &entry->plan;
+		}
+		// prefer an empty entry, then the least recently used one
+		if (NULL == victim || (0 != victim->hash &&
+					(0 == entry->hash || entry->lastUse < victim->lastUse))) {
+			victim = entry;
+		}
+	}
+
+	++cache->misses;
+	EftPlan_t plan;
+	if (parseEffectPlan (cache->norm, &plan) < 0) {
+		return NULL;
+	}
+
+	char *key = strdup (cache->norm);
+	if (NULL == key) {
+		LogE ("Failed strdup plan key\n");
+		return NULL;
+	}
+	if (NULL != victim->key) {
+		free (victim->key);
+	}
+	victim->hash = hash;
+	victim->key = key;
+	victim->lastUse = cache->tick;
+	memcpy (&victim->plan, &plan, sizeof(EftPlan_t));
+	return &victim->plan;
+}
+
+/*
+ * Get hit & miss count of the cache
+ */
+void getPlanCacheStats (const PlanCache *cache, uint32_t *hits, uint32_t *misses)
+{
+	if (NULL == cache) {
+		return;
+	}
+	if (NULL != hits) {
+		*hits = cache->hits;
+	}
+	if (NULL != misses) {
+		*misses = cache->misses;
+	}
+}
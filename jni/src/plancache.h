@@ -0,0 +1,51 @@
+/************************************
+ * file name:   plancache.h
+ * description: LRU cache of compiled effect plans
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __PLANCACHE__H__
+#define __PLANCACHE__H__
+
+#include <stdint.h>
+#include "eftplan.h"
+
+// default count of plans kept
+#define PLAN_CACHE_CAPABILITY 16
+
+struct PlanCache;
+typedef struct PlanCache PlanCache;
+
+/*
+ * Create a plan cache
+ * Parameters:
+ *		cap:	max plans kept, the least recently used one is dropped
+ * Return:
+ *		NULL if ERROR
+ */
+PlanCache* newPlanCache (int cap);
+
+/*
+ * Release the plan cache
+ */
+void freePlanCache (PlanCache *cache);
+
+/*
+ * Get the plan of user cmd, parse & compile it if not cached.
+ * Commands differ only in whitespace outside strings share a plan.
+ * Parameters:
+ *		cache:	plan cache
+ *		cmd:	user cmd
+ * Return:
+ *		NULL if ERROR. The plan is valid until the next call
+ */
+const EftPlan_t* getEffectPlan (PlanCache *cache, const char *cmd);
+
+/*
+ * Get hit & miss count of the cache
+ */
+void getPlanCacheStats (const PlanCache *cache, uint32_t *hits, uint32_t *misses);
+
+#endif
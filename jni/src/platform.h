@@ -0,0 +1,45 @@
+/************************************
+ * file name:   platform.h
+ * description: platform related bits: log, assets & native window
+ *				platform_android.c for Android, platform_linux.c for Linux
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __PLATFORM__H__
+#define __PLATFORM__H__
+
+#include <EGL/egl.h>
+
+/**
+ * Write a formatted log line, called by the logger thread
+ * Parameters:
+ *		level:	DEBUG, INFO, WARN or ERROR of comm.h
+ *		tag:	log tag
+ */
+void platformWriteLog (int level, const char *tag, const char *text);
+
+/**
+ * Read an asset file
+ * Parameters:
+ *		data:	data of setPlatformData:
+ *				Android: AAssetManager
+ *				Linux:	 directory of assets, NULL for the current one
+ *		name:	asset file name
+ *		mem:	[OUT] file content and a '\0', free by caller
+ * Return:
+ *		  -1 ERROR
+ *		>= 0 size of mem
+ */
+int readPlatformAsset (const void *data, const char *name, char **mem);
+
+/**
+ * Size of native window
+ * Return:
+ *		 0 OK
+ *		-1 ERROR, not known on this platform
+ */
+int getNativeWindowSize (EGLNativeWindowType window, int *width, int *height);
+
+#endif
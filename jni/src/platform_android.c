@@ -0,0 +1,67 @@
+/***************************************
+ * file name:   platform_android.c
+ * description: platform layer of Android
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <malloc.h>
+#include <android/asset_manager.h>
+#include <android/log.h>
+#include <android/native_window.h>
+#include "comm.h"
+#include "platform.h"
+
+void platformWriteLog (int level, const char *tag, const char *text)
+{
+	__android_log_write (level, tag, text);
+}
+
+int readPlatformAsset (const void *data, const char *name, char **mem)
+{
+	if (NULL == data || NULL == name || NULL == mem) {
+		LogE ("NULL pointer in readPlatformAsset\n");
+		return -1;
+	}
+
+	AAssetManager *assetMgr = (AAssetManager *)data;
+	AAsset *asset = AAssetManager_open (assetMgr, name, AASSET_MODE_UNKNOWN);
+	if (NULL == asset) {
+		LogE ("Failed open %s by asset manger\n", name);
+		return -1;
+	}
+	off_t size = AAsset_getLength (asset);
+	if (size <= 0) {
+		LogE ("%s length is invalid (file length must > 0)\n", name);
+		AAsset_close (asset);
+		return -1;
+	}
+	*mem = (char *)calloc (1, size + 1);
+	if (NULL == *mem) {
+		LogE ("Failed calloc memory for %s\n", name);
+		AAsset_close (asset);
+		return -1;
+	}
+
+	if (AAsset_read (asset, *mem, size) != size) {
+		LogE ("Failed read %s\n", name);
+		AAsset_close (asset);
+		free (*mem);
+		*mem = NULL;
+		return -1;
+	}
+
+	AAsset_close (asset);
+	return size + 1;
+}
+
+int getNativeWindowSize (EGLNativeWindowType window, int *width, int *height)
+{
+	if (NULL == window || NULL == width || NULL == height) {
+		return -1;
+	}
+	*width = ANativeWindow_getWidth (window);
+	*height = ANativeWindow_getHeight (window);
+	return 0;
+}
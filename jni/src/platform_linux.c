@@ -0,0 +1,53 @@
+/***************************************
+ * file name:   platform_linux.c
+ * description: platform layer of Linux
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <malloc.h>
+#include <stdio.h>
+#include "comm.h"
+#include "imgsdk.h"
+#include "platform.h"
+
+/**
+ * Logs go to stderr, so a console tool keeps stdout for its output
+ */
+void platformWriteLog (int level, const char *tag, const char *text)
+{
+	if (level >= ERROR) {
+		fprintf (stderr, "%s E %s", tag, text);
+	} else if (level >= WARN) {
+		fprintf (stderr, "%s W %s", tag, text);
+	} else {
+		fputs (text, stderr);
+	}
+}
+
+int readPlatformAsset (const void *data, const char *name, char **mem)
+{
+	if (NULL == name || NULL == mem) {
+		LogE ("NULL pointer in readPlatformAsset\n");
+		return -1;
+	}
+	if (NULL == data) {
+		return readFile (name, mem);
+	}
+
+	char path[1024];
+	if (snprintf (path, sizeof(path), "%s/%s", (const char *)data, name) >= (int)sizeof(path)) {
+		LogE ("Too long asset path %s\n", name);
+		return -1;
+	}
+	return readFile (path, mem);
+}
+
+/**
+ * Not known from X11 or Wayland handles, the EGL surface tells
+ */
+int getNativeWindowSize (EGLNativeWindowType window, int *width, int *height)
+{
+	return -1;
+}
@@ -0,0 +1,381 @@
+/***************************************
+ * file name:   pointop.c
+ * description: implement point ops composed into lookup tables
+ *
+ *	A chain of per channel ops is one table per channel: appending
+ *	table t gives pre[c][v] = t[c][pre[c][v]], so any length of chain
+ *	costs 3 loads per pixel. A color matrix such as gray mixes the
+ *	channels; it's applied as 9 tables of color[i][j] * pre[j][v],
+ *	so a pixel is still loads & adds only.
+ *	There is no byte gather in SSE2 or NEON for 256 entries, so the
+ *	lookups are scalar, unrolled by pixel.
+ *
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <malloc.h>
+#include <math.h>
+#include <string.h>
+#include "comm.h"
+#include "parallel.h"
+#include "pointop.h"
+
+// rows of a chunk of applying
+#define POINT_CHUNK_ROWS 64
+
+typedef struct {
+	const Bitmap_t	*src;
+	Bitmap_t		*dst;
+	PointMap_t		map;
+} PointJob;
+
+static inline uint8_t clampByte (float v) {
+	return v <= 0.0f ? 0 : (v >= 255.0f ? 255 : (uint8_t)(v + 0.5f));
+}
+
+static inline uint8_t clampInt (int v) {
+	return v < 0 ? 0 : (v > 255 ? 255 : (uint8_t)v);
+}
+
+static void identityTable (uint8_t *t) {
+	int v;
+	for (v = 0; v < 256; ++v) {
+		t[v] = (uint8_t)v;
+	}
+}
+
+/**
+ * Reset op to identity
+ */
+void identityPointOp (PointOp_t *op)
+{
+	int c;
+	for (c = 0; c < 3; ++c) {
+		identityTable (op->pre[c]);
+		identityTable (op->post[c]);
+	}
+	identityTable (op->gray);
+	memset (op->color, 0, sizeof(op->color));
+	op->color[0] = op->color[5] = op->color[10] = 1.0f;
+	op->hasColor = false;
+	op->hasPost = false;
+}
+
+/**
+ * Monotone cubic through points (Fritsch-Carlson), flat outside
+ */
+static void curveTable (const int *points, int n, uint8_t *t) {
+	float d[CURVE_MAX_POINTS] = { 0 };	// secant slopes
+	float m[CURVE_MAX_POINTS];		// tangents
+	int i;
+	for (i = 0; i + 1 < n; ++i) {
+		d[i] = (float)(points[2 * i + 3] - points[2 * i + 1]) /
+			(points[2 * i + 2] - points[2 * i]);
+	}
+	m[0] = d[0];
+	m[n - 1] = d[n - 2];
+	for (i = 1; i + 1 < n; ++i) {
+		m[i] = d[i - 1] * d[i] <= 0.0f ? 0.0f : (d[i - 1] + d[i]) * 0.5f;
+	}
+	for (i = 0; i + 1 < n; ++i) {
+		if (0.0f == d[i]) {
+			m[i] = m[i + 1] = 0.0f;
+			continue;
+		}
+		float a = m[i] / d[i];
+		float b = m[i + 1] / d[i];
+		float s = a * a + b * b;
+		if (s > 9.0f) {
+			s = 3.0f / sqrtf (s);
+			m[i] = s * a * d[i];
+			m[i + 1] = s * b * d[i];
+		}
+	}
+
+	int v;
+	int k = 0;
+	for (v = 0; v < 256; ++v) {
+		if (v <= points[0]) {
+			t[v] = (uint8_t)points[1];
+			continue;
+		}
+		if (v >= points[2 * n - 2]) {
+			t[v] = (uint8_t)points[2 * n - 1];
+			continue;
+		}
+		while (v > points[2 * k + 2]) {
+			++k;
+		}
+		float h = (float)(points[2 * k + 2] - points[2 * k]);
+		float x = (v - points[2 * k]) / h;
+		float x2 = x * x;
+		float x3 = x2 * x;
+		float y = (2 * x3 - 3 * x2 + 1) * points[2 * k + 1] + (x3 - 2 * x2 + x) * h * m[k] +
+			(-2 * x3 + 3 * x2) * points[2 * k + 3] + (x3 - x2) * h * m[k + 1];
+		t[v] = clampByte (y);
+	}
+}
+
+/**
+ * Per channel table of cmd
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int pointTableOf (ecEnum cmd, const int *params, int count, uint8_t table[3][256])
+{
+	if (NULL == params || NULL == table) {
+		return -1;
+	}
+
+	int v, c;
+	uint8_t *t = table[0];
+	switch (cmd) {
+		case ec_BRIGHTNESS:
+			for (v = 0; v < 256; ++v) {
+				t[v] = clampInt (v + (params[0] * 255 + (params[0] < 0 ? -50 : 50)) / 100);
+			}
+			break;
+		case ec_CONTRAST: {
+			float f = params[0] <= 0 ? (100 + params[0]) / 100.0f : 100.0f / (101 - params[0]);
+			for (v = 0; v < 256; ++v) {
+				t[v] = clampByte ((v - 127.5f) * f + 127.5f);
+			}
+			break;
+		}
+		case ec_GAMMA: {
+			float e = (float)GAMMA_PARAM_SCALE / params[0];
+			for (v = 0; v < 256; ++v) {
+				t[v] = clampByte (255.0f * powf (v / 255.0f, e));
+			}
+			break;
+		}
+		case ec_CURVES: {
+			int n = (count - 1) / 2;
+			if (n < CURVE_MIN_POINTS || n > CURVE_MAX_POINTS) {
+				return -1;
+			}
+			uint8_t curve[256];
+			curveTable (params + 1, n, curve);
+			for (c = 0; c < 3; ++c) {
+				if (params[0] & (1 << c)) {
+					memcpy (table[c], curve, 256);
+				} else {
+					identityTable (table[c]);
+				}
+			}
+			return 0;
+		}
+		default:
+			return -1;
+	}
+	memcpy (table[1], t, 256);
+	memcpy (table[2], t, 256);
+	return 0;
+}
+
+/**
+ * Append per channel table to op
+ */
+void appendPointTable (PointOp_t *op, const uint8_t table[3][256])
+{
+	uint8_t (*dst)[256] = op->hasColor ? op->post : op->pre;
+	int c, v;
+	for (c = 0; c < 3; ++c) {
+		for (v = 0; v < 256; ++v) {
+			dst[c][v] = table[c][dst[c][v]];
+		}
+	}
+	op->hasPost = op->hasColor;
+
+	// a gray value maps as (v, v, v) & takes the mean of r, g, b
+	for (v = 0; v < 256; ++v) {
+		uint8_t g = op->gray[v];
+		op->gray[v] = (uint8_t)((table[0][g] + table[1][g] + table[2][g] + 1) / 3);
+	}
+}
+
+/**
+ * Append 3x4 color matrix to op
+ * Return:
+ *		 0 OK
+ *		-1 op has a matrix already
+ */
+int appendPointColor (PointOp_t *op, const float *a)
+{
+	// two matrices multiplied would skip rounding between them
+	if (op->hasColor) {
+		return -1;
+	}
+	memcpy (op->color, a, sizeof(op->color));
+	op->hasColor = true;
+
+	int v, i;
+	for (v = 0; v < 256; ++v) {
+		float g = op->gray[v];
+		int sum = 0;
+		for (i = 0; i < 3; ++i) {
+			const float *m = a + i * 4;
+			sum += clampByte (m[0] * g + m[1] * g + m[2] * g + m[3]);
+		}
+		op->gray[v] = (uint8_t)((sum + 1) / 3);
+	}
+	return 0;
+}
+
+/**
+ * Build mapping tables of op
+ */
+void bindPointOp (const PointOp_t *op, PointMap_t *map)
+{
+	map->op = op;
+	if (!op->hasColor) {
+		return;
+	}
+	int i, j, v;
+	for (i = 0; i < 3; ++i) {
+		for (j = 0; j < 3; ++j) {
+			float m = op->color[i * 4 + j] * (1 << POINT_BITS);
+			for (v = 0; v < 256; ++v) {
+				map->mix[i][j][v] = (int32_t)lrintf (m * op->pre[j][v]);
+			}
+		}
+		map->bias[i] = (int32_t)lrintf (op->color[i * 4 + 3] * (1 << POINT_BITS)) +
+			(1 << (POINT_BITS - 1));
+	}
+	map->sameRows = memcmp (op->color, op->color + 4, 4 * sizeof(float)) == 0 &&
+		memcmp (op->color, op->color + 8, 4 * sizeof(float)) == 0;
+}
+
+static inline uint8_t mixChannel (const PointMap_t *map, int i, const uint8_t *p) {
+	int32_t s = (map->mix[i][0][p[0]] + map->mix[i][1][p[1]] + map->mix[i][2][p[2]] +
+			map->bias[i]) >> POINT_BITS;
+	return map->op->post[i][clampInt (s)];
+}
+
+/**
+ * Map count pixels of form, src & dst may be the same
+ */
+void mapPointRow (const PointMap_t *map, const uint8_t *src, uint8_t *dst, int count, int form)
+{
+	const PointOp_t *op = map->op;
+	int x = 0;
+	if (GRAY == form) {
+		const uint8_t *g = op->gray;
+		for (; x + 4 <= count; x += 4) {
+			uint8_t a = g[src[x]];
+			uint8_t b = g[src[x + 1]];
+			uint8_t c = g[src[x + 2]];
+			uint8_t d = g[src[x + 3]];
+			dst[x] = a;
+			dst[x + 1] = b;
+			dst[x + 2] = c;
+			dst[x + 3] = d;
+		}
+		for (; x < count; ++x) {
+			dst[x] = g[src[x]];
+		}
+		return;
+	}
+
+	if (op->hasColor && map->sameRows) {
+		const int32_t *mr = map->mix[0][0];
+		const int32_t *mg = map->mix[0][1];
+		const int32_t *mb = map->mix[0][2];
+		int32_t bias = map->bias[0];
+		for (; x < count; ++x, src += form, dst += form) {
+			uint8_t y = clampInt ((mr[src[0]] + mg[src[1]] + mb[src[2]] + bias) >> POINT_BITS);
+			dst[0] = op->post[0][y];
+			dst[1] = op->post[1][y];
+			dst[2] = op->post[2][y];
+			if (RGBA32 == form) {
+				dst[3] = src[3];
+			}
+		}
+		return;
+	}
+
+	if (op->hasColor) {
+		for (; x < count; ++x, src += form, dst += form) {
+			uint8_t r = mixChannel (map, 0, src);
+			uint8_t g = mixChannel (map, 1, src);
+			uint8_t b = mixChannel (map, 2, src);
+			dst[0] = r;
+			dst[1] = g;
+			dst[2] = b;
+			if (RGBA32 == form) {
+				dst[3] = src[3];
+			}
+		}
+		return;
+	}
+
+	// per channel tables only, post is identity
+	const uint8_t *tr = op->pre[0];
+	const uint8_t *tg = op->pre[1];
+	const uint8_t *tb = op->pre[2];
+	if (RGBA32 == form) {
+		for (; x + 2 <= count; x += 2, src += 8, dst += 8) {
+			uint8_t r0 = tr[src[0]], g0 = tg[src[1]], b0 = tb[src[2]], a0 = src[3];
+			uint8_t r1 = tr[src[4]], g1 = tg[src[5]], b1 = tb[src[6]], a1 = src[7];
+			dst[0] = r0; dst[1] = g0; dst[2] = b0; dst[3] = a0;
+			dst[4] = r1; dst[5] = g1; dst[6] = b1; dst[7] = a1;
+		}
+	}
+	for (; x < count; ++x, src += form, dst += form) {
+		uint8_t r = tr[src[0]];
+		uint8_t g = tg[src[1]];
+		uint8_t b = tb[src[2]];
+		dst[0] = r;
+		dst[1] = g;
+		dst[2] = b;
+		if (RGBA32 == form) {
+			dst[3] = src[3];
+		}
+	}
+}
+
+static void pointRows (void *arg, int begin, int end) {
+	PointJob *job = (PointJob *)arg;
+	int width = job->src->width;
+	int form = job->src->form;
+	size_t stride = (size_t)width * form;
+	int y;
+	for (y = begin; y < end; ++y) {
+		mapPointRow (&job->map, (const uint8_t *)job->src->base + y * stride,
+				(uint8_t *)job->dst->base + y * stride, width, form);
+	}
+}
+
+/**
+ * Map image through op on all cores
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int applyPointOp (const Bitmap_t *src, const PointOp_t *op, Bitmap_t *dst)
+{
+	if (NULL == src || NULL == src->base || NULL == op || NULL == dst || NULL == dst->base) {
+		return -1;
+	}
+	if (src->form != GRAY && src->form != RGB24 && src->form != RGBA32) {
+		LogE ("Unsupported pixel format %d in point op\n", src->form);
+		return -1;
+	}
+
+	PointJob *job = (PointJob *)malloc (sizeof(PointJob));
+	if (NULL == job) {
+		LogE ("Failed malloc point job\n");
+		return -1;
+	}
+	job->src = src;
+	job->dst = dst;
+	bindPointOp (op, &job->map);
+	uint64_t trace_ns = TRACE_BEGIN ();
+	int retCode = parallelFor (src->height, POINT_CHUNK_ROWS, pointRows, job);
+	TRACE_END ("applyPointOp", trace_ns);
+	free (job);
+	return retCode;
+}
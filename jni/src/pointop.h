@@ -0,0 +1,96 @@
+/************************************
+ * file name:   pointop.h
+ * description: per-pixel color ops composed into lookup tables
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __POINTOP__H__
+#define __POINTOP__H__
+
+#include <stdint.h>
+#include "eftcmd.h"
+#include "imgsdk.h"
+
+// fixed point of color matrix tables
+#define POINT_BITS 16
+
+/**
+ * Chain of point ops as
+ *		out[c] = post[c][clamp (color * pre[in])]
+ * Per channel ops before the matrix compose into pre, the ones after
+ * into post. Every op rounds to 8 bits like running the ops one by one,
+ * so an op holds one matrix at most.
+ */
+typedef struct {
+	uint8_t		pre[3][256];	// per channel tables before color
+	float		color[12];		// 3x4 row-major color matrix
+	uint8_t		post[3][256];	// per channel tables after color
+	uint8_t		gray[256];		// whole chain on GRAY images, op by op
+	bool		hasColor;		// color isn't identity
+	bool		hasPost;		// post isn't identity
+} PointOp_t;
+
+/**
+ * PointOp_t bound for mapping pixels, built by bindPointOp
+ */
+typedef struct {
+	const PointOp_t	*op;
+	int32_t			mix[3][3][256];	// color[i][j] * pre[j][v] in POINT_BITS
+	int32_t			bias[3];		// color[i][3] & rounding in POINT_BITS
+	bool			sameRows;		// rows of color are equal, e.g. gray
+} PointMap_t;
+
+/**
+ * Reset op to identity
+ */
+void identityPointOp (PointOp_t *op);
+
+/**
+ * Per channel table of cmd
+ * Parameters:
+ *		cmd:	ec_BRIGHTNESS, ec_CONTRAST, ec_GAMMA or ec_CURVES
+ *		params:	params of cmd, see ecEnum
+ *		table:	[OUT] table of r, g, b
+ * Return:
+ *		 0 OK
+ *		-1 ERROR, not a per channel op
+ */
+int pointTableOf (ecEnum cmd, const int *params, int count, uint8_t table[3][256]);
+
+/**
+ * Append per channel table to op
+ */
+void appendPointTable (PointOp_t *op, const uint8_t table[3][256]);
+
+/**
+ * Append 3x4 color matrix to op
+ * Return:
+ *		 0 OK
+ *		-1 op has a matrix already, the matrix must start a new op
+ */
+int appendPointColor (PointOp_t *op, const float *color);
+
+/**
+ * Build mapping tables of op
+ */
+void bindPointOp (const PointOp_t *op, PointMap_t *map);
+
+/**
+ * Map count pixels of form, src & dst may be the same
+ */
+void mapPointRow (const PointMap_t *map, const uint8_t *src, uint8_t *dst, int count, int form);
+
+/**
+ * Map image through op on all cores
+ * Parameters:
+ *		src:	GRAY, RGB24 or RGBA32 image, alpha is kept
+ *		dst:	[OUT] the size of src, may be src
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int applyPointOp (const Bitmap_t *src, const PointOp_t *op, Bitmap_t *dst);
+
+#endif
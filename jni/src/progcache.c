@@ -0,0 +1,391 @@
+/************************************
+ * file name:   progcache.c
+ * description: implement program cache & binary persistence
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#include <malloc.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <EGL/egl.h>
+#include "progcache.h"
+#include "trace.h"
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME  1099511628211ULL
+
+#define LOG_BUFF_SIZE 1024
+
+// "IMGP", first word of a binary file
+#define PROG_BINARY_MAGIC 0x504d4749
+
+/*
+ * Entries of program binaries, core in GLES 3 & OES in GLES 2
+ */
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH            0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS       0x87FE
+#endif
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT  0x8257
+#endif
+
+typedef void (GL_APIENTRY *GetProgramBinaryFunc) (GLuint program, GLsizei bufSize,
+		GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (GL_APIENTRY *ProgramBinaryFunc) (GLuint program, GLenum binaryFormat,
+		const void *binary, GLsizei length);
+typedef void (GL_APIENTRY *ProgramParameteriFunc) (GLuint program, GLenum pname, GLint value);
+
+typedef struct {
+	uint64_t	key;		// hash of sources
+	GLuint		program;
+} ProgEntry;
+
+struct ProgCache {
+	ProgEntry	*entries;
+	int			count;
+	int			capability;
+	char		*dir;		// directory of binaries, NULL none
+	uint64_t	driver;		// hash of GL vendor, renderer & version
+	GetProgramBinaryFunc	getProgramBinary;
+	ProgramBinaryFunc		programBinary;
+	ProgramParameteriFunc	programParameteri;		// GLES 3 only
+};
+
+/**
+ * Header of a binary file, followed by length bytes of binary
+ */
+typedef struct {
+	uint32_t	magic;		// PROG_BINARY_MAGIC
+	uint32_t	format;		// binary format of GL
+	uint64_t	key;		// hash of sources
+	uint64_t	driver;		// binaries only load on the same driver
+	uint32_t	length;		// bytes of binary
+	uint32_t	reserved;
+} ProgHeader;
+
+static uint64_t hashBytes (uint64_t hash, const char *data, size_t len) {
+	size_t i;
+	for (i = 0; i < len; ++i) {
+		hash ^= (unsigned char)data[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+static uint64_t hashString (uint64_t hash, const char *str) {
+	// the terminator separates strings
+	return hashBytes (hash, NULL != str ? str : "", NULL != str ? strlen (str) + 1 : 1);
+}
+
+/**
+ * Find binary entries of the current context
+ */
+static void findBinaryEntries (ProgCache *cache) {
+	const char *version = (const char *)glGetString (GL_VERSION);
+	const char *extensions = (const char *)glGetString (GL_EXTENSIONS);
+	int major = 0;
+	if (NULL != version && sscanf (version, "OpenGL ES %d", &major) == 1 && major >= 3) {
+		cache->getProgramBinary = (GetProgramBinaryFunc)eglGetProcAddress ("glGetProgramBinary");
+		cache->programBinary = (ProgramBinaryFunc)eglGetProcAddress ("glProgramBinary");
+		cache->programParameteri = (ProgramParameteriFunc)eglGetProcAddress ("glProgramParameteri");
+	}
+	else if (NULL != extensions && NULL != strstr (extensions, "GL_OES_get_program_binary")) {
+		cache->getProgramBinary = (GetProgramBinaryFunc)eglGetProcAddress ("glGetProgramBinaryOES");
+		cache->programBinary = (ProgramBinaryFunc)eglGetProcAddress ("glProgramBinaryOES");
+	}
+
+	GLint formats = 0;
+	if (NULL != cache->getProgramBinary && NULL != cache->programBinary) {
+		glGetIntegerv (GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	}
+	if (formats <= 0) {
+		cache->getProgramBinary = NULL;
+		cache->programBinary = NULL;
+		cache->programParameteri = NULL;
+		Log ("No program binary format, programs are compiled\n");
+	}
+}
+
+/*
+ * Create a program cache of the current GL context
+ * Return:
+ *		NULL if ERROR
+ */
+ProgCache* newProgCache (const char *dir)
+{
+	ProgCache *cache = (ProgCache *)calloc (1, sizeof(ProgCache));
+	if (NULL == cache) {
+		return NULL;
+	}
+
+	if (NULL != dir) {
+		cache->dir = strdup (dir);
+		if (NULL == cache->dir) {
+			free (cache);
+			return NULL;
+		}
+		uint64_t driver = FNV_OFFSET;
+		driver = hashString (driver, (const char *)glGetString (GL_VENDOR));
+		driver = hashString (driver, (const char *)glGetString (GL_RENDERER));
+		driver = hashString (driver, (const char *)glGetString (GL_VERSION));
+		cache->driver = driver;
+		findBinaryEntries (cache);
+	}
+	return cache;
+}
+
+/*
+ * Delete the programs
+ */
+void freeProgCache (ProgCache *cache)
+{
+	if (NULL == cache) {
+		return;
+	}
+	int i;
+	for (i = 0; i < cache->count; ++i) {
+		glDeleteProgram (cache->entries[i].program);
+	}
+	free (cache->entries);
+	free (cache->dir);
+	free (cache);
+}
+
+/**
+ * Compile a shader
+ * Return:
+ *		0 if ERROR
+ */
+static GLuint loadShader (GLenum type, const char *source) {
+	GLuint shader = glCreateShader (type);
+	if (!shader) {
+		LogE ("Invalid shader\n");
+		return 0;
+	}
+	GLint length = strlen (source);
+	glShaderSource (shader, 1, &source, &length);
+	glCompileShader (shader);
+	GLint compiled = GL_FALSE;
+	glGetShaderiv (shader, GL_COMPILE_STATUS, &compiled);
+	if (!compiled) {
+		char logBuff[LOG_BUFF_SIZE];
+		GLsizei len = 0;
+		glGetShaderInfoLog (shader, LOG_BUFF_SIZE, &len, logBuff);
+		if (len > 0) {
+			Log ("compile error:%s\n", logBuff);
+		} else {
+			LogE ("Failed get compile log\n");
+		}
+		glDeleteShader (shader);
+		return 0;
+	}
+	return shader;
+}
+
+/**
+ * Compile & link sources
+ * Return:
+ *		0 if ERROR
+ */
+static GLuint buildProgram (ProgCache *cache, const char *vertSource, const char *fragSource) {
+	uint64_t trace_ns = TRACE_BEGIN ();
+	GLuint vertShader = loadShader (GL_VERTEX_SHADER, vertSource);
+	GLuint fragShader = loadShader (GL_FRAGMENT_SHADER, fragSource);
+	GLuint program = 0;
+	if (vertShader && fragShader) {
+		program = glCreateProgram ();
+	}
+	if (program) {
+		glAttachShader (program, vertShader);
+		glAttachShader (program, fragShader);
+		if (NULL != cache->programParameteri) {
+			cache->programParameteri (program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+		glLinkProgram (program);
+		GLint linkStatus = GL_FALSE;
+		glGetProgramiv (program, GL_LINK_STATUS, &linkStatus);
+		if (!linkStatus) {
+			char logBuff[LOG_BUFF_SIZE];
+			GLsizei len = 0;
+			glGetProgramInfoLog (program, LOG_BUFF_SIZE, &len, logBuff);
+			if (len > 0) {
+				Log ("link error log:%s\n", logBuff);
+			} else {
+				LogE ("Failed get link log\n");
+			}
+			glDeleteProgram (program);
+			program = 0;
+		}
+	}
+
+	// program keeps the shaders alive
+	if (vertShader) {
+		if (program) {
+			glDetachShader (program, vertShader);
+		}
+		glDeleteShader (vertShader);
+	}
+	if (fragShader) {
+		if (program) {
+			glDetachShader (program, fragShader);
+		}
+		glDeleteShader (fragShader);
+	}
+	TRACE_END ("buildProgram", trace_ns);
+	return program;
+}
+
+static void binaryPath (const ProgCache *cache, uint64_t key, char *path, int size) {
+	snprintf (path, size, "%s/%016llx.prog", cache->dir, (unsigned long long)key);
+}
+
+/**
+ * Load the binary of key saved by an earlier run
+ * Return:
+ *		0 if there's none or the driver rejects it
+ */
+static GLuint loadBinary (ProgCache *cache, uint64_t key) {
+	char path[PATH_MAX];
+	binaryPath (cache, key, path, sizeof(path));
+	FILE *fp = fopen (path, "rb");
+	if (NULL == fp) {
+		return 0;
+	}
+
+	uint64_t trace_ns = TRACE_BEGIN ();
+	GLuint program = 0;
+	char *binary = NULL;
+	ProgHeader header;
+	if (fread (&header, sizeof(header), 1, fp) == 1 && PROG_BINARY_MAGIC == header.magic &&
+			key == header.key && cache->driver == header.driver && header.length > 0) {
+		binary = (char *)malloc (header.length);
+	}
+	if (NULL != binary && fread (binary, 1, header.length, fp) == header.length) {
+		program = glCreateProgram ();
+	}
+	fclose (fp);
+
+	if (program) {
+		cache->programBinary (program, header.format, binary, header.length);
+		GLint linkStatus = GL_FALSE;
+		glGetProgramiv (program, GL_LINK_STATUS, &linkStatus);
+		if (!linkStatus) {
+			LogW ("Program binary %s is rejected\n", path);
+			glDeleteProgram (program);
+			program = 0;
+		}
+	}
+	free (binary);
+	TRACE_END ("loadProgramBinary", trace_ns);
+	return program;
+}
+
+/**
+ * Save the binary of program for later runs. Written to a temporary
+ * file & renamed, so other processes never load half a binary.
+ */
+static void saveBinary (ProgCache *cache, uint64_t key, GLuint program) {
+	GLint length = 0;
+	glGetProgramiv (program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+	char *binary = (char *)malloc (length);
+	if (NULL == binary) {
+		return;
+	}
+
+	ProgHeader header;
+	memset (&header, 0, sizeof(header));
+	GLenum format = 0;
+	GLsizei written = 0;
+	cache->getProgramBinary (program, length, &written, &format, binary);
+	if (written <= 0) {
+		LogW ("Failed glGetProgramBinary, error code:0x%04x\n", glGetError ());
+		free (binary);
+		return;
+	}
+	header.magic = PROG_BINARY_MAGIC;
+	header.format = format;
+	header.key = key;
+	header.driver = cache->driver;
+	header.length = written;
+
+	char path[PATH_MAX];
+	char temp[PATH_MAX + 16];
+	binaryPath (cache, key, path, sizeof(path));
+	snprintf (temp, sizeof(temp), "%s.%d", path, (int)getpid ());
+	FILE *fp = fopen (temp, "wb");
+	if (NULL == fp) {
+		LogW ("Failed open %s\n", temp);
+		free (binary);
+		return;
+	}
+	int failed = fwrite (&header, sizeof(header), 1, fp) != 1 ||
+		fwrite (binary, 1, written, fp) != (size_t)written;
+	failed = fclose (fp) != 0 || failed;
+	if (failed || rename (temp, path) != 0) {
+		LogW ("Failed save program binary %s\n", path);
+		unlink (temp);
+	}
+	free (binary);
+}
+
+/*
+ * Get the program of vertex & fragment sources
+ * Return:
+ *		0 if ERROR
+ */
+GLuint getProgram (ProgCache *cache, const char *vertSource, const char *fragSource)
+{
+	if (NULL == cache || NULL == vertSource || NULL == fragSource) {
+		return 0;
+	}
+
+	uint64_t key = hashString (hashString (FNV_OFFSET, vertSource), fragSource);
+	key = 0 == key ? 1 : key;
+	int i;
+	for (i = 0; i < cache->count; ++i) {
+		if (cache->entries[i].key == key) {
+			return cache->entries[i].program;
+		}
+	}
+
+	if (cache->count == cache->capability) {
+		int cap = cache->capability > 0 ? 2 * cache->capability : 4;
+		ProgEntry *entries = (ProgEntry *)realloc (cache->entries, cap * sizeof(ProgEntry));
+		if (NULL == entries) {
+			LogE ("Failed realloc program entries\n");
+			return 0;
+		}
+		cache->entries = entries;
+		cache->capability = cap;
+	}
+
+	bool binary = NULL != cache->dir && NULL != cache->programBinary;
+	GLuint program = binary ? loadBinary (cache, key) : 0;
+	if (program) {
+		LogD ("Loaded program binary %016llx\n", (unsigned long long)key);
+	}
+	else {
+		program = buildProgram (cache, vertSource, fragSource);
+		if (!program) {
+			return 0;
+		}
+		if (binary) {
+			saveBinary (cache, key, program);
+		}
+	}
+
+	cache->entries[cache->count].key = key;
+	cache->entries[cache->count].program = program;
+	++cache->count;
+	return program;
+}
@@ -0,0 +1,48 @@
+/************************************
+ * file name:   progcache.h
+ * description: cache of linked shader programs
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ * Programs are keyed by a hash of their sources & kept until the
+ * cache is freed, so every effect program of an env stays linked.
+ * With a cache directory, linked programs are also saved as GL
+ * program binaries (GLES 3 or GL_OES_get_program_binary) & loaded
+ * instead of compiling on later runs. A binary the driver rejects,
+ * e.g. after a driver update, is compiled from source & saved again.
+ *
+ ***********************************/
+
+#ifndef __PROGCACHE__H__
+#define __PROGCACHE__H__
+
+#include <stdint.h>
+#include <GLES2/gl2.h>
+#include "comm.h"
+
+struct ProgCache;
+typedef struct ProgCache ProgCache;
+
+/*
+ * Create a program cache of the current GL context
+ * Parameters:
+ *		dir:	directory of program binaries, NULL keeps them in memory
+ * Return:
+ *		NULL if ERROR
+ */
+ProgCache* newProgCache (const char *dir);
+
+/*
+ * Delete the programs, the context of the cache is current
+ */
+void freeProgCache (ProgCache *cache);
+
+/*
+ * Get the program of vertex & fragment sources, load or build it if
+ * not cached.
+ * Return:
+ *		0 if ERROR. The program is valid until freeProgCache
+ */
+GLuint getProgram (ProgCache *cache, const char *vertSource, const char *fragSource);
+
+#endif
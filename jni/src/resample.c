@@ -0,0 +1,420 @@
+/***************************************
+ * file name:   resample.c
+ * description: implement separable resampler
+ *
+ *	source rows --horizontal--> ring of rows --vertical--> output row
+ *
+ *	Weights are precomputed per output column / row in Q14 fixed
+ *	point. The inner loops use SSE2 or NEON when available.
+ *
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <malloc.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "comm.h"
+#include "resample.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RESAMPLE_SSE2
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RESAMPLE_NEON
+#endif
+
+#define PI 3.14159265358979
+
+// fixed point of weights
+#define WEIGHT_BITS 14
+#define WEIGHT_ONE  (1 << WEIGHT_BITS)
+#define WEIGHT_HALF (1 << (WEIGHT_BITS - 1))
+
+/**
+ * Weights of one direction
+ */
+typedef struct {
+	int		*start;		// first source index of each output
+	int		*count;		// taps of each output
+	int16_t	*weights;	// taps weights of output i at i * taps
+	int		taps;		// max taps
+} Kernel;
+
+static double boxFilter (double x) {
+	return (x >= -0.5 && x < 0.5) ? 1.0 : 0.0;
+}
+
+static double triangleFilter (double x) {
+	x = fabs (x);
+	return x < 1.0 ? 1.0 - x : 0.0;
+}
+
+static double cubicFilter (double x) {
+	const double a = -0.5;
+	x = fabs (x);
+	if (x < 1.0) {
+		return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+	}
+	if (x < 2.0) {
+		return (((x - 5.0) * x + 8.0) * x - 4.0) * a;
+	}
+	return 0.0;
+}
+
+static double sinc (double x) {
+	if (0.0 == x) {
+		return 1.0;
+	}
+	x *= PI;
+	return sin (x) / x;
+}
+
+static double lanczos3Filter (double x) {
+	return (x > -3.0 && x < 3.0) ? sinc (x) * sinc (x / 3.0) : 0.0;
+}
+
+typedef double (*FilterFunc) (double);
+
+static const struct {
+	const char	*name;
+	FilterFunc	func;
+	double		radius;
+} sFilters[RESAMPLE_END] = {
+	{ "box",		boxFilter,		0.5 },
+	{ "bilinear",	triangleFilter,	1.0 },
+	{ "bicubic",	cubicFilter,	2.0 },
+	{ "lanczos",	lanczos3Filter,	3.0 },
+};
+
+/**
+ * Get filter by name
+ * Return:
+ *		RESAMPLE_END if unknown
+ */
+ResampleFilter getResampleFilter(const char *name)
+{
+	int i;
+	for (i = 0; NULL != name && i < RESAMPLE_END; ++i) {
+		if (strcmp (name, sFilters[i].name) == 0) {
+			return (ResampleFilter)i;
+		}
+	}
+	return RESAMPLE_END;
+}
+
+static void freeKernel (Kernel *k) {
+	if (NULL != k->start) {
+		free (k->start);
+	}
+	if (NULL != k->count) {
+		free (k->count);
+	}
+	if (NULL != k->weights) {
+		free (k->weights);
+	}
+	memset (k, 0, sizeof(Kernel));
+}
+
+/**
+ * Precompute weights mapping srcLen samples to dstLen samples
+ */
+static int buildKernel (int srcLen, int dstLen, ResampleFilter filter, Kernel *k) {
+	double scale = (double)srcLen / dstLen;
+	double fscale = scale > 1.0 ? scale : 1.0;
+	double support = sFilters[filter].radius * fscale;
+	FilterFunc func = sFilters[filter].func;
+
+	memset (k, 0, sizeof(Kernel));
+	k->taps = (int)ceil (support) * 2 + 1;
+	k->start = (int *)malloc (dstLen * sizeof(int));
+	k->count = (int *)malloc (dstLen * sizeof(int));
+	k->weights = (int16_t *)calloc (dstLen * k->taps, sizeof(int16_t));
+	double *w = (double *)malloc (k->taps * sizeof(double));
+	if (NULL == k->start || NULL == k->count || NULL == k->weights || NULL == w) {
+		LogE ("Failed malloc resample kernel\n");
+		freeKernel (k);
+		if (NULL != w) {
+			free (w);
+		}
+		return -1;
+	}
+
+	int i, j;
+	for (i = 0; i < dstLen; ++i) {
+		double center = (i + 0.5) * scale;
+		int lo = (int)floor (center - support + 0.5);
+		int hi = (int)floor (center + support + 0.5);
+		lo = lo > 0 ? lo : 0;
+		hi = hi < srcLen ? hi : srcLen;
+		if (hi - lo > k->taps) {
+			hi = lo + k->taps;
+		}
+		if (hi <= lo) {
+			// box filter between samples, take the nearest
+			lo = (int)center < srcLen ? (int)center : srcLen - 1;
+			hi = lo + 1;
+		}
+
+		double sum = 0.0;
+		for (j = lo; j < hi; ++j) {
+			w[j - lo] = func ((j + 0.5 - center) / fscale);
+			sum += w[j - lo];
+		}
+		if (0.0 == sum) {
+			for (j = lo; j < hi; ++j) {
+				w[j - lo] = 1.0;
+			}
+			sum = hi - lo;
+		}
+
+		// Q14, rounding error goes to the largest tap
+		int16_t *q = k->weights + i * k->taps;
+		int total = 0, peak = 0;
+		for (j = 0; j < hi - lo; ++j) {
+			q[j] = (int16_t)floor (w[j] / sum * WEIGHT_ONE + 0.5);
+			total += q[j];
+			if (q[j] > q[peak]) {
+				peak = j;
+			}
+		}
+		q[peak] += WEIGHT_ONE - total;
+
+		k->start[i] = lo;
+		k->count[i] = hi - lo;
+	}
+
+	free (w);
+	return 0;
+}
+
+static uint8_t clampPixel (int v) {
+	v = (v + WEIGHT_HALF) >> WEIGHT_BITS;
+	return v < 0 ? 0 : (v > 255 ? 255 : (uint8_t)v);
+}
+
+/**
+ * Load pixel of 3 or 4 channels into 32 bits, 4th channel of RGB is 0
+ */
+static inline uint32_t loadPixel (const uint8_t *p, int form) {
+	if (RGBA32 == form) {
+		uint32_t v;
+		memcpy (&v, p, 4);
+		return v;
+	}
+	return p[0] | (p[1] << 8) | (p[2] << 16);
+}
+
+static inline void storePixel (uint8_t *dst, uint32_t v, int form) {
+	if (RGBA32 == form) {
+		memcpy (dst, &v, 4);
+		return;
+	}
+	dst[0] = (uint8_t)v;
+	dst[1] = (uint8_t)(v >> 8);
+	dst[2] = (uint8_t)(v >> 16);
+}
+
+/**
+ * Filter one row horizontally
+ */
+static void horizontalPass (const uint8_t *src, int form, const Kernel *k,
+		int width, uint8_t *dst) {
+	int x, t, c;
+#if defined(RESAMPLE_SSE2)
+	if (RGBA32 == form || RGB24 == form) {
+		const __m128i round = _mm_set1_epi32 (WEIGHT_HALF);
+		const __m128i zero = _mm_setzero_si128 ();
+		for (x = 0; x < width; ++x) {
+			const uint8_t *p = src + k->start[x] * form;
+			const int16_t *w = k->weights + x * k->taps;
+			int n = k->count[x];
+			__m128i acc = round;
+			for (t = 0; t + 1 < n; t += 2, p += form * 2) {
+				// r0 g0 b0 a0 r1 g1 b1 a1 -> r0 r1 g0 g1 b0 b1 a0 a1
+				__m128i px = RGBA32 == form ? _mm_loadl_epi64 ((const __m128i *)p) :
+					_mm_unpacklo_epi32 (_mm_cvtsi32_si128 (loadPixel (p, form)),
+							_mm_cvtsi32_si128 (loadPixel (p + form, form)));
+				px = _mm_unpacklo_epi8 (px, zero);
+				px = _mm_unpacklo_epi16 (px, _mm_srli_si128 (px, 8));
+				__m128i wt = _mm_set1_epi32 ((int)((uint16_t)w[t] | (uint32_t)(uint16_t)w[t + 1] << 16));
+				acc = _mm_add_epi32 (acc, _mm_madd_epi16 (px, wt));
+			}
+			if (t < n) {
+				__m128i px = _mm_unpacklo_epi8 (_mm_cvtsi32_si128 (loadPixel (p, form)), zero);
+				px = _mm_unpacklo_epi16 (px, zero);
+				acc = _mm_add_epi32 (acc, _mm_madd_epi16 (px, _mm_set1_epi32 ((uint16_t)w[t])));
+			}
+			acc = _mm_srai_epi32 (acc, WEIGHT_BITS);
+			acc = _mm_packus_epi16 (_mm_packs_epi32 (acc, acc), zero);
+			storePixel (dst + x * form, (uint32_t)_mm_cvtsi128_si32 (acc), form);
+		}
+		return;
+	}
+#elif defined(RESAMPLE_NEON)
+	if (RGBA32 == form || RGB24 == form) {
+		for (x = 0; x < width; ++x) {
+			const uint8_t *p = src + k->start[x] * form;
+			const int16_t *w = k->weights + x * k->taps;
+			int n = k->count[x];
+			int32x4_t acc = vdupq_n_s32 (WEIGHT_HALF);
+			for (t = 0; t + 1 < n; t += 2, p += form * 2) {
+				uint32x2_t v = vdup_n_u32 (loadPixel (p, form));
+				v = vset_lane_u32 (loadPixel (p + form, form), v, 1);
+				int16x8_t px = vreinterpretq_s16_u16 (vmovl_u8 (vreinterpret_u8_u32 (v)));
+				acc = vmlal_n_s16 (acc, vget_low_s16 (px), w[t]);
+				acc = vmlal_n_s16 (acc, vget_high_s16 (px), w[t + 1]);
+			}
+			if (t < n) {
+				uint32x2_t v = vdup_n_u32 (loadPixel (p, form));
+				int16x8_t px = vreinterpretq_s16_u16 (vmovl_u8 (vreinterpret_u8_u32 (v)));
+				acc = vmlal_n_s16 (acc, vget_low_s16 (px), w[t]);
+			}
+			int16x4_t s = vshrn_n_s32 (acc, WEIGHT_BITS);
+			uint8x8_t b = vqmovun_s16 (vcombine_s16 (s, s));
+			storePixel (dst + x * form, vget_lane_u32 (vreinterpret_u32_u8 (b), 0), form);
+		}
+		return;
+	}
+#endif
+	for (x = 0; x < width; ++x) {
+		const uint8_t *p = src + k->start[x] * form;
+		const int16_t *w = k->weights + x * k->taps;
+		int n = k->count[x];
+		for (c = 0; c < form; ++c) {
+			int acc = 0;
+			for (t = 0; t < n; ++t) {
+				acc += p[t * form + c] * w[t];
+			}
+			dst[x * form + c] = clampPixel (acc);
+		}
+	}
+}
+
+/**
+ * Blend n filtered rows into one output row
+ */
+static void verticalPass (const uint8_t **rows, const int16_t *w, int n,
+		int len, uint8_t *dst) {
+	int x = 0, t;
+#if defined(RESAMPLE_SSE2)
+	const __m128i round = _mm_set1_epi32 (WEIGHT_HALF);
+	const __m128i zero = _mm_setzero_si128 ();
+	for (; x + 8 <= len; x += 8) {
+		__m128i lo = round, hi = round;
+		for (t = 0; t + 1 < n; t += 2) {
+			__m128i a = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *)(rows[t] + x)), zero);
+			__m128i b = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *)(rows[t + 1] + x)), zero);
+			__m128i wt = _mm_set1_epi32 ((int)((uint16_t)w[t] | (uint32_t)(uint16_t)w[t + 1] << 16));
+			lo = _mm_add_epi32 (lo, _mm_madd_epi16 (_mm_unpacklo_epi16 (a, b), wt));
+			hi = _mm_add_epi32 (hi, _mm_madd_epi16 (_mm_unpackhi_epi16 (a, b), wt));
+		}
+		if (t < n) {
+			__m128i a = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *)(rows[t] + x)), zero);
+			__m128i wt = _mm_set1_epi32 ((uint16_t)w[t]);
+			lo = _mm_add_epi32 (lo, _mm_madd_epi16 (_mm_unpacklo_epi16 (a, zero), wt));
+			hi = _mm_add_epi32 (hi, _mm_madd_epi16 (_mm_unpackhi_epi16 (a, zero), wt));
+		}
+		lo = _mm_srai_epi32 (lo, WEIGHT_BITS);
+		hi = _mm_srai_epi32 (hi, WEIGHT_BITS);
+		__m128i px = _mm_packus_epi16 (_mm_packs_epi32 (lo, hi), zero);
+		_mm_storel_epi64 ((__m128i *)(dst + x), px);
+	}
+#elif defined(RESAMPLE_NEON)
+	for (; x + 8 <= len; x += 8) {
+		int32x4_t lo = vdupq_n_s32 (WEIGHT_HALF);
+		int32x4_t hi = lo;
+		for (t = 0; t < n; ++t) {
+			int16x8_t a = vreinterpretq_s16_u16 (vmovl_u8 (vld1_u8 (rows[t] + x)));
+			lo = vmlal_n_s16 (lo, vget_low_s16 (a), w[t]);
+			hi = vmlal_n_s16 (hi, vget_high_s16 (a), w[t]);
+		}
+		int16x8_t s = vcombine_s16 (vshrn_n_s32 (lo, WEIGHT_BITS), vshrn_n_s32 (hi, WEIGHT_BITS));
+		vst1_u8 (dst + x, vqmovun_s16 (s));
+	}
+#endif
+	for (; x < len; ++x) {
+		int acc = 0;
+		for (t = 0; t < n; ++t) {
+			acc += rows[t][x] * w[t];
+		}
+		dst[x] = clampPixel (acc);
+	}
+}
+
+/**
+ * Resize image
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int resampleImage(const Bitmap_t *src, int width, int height,
+		ResampleFilter filter, Bitmap_t *dst)
+{
+	if (NULL == src || NULL == src->base || NULL == dst || src == dst ||
+			width <= 0 || height <= 0 || filter < 0 || filter >= RESAMPLE_END) {
+		return -1;
+	}
+	int form = src->form;
+	if (form != GRAY && form != RGB24 && form != RGBA32) {
+		LogE ("Unsupported pixel format %d in resample\n", form);
+		return -1;
+	}
+
+	uint64_t trace_ns = TRACE_BEGIN ();
+	Kernel kx, ky;
+	if (buildKernel (src->width, width, filter, &kx) < 0) {
+		return -1;
+	}
+	if (buildKernel (src->height, height, filter, &ky) < 0) {
+		freeKernel (&kx);
+		return -1;
+	}
+
+	// ring of horizontally filtered rows, source row r is at r % ringRows
+	int ringRows = ky.taps;
+	int rowLen = width * form;
+	uint8_t *ring = (uint8_t *)malloc (ringRows * rowLen);
+	const uint8_t **rows = (const uint8_t **)malloc (ringRows * sizeof(uint8_t *));
+	int retCode = -1;
+	if (NULL == ring || NULL == rows) {
+		LogE ("Failed malloc resample ring\n");
+	}
+	else if (ensureBitmap (dst, width, height, form) >= 0) {
+		const uint8_t *base = (const uint8_t *)src->base;
+		int srcStride = src->width * form;
+		int filtered = 0;	// source rows filtered so far
+		int y, t;
+		for (y = 0; y < height; ++y) {
+			int first = ky.start[y];
+			int n = ky.count[y];
+			if (filtered < first) {
+				filtered = first;
+			}
+			for (; filtered < first + n; ++filtered) {
+				horizontalPass (base + filtered * srcStride, form, &kx, width,
+						ring + (filtered % ringRows) * rowLen);
+			}
+			for (t = 0; t < n; ++t) {
+				rows[t] = ring + ((first + t) % ringRows) * rowLen;
+			}
+			verticalPass (rows, ky.weights + y * ky.taps, n, rowLen,
+					(uint8_t *)dst->base + y * rowLen);
+		}
+		retCode = 0;
+	}
+
+	if (NULL != ring) {
+		free (ring);
+	}
+	if (NULL != rows) {
+		free ((void *)rows);
+	}
+	freeKernel (&kx);
+	freeKernel (&ky);
+	TRACE_END ("resampleImage", trace_ns);
+	return retCode;
+}
@@ -0,0 +1,50 @@
+/************************************
+ * file name:   resample.h
+ * description: separable image resampler
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __RESAMPLE__H__
+#define __RESAMPLE__H__
+
+#include "imgsdk.h"
+
+/**
+ * Resampling filter
+ */
+typedef enum {
+	RESAMPLE_BOX = 0,		// area average, good for integer downscale
+	RESAMPLE_BILINEAR,		// triangle, radius 1
+	RESAMPLE_BICUBIC,		// cubic convolution a = -0.5, radius 2
+	RESAMPLE_LANCZOS3,		// windowed sinc, radius 3
+	RESAMPLE_END			// == end ==
+} ResampleFilter;
+
+/**
+ * Get filter by name: "box", "bilinear", "bicubic", "lanczos"
+ * Return:
+ *		RESAMPLE_END if unknown
+ */
+ResampleFilter getResampleFilter(const char *name);
+
+/**
+ * Resize image. The filter is widened by the scale factor when
+ * downscaling, so every source pixel contributes (no aliasing).
+ * Rows are filtered horizontally into a ring buffer as the vertical
+ * pass needs them, so only a few rows are alive at any time.
+ * Parameters:
+ *		src:		source image, GRAY, RGB24 or RGBA32
+ *		width:		output width
+ *		height:		output height
+ *		filter:		resampling filter
+ *		dst:		[OUT] output image, dst->base is reused if large enough
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int resampleImage(const Bitmap_t *src, int width, int height,
+		ResampleFilter filter, Bitmap_t *dst);
+
+#endif
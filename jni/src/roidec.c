@@ -0,0 +1,429 @@
+/***************************************
+ * file name:   roidec.c
+ * description: implement region of interest decoding
+ *
+ *	jpeg: rows after the region are never decoded. When the region
+ *	      is low in the image, the MCU blocks covering it are cut out
+ *	      of the coefficients (transupp crop), written to a small
+ *	      jpeg in memory, and only that one is transformed.
+ *	png:  rows after the region are never read.
+ *
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <malloc.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "comm.h"
+#include "jpeglib.h"
+#include "jerror.h"
+#include "png.h"
+#include "roidec.h"
+#include "transupp.h"
+#include "utility.h"
+
+/**
+ * Jpeg error manager, never exit() on bad file
+ */
+typedef struct {
+	struct jpeg_error_mgr pub;
+	jmp_buf jmp;
+} JpegError;
+
+/**
+ * Everything to release when jpeg decoding fails
+ */
+typedef struct {
+	JpegError	jerr;
+	struct jpeg_decompress_struct	src;	// the file
+	struct jpeg_compress_struct		crop;	// writes the cropped coefficients
+	struct jpeg_decompress_struct	roi;	// decodes the cropped jpeg
+	bool			srcCreated;
+	bool			cropCreated;
+	bool			roiCreated;
+	unsigned char	*buf;					// cropped jpeg in memory
+	unsigned long	size;					// bytes of buf
+	Bitmap_t		*mem;					// output
+	bool			allocated;				// mem is allocated here
+} JpegRegion;
+
+/**
+ * Intersect region with image
+ * Return:
+ *		 0 OK
+ *		-1 region is out of image
+ */
+static int clipRegion (Rect_t *rect, int width, int height) {
+	int64_t x0 = rect->x > 0 ? rect->x : 0;
+	int64_t y0 = rect->y > 0 ? rect->y : 0;
+	int64_t x1 = (int64_t)rect->x + rect->width;
+	int64_t y1 = (int64_t)rect->y + rect->height;
+	x1 = x1 < width ? x1 : width;
+	y1 = y1 < height ? y1 : height;
+	if (x1 <= x0 || y1 <= y0) {
+		LogE ("Region (%d, %d) %d x %d is out of image %d x %d\n",
+				rect->x, rect->y, rect->width, rect->height, width, height);
+		return -1;
+	}
+	rect->x = (int)x0;
+	rect->y = (int)y0;
+	rect->width = (int)(x1 - x0);
+	rect->height = (int)(y1 - y0);
+	return 0;
+}
+
+static int allocRegion (Bitmap_t *mem, int width, int height, int form, bool bottomUp) {
+	mem->base = (char *)malloc ((size_t)width * height * form);
+	if (NULL == mem->base) {
+		LogE ("Failed malloc region %d x %d\n", width, height);
+		return -1;
+	}
+	mem->width = width;
+	mem->height = height;
+	mem->form = form;
+	mem->bottomUp = bottomUp;
+	return 0;
+}
+
+static void onJpegError (j_common_ptr cinfo) {
+	JpegError *err = (JpegError *)cinfo->err;
+	char msg[JMSG_LENGTH_MAX];
+	(*cinfo->err->format_message) (cinfo, msg);
+	LogE ("jpeg region error:%s\n", msg);
+	longjmp (err->jmp, 1);
+}
+
+static int setJpegColor (j_decompress_ptr jds) {
+	if (1 == jds->num_components) {
+		jds->out_color_space = JCS_GRAYSCALE;
+	} else if (3 == jds->num_components) {
+		jds->out_color_space = JCS_RGB;
+	} else {
+		LogE ("Not supported jpeg components:%d\n", jds->num_components);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Decode rows [top, top + rect->height) of the started decompressor,
+ * keep columns [left, left + rect->width) bottom-up as read_jpeg does.
+ * Nothing after the last row is decoded.
+ */
+static void readJpegRows (j_decompress_ptr jds, int top, int left,
+		const Rect_t *rect, Bitmap_t *mem) {
+	int form = jds->output_components;
+	int stride = rect->width * form;
+	JSAMPARRAY row = (*jds->mem->alloc_sarray) ((j_common_ptr)jds, JPOOL_IMAGE,
+			jds->output_width * form, 1);
+	int bottom = top + rect->height;
+	while ((int)jds->output_scanline < bottom) {
+		int y = jds->output_scanline;
+		jpeg_read_scanlines (jds, row, 1);
+		if (y >= top) {
+			memcpy (mem->base + (bottom - 1 - y) * stride, row[0] + left * form, stride);
+		}
+	}
+	jpeg_abort_decompress (jds);
+}
+
+/**
+ * Cut the iMCUs covering the region out of the coefficients, and
+ * decode the small jpeg made of them
+ * Return:
+ *		false if the crop is not possible, nothing is read yet
+ */
+static bool readJpegBlocks (JpegRegion *ctx, int top, const Rect_t *rect) {
+	jpeg_transform_info info;
+	memset (&info, 0, sizeof(info));
+	info.transform = JXFORM_NONE;
+	info.crop = TRUE;
+	info.crop_xoffset = rect->x;
+	info.crop_xoffset_set = JCROP_POS;
+	info.crop_yoffset = top;
+	info.crop_yoffset_set = JCROP_POS;
+	info.crop_width = rect->width;
+	info.crop_width_set = JCROP_POS;
+	info.crop_height = rect->height;
+	info.crop_height_set = JCROP_POS;
+	if (!jtransform_request_workspace (&ctx->src, &info)) {
+		return false;
+	}
+
+	jvirt_barray_ptr *coefs = jpeg_read_coefficients (&ctx->src);
+	ctx->crop.err = &ctx->jerr.pub;
+	jpeg_create_compress (&ctx->crop);
+	ctx->cropCreated = true;
+	jpeg_copy_critical_parameters (&ctx->src, &ctx->crop);
+	jvirt_barray_ptr *cropCoefs = jtransform_adjust_parameters (&ctx->src,
+			&ctx->crop, coefs, &info);
+	jpeg_mem_dest (&ctx->crop, &ctx->buf, &ctx->size);
+	jpeg_write_coefficients (&ctx->crop, cropCoefs);
+	jtransform_execute_transform (&ctx->src, &ctx->crop, coefs, &info);
+	jpeg_finish_compress (&ctx->crop);
+	jpeg_abort_decompress (&ctx->src);
+
+	ctx->roi.err = &ctx->jerr.pub;
+	jpeg_create_decompress (&ctx->roi);
+	ctx->roiCreated = true;
+	jpeg_mem_src (&ctx->roi, ctx->buf, ctx->size);
+	jpeg_read_header (&ctx->roi, TRUE);
+	setJpegColor (&ctx->roi);
+	jpeg_start_decompress (&ctx->roi);
+
+	// the cropped jpeg starts at the iMCU holding the region's corner
+	int left = rect->x - info.x_crop_offset * info.iMCU_sample_width;
+	top -= info.y_crop_offset * info.iMCU_sample_height;
+	readJpegRows (&ctx->roi, top, left, rect, ctx->mem);
+	return true;
+}
+
+static int decodeJpegRegion (JpegRegion *ctx, FILE *fp, Rect_t *rect) {
+	struct jpeg_decompress_struct *jds = &ctx->src;
+	jds->err = jpeg_std_error (&ctx->jerr.pub);
+	ctx->jerr.pub.error_exit = onJpegError;
+	if (setjmp (ctx->jerr.jmp)) {
+		if (ctx->allocated) {
+			freeBitmap (ctx->mem);
+		}
+		return -1;
+	}
+	jpeg_create_decompress (jds);
+	ctx->srcCreated = true;
+	jpeg_stdio_src (jds, fp);
+	jpeg_read_header (jds, TRUE);
+	if (setJpegColor (jds) < 0) {
+		return -1;
+	}
+
+	int width = jds->image_width;
+	int height = jds->image_height;
+	if (clipRegion (rect, width, height) < 0 ||
+			allocRegion (ctx->mem, rect->width, rect->height, jds->num_components, true) < 0) {
+		return -1;
+	}
+	ctx->allocated = true;
+
+	// region is counted from the top like Clip, rows are only stored bottom-up
+	int top = rect->y;
+	int bottom = top + rect->height;
+
+	// Entropy decoding is about half of a full decode and can't skip
+	// anything. Cropping the blocks costs that plus the region, while
+	// decoding rows costs the rows down to the region's bottom.
+	// Progressive jpeg buffers all coefficients anyway.
+	int64_t rows = (int64_t)bottom * width;
+	int64_t blocks = (int64_t)width * height / 2 + (int64_t)rect->width * rect->height;
+	bool byRows = !jpeg_has_multiple_scans (jds) && rows <= blocks;
+	if (byRows || !readJpegBlocks (ctx, top, rect)) {
+		jpeg_start_decompress (jds);
+		readJpegRows (jds, top, rect->x, rect, ctx->mem);
+	}
+	return 0;
+}
+
+/**
+ * Read region of jpeg file
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int read_jpeg_region(const char *path, Rect_t *rect, Bitmap_t *mem)
+{
+	if (NULL == path || NULL == rect || NULL == mem) {
+		return -1;
+	}
+
+	FILE *fp = fopen (path, "rb");
+	if (NULL == fp) {
+		LogE ("Failed open %s\n", path);
+		return -1;
+	}
+
+	uint32_t begin_t = getCurrentTime ();
+	JpegRegion *ctx = (JpegRegion *)calloc (1, sizeof(JpegRegion));
+	int ret = -1;
+	if (NULL == ctx) {
+		LogE ("Failed calloc jpeg region\n");
+	} else {
+		ctx->mem = mem;
+		ret = decodeJpegRegion (ctx, fp, rect);
+		if (ctx->roiCreated) {
+			jpeg_destroy_decompress (&ctx->roi);
+		}
+		if (ctx->cropCreated) {
+			jpeg_destroy_compress (&ctx->crop);
+		}
+		if (ctx->srcCreated) {
+			jpeg_destroy_decompress (&ctx->src);
+		}
+		free (ctx->buf);
+		free (ctx);
+	}
+	fclose (fp);
+
+	if (0 == ret) {
+		LogD ("Region (%d, %d) %d x %d of %s cost %d ms\n", rect->x, rect->y,
+				rect->width, rect->height, path, getCurrentTime () - begin_t);
+	}
+	return ret;
+}
+
+/**
+ * Everything to release when png decoding fails
+ */
+typedef struct {
+	png_structp	png;
+	png_infop	info;
+	png_bytep	row;		// scratch row
+	png_bytep	band;		// rows of region, interlaced png only
+	Bitmap_t	*mem;		// output
+	bool		allocated;	// mem is allocated here
+} PngRegion;
+
+static int decodePngRegion (PngRegion *ctx, FILE *fp, Rect_t *rect) {
+	png_structp png = ctx->png;
+	png_infop info = ctx->info;
+	if (setjmp (png_jmpbuf (png))) {
+		if (ctx->allocated) {
+			freeBitmap (ctx->mem);
+		}
+		return -1;
+	}
+	png_init_io (png, fp);
+	png_read_info (png, info);
+
+	// normalize to gray, rgb or rgba 8 bits
+	int type = png_get_color_type (png, info);
+	png_set_expand (png);
+	png_set_strip_16 (png);
+	if (PNG_COLOR_TYPE_GRAY_ALPHA == type ||
+			(PNG_COLOR_TYPE_GRAY == type && png_get_valid (png, info, PNG_INFO_tRNS))) {
+		png_set_gray_to_rgb (png);
+	}
+	int passes = png_set_interlace_handling (png);
+	png_read_update_info (png, info);
+
+	int height = png_get_image_height (png, info);
+	int form = png_get_channels (png, info);
+	size_t rowBytes = png_get_rowbytes (png, info);
+	if (clipRegion (rect, png_get_image_width (png, info), height) < 0 ||
+			allocRegion (ctx->mem, rect->width, rect->height, form, false) < 0) {
+		return -1;
+	}
+	ctx->allocated = true;
+	ctx->row = (png_bytep)malloc (rowBytes);
+	if (NULL == ctx->row) {
+		LogE ("Failed malloc png row\n");
+		freeBitmap (ctx->mem);
+		return -1;
+	}
+
+	int top = rect->y;
+	int bottom = rect->y + rect->height;
+	int stride = rect->width * form;
+	int y, pass;
+	if (1 == passes) {
+		for (y = 0; y < bottom; ++y) {
+			png_read_row (png, ctx->row, NULL);
+			if (y >= top) {
+				memcpy (ctx->mem->base + (y - top) * stride, ctx->row + rect->x * form, stride);
+			}
+		}
+		return 0;
+	}
+
+	// every pass spans the whole image, keep full rows of region
+	ctx->band = (png_bytep)calloc (rect->height, rowBytes);
+	if (NULL == ctx->band) {
+		LogE ("Failed calloc png band\n");
+		freeBitmap (ctx->mem);
+		return -1;
+	}
+	for (pass = 0; pass < passes; ++pass) {
+		int last = pass == passes - 1 ? bottom : height;
+		for (y = 0; y < last; ++y) {
+			bool inside = y >= top && y < bottom;
+			png_read_row (png, inside ? ctx->band + (y - top) * rowBytes : ctx->row, NULL);
+		}
+	}
+	for (y = 0; y < rect->height; ++y) {
+		memcpy (ctx->mem->base + y * stride, ctx->band + y * rowBytes + rect->x * form, stride);
+	}
+	return 0;
+}
+
+/**
+ * Read region of png file
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int read_png_region(const char *path, Rect_t *rect, Bitmap_t *mem)
+{
+	if (NULL == path || NULL == rect || NULL == mem) {
+		return -1;
+	}
+
+	FILE *fp = fopen (path, "rb");
+	if (NULL == fp) {
+		LogE ("Failed open %s\n", path);
+		return -1;
+	}
+
+	uint32_t begin_t = getCurrentTime ();
+	PngRegion ctx;
+	memset (&ctx, 0, sizeof(PngRegion));
+	ctx.mem = mem;
+	int ret = -1;
+	ctx.png = png_create_read_struct (PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (NULL != ctx.png) {
+		ctx.info = png_create_info_struct (ctx.png);
+	}
+	if (NULL == ctx.png || NULL == ctx.info) {
+		LogE ("Failed create png read struct\n");
+	} else {
+		ret = decodePngRegion (&ctx, fp, rect);
+	}
+	png_destroy_read_struct (&ctx.png, &ctx.info, NULL);
+	free (ctx.row);
+	free (ctx.band);
+	fclose (fp);
+
+	if (0 == ret) {
+		LogD ("Region (%d, %d) %d x %d of %s cost %d ms\n", rect->x, rect->y,
+				rect->width, rect->height, path, getCurrentTime () - begin_t);
+	}
+	return ret;
+}
+
+/**
+ * Load region of image
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int loadImageRegion(const char *path, Rect_t *rect, Bitmap_t *mem)
+{
+	if (NULL == path || NULL == rect || NULL == mem) {
+		return -1;
+	}
+	const char *postfix = getFilePostfix (path);
+	if (NULL == postfix) {
+		LogE ("Failed getFilePostfix in loadImageRegion\n");
+		return -1;
+	}
+
+	if (strcasecmp (postfix, "jpg") == 0) {
+		return read_jpeg_region (path, rect, mem);
+	}
+	else if (strcasecmp (postfix, "png") == 0) {
+		return read_png_region (path, rect, mem);
+	}
+	LogE ("Invalid postfix name (%s) in loadImageRegion\n", postfix);
+	return -1;
+}
@@ -0,0 +1,51 @@
+/************************************
+ * file name:   roidec.h
+ * description: decode a region of image only
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __ROIDEC__H__
+#define __ROIDEC__H__
+
+#include "imgsdk.h"
+
+/**
+ * Read region of jpeg file
+ * The result is the region of what read_jpeg gives (rows bottom-up),
+ * but the rows outside are never stored, and the blocks outside are
+ * not even transformed when cropping in the coefficients is cheaper.
+ * Parameters:
+ *		path:	jpeg file path
+ *		rect:	[IN/OUT] region counted from the top of image like Clip,
+ *				clipped to the image on return
+ *		mem:	[OUT] decoded region
+ * Return:
+ *		 0 OK
+ *		-1 ERROR, e.g. the region is out of image
+ */
+int read_jpeg_region(const char *path, Rect_t *rect, Bitmap_t *mem);
+
+/**
+ * Read region of png file, what read_png then cropping gives.
+ * Non-interlaced png stops reading after the last row of region.
+ * Parameters:
+ *		path:	png file path
+ *		rect:	[IN/OUT] region, clipped to the image on return
+ *		mem:	[OUT] decoded region
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int read_png_region(const char *path, Rect_t *rect, Bitmap_t *mem);
+
+/**
+ * Load region of image, by the postfix of path like loadImage
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int loadImageRegion(const char *path, Rect_t *rect, Bitmap_t *mem);
+
+#endif
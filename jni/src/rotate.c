@@ -0,0 +1,558 @@
+/***************************************
+ * file name:   rotate.c
+ * description: implement CPU rotation
+ *
+ *	Quarter turns are transposes with one axis reversed. Walking the
+ *	source row by row writes the destination column by column, so
+ *	every pixel lands on another page. The image is cut into tiles
+ *	small enough that source & destination rows of a tile stay in
+ *	cache and TLB, and tiles are transposed as 4x4 (RGBA32) or 8x8
+ *	(GRAY) register blocks with SSE2 or NEON.
+ *
+ *	Other angles sample the source through the inverse rotation,
+ *	stepping the coordinates in 16.16 fixed point.
+ *
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "comm.h"
+#include "rotate.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define ROTATE_SSE2
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ROTATE_NEON
+#endif
+
+#define PI 3.14159265358979
+
+// tile edge in pixels, multiple of 8
+#define ROTATE_TILE 64
+
+// fixed point of sampling coordinates
+#define COORD_BITS 16
+#define COORD_ONE  (1 << COORD_BITS)
+
+// fixed point of bicubic weights, keeps two passes in int32
+#define CUBIC_BITS 11
+#define CUBIC_ONE  (1 << CUBIC_BITS)
+
+// fraction phases of bicubic weights
+#define CUBIC_PHASES 256
+
+/**
+ * Quarter turn: source pixel (x, y) goes to destination
+ *		clockwise:	row x, column height - 1 - y
+ *		otherwise:	row width - 1 - x, column y
+ */
+typedef struct {
+	const uint8_t	*src;
+	ptrdiff_t		srcStride;
+	uint8_t			*dst;
+	ptrdiff_t		dstStride;
+	int				width;		// source width
+	int				height;		// source height
+	int				form;
+	bool			clockwise;
+} Turn;
+
+static inline uint8_t* turnTarget (const Turn *t, int x, int y) {
+	if (t->clockwise) {
+		return t->dst + x * t->dstStride + (t->height - 1 - y) * t->form;
+	}
+	return t->dst + (t->width - 1 - x) * t->dstStride + y * t->form;
+}
+
+/**
+ * Pixel by pixel, any format
+ */
+static void turnRect (const Turn *t, int x0, int y0, int x1, int y1) {
+	int form = t->form;
+	ptrdiff_t step = t->clockwise ? t->dstStride : -t->dstStride;
+	int x, y;
+	for (y = y0; y < y1; ++y) {
+		const uint8_t *s = t->src + y * t->srcStride + x0 * form;
+		uint8_t *d = turnTarget (t, x0, y);
+		switch (form) {
+			case RGBA32:
+				for (x = x0; x < x1; ++x, s += 4, d += step) {
+					memcpy (d, s, 4);
+				}
+				break;
+			case RGB24:
+				for (x = x0; x < x1; ++x, s += 3, d += step) {
+					d[0] = s[0];
+					d[1] = s[1];
+					d[2] = s[2];
+				}
+				break;
+			default:
+				for (x = x0; x < x1; ++x, ++s, d += step) {
+					*d = *s;
+				}
+				break;
+		}
+	}
+}
+
+#if defined(ROTATE_SSE2) || defined(ROTATE_NEON)
+
+/**
+ * d row i = s column i, 4x4 pixels of 32 bits.
+ * Strides may be negative to reverse an axis.
+ */
+static inline void transpose4x4 (const uint8_t *s, ptrdiff_t ss, uint8_t *d, ptrdiff_t ds) {
+#if defined(ROTATE_SSE2)
+	__m128i r0 = _mm_loadu_si128 ((const __m128i *)(s));
+	__m128i r1 = _mm_loadu_si128 ((const __m128i *)(s + ss));
+	__m128i r2 = _mm_loadu_si128 ((const __m128i *)(s + 2 * ss));
+	__m128i r3 = _mm_loadu_si128 ((const __m128i *)(s + 3 * ss));
+	__m128i t0 = _mm_unpacklo_epi32 (r0, r1);
+	__m128i t1 = _mm_unpackhi_epi32 (r0, r1);
+	__m128i t2 = _mm_unpacklo_epi32 (r2, r3);
+	__m128i t3 = _mm_unpackhi_epi32 (r2, r3);
+	_mm_storeu_si128 ((__m128i *)(d),          _mm_unpacklo_epi64 (t0, t2));
+	_mm_storeu_si128 ((__m128i *)(d + ds),     _mm_unpackhi_epi64 (t0, t2));
+	_mm_storeu_si128 ((__m128i *)(d + 2 * ds), _mm_unpacklo_epi64 (t1, t3));
+	_mm_storeu_si128 ((__m128i *)(d + 3 * ds), _mm_unpackhi_epi64 (t1, t3));
+#else
+	uint32x4_t r0 = vreinterpretq_u32_u8 (vld1q_u8 (s));
+	uint32x4_t r1 = vreinterpretq_u32_u8 (vld1q_u8 (s + ss));
+	uint32x4_t r2 = vreinterpretq_u32_u8 (vld1q_u8 (s + 2 * ss));
+	uint32x4_t r3 = vreinterpretq_u32_u8 (vld1q_u8 (s + 3 * ss));
+	uint32x4x2_t t01 = vtrnq_u32 (r0, r1);
+	uint32x4x2_t t23 = vtrnq_u32 (r2, r3);
+	vst1q_u8 (d,          vreinterpretq_u8_u32 (vcombine_u32 (
+				vget_low_u32 (t01.val[0]), vget_low_u32 (t23.val[0]))));
+	vst1q_u8 (d + ds,     vreinterpretq_u8_u32 (vcombine_u32 (
+				vget_low_u32 (t01.val[1]), vget_low_u32 (t23.val[1]))));
+	vst1q_u8 (d + 2 * ds, vreinterpretq_u8_u32 (vcombine_u32 (
+				vget_high_u32 (t01.val[0]), vget_high_u32 (t23.val[0]))));
+	vst1q_u8 (d + 3 * ds, vreinterpretq_u8_u32 (vcombine_u32 (
+				vget_high_u32 (t01.val[1]), vget_high_u32 (t23.val[1]))));
+#endif
+}
+
+/**
+ * d row i = s column i, 8x8 bytes
+ */
+static inline void transpose8x8 (const uint8_t *s, ptrdiff_t ss, uint8_t *d, ptrdiff_t ds) {
+#if defined(ROTATE_SSE2)
+	__m128i r0 = _mm_loadl_epi64 ((const __m128i *)(s));
+	__m128i r1 = _mm_loadl_epi64 ((const __m128i *)(s + ss));
+	__m128i r2 = _mm_loadl_epi64 ((const __m128i *)(s + 2 * ss));
+	__m128i r3 = _mm_loadl_epi64 ((const __m128i *)(s + 3 * ss));
+	__m128i r4 = _mm_loadl_epi64 ((const __m128i *)(s + 4 * ss));
+	__m128i r5 = _mm_loadl_epi64 ((const __m128i *)(s + 5 * ss));
+	__m128i r6 = _mm_loadl_epi64 ((const __m128i *)(s + 6 * ss));
+	__m128i r7 = _mm_loadl_epi64 ((const __m128i *)(s + 7 * ss));
+	// byte pairs, then 4 rows of each column, then 8
+	__m128i a0 = _mm_unpacklo_epi8 (r0, r1);
+	__m128i a1 = _mm_unpacklo_epi8 (r2, r3);
+	__m128i a2 = _mm_unpacklo_epi8 (r4, r5);
+	__m128i a3 = _mm_unpacklo_epi8 (r6, r7);
+	__m128i b0 = _mm_unpacklo_epi16 (a0, a1);	// columns 0 - 3 of rows 0 - 3
+	__m128i b1 = _mm_unpackhi_epi16 (a0, a1);	// columns 4 - 7 of rows 0 - 3
+	__m128i b2 = _mm_unpacklo_epi16 (a2, a3);
+	__m128i b3 = _mm_unpackhi_epi16 (a2, a3);
+	__m128i c0 = _mm_unpacklo_epi32 (b0, b2);	// columns 0, 1
+	__m128i c1 = _mm_unpackhi_epi32 (b0, b2);	// columns 2, 3
+	__m128i c2 = _mm_unpacklo_epi32 (b1, b3);	// columns 4, 5
+	__m128i c3 = _mm_unpackhi_epi32 (b1, b3);	// columns 6, 7
+	_mm_storel_epi64 ((__m128i *)(d),          c0);
+	_mm_storel_epi64 ((__m128i *)(d + ds),     _mm_srli_si128 (c0, 8));
+	_mm_storel_epi64 ((__m128i *)(d + 2 * ds), c1);
+	_mm_storel_epi64 ((__m128i *)(d + 3 * ds), _mm_srli_si128 (c1, 8));
+	_mm_storel_epi64 ((__m128i *)(d + 4 * ds), c2);
+	_mm_storel_epi64 ((__m128i *)(d + 5 * ds), _mm_srli_si128 (c2, 8));
+	_mm_storel_epi64 ((__m128i *)(d + 6 * ds), c3);
+	_mm_storel_epi64 ((__m128i *)(d + 7 * ds), _mm_srli_si128 (c3, 8));
+#else
+	uint8x8x2_t t0 = vtrn_u8 (vld1_u8 (s),          vld1_u8 (s + ss));
+	uint8x8x2_t t1 = vtrn_u8 (vld1_u8 (s + 2 * ss), vld1_u8 (s + 3 * ss));
+	uint8x8x2_t t2 = vtrn_u8 (vld1_u8 (s + 4 * ss), vld1_u8 (s + 5 * ss));
+	uint8x8x2_t t3 = vtrn_u8 (vld1_u8 (s + 6 * ss), vld1_u8 (s + 7 * ss));
+	uint16x4x2_t u0 = vtrn_u16 (vreinterpret_u16_u8 (t0.val[0]), vreinterpret_u16_u8 (t1.val[0]));
+	uint16x4x2_t u1 = vtrn_u16 (vreinterpret_u16_u8 (t0.val[1]), vreinterpret_u16_u8 (t1.val[1]));
+	uint16x4x2_t u2 = vtrn_u16 (vreinterpret_u16_u8 (t2.val[0]), vreinterpret_u16_u8 (t3.val[0]));
+	uint16x4x2_t u3 = vtrn_u16 (vreinterpret_u16_u8 (t2.val[1]), vreinterpret_u16_u8 (t3.val[1]));
+	uint32x2x2_t v0 = vtrn_u32 (vreinterpret_u32_u16 (u0.val[0]), vreinterpret_u32_u16 (u2.val[0]));
+	uint32x2x2_t v1 = vtrn_u32 (vreinterpret_u32_u16 (u1.val[0]), vreinterpret_u32_u16 (u3.val[0]));
+	uint32x2x2_t v2 = vtrn_u32 (vreinterpret_u32_u16 (u0.val[1]), vreinterpret_u32_u16 (u2.val[1]));
+	uint32x2x2_t v3 = vtrn_u32 (vreinterpret_u32_u16 (u1.val[1]), vreinterpret_u32_u16 (u3.val[1]));
+	vst1_u8 (d,          vreinterpret_u8_u32 (v0.val[0]));
+	vst1_u8 (d + ds,     vreinterpret_u8_u32 (v1.val[0]));
+	vst1_u8 (d + 2 * ds, vreinterpret_u8_u32 (v2.val[0]));
+	vst1_u8 (d + 3 * ds, vreinterpret_u8_u32 (v3.val[0]));
+	vst1_u8 (d + 4 * ds, vreinterpret_u8_u32 (v0.val[1]));
+	vst1_u8 (d + 5 * ds, vreinterpret_u8_u32 (v1.val[1]));
+	vst1_u8 (d + 6 * ds, vreinterpret_u8_u32 (v2.val[1]));
+	vst1_u8 (d + 7 * ds, vreinterpret_u8_u32 (v3.val[1]));
+#endif
+}
+
+/**
+ * Transpose n x n blocks of the tile, returns false if not vectorized
+ */
+static bool turnBlocks (const Turn *t, int x0, int y0, int x1, int y1) {
+	int n;
+	if (RGBA32 == t->form) {
+		n = 4;
+	} else if (GRAY == t->form) {
+		n = 8;
+	} else {
+		return false;
+	}
+
+	// clockwise reads rows upwards, otherwise writes rows upwards
+	ptrdiff_t ss = t->clockwise ? -t->srcStride : t->srcStride;
+	ptrdiff_t ds = t->clockwise ? t->dstStride : -t->dstStride;
+	int x, y;
+	for (y = y0; y < y1; y += n) {
+		int sy = t->clockwise ? y + n - 1 : y;
+		const uint8_t *s = t->src + sy * t->srcStride;
+		for (x = x0; x < x1; x += n) {
+			uint8_t *d = turnTarget (t, x, sy);
+			if (4 == n) {
+				transpose4x4 (s + x * 4, ss, d, ds);
+			} else {
+				transpose8x8 (s + x, ss, d, ds);
+			}
+		}
+	}
+	return true;
+}
+
+#endif
+
+/**
+ * Quarter turn in tiles, blocks inside, pixels on the ragged edges
+ */
+static void turnImage (const Turn *t) {
+	int n = RGBA32 == t->form ? 4 : 8;
+	int w = t->width / n * n;	// covered by blocks
+	int h = t->height / n * n;
+	int tx, ty;
+	for (ty = 0; ty < h; ty += ROTATE_TILE) {
+		int ty1 = ty + ROTATE_TILE < h ? ty + ROTATE_TILE : h;
+		for (tx = 0; tx < w; tx += ROTATE_TILE) {
+			int tx1 = tx + ROTATE_TILE < w ? tx + ROTATE_TILE : w;
+#if defined(ROTATE_SSE2) || defined(ROTATE_NEON)
+			if (turnBlocks (t, tx, ty, tx1, ty1)) {
+				continue;
+			}
+#endif
+			turnRect (t, tx, ty, tx1, ty1);
+		}
+	}
+	if (w < t->width) {
+		turnRect (t, w, 0, t->width, t->height);
+	}
+	if (h < t->height) {
+		turnRect (t, 0, h, w, t->height);
+	}
+}
+
+/**
+ * Half turn: destination row y is source row height - 1 - y reversed
+ */
+static void flipImage (const Bitmap_t *src, Bitmap_t *dst) {
+	int w = src->width;
+	int h = src->height;
+	int form = src->form;
+	int stride = w * form;
+	int x, y, k;
+	for (y = 0; y < h; ++y) {
+		const uint8_t *s = (const uint8_t *)src->base + (h - 1 - y) * stride;
+		uint8_t *d = (uint8_t *)dst->base + y * stride;
+		x = 0;
+		if (RGBA32 == form) {
+#if defined(ROTATE_SSE2)
+			for (; x + 4 <= w; x += 4) {
+				__m128i v = _mm_loadu_si128 ((const __m128i *)(s + (w - 4 - x) * 4));
+				_mm_storeu_si128 ((__m128i *)(d + x * 4), _mm_shuffle_epi32 (v, 0x1B));
+			}
+#elif defined(ROTATE_NEON)
+			for (; x + 4 <= w; x += 4) {
+				uint32x4_t v = vrev64q_u32 (vreinterpretq_u32_u8 (vld1q_u8 (s + (w - 4 - x) * 4)));
+				vst1q_u8 (d + x * 4, vreinterpretq_u8_u32 (
+							vcombine_u32 (vget_high_u32 (v), vget_low_u32 (v))));
+			}
+#endif
+			for (; x < w; ++x) {
+				memcpy (d + x * 4, s + (w - 1 - x) * 4, 4);
+			}
+		}
+		else if (GRAY == form) {
+#if defined(ROTATE_SSE2)
+			for (; x + 16 <= w; x += 16) {
+				// reverse dwords, words in dwords, bytes in words
+				__m128i v = _mm_loadu_si128 ((const __m128i *)(s + w - 16 - x));
+				v = _mm_shuffle_epi32 (v, 0x1B);
+				v = _mm_shufflelo_epi16 (_mm_shufflehi_epi16 (v, 0xB1), 0xB1);
+				v = _mm_or_si128 (_mm_slli_epi16 (v, 8), _mm_srli_epi16 (v, 8));
+				_mm_storeu_si128 ((__m128i *)(d + x), v);
+			}
+#elif defined(ROTATE_NEON)
+			for (; x + 16 <= w; x += 16) {
+				uint8x16_t v = vrev64q_u8 (vld1q_u8 (s + w - 16 - x));
+				vst1q_u8 (d + x, vcombine_u8 (vget_high_u8 (v), vget_low_u8 (v)));
+			}
+#endif
+			for (; x < w; ++x) {
+				d[x] = s[w - 1 - x];
+			}
+		}
+		else {
+			for (; x < w; ++x) {
+				for (k = 0; k < form; ++k) {
+					d[x * form + k] = s[(w - 1 - x) * form + k];
+				}
+			}
+		}
+	}
+}
+
+static bool isRotatable (const Bitmap_t *src, const Bitmap_t *dst) {
+	if (NULL == src || NULL == src->base || NULL == dst || src == dst ||
+			src->width <= 0 || src->height <= 0) {
+		return false;
+	}
+	if (src->form != GRAY && src->form != RGB24 && src->form != RGBA32) {
+		LogE ("Unsupported pixel format %d in rotate\n", src->form);
+		return false;
+	}
+	return true;
+}
+
+static double snapZero (double v) {
+	return fabs (v) < 1e-6 ? 0.0 : v;
+}
+
+/**
+ * Size of canvas holding the whole image rotated by degree
+ */
+void getRotatedSize(int width, int height, int degree, int *outWidth, int *outHeight)
+{
+	// float as bindGeometryPass does, so both agree on the canvas
+	float rad = degree * (float)PI / 180.0f;
+	float c = fabsf (cosf (rad));
+	float s = fabsf (sinf (rad));
+	c = c < 1e-6f ? 0.0f : c;
+	s = s < 1e-6f ? 0.0f : s;
+	int w = (int)floorf (width * c + height * s + 0.5f);
+	int h = (int)floorf (width * s + height * c + 0.5f);
+	if (NULL != outWidth) {
+		*outWidth = w > 0 ? w : 1;
+	}
+	if (NULL != outHeight) {
+		*outHeight = h > 0 ? h : 1;
+	}
+}
+
+/**
+ * Rotate by multiples of 90 degrees
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int rotateImage90(const Bitmap_t *src, int quarter, Bitmap_t *dst)
+{
+	if (!isRotatable (src, dst)) {
+		return -1;
+	}
+
+	int w = src->width;
+	int h = src->height;
+	int form = src->form;
+	quarter = (quarter % 4 + 4) % 4;
+	if (1 == quarter || 3 == quarter) {
+		if (ensureBitmap (dst, h, w, form) < 0) {
+			return -1;
+		}
+		Turn t;
+		t.src = (const uint8_t *)src->base;
+		t.srcStride = (ptrdiff_t)w * form;
+		t.dst = (uint8_t *)dst->base;
+		t.dstStride = (ptrdiff_t)h * form;
+		t.width = w;
+		t.height = h;
+		t.form = form;
+		t.clockwise = 1 == quarter;
+		turnImage (&t);
+		return 0;
+	}
+
+	if (ensureBitmap (dst, w, h, form) < 0) {
+		return -1;
+	}
+	if (0 == quarter) {
+		memcpy (dst->base, src->base, w * h * form);
+	} else {
+		flipImage (src, dst);
+	}
+	return 0;
+}
+
+static double cubic (double x) {
+	const double a = -0.5;
+	x = fabs (x);
+	if (x < 1.0) {
+		return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+	}
+	if (x < 2.0) {
+		return (((x - 5.0) * x + 8.0) * x - 4.0) * a;
+	}
+	return 0.0;
+}
+
+/**
+ * Taps at -1, 0, 1, 2 for each fraction phase, they sum to CUBIC_ONE
+ */
+static void buildCubicTable (int16_t table[CUBIC_PHASES][4]) {
+	int p, i;
+	for (p = 0; p < CUBIC_PHASES; ++p) {
+		double f = (double)p / CUBIC_PHASES;
+		int sum = 0;
+		for (i = 0; i < 4; ++i) {
+			table[p][i] = (int16_t)floor (cubic (i - 1 - f) * CUBIC_ONE + 0.5);
+			sum += table[p][i];
+		}
+		// rounding error goes to the nearest tap
+		table[p][f < 0.5 ? 1 : 2] += CUBIC_ONE - sum;
+	}
+}
+
+static inline int clampIndex (int v, int n) {
+	return v < 0 ? 0 : (v >= n ? n - 1 : v);
+}
+
+static inline uint8_t clampByte (int v) {
+	return v < 0 ? 0 : (v > 255 ? 255 : (uint8_t)v);
+}
+
+/**
+ * Sample src through the inverse rotation, coordinates in 16.16 of
+ * int64, sides of 32768 or more overflow int32
+ */
+static void rotateSample (const Bitmap_t *src, double degree, ResampleFilter filter, Bitmap_t *dst) {
+	const uint8_t *base = (const uint8_t *)src->base;
+	int form = src->form;
+	int sw = src->width;
+	int sh = src->height;
+	int stride = sw * form;
+	int dw = dst->width;
+	int dh = dst->height;
+	uint8_t *out = (uint8_t *)dst->base;
+
+	int16_t table[CUBIC_PHASES][4];
+	if (RESAMPLE_BICUBIC == filter) {
+		buildCubicTable (table);
+	}
+
+	// output pixel center -> source pixel index, rotating back around centers
+	double rad = degree * PI / 180.0;
+	double c = snapZero (cos (rad));
+	double s = snapZero (sin (rad));
+	int64_t dxx = (int64_t)floor (c * COORD_ONE + 0.5);
+	int64_t dxy = (int64_t)floor (-s * COORD_ONE + 0.5);
+
+	// inside when -0.5 <= coordinate <= size - 0.5
+	int64_t minX = -COORD_ONE / 2;
+	int64_t minY = -COORD_ONE / 2;
+	int64_t maxX = (int64_t)sw * COORD_ONE - COORD_ONE / 2;
+	int64_t maxY = (int64_t)sh * COORD_ONE - COORD_ONE / 2;
+
+	int x, y, k, i, j;
+	for (y = 0; y < dh; ++y) {
+		double oy = y + 0.5 - dh / 2.0;
+		double ox = 0.5 - dw / 2.0;
+		int64_t sx = (int64_t)floor ((c * ox + s * oy + sw / 2.0 - 0.5) * COORD_ONE + 0.5);
+		int64_t sy = (int64_t)floor ((-s * ox + c * oy + sh / 2.0 - 0.5) * COORD_ONE + 0.5);
+		for (x = 0; x < dw; ++x, sx += dxx, sy += dxy, out += form) {
+			if (sx < minX || sy < minY || sx > maxX || sy > maxY) {
+				memset (out, 0, form);
+				continue;
+			}
+
+			// arithmetic shift floors negative coordinates
+			int x0 = (int)(sx >> COORD_BITS);
+			int y0 = (int)(sy >> COORD_BITS);
+			int fx = (int)(sx >> (COORD_BITS - 8)) & 0xFF;
+			int fy = (int)(sy >> (COORD_BITS - 8)) & 0xFF;
+
+			if (RESAMPLE_BICUBIC == filter) {
+				const int16_t *wx = table[fx];
+				const int16_t *wy = table[fy];
+				int xs[4];
+				const uint8_t *rows[4];
+				for (i = 0; i < 4; ++i) {
+					xs[i] = clampIndex (x0 - 1 + i, sw) * form;
+					rows[i] = base + (size_t)clampIndex (y0 - 1 + i, sh) * stride;
+				}
+				for (k = 0; k < form; ++k) {
+					int sum = 0;
+					for (j = 0; j < 4; ++j) {
+						const uint8_t *r = rows[j] + k;
+						int row = wx[0] * r[xs[0]] + wx[1] * r[xs[1]]
+							+ wx[2] * r[xs[2]] + wx[3] * r[xs[3]];
+						sum += wy[j] * row;
+					}
+					out[k] = clampByte ((sum + (1 << (2 * CUBIC_BITS - 1))) >> (2 * CUBIC_BITS));
+				}
+			}
+			else {
+				int x1 = clampIndex (x0 + 1, sw) * form;
+				const uint8_t *p0 = base + (size_t)clampIndex (y0, sh) * stride;
+				const uint8_t *p1 = base + (size_t)clampIndex (y0 + 1, sh) * stride;
+				x0 = clampIndex (x0, sw) * form;
+				for (k = 0; k < form; ++k) {
+					int top = p0[x0 + k] * (256 - fx) + p0[x1 + k] * fx;
+					int bottom = p1[x0 + k] * (256 - fx) + p1[x1 + k] * fx;
+					out[k] = (uint8_t)((top * (256 - fy) + bottom * fy + 32768) >> 16);
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Rotate by any angle clockwise around the center
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int rotateImage(const Bitmap_t *src, int degree, ResampleFilter filter, Bitmap_t *dst)
+{
+	if (!isRotatable (src, dst)) {
+		return -1;
+	}
+	if (0 == degree % 90) {
+		uint64_t trace_ns = TRACE_BEGIN ();
+		int retCode = rotateImage90 (src, degree / 90, dst);
+		TRACE_END ("rotateImage90", trace_ns);
+		return retCode;
+	}
+	if (filter != RESAMPLE_BILINEAR && filter != RESAMPLE_BICUBIC) {
+		LogE ("Unsupported rotate filter %d\n", filter);
+		return -1;
+	}
+
+	int w, h;
+	getRotatedSize (src->width, src->height, degree, &w, &h);
+	if (ensureBitmap (dst, w, h, src->form) < 0) {
+		return -1;
+	}
+	uint64_t trace_ns = TRACE_BEGIN ();
+	rotateSample (src, degree % 360, filter, dst);
+	TRACE_END ("rotateImage", trace_ns);
+	return 0;
+}
@@ -0,0 +1,53 @@
+/************************************
+ * file name:   rotate.h
+ * description: rotate image on CPU
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __ROTATE__H__
+#define __ROTATE__H__
+
+#include "imgsdk.h"
+#include "resample.h"
+
+/**
+ * Size of canvas holding the whole image rotated by degree
+ * Parameters:
+ *		width:		image width
+ *		height:		image height
+ *		degree:		clockwise
+ *		outWidth:	[OUT] canvas width
+ *		outHeight:	[OUT] canvas height
+ */
+void getRotatedSize(int width, int height, int degree, int *outWidth, int *outHeight);
+
+/**
+ * Rotate by multiples of 90 degrees, exact & cache blocked
+ * Parameters:
+ *		src:		source image, GRAY, RGB24 or RGBA32
+ *		quarter:	clockwise quarter turns, any integer
+ *		dst:		[OUT] result, dst->base is reused if large enough
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int rotateImage90(const Bitmap_t *src, int quarter, Bitmap_t *dst);
+
+/**
+ * Rotate by any angle clockwise around the center. The canvas grows
+ * to hold the whole image, uncovered pixels are 0.
+ * Multiples of 90 degrees go to rotateImage90.
+ * Parameters:
+ *		src:		source image, GRAY, RGB24 or RGBA32
+ *		degree:		clockwise
+ *		filter:		RESAMPLE_BILINEAR or RESAMPLE_BICUBIC
+ *		dst:		[OUT] result, dst->base is reused if large enough
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int rotateImage(const Bitmap_t *src, int degree, ResampleFilter filter, Bitmap_t *dst);
+
+#endif
@@ -0,0 +1,278 @@
+/***************************************
+ * file name:   skin.c
+ * description: implement skin smoothing
+ *
+ *	Guided filter with p as its own guide, for window k around pixel:
+ *		a_k = var_k / (var_k + eps),  b_k = (1 - a_k) * mean_k
+ *		q   = mean(a) * p + mean(b)
+ *	Every mean is a box filter of running sums: column sums slide
+ *	down one row at a time, and row sums slide across the columns,
+ *	so each costs a few adds per pixel whatever the radius is.
+ *
+ *	The image is cut into strips of rows run on all cores. A strip
+ *	also computes a, b for radius rows above & below it.
+ *
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <malloc.h>
+#include <stdint.h>
+#include <string.h>
+#include "comm.h"
+#include "parallel.h"
+#include "skin.h"
+
+// least rows of a strip
+#define SKIN_STRIP_ROWS 64
+
+// eps = (level * SKIN_SIGMA_STEP) ^ 2, level 100 smooths variations of +-40
+#define SKIN_SIGMA_STEP 0.4f
+
+typedef struct {
+	const uint8_t	*src;
+	uint8_t			*dst;
+	int				width;
+	int				height;
+	int				form;
+	int				channels;	// filtered channels, alpha is copied
+	int				radius;
+	float			eps;
+	int				failed;		// set by strips failed malloc
+} SkinJob;
+
+static inline int maxInt (int a, int b) {
+	return a > b ? a : b;
+}
+
+static inline int minInt (int a, int b) {
+	return a < b ? a : b;
+}
+
+/**
+ * Add (sign 1) or remove (sign -1) a source row from column sums
+ */
+static void slideSource (const SkinJob *job, int y, int sign, int32_t *sum, int32_t *sqr) {
+	const uint8_t *row = job->src + (size_t)y * job->width * job->form;
+	int cn = job->channels;
+	int x, c;
+	for (x = 0; x < job->width; ++x, row += job->form) {
+		for (c = 0; c < cn; ++c) {
+			int v = row[c] * sign;
+			sum[x * cn + c] += v;
+			sqr[x * cn + c] += v * row[c];
+		}
+	}
+}
+
+/**
+ * Add (sign 1) or remove (sign -1) a row of coefficients from column sums
+ */
+static void slideCoef (const float *row, int n, float sign, float *sumA, float *sumB) {
+	int i;
+	for (i = 0; i < n; ++i) {
+		sumA[i] += sign * row[2 * i];
+		sumB[i] += sign * row[2 * i + 1];
+	}
+}
+
+/**
+ * a, b of windows centered in rows [a0, a1), stored interleaved
+ */
+static void solveCoef (const SkinJob *job, int a0, int a1,
+		int32_t *sum, int32_t *sqr, float *coef) {
+	int w = job->width;
+	int h = job->height;
+	int r = job->radius;
+	int cn = job->channels;
+	int n = w * cn;
+	int x, y, c;
+
+	memset (sum, 0, n * sizeof(int32_t));
+	memset (sqr, 0, n * sizeof(int32_t));
+	for (y = maxInt (a0 - r, 0); y <= minInt (a0 + r, h - 1); ++y) {
+		slideSource (job, y, 1, sum, sqr);
+	}
+
+	for (y = a0; y < a1; ++y, coef += 2 * n) {
+		if (y > a0) {
+			if (y + r < h) {
+				slideSource (job, y + r, 1, sum, sqr);
+			}
+			if (y - r - 1 >= 0) {
+				slideSource (job, y - r - 1, -1, sum, sqr);
+			}
+		}
+		int ny = minInt (y + r, h - 1) - maxInt (y - r, 0) + 1;
+
+		int64_t s[4] = { 0, 0, 0, 0 };
+		int64_t ss[4] = { 0, 0, 0, 0 };
+		for (x = 0; x <= minInt (r, w - 1); ++x) {
+			for (c = 0; c < cn; ++c) {
+				s[c] += sum[x * cn + c];
+				ss[c] += sqr[x * cn + c];
+			}
+		}
+		for (x = 0; x < w; ++x) {
+			int nx = minInt (x + r, w - 1) - maxInt (x - r, 0) + 1;
+			float inv = 1.0f / (nx * ny);
+			for (c = 0; c < cn; ++c) {
+				float mean = s[c] * inv;
+				float var = ss[c] * inv - mean * mean;
+				var = var > 0.0f ? var : 0.0f;
+				float a = var / (var + job->eps);
+				coef[2 * (x * cn + c)] = a;
+				coef[2 * (x * cn + c) + 1] = mean - a * mean;
+			}
+			int in = x + r + 1;
+			int out = x - r;
+			for (c = 0; c < cn; ++c) {
+				if (in < w) {
+					s[c] += sum[in * cn + c];
+					ss[c] += sqr[in * cn + c];
+				}
+				if (out >= 0) {
+					s[c] -= sum[out * cn + c];
+					ss[c] -= sqr[out * cn + c];
+				}
+			}
+		}
+	}
+}
+
+/**
+ * q = mean(a) * p + mean(b) of rows [y0, y1), coef holds rows from a0
+ */
+static void applyCoef (const SkinJob *job, int y0, int y1, int a0,
+		const float *coef, float *sumA, float *sumB) {
+	int w = job->width;
+	int h = job->height;
+	int r = job->radius;
+	int cn = job->channels;
+	int form = job->form;
+	int n = w * cn;
+	int x, y, c;
+
+	memset (sumA, 0, n * sizeof(float));
+	memset (sumB, 0, n * sizeof(float));
+	for (y = maxInt (y0 - r, 0); y <= minInt (y0 + r, h - 1); ++y) {
+		slideCoef (coef + (size_t)(y - a0) * 2 * n, n, 1.0f, sumA, sumB);
+	}
+
+	for (y = y0; y < y1; ++y) {
+		if (y > y0) {
+			if (y + r < h) {
+				slideCoef (coef + (size_t)(y + r - a0) * 2 * n, n, 1.0f, sumA, sumB);
+			}
+			if (y - r - 1 >= 0) {
+				slideCoef (coef + (size_t)(y - r - 1 - a0) * 2 * n, n, -1.0f, sumA, sumB);
+			}
+		}
+		int ny = minInt (y + r, h - 1) - maxInt (y - r, 0) + 1;
+
+		const uint8_t *in = job->src + (size_t)y * w * form;
+		uint8_t *out = job->dst + (size_t)y * w * form;
+		double sa[4] = { 0, 0, 0, 0 };
+		double sb[4] = { 0, 0, 0, 0 };
+		for (x = 0; x <= minInt (r, w - 1); ++x) {
+			for (c = 0; c < cn; ++c) {
+				sa[c] += sumA[x * cn + c];
+				sb[c] += sumB[x * cn + c];
+			}
+		}
+		for (x = 0; x < w; ++x, in += form, out += form) {
+			int nx = minInt (x + r, w - 1) - maxInt (x - r, 0) + 1;
+			double inv = 1.0 / (nx * ny);
+			for (c = 0; c < cn; ++c) {
+				double q = (sa[c] * in[c] + sb[c]) * inv;
+				out[c] = q <= 0.0 ? 0 : (q >= 255.0 ? 255 : (uint8_t)(q + 0.5));
+			}
+			if (cn < form) {
+				out[cn] = in[cn];
+			}
+			int add = x + r + 1;
+			int sub = x - r;
+			for (c = 0; c < cn; ++c) {
+				if (add < w) {
+					sa[c] += sumA[add * cn + c];
+					sb[c] += sumB[add * cn + c];
+				}
+				if (sub >= 0) {
+					sa[c] -= sumA[sub * cn + c];
+					sb[c] -= sumB[sub * cn + c];
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Guided filter of rows [y0, y1)
+ */
+static void smoothStrip (void *arg, int y0, int y1) {
+	SkinJob *job = (SkinJob *)arg;
+	int n = job->width * job->channels;
+	int a0 = maxInt (y0 - job->radius, 0);
+	int a1 = minInt (y1 + job->radius, job->height);
+
+	float *coef = (float *)malloc ((size_t)(a1 - a0) * 2 * n * sizeof(float));
+	int32_t *sums = (int32_t *)malloc (2 * n * sizeof(int32_t));
+	float *sumsF = (float *)malloc (2 * n * sizeof(float));
+	if (NULL == coef || NULL == sums || NULL == sumsF) {
+		LogE ("Failed malloc skin strip\n");
+		__atomic_store_n (&job->failed, 1, __ATOMIC_RELAXED);
+	} else {
+		solveCoef (job, a0, a1, sums, sums + n, coef);
+		applyCoef (job, y0, y1, a0, coef, sumsF, sumsF + n);
+	}
+	free (coef);
+	free (sums);
+	free (sumsF);
+}
+
+/**
+ * Smooth skin with edge-preserving guided filter
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int smoothSkin (const Bitmap_t *src, int radius, int level, Bitmap_t *dst)
+{
+	if (NULL == src || NULL == src->base || NULL == dst || src == dst ||
+			src->width <= 0 || src->height <= 0 ||
+			radius < SKIN_MIN_RADIUS || radius > SKIN_MAX_RADIUS ||
+			level < 0 || level > 100) {
+		return -1;
+	}
+	int form = src->form;
+	if (form != GRAY && form != RGB24 && form != RGBA32) {
+		LogE ("Unsupported pixel format %d in skin\n", form);
+		return -1;
+	}
+	if (ensureBitmap (dst, src->width, src->height, form) < 0) {
+		return -1;
+	}
+	if (0 == level) {
+		memcpy (dst->base, src->base, src->width * src->height * form);
+		return 0;
+	}
+
+	SkinJob job;
+	job.src = (const uint8_t *)src->base;
+	job.dst = (uint8_t *)dst->base;
+	job.width = src->width;
+	job.height = src->height;
+	job.form = form;
+	job.channels = RGBA32 == form ? 3 : form;
+	job.radius = radius;
+	job.eps = (level * SKIN_SIGMA_STEP) * (level * SKIN_SIGMA_STEP);
+	job.failed = 0;
+
+	// strips of 4 radius rows at least, a, b are solved for 1.5x rows
+	int grain = maxInt (SKIN_STRIP_ROWS, 4 * radius);
+	uint64_t trace_ns = TRACE_BEGIN ();
+	int retCode = parallelFor (src->height, grain, smoothStrip, &job);
+	TRACE_END ("smoothSkin", trace_ns);
+	return retCode < 0 || job.failed ? -1 : 0;
+}
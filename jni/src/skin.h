@@ -0,0 +1,37 @@
+/************************************
+ * file name:   skin.h
+ * description: skin smoothing effect
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __SKIN__H__
+#define __SKIN__H__
+
+#include "imgsdk.h"
+
+// radius range of skin smoothing
+#define SKIN_MIN_RADIUS 1
+#define SKIN_MAX_RADIUS 100
+
+// defaults of skin cmd
+#define SKIN_DEFAULT_RADIUS 8
+#define SKIN_DEFAULT_LEVEL 50
+
+/**
+ * Smooth skin with edge-preserving guided filter, every channel is
+ * its own guide. Flat areas (variance << eps) are averaged, edges
+ * (variance >> eps) are kept. The cost doesn't depend on radius.
+ * Parameters:
+ *		src:		source image, GRAY, RGB24 or RGBA32, alpha is kept
+ *		radius:		window radius, SKIN_MIN_RADIUS - SKIN_MAX_RADIUS
+ *		level:		smoothing strength 0 - 100
+ *		dst:		[OUT] result, dst->base is reused if large enough
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int smoothSkin (const Bitmap_t *src, int radius, int level, Bitmap_t *dst);
+
+#endif
@@ -0,0 +1,108 @@
+/************************************
+ * file name:   spscq.c
+ * description: implement lock-free spsc queue
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#include <malloc.h>
+#include <sched.h>
+#include <time.h>
+#include "spscq.h"
+
+#define SPIN_LIMIT  64
+#define YIELD_LIMIT 128
+#define SLEEP_NS    100000
+
+/*
+ * Create a queue
+ * Return:
+ *		NULL if ERROR
+ */
+spscq_t* newSpscq (int cap)
+{
+	if (cap <= 0) {
+		return NULL;
+	}
+
+	unsigned int size = 1;
+	while (size < (unsigned int)cap) {
+		size <<= 1;
+	}
+
+	spscq_t *q = (spscq_t *)calloc (1, sizeof(spscq_t));
+	if (NULL == q) {
+		return NULL;
+	}
+	q->slots = (void **)calloc (size, sizeof(void *));
+	if (NULL == q->slots) {
+		free (q);
+		return NULL;
+	}
+	q->mask = size - 1;
+	return q;
+}
+
+/*
+ * Release the queue
+ */
+void freeSpscq (spscq_t *q)
+{
+	if (NULL != q) {
+		if (NULL != q->slots) {
+			free (q->slots);
+		}
+		free (q);
+	}
+}
+
+/*
+ * Push item, only called by producer
+ */
+bool pushSpscq (spscq_t *q, void *item)
+{
+	unsigned int tail = __atomic_load_n (&q->tail, __ATOMIC_RELAXED);
+	unsigned int head = __atomic_load_n (&q->head, __ATOMIC_ACQUIRE);
+	if (tail - head > q->mask) {
+		return false;
+	}
+	q->slots[tail & q->mask] = item;
+	__atomic_store_n (&q->tail, tail + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+/*
+ * Pop item, only called by consumer
+ */
+void* popSpscq (spscq_t *q)
+{
+	unsigned int head = __atomic_load_n (&q->head, __ATOMIC_RELAXED);
+	unsigned int tail = __atomic_load_n (&q->tail, __ATOMIC_ACQUIRE);
+	if (head == tail) {
+		return NULL;
+	}
+	void *item = q->slots[head & q->mask];
+	__atomic_store_n (&q->head, head + 1, __ATOMIC_RELEASE);
+	return item;
+}
+
+/*
+ * Wait strategy while the queue is full or empty
+ */
+void backoffSpscq (int *spins)
+{
+	if (*spins < SPIN_LIMIT) {
+		++(*spins);
+		return;
+	}
+
+	if (*spins < YIELD_LIMIT) {
+		++(*spins);
+		sched_yield ();
+		return;
+	}
+
+	struct timespec ts = { 0, SLEEP_NS };
+	nanosleep (&ts, NULL);
+}
@@ -0,0 +1,68 @@
+/************************************
+ * file name:   spscq.h
+ * description: bounded single-producer single-consumer
+ *				lock-free queue
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __SPSCQ__H__
+#define __SPSCQ__H__
+
+#include "comm.h"
+
+// keep producer & consumer index in different cache lines
+#define SPSCQ_CACHE_LINE 64
+
+/**
+ * Exactly one thread may push and exactly one thread may pop
+ */
+typedef struct {
+	void			**slots;
+	unsigned int	mask;			// capability - 1
+	char			pad0[SPSCQ_CACHE_LINE];
+	unsigned int	head;			// next slot to pop, written by consumer
+	char			pad1[SPSCQ_CACHE_LINE];
+	unsigned int	tail;			// next slot to push, written by producer
+	char			pad2[SPSCQ_CACHE_LINE];
+} spscq_t;
+
+/*
+ * Create a queue
+ * Parameters:
+ *		cap:	capability, round up to power of 2
+ * Return:
+ *		NULL if ERROR
+ */
+spscq_t* newSpscq (int cap);
+
+/*
+ * Release the queue. The items left are not released
+ */
+void freeSpscq (spscq_t *q);
+
+/*
+ * Push item, only called by producer
+ * Return:
+ *		true  OK
+ *		false the queue is full
+ */
+bool pushSpscq (spscq_t *q, void *item);
+
+/*
+ * Pop item, only called by consumer
+ * Return:
+ *		NULL if the queue is empty
+ */
+void* popSpscq (spscq_t *q);
+
+/*
+ * Wait strategy while the queue is full or empty:
+ * spin first, then yield, then sleep
+ * Parameters:
+ *		spins:	[IN/OUT] times waited, reset to 0 after success
+ */
+void backoffSpscq (int *spins);
+
+#endif
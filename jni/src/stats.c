@@ -0,0 +1,188 @@
+/***************************************
+ * file name:   stats.c
+ * description: implement timers & counters of sdk stages
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+static const char *sStageNames[STAGE_END] = {
+	"init", "decode", "upload", "effect",
+	"render", "readback", "encode", "io"
+};
+
+static const char *sCounterNames[COUNTER_END] = {
+	"images", "failures", "bytesRead", "bytesDecoded",
+	"bytesUploaded", "bytesReadback", "bytesEncoded", "allocs"
+};
+
+/**
+ * Monotonic clock in nanoseconds
+ */
+uint64_t getNanoTime (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Clear stats
+ */
+void resetStats (SdkStats_t *stats)
+{
+	if (NULL == stats) {
+		return;
+	}
+	memset (stats, 0, sizeof(SdkStats_t));
+	int i;
+	for (i = 0; i < STAGE_END; ++i) {
+		stats->stages[i].minNs = UINT64_MAX;
+	}
+}
+
+static int bucketOf (uint64_t ns) {
+	uint64_t us = ns / 1000;
+	int k = 0;
+	while (us > 1 && k < STATS_HIST_BUCKETS - 1) {
+		us >>= 1;
+		++k;
+	}
+	return k;
+}
+
+/**
+ * Add a sample of stage
+ */
+void addStageTime (SdkStats_t *stats, StatStage_e stage, uint64_t ns)
+{
+	if (NULL == stats || stage < 0 || stage >= STAGE_END) {
+		return;
+	}
+	StageStats_t *s = &stats->stages[stage];
+	__atomic_fetch_add (&s->count, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add (&s->totalNs, ns, __ATOMIC_RELAXED);
+	__atomic_fetch_add (&s->hist[bucketOf (ns)], 1, __ATOMIC_RELAXED);
+
+	uint64_t cur = __atomic_load_n (&s->minNs, __ATOMIC_RELAXED);
+	while (ns < cur && !__atomic_compare_exchange_n (&s->minNs, &cur, ns,
+				true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	}
+	cur = __atomic_load_n (&s->maxNs, __ATOMIC_RELAXED);
+	while (ns > cur && !__atomic_compare_exchange_n (&s->maxNs, &cur, ns,
+				true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	}
+}
+
+/**
+ * Add a sample of stage from beginNs to now
+ */
+uint64_t endStage (SdkStats_t *stats, StatStage_e stage, uint64_t beginNs)
+{
+	uint64_t ns = getNanoTime () - beginNs;
+	addStageTime (stats, stage, ns);
+	return ns;
+}
+
+/**
+ * Add n to counter
+ */
+void addCounter (SdkStats_t *stats, StatCounter_e counter, int64_t n)
+{
+	if (NULL == stats || counter < 0 || counter >= COUNTER_END) {
+		return;
+	}
+	__atomic_fetch_add (&stats->counters[counter], n, __ATOMIC_RELAXED);
+}
+
+/**
+ * Snapshot of stats being updated
+ */
+void copyStats (const SdkStats_t *stats, SdkStats_t *out)
+{
+	if (NULL == stats || NULL == out) {
+		return;
+	}
+	int i, k;
+	for (i = 0; i < STAGE_END; ++i) {
+		const StageStats_t *s = &stats->stages[i];
+		StageStats_t *d = &out->stages[i];
+		d->count = __atomic_load_n (&s->count, __ATOMIC_RELAXED);
+		d->totalNs = __atomic_load_n (&s->totalNs, __ATOMIC_RELAXED);
+		d->minNs = __atomic_load_n (&s->minNs, __ATOMIC_RELAXED);
+		d->maxNs = __atomic_load_n (&s->maxNs, __ATOMIC_RELAXED);
+		for (k = 0; k < STATS_HIST_BUCKETS; ++k) {
+			d->hist[k] = __atomic_load_n (&s->hist[k], __ATOMIC_RELAXED);
+		}
+	}
+	for (i = 0; i < COUNTER_END; ++i) {
+		out->counters[i] = __atomic_load_n (&stats->counters[i], __ATOMIC_RELAXED);
+	}
+}
+
+const char* getStageName (StatStage_e stage)
+{
+	return stage >= 0 && stage < STAGE_END ? sStageNames[stage] : NULL;
+}
+
+const char* getCounterName (StatCounter_e counter)
+{
+	return counter >= 0 && counter < COUNTER_END ? sCounterNames[counter] : NULL;
+}
+
+/**
+ * Format stats as JSON
+ * Return:
+ *		length of text
+ *		-1 ERROR
+ */
+int formatStats (const SdkStats_t *stats, char *buf, int size)
+{
+	if (NULL == stats || NULL == buf || size <= 0) {
+		return -1;
+	}
+
+	SdkStats_t snap;
+	copyStats (stats, &snap);
+
+	// snprintf returns the length wanted, stop once it doesn't fit
+	int len = 0;
+#define APPEND(...) do { \
+		int n = snprintf (buf + len, size - len, __VA_ARGS__); \
+		if (n < 0 || n >= size - len) { \
+			buf[0] = '\0'; \
+			return -1; \
+		} \
+		len += n; \
+	} while (0)
+
+	APPEND ("{\"stages\":{");
+	int i, k;
+	for (i = 0; i < STAGE_END; ++i) {
+		const StageStats_t *s = &snap.stages[i];
+		APPEND ("%s\"%s\":{\"count\":%llu,\"totalNs\":%llu,\"minNs\":%llu,\"maxNs\":%llu,\"hist\":[",
+				i > 0 ? "," : "", sStageNames[i],
+				(unsigned long long)s->count, (unsigned long long)s->totalNs,
+				(unsigned long long)(s->count > 0 ? s->minNs : 0),
+				(unsigned long long)s->maxNs);
+		for (k = 0; k < STATS_HIST_BUCKETS; ++k) {
+			APPEND ("%s%u", k > 0 ? "," : "", s->hist[k]);
+		}
+		APPEND ("]}");
+	}
+	APPEND ("},\"counters\":{");
+	for (i = 0; i < COUNTER_END; ++i) {
+		APPEND ("%s\"%s\":%lld", i > 0 ? "," : "", sCounterNames[i],
+				(long long)snap.counters[i]);
+	}
+	APPEND ("}}");
+#undef APPEND
+
+	return len;
+}
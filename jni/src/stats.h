@@ -0,0 +1,122 @@
+/************************************
+ * file name:   stats.h
+ * description: timers & counters of sdk stages
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __STATS__H__
+#define __STATS__H__
+
+#include <stdint.h>
+
+// latency histogram, bucket k counts [2^k, 2^(k+1)) us, the last one
+// everything longer
+#define STATS_HIST_BUCKETS 24
+
+// buffer large enough for formatStats
+#define STATS_JSON_SIZE 8192
+
+/**
+ * Timed stages of processing an image
+ */
+typedef enum {
+	STAGE_INIT = 0,		// EGL & shader setup
+	STAGE_DECODE,		// file to pixels, splitting the clip to decode
+	STAGE_UPLOAD,		// pixels to texture
+	STAGE_EFFECT,		// effect plan on CPU & GPU pre-passes
+	STAGE_RENDER,		// shader pass to glFinish
+	STAGE_READBACK,		// glReadPixels & conversion
+	STAGE_ENCODE,		// pixels to file
+	STAGE_IO,			// plain file & asset reads
+	STAGE_END
+} StatStage_e;
+
+/**
+ * Counters
+ */
+typedef enum {
+	COUNTER_IMAGES = 0,			// images processed
+	COUNTER_FAILURES,			// images failed
+	COUNTER_BYTES_READ,			// bytes of files & assets read
+	COUNTER_BYTES_DECODED,		// pixel bytes decoded
+	COUNTER_BYTES_UPLOADED,		// pixel bytes to GPU
+	COUNTER_BYTES_READBACK,		// pixel bytes from GPU
+	COUNTER_BYTES_ENCODED,		// pixel bytes encoded
+	COUNTER_ALLOCS,				// buffers (re)allocated
+	COUNTER_END
+} StatCounter_e;
+
+typedef struct {
+	uint64_t	count;							// samples
+	uint64_t	totalNs;						// sum of samples
+	uint64_t	minNs;							// UINT64_MAX if no sample
+	uint64_t	maxNs;
+	uint32_t	hist[STATS_HIST_BUCKETS];		// samples by latency
+} StageStats_t;
+
+/**
+ * All fields are updated atomically, so any thread may add to the
+ * same stats. Read them by copyStats.
+ */
+typedef struct {
+	StageStats_t	stages[STAGE_END];
+	int64_t			counters[COUNTER_END];
+} SdkStats_t;
+
+/**
+ * Monotonic clock in nanoseconds
+ */
+uint64_t getNanoTime (void);
+
+/**
+ * Clear stats, not thread safe against adding
+ */
+void resetStats (SdkStats_t *stats);
+
+/**
+ * Add a sample of stage
+ * Parameters:
+ *		stats:	may be NULL to count nothing
+ *		ns:		duration in nanoseconds
+ */
+void addStageTime (SdkStats_t *stats, StatStage_e stage, uint64_t ns);
+
+/**
+ * Add a sample of stage from beginNs of getNanoTime to now
+ * Return:
+ *		the duration in nanoseconds
+ */
+uint64_t endStage (SdkStats_t *stats, StatStage_e stage, uint64_t beginNs);
+
+/**
+ * Add n to counter, stats may be NULL
+ */
+void addCounter (SdkStats_t *stats, StatCounter_e counter, int64_t n);
+
+/**
+ * Snapshot of stats being updated
+ */
+void copyStats (const SdkStats_t *stats, SdkStats_t *out);
+
+/**
+ * Name of stage or counter such as "decode", "bytesRead"
+ */
+const char* getStageName (StatStage_e stage);
+const char* getCounterName (StatCounter_e counter);
+
+/**
+ * Format stats as JSON:
+ *	{"stages":{"decode":{"count":1,"totalNs":..,"minNs":..,"maxNs":..,
+ *		"hist":[..]},..},"counters":{"images":1,..}}
+ * Parameters:
+ *		buf:	[OUT] text, '\0' terminated
+ *		size:	size of buf
+ * Return:
+ *		length of text
+ *		-1 ERROR, e.g. buf is too small
+ */
+int formatStats (const SdkStats_t *stats, char *buf, int size);
+
+#endif
@@ -0,0 +1,142 @@
+/************************************
+ * file name:   texpool.c
+ * description: implement texture pool
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#include <malloc.h>
+#include <string.h>
+#include "texpool.h"
+
+struct TexPool {
+	PoolTex_t	*entries;
+	int			capability;
+	uint32_t	tick;
+};
+
+/*
+ * Create a texture pool
+ * Return:
+ *		NULL if ERROR
+ */
+TexPool* newTexPool (int cap)
+{
+	if (cap < TEX_ROLE_END) {
+		return NULL;
+	}
+
+	TexPool *pool = (TexPool *)calloc (1, sizeof(TexPool));
+	if (NULL == pool) {
+		return NULL;
+	}
+	pool->entries = (PoolTex_t *)calloc (cap, sizeof(PoolTex_t));
+	if (NULL == pool->entries) {
+		free (pool);
+		return NULL;
+	}
+	pool->capability = cap;
+	return pool;
+}
+
+static void releaseEntry (PoolTex_t *entry) {
+	if (0 != entry->fbo) {
+		glDeleteFramebuffers (1, &entry->fbo);
+	}
+	if (0 != entry->texture) {
+		glDeleteTextures (1, &entry->texture);
+	}
+	memset (entry, 0, sizeof(PoolTex_t));
+}
+
+/*
+ * Delete the textures & framebuffers
+ */
+void freeTexPool (TexPool *pool)
+{
+	if (NULL == pool) {
+		return;
+	}
+	int i;
+	for (i = 0; i < pool->capability; ++i) {
+		releaseEntry (&pool->entries[i]);
+	}
+	free (pool->entries);
+	free (pool);
+}
+
+static int createEntry (PoolTex_t *entry, TexRole role, GLsizei width, GLsizei height, GLenum format) {
+	entry->role = role;
+	entry->width = width;
+	entry->height = height;
+	entry->format = format;
+
+	glGenTextures (1, &entry->texture);
+	glBindTexture (GL_TEXTURE_2D, entry->texture);
+	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	uint64_t trace_ns = TRACE_BEGIN ();
+	glTexImage2D (GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, NULL);
+	TRACE_END ("glTexImage2D", trace_ns);
+	GLenum errCode = glGetError ();
+	if (GL_NO_ERROR != errCode) {
+		LogE ("Failed glTexImage2D %dx%d, error code:0x%04x\n", width, height, errCode);
+		releaseEntry (entry);
+		return -1;
+	}
+
+	if (TEX_INPUT != role) {
+		GLint prevFbo = 0;
+		glGetIntegerv (GL_FRAMEBUFFER_BINDING, &prevFbo);
+		glGenFramebuffers (1, &entry->fbo);
+		glBindFramebuffer (GL_FRAMEBUFFER, entry->fbo);
+		glFramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, entry->texture, 0);
+		entry->status = glCheckFramebufferStatus (GL_FRAMEBUFFER);
+		glBindFramebuffer (GL_FRAMEBUFFER, prevFbo);
+		if (GL_FRAMEBUFFER_COMPLETE != entry->status) {
+			LogE ("Framebuffer not ready. status code:0x%04x\n", entry->status);
+		}
+	}
+	return 0;
+}
+
+/*
+ * Get the texture of role, size & format
+ * Return:
+ *		NULL if ERROR
+ */
+PoolTex_t* acquireTexture (TexPool *pool, TexRole role, GLsizei width, GLsizei height, GLenum format)
+{
+	if (NULL == pool || role < 0 || role >= TEX_ROLE_END || width <= 0 || height <= 0) {
+		return NULL;
+	}
+	++pool->tick;
+
+	PoolTex_t *victim = NULL;
+	int i;
+	for (i = 0; i < pool->capability; ++i) {
+		PoolTex_t *entry = &pool->entries[i];
+		if (0 != entry->texture && entry->role == role && entry->width == width &&
+				entry->height == height && entry->format == format) {
+			entry->lastUse = pool->tick;
+			entry->fresh = false;
+			glBindTexture (GL_TEXTURE_2D, entry->texture);
+			return entry;
+		}
+		if (NULL == victim || 0 == entry->texture ||
+				(0 != victim->texture && entry->lastUse < victim->lastUse)) {
+			victim = entry;
+		}
+	}
+
+	releaseEntry (victim);
+	if (createEntry (victim, role, width, height, format) < 0) {
+		return NULL;
+	}
+	victim->lastUse = pool->tick;
+	victim->fresh = true;
+	return victim;
+}
@@ -0,0 +1,74 @@
+/************************************
+ * file name:   texpool.h
+ * description: pool of textures & framebuffers kept between images
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***********************************/
+
+#ifndef __TEXPOOL__H__
+#define __TEXPOOL__H__
+
+#include <stdint.h>
+#include <GLES2/gl2.h>
+#include "comm.h"
+
+// default count of textures kept, input, target & LUT of 2 sizes
+#define TEX_POOL_CAPABILITY 6
+
+/**
+ * Use of a texture, a frame takes one texture of every role it needs
+ */
+typedef enum {
+	TEX_INPUT = 0,		// image uploaded for rendering
+	TEX_TARGET,			// render target to read back
+	TEX_LUT,			// output of the GPU LUT pass
+	TEX_ROLE_END
+} TexRole;
+
+/**
+ * Texture of the pool. Render targets have their framebuffer
+ * attached & checked once at creating.
+ */
+typedef struct {
+	TexRole		role;
+	GLsizei		width;
+	GLsizei		height;
+	GLenum		format;		// GL_LUMINANCE, GL_RGB or GL_RGBA
+	GLuint		texture;	// 0 means empty
+	GLuint		fbo;		// framebuffer of render target, 0 for input
+	GLenum		status;		// glCheckFramebufferStatus of fbo
+	bool		fresh;		// storage created by the last acquire
+	uint32_t	lastUse;	// tick of the last acquire
+} PoolTex_t;
+
+struct TexPool;
+typedef struct TexPool TexPool;
+
+/*
+ * Create a texture pool, GL objects are created on demand in the
+ * context current then
+ * Parameters:
+ *		cap:	max textures kept, the least recently used one is deleted
+ * Return:
+ *		NULL if ERROR
+ */
+TexPool* newTexPool (int cap);
+
+/*
+ * Delete the textures & framebuffers, the context creating them
+ * must be current
+ */
+void freeTexPool (TexPool *pool);
+
+/*
+ * Get the texture of role, size & format. Storage is allocated by
+ * glTexImage2D only when no texture matches, otherwise upload pixels
+ * by glTexSubImage2D. The texture is bound to GL_TEXTURE_2D.
+ * Return:
+ *		NULL if ERROR. The texture is valid until cap other
+ *		textures are acquired
+ */
+PoolTex_t* acquireTexture (TexPool *pool, TexRole role, GLsizei width, GLsizei height, GLenum format);
+
+#endif
@@ -0,0 +1,174 @@
+/***************************************
+ * file name:   tiler.c
+ * description: implement tiles of images beyond the texture size
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <math.h>
+#include <string.h>
+#include "tiler.h"
+
+/**
+ * Size of tiles along an axis, source pixels per output pixel is
+ * 2 * |scale| as clip coordinates span 2 over the image
+ */
+static int planAxis (int size, int maxSize, double scale, int *tileSize, int *srcSize) {
+	double k = 2.0 * fabs (scale);
+	int margin = 2 * TILE_HALO + 2;
+	int tile = size < maxSize ? size : maxSize;
+	if ((int)ceil (tile * k) + margin > maxSize) {
+		tile = (int)((maxSize - margin) / k);
+	}
+	if (tile <= 0) {
+		return -1;
+	}
+	int src = (int)ceil (tile * k) + margin;
+	*tileSize = tile;
+	*srcSize = src < size ? src : size;
+	return 0;
+}
+
+/**
+ * Plan tiles of width x height no larger than maxSize
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int initTiler (Tiler_t *tiler, int width, int height, int maxSize,
+		const float *quad, const float *texCoord)
+{
+	if (NULL == tiler || NULL == quad || NULL == texCoord ||
+			width <= 0 || height <= 0 || maxSize <= 0) {
+		return -1;
+	}
+
+	int i;
+	for (i = 0; i < 2; ++i) {
+		double span = (double)quad[4 + i] - quad[i];
+		if (0 == span) {
+			LogE ("Degenerated quad\n");
+			return -1;
+		}
+		tiler->scale[i] = (texCoord[4 + i] - texCoord[i]) / span;
+		tiler->offset[i] = texCoord[i] - tiler->scale[i] * quad[i];
+	}
+
+	if (planAxis (width, maxSize, tiler->scale[0], &tiler->tileWidth, &tiler->srcWidth) < 0 ||
+			planAxis (height, maxSize, tiler->scale[1], &tiler->tileHeight, &tiler->srcHeight) < 0) {
+		LogE ("No tile of %dx%d fits %d\n", width, height, maxSize);
+		return -1;
+	}
+
+	tiler->width = width;
+	tiler->height = height;
+	tiler->cols = (width + tiler->tileWidth - 1) / tiler->tileWidth;
+	tiler->rows = (height + tiler->tileHeight - 1) / tiler->tileHeight;
+	memcpy (tiler->quad, quad, sizeof(tiler->quad));
+	memcpy (tiler->texCoord, texCoord, sizeof(tiler->texCoord));
+	return 0;
+}
+
+/**
+ * Count of tiles
+ */
+int getTileCount (const Tiler_t *tiler)
+{
+	return NULL == tiler ? 0 : tiler->cols * tiler->rows;
+}
+
+/**
+ * Place a tile along an axis
+ * Parameters:
+ *		axis:	0 for x, 1 for y
+ *		pos:	first output pixel of the tile
+ *		len:	output pixels of the tile
+ *		size:	image size along axis
+ *		srcPos:	[OUT] first source pixel
+ *		srcLen:	[OUT] source pixels
+ */
+static void placeAxis (const Tiler_t *tiler, int axis, int pos, int len, int size,
+		int srcSize, int *srcPos, int *srcLen, float *quad, float *texCoord) {
+	// clip range of the tile & the part of quad in it
+	double n0 = 2.0 * pos / size - 1.0;
+	double n1 = 2.0 * (pos + len) / size - 1.0;
+	double q0 = tiler->quad[axis];
+	double q1 = tiler->quad[4 + axis];
+	double lo = q0 < q1 ? q0 : q1;
+	double hi = q0 < q1 ? q1 : q0;
+	lo = lo > n0 ? lo : n0;
+	hi = hi < n1 ? hi : n1;
+	if (lo > hi) {
+		// quad misses the tile, any source will do
+		lo = hi = n0;
+	}
+
+	double u0 = (tiler->scale[axis] * lo + tiler->offset[axis]) * size;
+	double u1 = (tiler->scale[axis] * hi + tiler->offset[axis]) * size;
+	int first = (int)floor (u0 < u1 ? u0 : u1) - TILE_HALO;
+	int last = (int)ceil (u0 < u1 ? u1 : u0) + TILE_HALO;
+	first = first < 0 ? 0 : (first > size - 1 ? size - 1 : first);
+	last = last > size ? size : (last <= first ? first + 1 : last);
+	if (last - first > srcSize) {
+		last = first + srcSize;
+	}
+	*srcPos = first;
+	*srcLen = last - first;
+
+	int i;
+	for (i = 0; i < 4; ++i) {
+		double c = tiler->quad[2 * i + axis];
+		double t = tiler->texCoord[2 * i + axis];
+		quad[2 * i + axis] = (float)((c - n0) * 2.0 / (n1 - n0) - 1.0);
+		texCoord[2 * i + axis] = (float)((t * size - first) / srcSize);
+	}
+}
+
+/**
+ * Get the tile of index in row-major order
+ */
+void getTile (const Tiler_t *tiler, int index, Tile_t *tile)
+{
+	if (NULL == tiler || NULL == tile) {
+		return;
+	}
+	Rect_t *out = &tile->out;
+	out->x = index % tiler->cols * tiler->tileWidth;
+	out->y = index / tiler->cols * tiler->tileHeight;
+	out->width = tiler->width - out->x < tiler->tileWidth ? tiler->width - out->x : tiler->tileWidth;
+	out->height = tiler->height - out->y < tiler->tileHeight ? tiler->height - out->y : tiler->tileHeight;
+
+	placeAxis (tiler, 0, out->x, out->width, tiler->width, tiler->srcWidth,
+			&tile->src.x, &tile->src.width, tile->quad, tile->texCoord);
+	placeAxis (tiler, 1, out->y, out->height, tiler->height, tiler->srcHeight,
+			&tile->src.y, &tile->src.height, tile->quad, tile->texCoord);
+}
+
+/**
+ * Copy src of img to dst packed, repeating edge pixels once
+ */
+void copyTileSource (const Tiler_t *tiler, const Bitmap_t *img,
+		const Rect_t *src, char *dst, int *width, int *height)
+{
+	int form = img->form;
+	int cols = src->width + (src->width < tiler->srcWidth ? 1 : 0);
+	int rows = src->height + (src->height < tiler->srcHeight ? 1 : 0);
+	int lastCol = src->x + src->width - 1;
+	int lastRow = src->y + src->height - 1;
+	size_t stride = (size_t)cols * form;
+
+	int y;
+	for (y = 0; y < rows; ++y) {
+		int row = src->y + y < lastRow ? src->y + y : lastRow;
+		const char *line = img->base + ((size_t)row * img->width + src->x) * form;
+		char *out = dst + y * stride;
+		memcpy (out, line, (size_t)src->width * form);
+		if (cols > src->width) {
+			memcpy (out + (size_t)src->width * form,
+					img->base + ((size_t)row * img->width + lastCol) * form, form);
+		}
+	}
+	*width = cols;
+	*height = rows;
+}
@@ -0,0 +1,86 @@
+/************************************
+ * file name:   tiler.h
+ * description: split images beyond the texture size into tiles
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ * The output is cut into tiles of at most tileWidth x tileHeight.
+ * Every tile renders the image quad moved & scaled to its viewport,
+ * sampling a source rect of the image that covers the tile plus a
+ * halo, so bilinear filtering across tile edges matches rendering
+ * the image whole. Sources of all tiles fit srcWidth x srcHeight, so
+ * a frame needs the same few textures whatever the image size.
+ *
+ ***********************************/
+
+#ifndef __TILER__H__
+#define __TILER__H__
+
+#include "imgsdk.h"
+
+// pixels around the source of a tile, bilinear sampling reads 1
+#define TILE_HALO 2
+
+// largest side rendered whole unless set by setTileSize
+#define TILE_MAX_SIZE 4096
+
+/**
+ * Grid of tiles over an image. The quad is in clip coordinates with
+ * x & y of 4 vertices, vertex 0 & 2 are opposite corners.
+ */
+typedef struct {
+	int width;			// image width, output & source alike
+	int height;			// image height
+	int tileWidth;		// output tile size, tiles of last col & row are smaller
+	int tileHeight;
+	int srcWidth;		// texture size holding the source of any tile
+	int srcHeight;
+	int cols;			// tiles per row
+	int rows;			// rows of tiles
+	float quad[8];		// image quad, x & y per vertex
+	float texCoord[8];	// texture coordinates of quad
+	double scale[2];	// texture coordinate = clip * scale + offset
+	double offset[2];
+} Tiler_t;
+
+/**
+ * A tile of Tiler_t
+ */
+typedef struct {
+	Rect_t out;			// region of output image
+	Rect_t src;			// region of source image, halo included
+	float quad[8];		// image quad in clip coordinates of the tile
+	float texCoord[8];	// texture coordinates of quad in the tile source
+} Tile_t;
+
+/**
+ * Plan tiles of width x height no larger than maxSize
+ * Return:
+ *		 0 OK
+ *		-1 ERROR
+ */
+int initTiler (Tiler_t *tiler, int width, int height, int maxSize,
+		const float *quad, const float *texCoord);
+
+/**
+ * Count of tiles
+ */
+int getTileCount (const Tiler_t *tiler);
+
+/**
+ * Get the tile of index in row-major order
+ */
+void getTile (const Tiler_t *tiler, int index, Tile_t *tile);
+
+/**
+ * Copy src of img to dst packed. Edge pixels of img are repeated one
+ * past src where the texture has room, as clamp to edge reads them.
+ * Parameters:
+ *		dst:		holds (srcWidth + 1) * (srcHeight + 1) * form
+ *		width:		[OUT] columns copied
+ *		height:		[OUT] rows copied
+ */
+void copyTileSource (const Tiler_t *tiler, const Bitmap_t *img,
+		const Rect_t *src, char *dst, int *width, int *height);
+
+#endif
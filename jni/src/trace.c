@@ -0,0 +1,217 @@
+/***************************************
+ * file name:   trace.c
+ * description: implement per-thread span buffers & trace dump
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ ***************************************/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "comm.h"
+#include "trace.h"
+
+typedef struct {
+	const char	*name;
+	uint64_t	beginNs;
+	uint64_t	endNs;		// 0 for a thread name
+	int			tid;
+} TraceEvent;
+
+/**
+ * Only the owner thread appends, count is published with release so
+ * dumpTrace reads whole events. Buffers are never freed, a thread
+ * takes over the buffer of an exited one.
+ */
+typedef struct TraceBuffer {
+	struct TraceBuffer	*next;		// list of all buffers
+	int					owned;		// a live thread records into it
+	uint32_t			count;		// events recorded
+	uint32_t			dropped;	// events dropped while full
+	TraceEvent			events[TRACE_BUFFER_EVENTS];
+} TraceBuffer;
+
+int gTraceEnabled = 0;
+
+static TraceBuffer *sBuffers = NULL;
+static int sBufferCount = 0;
+static uint32_t sDropped = 0;		// events of threads without buffer
+static uint64_t sOriginNs = 0;
+static __thread TraceBuffer *sThreadBuffer = NULL;
+static __thread int sThreadId = 0;
+static pthread_key_t sExitKey;
+static pthread_once_t sKeyOnce = PTHREAD_ONCE_INIT;
+
+static void releaseBuffer (void *arg) {
+	__atomic_store_n (&((TraceBuffer *)arg)->owned, 0, __ATOMIC_RELEASE);
+}
+
+static void createExitKey (void) {
+	pthread_key_create (&sExitKey, releaseBuffer);
+}
+
+static TraceBuffer* acquireBuffer (void) {
+	// a full buffer is of no use to a new thread
+	TraceBuffer *buf = __atomic_load_n (&sBuffers, __ATOMIC_ACQUIRE);
+	for (; NULL != buf; buf = buf->next) {
+		int expected = 0;
+		if (__atomic_load_n (&buf->count, __ATOMIC_RELAXED) < TRACE_BUFFER_EVENTS &&
+				__atomic_compare_exchange_n (&buf->owned, &expected, 1,
+					0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			break;
+		}
+	}
+
+	if (NULL == buf) {
+		if (__atomic_fetch_add (&sBufferCount, 1, __ATOMIC_RELAXED) >= TRACE_MAX_BUFFERS) {
+			__atomic_fetch_sub (&sBufferCount, 1, __ATOMIC_RELAXED);
+			return NULL;
+		}
+		buf = (TraceBuffer *)calloc (1, sizeof(TraceBuffer));
+		if (NULL == buf) {
+			__atomic_fetch_sub (&sBufferCount, 1, __ATOMIC_RELAXED);
+			return NULL;
+		}
+		buf->owned = 1;
+		buf->next = __atomic_load_n (&sBuffers, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n (&sBuffers, &buf->next, buf,
+					1, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+		}
+	}
+
+	// give the buffer back at thread exit
+	pthread_once (&sKeyOnce, createExitKey);
+	pthread_setspecific (sExitKey, buf);
+	return buf;
+}
+
+static void appendEvent (const char *name, uint64_t beginNs, uint64_t endNs) {
+	if (NULL == sThreadBuffer) {
+		sThreadBuffer = acquireBuffer ();
+		if (NULL == sThreadBuffer) {
+			__atomic_fetch_add (&sDropped, 1, __ATOMIC_RELAXED);
+			return;
+		}
+		sThreadId = (int)syscall (__NR_gettid);
+	}
+
+	TraceBuffer *buf = sThreadBuffer;
+	uint32_t n = __atomic_load_n (&buf->count, __ATOMIC_RELAXED);
+	if (n >= TRACE_BUFFER_EVENTS) {
+		__atomic_fetch_add (&buf->dropped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	TraceEvent *e = &buf->events[n];
+	e->name = name;
+	e->beginNs = beginNs;
+	e->endNs = endNs;
+	e->tid = sThreadId;
+	__atomic_store_n (&buf->count, n + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Clear recorded spans and start tracing
+ */
+void startTrace (void)
+{
+	__atomic_store_n (&gTraceEnabled, 0, __ATOMIC_RELAXED);
+	__atomic_store_n (&sDropped, 0, __ATOMIC_RELAXED);
+	TraceBuffer *buf = __atomic_load_n (&sBuffers, __ATOMIC_ACQUIRE);
+	for (; NULL != buf; buf = buf->next) {
+		__atomic_store_n (&buf->count, 0, __ATOMIC_RELAXED);
+		__atomic_store_n (&buf->dropped, 0, __ATOMIC_RELAXED);
+	}
+	sOriginNs = getNanoTime ();
+	__atomic_store_n (&gTraceEnabled, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Stop tracing
+ */
+void stopTrace (void)
+{
+	__atomic_store_n (&gTraceEnabled, 0, __ATOMIC_RELAXED);
+}
+
+/**
+ * Record a span of the calling thread
+ */
+void traceSpan (const char *name, uint64_t beginNs, uint64_t endNs)
+{
+	if (NULL == name) {
+		return;
+	}
+	// a span never ends at 0, that marks thread names
+	appendEvent (name, beginNs, endNs > beginNs ? endNs : beginNs + 1);
+}
+
+/**
+ * Name the calling thread in trace
+ */
+void setTraceThreadName (const char *name)
+{
+	if (NULL == name || !__atomic_load_n (&gTraceEnabled, __ATOMIC_RELAXED)) {
+		return;
+	}
+	appendEvent (name, 0, 0);
+}
+
+static double toMicros (uint64_t ns) {
+	return (double)(int64_t)(ns - sOriginNs) / 1000.0;
+}
+
+/**
+ * Write recorded spans as Chrome trace-event JSON
+ * Return:
+ *		count of spans written
+ *		-1 ERROR
+ */
+int dumpTrace (const char *path)
+{
+	if (NULL == path) {
+		return -1;
+	}
+	FILE *fp = fopen (path, "w");
+	if (NULL == fp) {
+		LogE ("Failed open %s\n", path);
+		return -1;
+	}
+
+	int pid = (int)getpid ();
+	int written = 0;
+	int first = 1;
+	unsigned long long dropped = __atomic_load_n (&sDropped, __ATOMIC_RELAXED);
+	fprintf (fp, "{\"traceEvents\":[");
+	TraceBuffer *buf = __atomic_load_n (&sBuffers, __ATOMIC_ACQUIRE);
+	for (; NULL != buf; buf = buf->next) {
+		uint32_t n = __atomic_load_n (&buf->count, __ATOMIC_ACQUIRE);
+		dropped += __atomic_load_n (&buf->dropped, __ATOMIC_RELAXED);
+		uint32_t i;
+		for (i = 0; i < n; ++i) {
+			const TraceEvent *e = &buf->events[i];
+			if (0 == e->endNs) {
+				fprintf (fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+						"\"args\":{\"name\":\"%s\"}}",
+						first ? "" : ",", pid, e->tid, e->name);
+			} else {
+				fprintf (fp, "%s\n{\"name\":\"%s\",\"cat\":\"imgsdk\",\"ph\":\"X\","
+						"\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+						first ? "" : ",", e->name, toMicros (e->beginNs),
+						(e->endNs - e->beginNs) / 1000.0, pid, e->tid);
+				++written;
+			}
+			first = 0;
+		}
+	}
+	fprintf (fp, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%llu}}\n", dropped);
+
+	int failed = ferror (fp);
+	if (fclose (fp) != 0 || failed) {
+		LogE ("Failed write %s\n", path);
+		return -1;
+	}
+	return written;
+}
@@ -0,0 +1,84 @@
+/************************************
+ * file name:   trace.h
+ * description: spans of sdk stages in Chrome trace-event JSON
+ * author:      kari.zhang
+ * date:        2026-10-19
+ *
+ * Every thread records its spans into a buffer of its own, so a span
+ * is two clock reads and a store. Buffers of exited threads are taken
+ * over by new threads. While tracing is stopped a span is one relaxed
+ * load, define _NO_TRACE_ to compile spans out. Open dumpTrace output
+ * in chrome://tracing or ui.perfetto.dev.
+ *
+ ***********************************/
+
+#ifndef __TRACE__H__
+#define __TRACE__H__
+
+#include <stdint.h>
+#include "stats.h"
+
+// spans kept per thread buffer, later spans are dropped
+#define TRACE_BUFFER_EVENTS 4096
+
+// buffers of all threads, threads beyond them drop their spans
+#define TRACE_MAX_BUFFERS 64
+
+/**
+ * Nonzero while tracing, set by startTrace & stopTrace
+ */
+extern int gTraceEnabled;
+
+/**
+ * Span of the code between TRACE_BEGIN & TRACE_END, e.g.
+ *		uint64_t trace_ns = TRACE_BEGIN ();
+ *		...
+ *		TRACE_END ("decode", trace_ns);
+ * name must be a string literal, it's kept until dumpTrace
+ */
+#ifdef _NO_TRACE_
+#define TRACE_BEGIN() ((uint64_t)0)
+#define TRACE_END(name, begin) ((void)(begin))
+#else
+#define TRACE_BEGIN() \
+	(__atomic_load_n (&gTraceEnabled, __ATOMIC_RELAXED) ? getNanoTime () : (uint64_t)0)
+#define TRACE_END(name, begin) do { \
+		if (0 != (begin)) { \
+			traceSpan ((name), (begin), getNanoTime ()); \
+		} \
+	} while (0)
+#endif
+
+/**
+ * Clear recorded spans and start tracing. Clearing isn't thread safe
+ * against recording, start while idle.
+ */
+void startTrace (void);
+
+/**
+ * Stop tracing, recorded spans are kept for dumpTrace
+ */
+void stopTrace (void);
+
+/**
+ * Record a span of the calling thread, use TRACE_END instead
+ */
+void traceSpan (const char *name, uint64_t beginNs, uint64_t endNs);
+
+/**
+ * Name the calling thread in trace, name must be a string literal
+ */
+void setTraceThreadName (const char *name);
+
+/**
+ * Write recorded spans as Chrome trace-event JSON:
+ *	{"traceEvents":[{"name":"decode","ph":"X","ts":12.345,"dur":6.789,
+ *		"pid":1,"tid":2},..],"otherData":{"dropped":0}}
+ * ts & dur are in us from startTrace
+ * Return:
+ *		count of spans written
+ *		-1 ERROR
+ */
+int dumpTrace (const char *path);
+
+#endif
@@ -11,8 +11,8 @@
 
 #include "comm.h"
 
-#define LOG_ENTRY Log("++++ %s ++++\n", __func__);
-#define LOG_EXIT Log("---- %s ----\n", __func__);
+#define LOG_ENTRY LogD("++++ %s ++++\n", __func__);
+#define LOG_EXIT LogD("---- %s ----\n", __func__);
 
 /*
  * Get file postfix name 
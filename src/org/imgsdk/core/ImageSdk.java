@@ -60,4 +60,28 @@ public final class ImageSdk {
     public void executeCmd(OnEditCompleteListener listener, Object param) {
         nativeImageSdk.executeCmd(mPointer, listener, param);
     }
+
+    /**
+     * Process images in batch, the SDK must be created without surface.
+     * cmds may be null to keep the last effect command.
+     * Returns the result of every image, 0 OK and -1 ERROR.
+     */
+    public int[] executeBatch(String[] inputs, String[] outputs, String[] cmds) {
+        return nativeImageSdk.executeBatch(mPointer, inputs, outputs, cmds);
+    }
+
+    /**
+     * Timers & counters of the stages as JSON, e.g.
+     * {"stages":{"decode":{"count":1,"totalNs":..},..},"counters":{"images":1,..}}
+     */
+    public String getStats() {
+        return nativeImageSdk.getStats(mPointer);
+    }
+
+    /**
+     * Clear timers & counters
+     */
+    public void resetStats() {
+        nativeImageSdk.resetStats(mPointer);
+    }
 }
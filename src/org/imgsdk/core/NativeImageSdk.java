@@ -11,4 +11,7 @@ public final class NativeImageSdk {
     public native void setOutputPath(long pointer, String path);
     public native void setEffectCmd(long pointer, String cmd);
     public native void executeCmd(long pointer, OnEditCompleteListener callback, Object param);
+    public native int[] executeBatch(long pointer, String[] inputs, String[] outputs, String[] cmds);
+    public native String getStats(long pointer);
+    public native void resetStats(long pointer);
 }
\ No newline at end of file